@@ -4,6 +4,7 @@ DEFINE_string(mount_templat, "", "mount templat");
 DEFINE_string(mount_cgroups, "", "mount templat");
 
 DEFINE_string(cgroup_root_path, "/cgroups", "cgroup root path");
+DEFINE_string(cgroup_version, "auto", "cgroup hierarchy: v1, v2, or auto to probe the filesystem at cgroup_root_path");
 DEFINE_string(galaxy_root_path, "", "galaxy work path");
 
 DEFINE_string(nexus_root_path, "", "root path on nexus");
@@ -24,11 +25,43 @@ DEFINE_int64(memory_resource, 0L, "max memory(unit:byte) galaxy can use");
 
 DEFINE_string(cmd_line, "", "just for debu");
 DEFINE_int64(gc_delay_time, 43200, "");
+DEFINE_int32(gc_threads_per_device, 2, "threads removing gc dirs on one device");
+DEFINE_int64(gc_inodes_per_second, 20000, "max inodes removed per second by gc on one device, 0 means no limit");
+DEFINE_int64(gc_bytes_per_second, 0L, "max bytes freed per second by gc on one device, 0 means no limit");
+DEFINE_int32(gc_io_class, 2, "io priority class of gc: 1 realtime, 2 best effort, 3 idle, 0 keeps the one of agent");
+DEFINE_int32(gc_io_level, 7, "io priority level of gc in its class, 0 is the highest and 7 the lowest");
 
 DEFINE_int64(volum_collect_cycle, 18000, "");
-DEFINE_int64(cgroup_collect_cycle, 5000, "");
+DEFINE_int64(volum_fast_collect_cycle, 10, "collect cycle of volums with O(1) usage backend, unit second");
+DEFINE_string(volum_usage_backend, "kTmpfs:statfs,kDisk:quota,kSsd:quota", "usage backend per medium: statfs, quota or walk, exclusive volums always use statfs");
+DEFINE_int32(volum_walk_threads, 4, "threads walking one volum");
+DEFINE_int64(volum_walk_rate, 20000, "max entries stated per second by all volum walks, 0 means no limit");
+DEFINE_int32(volum_project_id_base, 100000, "project ids of volum quota start from here");
+DEFINE_int64(cgroup_collect_cycle, 1, "cgroup collect cycle, unit second");
+DEFINE_int32(collector_tick_interval, 100, "tick of collector engine, unit ms");
+DEFINE_int32(collector_threads, 0, "threads of fast collectors, 0 means one per cpu core");
+DEFINE_int32(slow_collector_threads, 10, "threads of slow collectors");
+DEFINE_int32(construct_threads, 8, "threads constructing containers");
+DEFINE_int32(construct_per_disk, 2, "max containers constructed on one disk at the same time");
+DEFINE_int32(construct_queue_size, 256, "max containers waiting for constructing, more are rejected");
+DEFINE_int32(construct_step_concurrency, 8, "max steps of one container constructed or destroyed at the same time");
+DEFINE_int32(slot_pool_min_size, 2, "min slots prepared for containers");
+DEFINE_int32(slot_pool_max_size, 16, "max slots prepared for containers, 0 disables slots");
+DEFINE_int32(slot_pool_window, 60, "slots prepared are as many as containers created in the last seconds");
+DEFINE_int32(reload_threads, 16, "threads reloading containers on agent restart");
+DEFINE_int32(report_cache_interval, 1000, "container infos reported are cached for milliseconds if no container is created or released");
+DEFINE_string(package_cache_path, "", "dir of packages cached for containers, package_cache under root path if empty, workspaces on file systems supporting reflink share blocks with it");
+DEFINE_int64(package_cache_capacity, 0, "max size of packages cached, unit MB, 0 disables the cache");
+DEFINE_int32(package_cache_threads, 4, "threads downloading packages to cache");
+DEFINE_int32(package_cache_download_timeout, 300, "timeout of downloading a package to cache, unit second");
+DEFINE_int32(metrix_history_window, 1800, "seconds of per second container metrix kept for GetMetrics");
 DEFINE_string(v2_prefix, "/home/baidulinux/V2", "v2 prefix");
 
 DEFINE_int32(assign_level, 2, "assign level: {0, 1, 2, 3}");
 DEFINE_int32(check_assign_interval, 5000, "check assign interval");
+DEFINE_string(memory_psi_path, "/proc/pressure/memory", "psi file watched if memory.pressure_level is not available");
+DEFINE_int64(memory_psi_some_threshold, 150000, "memory pressure is medium if some tasks stall longer in 1s, unit us");
+DEFINE_int64(memory_psi_full_threshold, 50000, "memory pressure is critical if all tasks stall longer in 1s, unit us");
+DEFINE_int32(memory_reclaim_cooldown, 2000, "ignore pressure events after a reclaim for a while, unit ms");
+DEFINE_int64(memory_reclaim_reserve, 0L, "on critical pressure evict until so much memory is available on host, unit byte");
 
@@ -8,6 +8,7 @@
 #include "protocol/resman.pb.h"
 #include "cgroup/subsystem_factory.h"
 #include "collector/collector_engine.h"
+#include "collector/host_sampler.h"
 #include "util/path_tree.h"
 
 #include <string>
@@ -24,6 +25,9 @@ DECLARE_string(agent_ip);
 DECLARE_string(agent_port);
 DECLARE_int32(keepalive_interval);
 DECLARE_string(galaxy_root_path);
+DECLARE_string(package_cache_path);
+DECLARE_int64(package_cache_capacity);
+DECLARE_int32(package_cache_threads);
 
 namespace baidu {
 namespace galaxy {
@@ -89,6 +93,21 @@ void AgentImpl::Setup()
     health_checker_->LoadCgroup(baidu::galaxy::cgroup::SubsystemFactory::GetInstance());
     health_checker_->Setup();
 
+    if (FLAGS_package_cache_capacity > 0) {
+        std::string path = FLAGS_package_cache_path.empty()
+            ? baidu::galaxy::path::PackageCacheDir() : FLAGS_package_cache_path;
+        package_cache_.reset(new baidu::galaxy::package::PackageCache(path,
+                FLAGS_package_cache_capacity * 1024 * 1024,
+                FLAGS_package_cache_threads));
+        baidu::galaxy::util::ErrorCode ec = package_cache_->Setup();
+
+        // packages are downloaded by appworkers themselves
+        if (0 != ec.Code()) {
+            LOG(WARNING) << "set up package cache failed: " << ec.Message();
+            package_cache_.reset();
+        }
+    }
+
     if (!rm_watcher_->Init(boost::bind(&AgentImpl::HandleMasterChange, this, _1))) {
         LOG(FATAL) << "init res manager watch failed, agent will exit ...";
         exit(1);
@@ -96,6 +115,10 @@ void AgentImpl::Setup()
     LOG(INFO) << "init resource manager watcher successfully";
 
 
+    boost::shared_ptr<baidu::galaxy::collector::HostSampler> sampler
+        = baidu::galaxy::collector::HostSampler::GetInstance();
+    sampler->Enable(true);
+    baidu::galaxy::collector::CollectorEngine::GetInstance()->Register(sampler, true);
     baidu::galaxy::collector::CollectorEngine::GetInstance()->Setup();
 
     heartbeat_pool_.AddTask(boost::bind(&AgentImpl::KeepAlive, this, FLAGS_keepalive_interval));
@@ -180,51 +203,36 @@ void AgentImpl::Query(::google::protobuf::RpcController* controller,
         ::google::protobuf::Closure* done)
 {
 
-    std::cerr << "query " << std::endl;
-
     baidu::galaxy::proto::AgentInfo* ai = response->mutable_agent_info();
     ai->set_unhealthy(!health_checker_->Healthy());
     ai->set_start_time(start_time_);
     ai->set_version(version_);
+    baidu::galaxy::collector::HostSampler::GetInstance()->Statistics(ai->mutable_host_metrix());
+    baidu::galaxy::collector::CollectorEngine::GetInstance()->GetStatistics(ai->mutable_collector_metrix());
+    cm_->ConstructStatistics(ai->mutable_construct_metrix());
+    cm_->GcStatistics(ai->mutable_gc_metrix());
+    bool reloading = false;
+    int64_t reload_time = 0L;
+    cm_->ReloadStatistics(reloading, reload_time);
+    ai->set_reloading(reloading);
+    ai->set_reload_time(reload_time);
+
+    if (NULL != package_cache_.get()) {
+        package_cache_->Statistics(ai->mutable_package_cache_metrix());
+    }
 
     bool full_report = false;
     if (request->has_full_report() && request->full_report()) {
         full_report = true;
     }
-    std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> > cis;
-    cm_->ListContainers(cis, full_report);
-
-    for (size_t i = 0; i < cis.size(); i++) {
-        ai->add_container_info()->CopyFrom(*(cis[i]));
-    }
-
-    int64_t cpu_used = 0L;
-    int64_t memory_used = 0L;
-    int64_t memory_volum_used = 0L;
-    // calculate used resource
-
-    std::map<std::string, int64_t> volum_used;
-    for (size_t i = 0; i < cis.size(); i++) {
-        if (cis[i]->container_desc().priority() != baidu::galaxy::proto::kJobBestEffort) {
-            cpu_used += cis[i]->cpu_used();
-            memory_used += cis[i]->memory_used();
-        }
-
-        for (int j = 0; j < cis[i]->volum_used_size(); j++) {
-            if (cis[i]->volum_used(j).medium() == baidu::galaxy::proto::kTmpfs) {
-                memory_volum_used += cis[i]->volum_used(j).used_size();
-            }
-
-            std::string dp = cis[i]->volum_used(j).device_path();
-            std::map<std::string, int64_t> ::iterator iter = volum_used.find(dp);
-            if (iter == volum_used.end()) {
-                volum_used[dp] = cis[i]->volum_used(j).used_size();
-            } else {
-                iter->second += cis[i]->volum_used(j).used_size();
-            }
-
-        }
-    }
+    // infos are copied as serialized, built again only for containers changed
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> report = cm_->ContainerReport();
+    baidu::galaxy::container::ReportCache::Fill(*report, full_report, ai);
+    const baidu::galaxy::container::ReportCache::Usage& usage = report->usage;
+    int64_t cpu_used = usage.cpu_used;
+    int64_t memory_used = usage.memory_used;
+    int64_t memory_volum_used = usage.memory_volum_used;
+    const std::map<std::string, int64_t>& volum_used = usage.volum_used;
 
     baidu::galaxy::proto::Resource* cpu_resource = ai->mutable_cpu_resource();
     cpu_resource->CopyFrom(*(rm_->GetCpuResource()));
@@ -254,11 +262,72 @@ void AgentImpl::Query(::google::protobuf::RpcController* controller,
 
     baidu::galaxy::proto::ErrorCode* ec = response->mutable_code();
     ec->set_status(baidu::galaxy::proto::kOk);
-    std::cerr << response->DebugString() << std::endl;
-    VLOG(10) << "query:" << response->DebugString();
+    VLOG(10) << "query:" << baidu::galaxy::container::ReportCache::DebugString(*response);
     //std::cout << "query:" << response->DebugString() << std::endl;
     done->Run();
 }
 
+void AgentImpl::GetMetrics(::google::protobuf::RpcController* controller,
+        const ::baidu::galaxy::proto::GetMetricsRequest* request,
+        ::baidu::galaxy::proto::GetMetricsResponse* response,
+        ::google::protobuf::Closure* done)
+{
+    cm_->GetMetrics(*request, response);
+    baidu::galaxy::proto::ErrorCode* ec = response->mutable_code();
+    ec->set_status(baidu::galaxy::proto::kOk);
+    VLOG(10) << "get metrics of " << response->histories_size() << " containers";
+    done->Run();
+}
+
+void AgentImpl::FetchPackage(::google::protobuf::RpcController* controller,
+        const ::baidu::galaxy::proto::FetchPackageRequest* request,
+        ::baidu::galaxy::proto::FetchPackageResponse* response,
+        ::google::protobuf::Closure* done)
+{
+    baidu::galaxy::container::ContainerId id(request->container_group_id(), request->id());
+    const std::string& file = request->file();
+    std::string workspace;
+    baidu::galaxy::util::ErrorCode err = ERRORCODE_OK;
+
+    if (NULL == package_cache_.get()) {
+        err = ERRORCODE(-1, "package cache is disabled");
+    } else if (file.empty() || file == "." || file == ".." || std::string::npos != file.find('/')) {
+        err = ERRORCODE(-1, "bad file name");
+    } else {
+        err = cm_->WorkspacePath(id, request->token(), workspace);
+    }
+
+    if (0 != err.Code()) {
+        FetchPackageCallback(response, done, err, false);
+        return;
+    }
+
+    VLOG(10) << "fetch package " << request->package().source_path() << " for " << id.CompactId();
+    // done runs once the package is delivered, it may be downloaded first
+    package_cache_->Fetch(request->package().source_path(),
+            request->package().version(),
+            workspace + "/" + file,
+            boost::bind(&AgentImpl::FetchPackageCallback, response, done, _1, _2));
+}
+
+void AgentImpl::FetchPackageCallback(::baidu::galaxy::proto::FetchPackageResponse* response,
+        ::google::protobuf::Closure* done,
+        const baidu::galaxy::util::ErrorCode& ec,
+        bool hit)
+{
+    baidu::galaxy::proto::ErrorCode* code = response->mutable_code();
+
+    if (0 != ec.Code()) {
+        code->set_status(baidu::galaxy::proto::kError);
+        code->set_reason(ec.ShortMessage());
+    } else {
+        code->set_status(baidu::galaxy::proto::kOk);
+        code->set_reason("sucess");
+    }
+
+    response->set_hit(hit);
+    done->Run();
+}
+
 }
 }
@@ -17,6 +17,7 @@
 #include "container/container.h"
 #include "container/container_manager.h"
 #include "health/healthy_checker.h"
+#include "package/package_cache.h"
 
 namespace baidu {
 namespace galaxy {
@@ -53,9 +54,23 @@ public:
             ::baidu::galaxy::proto::QueryResponse* response,
             ::google::protobuf::Closure* done);
 
+    void GetMetrics(::google::protobuf::RpcController* controller,
+            const ::baidu::galaxy::proto::GetMetricsRequest* request,
+            ::baidu::galaxy::proto::GetMetricsResponse* response,
+            ::google::protobuf::Closure* done);
+
+    void FetchPackage(::google::protobuf::RpcController* controller,
+            const ::baidu::galaxy::proto::FetchPackageRequest* request,
+            ::baidu::galaxy::proto::FetchPackageResponse* response,
+            ::google::protobuf::Closure* done);
+
 private:
     void KeepAlive(int internal_ms);
     void HandleMasterChange(const std::string& new_master_endpoint);
+    static void FetchPackageCallback(::baidu::galaxy::proto::FetchPackageResponse* response,
+            ::google::protobuf::Closure* done,
+            const baidu::galaxy::util::ErrorCode& ec,
+            bool hit);
 
 private:
     baidu::common::ThreadPool heartbeat_pool_;
@@ -70,6 +85,7 @@ private:
     boost::shared_ptr<baidu::galaxy::resource::ResourceManager> rm_;
     boost::shared_ptr<baidu::galaxy::container::ContainerManager> cm_;
     boost::shared_ptr<baidu::galaxy::health::HealthChecker> health_checker_;
+    boost::shared_ptr<baidu::galaxy::package::PackageCache> package_cache_;
     int64_t start_time_;
     std::string version_;
 
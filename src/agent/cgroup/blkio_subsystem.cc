@@ -11,9 +11,12 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <linux/kdev_t.h>
 
+#include <fstream>
+
 namespace baidu {
 namespace galaxy {
 namespace cgroup {
@@ -41,14 +44,66 @@ baidu::galaxy::util::ErrorCode BlkioSubsystem::Construct() {
                 ec.message().c_str());
     }
 
-    // tcp_throt.recv_bps_quota & tcp_throt.recv_bps_limit
-    boost::filesystem::path blkio_weight = path;
-    blkio_weight.append("blkio.weight");
-    baidu::galaxy::util::ErrorCode err = baidu::galaxy::cgroup::Attach(blkio_weight.string(),
-                                         (int64_t)cgroup_->blkio().weight());
+    // 0 means the default weight of the kernel
+    if (cgroup_->blkio().weight() > 0) {
+        boost::filesystem::path blkio_weight = path;
+        blkio_weight.append("blkio.weight");
+        baidu::galaxy::util::ErrorCode err = baidu::galaxy::cgroup::Attach(blkio_weight.string(),
+                                             (int64_t)cgroup_->blkio().weight());
+
+        if (0 != err.Code()) {
+            return ERRORCODE(-1, "attch weight failed: %s",
+                    err.Message().c_str());
+        }
+    }
+
+    for (int i = 0; i < cgroup_->blkio().throttles_size(); i++) {
+        const baidu::galaxy::proto::BlkioThrottle& throttle = cgroup_->blkio().throttles(i);
+
+        if (throttle.device().empty()) {
+            return ERRORCODE(-1, "device of %s is not resolved", throttle.path().c_str());
+        }
+
+        baidu::galaxy::util::ErrorCode err = Write("blkio.throttle.read_bps_device", throttle.device(), throttle.read_bps());
+
+        if (0 == err.Code()) {
+            err = Write("blkio.throttle.write_bps_device", throttle.device(), throttle.write_bps());
+        }
+
+        if (0 == err.Code()) {
+            err = Write("blkio.throttle.read_iops_device", throttle.device(), throttle.read_iops());
+        }
+
+        if (0 == err.Code()) {
+            err = Write("blkio.throttle.write_iops_device", throttle.device(), throttle.write_iops());
+        }
+
+        if (0 != err.Code()) {
+            return err;
+        }
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode BlkioSubsystem::Write(const std::string& file,
+        const std::string& device,
+        int64_t value) {
+    if (value <= 0) {
+        return ERRORCODE_OK;
+    }
+
+    // <major>:<minor> <value>
+    char buf[128];
+    snprintf(buf, sizeof buf, "%s %lld", device.c_str(), (long long)value);
+    boost::filesystem::path path(this->Path());
+    path.append(file);
+    baidu::galaxy::util::ErrorCode err = baidu::galaxy::cgroup::Attach(path.string(), buf, false);
 
     if (0 != err.Code()) {
-        return ERRORCODE(-1, "attch weight failed: %s",
+        return ERRORCODE(-1, "attach %s to %s failed: %s",
+                buf,
+                file.c_str(),
                 err.Message().c_str());
     }
 
@@ -68,7 +123,7 @@ baidu::galaxy::util::ErrorCode BlkioSubsystem::GetDeviceNum(const std::string& p
     struct stat st;
 
     if (0 != ::stat(path.c_str(), &st)) {
-        return PERRORCODE(-1, errno, "stat faile failed");
+        return PERRORCODE(-1, errno, "stat file failed");
     }
 
     major = MAJOR(st.st_dev);
@@ -76,6 +131,40 @@ baidu::galaxy::util::ErrorCode BlkioSubsystem::GetDeviceNum(const std::string& p
     return ERRORCODE_OK;
 }
 
+baidu::galaxy::util::ErrorCode BlkioSubsystem::GetDevice(const std::string& path, std::string& device) {
+    int major = 0;
+    int minor = 0;
+    baidu::galaxy::util::ErrorCode ec = GetDeviceNum(path, major, minor);
+
+    if (0 != ec.Code()) {
+        return ERRORCODE(-1, "%s: %s", path.c_str(), ec.Message().c_str());
+    }
+
+    // tmpfs, overlay and nfs have anonymous devices
+    if (0 == major) {
+        return ERRORCODE(-1, "%s is not on a block device", path.c_str());
+    }
+
+    char buf[64];
+    snprintf(buf, sizeof buf, "%d:%d", major, minor);
+    device = buf;
+    // /sys/dev/block/8:1 -> ../../devices/.../sda/sda1
+    const std::string sys = std::string("/sys/dev/block/") + buf;
+
+    if (0 == ::access((sys + "/partition").c_str(), F_OK)) {
+        std::ifstream in((sys + "/../dev").c_str());
+        std::string disk;
+
+        if (!std::getline(in, disk) || disk.empty()) {
+            return ERRORCODE(-1, "failed in reading disk of partition %s", buf);
+        }
+
+        device = disk;
+    }
+
+    return ERRORCODE_OK;
+}
+
 }
 }
 }
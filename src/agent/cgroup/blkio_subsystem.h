@@ -18,8 +18,13 @@ public:
     boost::shared_ptr<Subsystem> Clone();
     baidu::galaxy::util::ErrorCode Collect(std::map<std::string, AutoValue>& stat);
 
+    // major:minor of the disk holding path, throttling does not work on
+    // partitions, so a partition is mapped to the disk it belongs to
+    static baidu::galaxy::util::ErrorCode GetDevice(const std::string& path, std::string& device);
+
 private:
-    baidu::galaxy::util::ErrorCode GetDeviceNum(const std::string& path, int& major, int& minor);
+    static baidu::galaxy::util::ErrorCode GetDeviceNum(const std::string& path, int& major, int& minor);
+    baidu::galaxy::util::ErrorCode Write(const std::string& file, const std::string& device, int64_t value);
 };
 }
 }
@@ -12,9 +12,12 @@
 #include "collector/collector_engine.h"
 #include "cgroup_collector.h"
 #include <glog/logging.h>
+#include <gflags/gflags.h>
 
 #include <unistd.h>
 
+DECLARE_int64(cgroup_collect_cycle);
+
 namespace baidu {
 namespace galaxy {
 namespace cgroup {
@@ -53,7 +56,8 @@ baidu::galaxy::util::ErrorCode Cgroup::Construct() {
         ss->SetContainerId(container_id_);
         ss->SetCgroup(cgroup_);
 
-        if (subsystems[i] == "freezer") {
+        // unified freezes by cgroup.freeze, there is nothing else in v2
+        if (subsystems[i] == "freezer" || subsystems[i] == "unified") {
             freezer_ = boost::dynamic_pointer_cast<FreezerSubsystem>(ss);
             assert(NULL != freezer_.get());
         } else {
@@ -61,6 +65,10 @@ baidu::galaxy::util::ErrorCode Cgroup::Construct() {
                 cpu_acct_ = ss;
             } else if ("memory" == subsystems[i]) {
                 memory_ = ss;
+            } else if ("cpu" == subsystems[i]) {
+                cpu_ = ss;
+            } else if ("blkio" == subsystems[i]) {
+                blkio_ = ss;
             }
 
             subsystem_.push_back(ss);
@@ -99,9 +107,23 @@ baidu::galaxy::util::ErrorCode Cgroup::Construct() {
     }
 
     collector_.reset(new CgroupCollector());
-    collector_->SetCpuacctPath(cpu_acct_->Path() + "/cpuacct.stat");
-    collector_->SetMemoryPath(memory_->Path() + "/memory.usage_in_bytes");
-    collector_->SetCycle(5);
+
+    if (factory_->Unified()) {
+        collector_->SetUnifiedPath(freezer_->Path());
+    } else {
+        collector_->SetCpuacctPath(cpu_acct_->Path());
+        collector_->SetMemoryPath(memory_->Path());
+
+        if (NULL != cpu_.get()) {
+            collector_->SetCpuPath(cpu_->Path());
+        }
+
+        if (NULL != blkio_.get()) {
+            collector_->SetBlkioPath(blkio_->Path());
+        }
+    }
+
+    collector_->SetCycle(FLAGS_cgroup_collect_cycle);
     collector_->SetName(container_id_ + "_cgroup");
     collector_->Enable(true);
     baidu::galaxy::collector::CollectorEngine::GetInstance()->Register(collector_, true);
@@ -248,6 +270,10 @@ boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> Cgroup::Statistics() {
     return collector_->Statistics();
 }
 
+int64_t Cgroup::SampleTime() {
+    return collector_->SampleTime();
+}
+
 }
 }
 }
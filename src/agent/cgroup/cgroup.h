@@ -40,11 +40,14 @@ public:
 
     baidu::galaxy::util::ErrorCode Collect(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
     boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> Statistics(); // call by container
+    int64_t SampleTime(); // of Statistics(), unit us
 private:
     std::vector<boost::shared_ptr<Subsystem> > subsystem_;
     boost::shared_ptr<FreezerSubsystem> freezer_;
     boost::shared_ptr<Subsystem> cpu_acct_;
     boost::shared_ptr<Subsystem> memory_;
+    boost::shared_ptr<Subsystem> cpu_;
+    boost::shared_ptr<Subsystem> blkio_;
 
     std::string container_id_;
     boost::shared_ptr<baidu::galaxy::proto::Cgroup> cgroup_;
@@ -4,22 +4,31 @@
 
 #include "cgroup_collector.h"
 #include "protocol/agent.pb.h"
-#include "util/input_stream_file.h"
+#include "stat_reader.h"
 #include "cgroup.h"
+#include "collector/host_sampler.h"
 #include "timer.h"
-#include "boost/algorithm/string/predicate.hpp"
 #include <assert.h>
+#include <string.h>
 
 namespace baidu {
 namespace galaxy {
 namespace cgroup {
 
 const static long CPU_CORES = sysconf(_SC_NPROCESSORS_CONF);
+const static long CLOCK_TICKS = sysconf(_SC_CLK_TCK);
 CgroupCollector::CgroupCollector() :
     enabled_(false),
     cycle_(-1),
     metrix_(new baidu::galaxy::proto::CgroupMetrix()),
-    last_time_(0L) {
+    last_time_(0L),
+    last_container_cpu_time_(-1L),
+    last_system_cpu_time_(-1L),
+    last_io_time_(-1L),
+    unified_(false) {
+    for (int i = 0; i < 4; i++) {
+        last_io_[i] = 0L;
+    }
 }
 
 CgroupCollector::~CgroupCollector() {
@@ -27,50 +36,51 @@ CgroupCollector::~CgroupCollector() {
 }
 
 baidu::galaxy::util::ErrorCode CgroupCollector::Collect() {
-    boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix1(new baidu::galaxy::proto::CgroupMetrix);
-    int64_t t1 = 0L;
-    baidu::galaxy::util::ErrorCode ec = Collect(metrix1);
+    boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix(new baidu::galaxy::proto::CgroupMetrix);
+    baidu::galaxy::util::ErrorCode ec = Collect(metrix);
 
-    if (ec.Code() == 0) {
-        t1 = baidu::common::timer::get_micros();
-    } else {
+    if (ec.Code() != 0) {
         return ERRORCODE(-1, "%s", ec.Message().c_str());
     }
 
-    ::usleep(1000000);
-    boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix2(new baidu::galaxy::proto::CgroupMetrix);
-    int64_t t2 = 0L;
-    ec = Collect(metrix2);
+    // cpu rate is computed against the sample of last cycle, so the worker
+    // never sleeps between two samples
+    if (last_container_cpu_time_ >= 0 && last_system_cpu_time_ >= 0) {
+        double delta1 = (double)(metrix->container_cpu_time() - last_container_cpu_time_);
+        double delta2 = (double)(metrix->system_cpu_time() - last_system_cpu_time_);
 
-    if (ec.Code() == 0) {
-        t2 = baidu::common::timer::get_micros();
-    } else {
-        return ERRORCODE(-1, "%s", ec.Message().c_str());
+        if (delta2 > 0.01 && delta1 >= 0.0) {
+            int64_t mcore = (int64_t)(1000.0 * delta1 / delta2 * CPU_CORES);
+            metrix->set_cpu_used_in_millicore(mcore);
+        }
     }
 
-    // cal cpu
+    last_container_cpu_time_ = metrix->container_cpu_time();
+    last_system_cpu_time_ = metrix->system_cpu_time();
+    const int64_t now = baidu::common::timer::get_micros();
+    IoRate(metrix, now);
     boost::mutex::scoped_lock lock(mutex_);
-    metrix_.reset(new baidu::galaxy::proto::CgroupMetrix());
-    last_time_ = baidu::common::timer::get_micros();
-    metrix_->set_memory_used_in_byte(metrix2->memory_used_in_byte());
 
-    if (metrix1->has_container_cpu_time() && metrix1->has_system_cpu_time()
-            && metrix2->has_container_cpu_time() && metrix2->has_system_cpu_time()) {
-        double delta1 = (double)(metrix2->container_cpu_time() - metrix1->container_cpu_time());
-        double delta2 = (double)(metrix2->system_cpu_time() - metrix1->system_cpu_time());
-
-        if (delta2 > 0.01 && delta1 > 0.01) {
-            int64_t mcore = (int64_t)(1000.0 * delta1 / delta2 * CPU_CORES);
-            metrix_->set_cpu_used_in_millicore(mcore);
-        }
+    // keep the last rate until two samples are available
+    if (!metrix->has_cpu_used_in_millicore() && metrix_->has_cpu_used_in_millicore()) {
+        metrix->set_cpu_used_in_millicore(metrix_->cpu_used_in_millicore());
     }
 
+    metrix_ = metrix;
+    last_time_ = now;
     return ERRORCODE_OK;
 }
 
 
 baidu::galaxy::util::ErrorCode CgroupCollector::Collect(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
     assert(NULL != metrix);
+    boost::mutex::scoped_lock lock(reader_mutex_);
+
+    // readers were closed by Enable(false), do not reopen them
+    if (!Enabled()) {
+        return ERRORCODE(-1, "collector is disabled");
+    }
+
     baidu::galaxy::util::ErrorCode ec = ContainerCpuStat(metrix);
 
     if (ec.Code() != 0) {
@@ -89,12 +99,91 @@ baidu::galaxy::util::ErrorCode CgroupCollector::Collect(boost::shared_ptr<baidu:
         return ERRORCODE(-1, ec.Message().c_str());
     }
 
+    CpuThrottleStat(metrix);
+    PsiStat(metrix);
+    IoStat(metrix);
     return ERRORCODE_OK;
 }
 
+void CgroupCollector::SetCpuacctPath(const std::string& path) {
+    boost::mutex::scoped_lock lock(reader_mutex_);
+    cpuacct_stat_.reset(new StatReader(path + "/cpuacct.stat", 256));
+}
+
+void CgroupCollector::SetMemoryPath(const std::string& path) {
+    boost::mutex::scoped_lock lock(reader_mutex_);
+    memory_usage_.reset(new StatReader(path + "/memory.usage_in_bytes", 64));
+    memory_failcnt_.reset(new StatReader(path + "/memory.failcnt", 64));
+    memory_stat_.reset(new StatReader(path + "/memory.stat", 4096));
+}
+
+void CgroupCollector::SetCpuPath(const std::string& path) {
+    boost::mutex::scoped_lock lock(reader_mutex_);
+    cpu_stat_.reset(new StatReader(path + "/cpu.stat", 256));
+}
+
+void CgroupCollector::SetBlkioPath(const std::string& path) {
+    boost::mutex::scoped_lock lock(reader_mutex_);
+    io_bytes_.reset(new StatReader(path + "/blkio.throttle.io_service_bytes", 8192));
+    io_serviced_.reset(new StatReader(path + "/blkio.throttle.io_serviced", 8192));
+}
+
+void CgroupCollector::SetUnifiedPath(const std::string& path) {
+    boost::mutex::scoped_lock lock(reader_mutex_);
+    unified_ = true;
+    cpu_stat_.reset(new StatReader(path + "/cpu.stat", 512));
+    memory_usage_.reset(new StatReader(path + "/memory.current", 64));
+    memory_failcnt_.reset(new StatReader(path + "/memory.events", 256));
+    memory_stat_.reset(new StatReader(path + "/memory.stat", 4096));
+    cpu_pressure_.reset(new StatReader(path + "/cpu.pressure", 256));
+    memory_pressure_.reset(new StatReader(path + "/memory.pressure", 256));
+    io_pressure_.reset(new StatReader(path + "/io.pressure", 256));
+    io_bytes_.reset(new StatReader(path + "/io.stat", 8192));
+}
+
 void CgroupCollector::Enable(bool enabled) {
-    boost::mutex::scoped_lock lock(mutex_);
-    enabled_ = enabled;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        enabled_ = enabled;
+    }
+
+    // do not pin files of a cgroup being destroyed
+    if (!enabled) {
+        boost::mutex::scoped_lock lock(reader_mutex_);
+        CloseReaders();
+    }
+}
+
+void CgroupCollector::CloseReaders() {
+    if (NULL != cpuacct_stat_.get()) {
+        cpuacct_stat_->Close();
+    }
+
+    if (NULL != memory_usage_.get()) {
+        memory_usage_->Close();
+    }
+
+    if (NULL != memory_failcnt_.get()) {
+        memory_failcnt_->Close();
+    }
+
+    if (NULL != memory_stat_.get()) {
+        memory_stat_->Close();
+    }
+
+    if (NULL != cpu_stat_.get()) {
+        cpu_stat_->Close();
+    }
+
+    StatReader* optionals[] = {cpu_pressure_.get(), memory_pressure_.get(), io_pressure_.get(),
+                               io_bytes_.get(), io_serviced_.get()
+                              };
+
+    for (size_t i = 0; i < sizeof(optionals) / sizeof(optionals[0]); i++) {
+        if (NULL != optionals[i]) {
+            optionals[i]->Close();
+        }
+    }
 }
 
 bool CgroupCollector::Enabled() {
@@ -136,144 +225,327 @@ boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> CgroupCollector::Statistic
     return ret;
 }
 
+int64_t CgroupCollector::SampleTime() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return last_time_;
+}
+
 baidu::galaxy::util::ErrorCode CgroupCollector::ContainerCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
     assert(NULL != metrix.get());
 
-    if (cpuacct_path_.empty()) {
+    if (unified_) {
+        return UnifiedCpuStat(metrix);
+    }
+
+    if (NULL == cpuacct_stat_.get()) {
         return ERRORCODE(-1, "empty path");
     }
 
-    baidu::galaxy::file::InputStreamFile in(cpuacct_path_);
+    baidu::galaxy::util::ErrorCode ec = cpuacct_stat_->Read();
 
-    if (!in.IsOpen()) {
-        baidu::galaxy::util::ErrorCode ec = in.GetLastError();
-        return ERRORCODE(-1, "open %s failed: %s", cpuacct_path_.c_str(), ec.Message().c_str());
+    if (ec.Code() != 0) {
+        return ec;
     }
 
-    std::string line;
-    bool has_data = false;
+    // user 1234
+    // system 567
     int64_t cpu_time = 0;
 
-    while (!in.Eof()) {
-        baidu::galaxy::util::ErrorCode ec = in.ReadLine(line);
+    if (!cpuacct_stat_->Sum(cpu_time)) {
+        return ERRORCODE(-1, "format error: %s", cpuacct_stat_->Path().c_str());
+    }
 
-        if (ec.Code() != 0) {
-            return ERRORCODE(-1, "read (%s) failed: %s",
-                    cpuacct_path_.c_str(),
-                    ec.Message().c_str());
-        }
+    metrix->set_container_cpu_time(cpu_time);
+    return ERRORCODE_OK;
+}
 
-        char type[32];
-        long long int t = 0;
 
-        if (2 != sscanf(line.c_str(), "%s %lld", type, &t)) {
-            return ERRORCODE(-1, "format error");
-        }
+baidu::galaxy::util::ErrorCode CgroupCollector::UnifiedCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
+    if (NULL == cpu_stat_.get()) {
+        return ERRORCODE(-1, "empty path");
+    }
 
-        cpu_time += t;
-        has_data = true;
+    baidu::galaxy::util::ErrorCode ec = cpu_stat_->Read();
+
+    if (ec.Code() != 0) {
+        return ec;
     }
 
-    if (has_data) {
-        metrix->set_container_cpu_time(cpu_time);
-        return ERRORCODE_OK;
+    // usage_usec 1234567
+    static const char* const keys[] = {"usage_usec"};
+    int64_t usage = 0;
+
+    if (1 != cpu_stat_->Values(keys, &usage, 1)) {
+        return ERRORCODE(-1, "format error: %s", cpu_stat_->Path().c_str());
     }
 
-    return ERRORCODE(-1, "unkown error");
+    // same unit as cpuacct.stat and /proc/stat
+    metrix->set_container_cpu_time(usage * CLOCK_TICKS / 1000000L);
+    return ERRORCODE_OK;
 }
 
-
 baidu::galaxy::util::ErrorCode CgroupCollector::SystemCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
     assert(NULL != metrix.get());
     int64_t cpu_time = 0;
-    const static std::string  path("/proc/stat");
-    baidu::galaxy::file::InputStreamFile in(path);
+    // shared with all containers, /proc/stat is parsed once per tick
+    baidu::galaxy::util::ErrorCode ec = baidu::galaxy::collector::HostSampler::GetInstance()->SystemCpuTime(2000000L, cpu_time);
 
-    if (!in.IsOpen()) {
-        baidu::galaxy::util::ErrorCode ec = in.GetLastError();
-        return ERRORCODE(-1, "open %s failed: %s", path.c_str(), ec.Message().c_str());
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
     }
 
-    std::string line;
-    bool has_data = false;
+    metrix->set_system_cpu_time(cpu_time);
+    return ERRORCODE_OK;
+}
 
-    while (!in.Eof()) {
-        baidu::galaxy::util::ErrorCode ec = in.ReadLine(line);
 
-        if (ec.Code() != 0) {
-            return ERRORCODE(-1, "read (%s) failed: %s", path.c_str(), ec.Message().c_str());
-        }
+baidu::galaxy::util::ErrorCode CgroupCollector::MemoryStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
+    assert(NULL != metrix.get());
 
-        //cpu  19782368743 69952042 1588879335 90754227704 229233079 0 136086465 0 0
-        if (boost::starts_with(line, "cpu ")) {
-            char c[16];
-            long long int cpu_user_time = 0L;
-            long long int cpu_nice_time = 0L;
-            long long int cpu_system_time = 0L;
-            long long int cpu_idle_time = 0L;
-            long long int cpu_iowait_time = 0L;
-            long long int cpu_irq_time = 0L;
-            long long int cpu_softirq_time = 0L;
-            long long int cpu_stealstolen = 0L;
-            long long int cpu_guest = 0L;
-
-            if (10 == sscanf(line.c_str(), "%s %lld %lld %lld %lld %lld %lld %lld %lld %lld",
-                    c,
-                    &cpu_user_time,
-                    &cpu_nice_time,
-                    &cpu_system_time,
-                    &cpu_idle_time,
-                    &cpu_iowait_time,
-                    &cpu_irq_time,
-                    &cpu_softirq_time,
-                    &cpu_stealstolen,
-                    &cpu_guest)) {
-                cpu_time = cpu_user_time
-                           + cpu_nice_time
-                           + cpu_system_time
-                           + cpu_idle_time
-                           + cpu_iowait_time
-                           + cpu_irq_time
-                           + cpu_softirq_time
-                           + cpu_stealstolen
-                           + cpu_guest;
-                has_data = true;
-            }
+    if (NULL == memory_usage_.get()) {
+        return ERRORCODE(-1, "empty path");
+    }
 
-            break;
-        }
+    baidu::galaxy::util::ErrorCode ec = memory_usage_->Read();
+
+    if (ec.Code() != 0) {
+        return ec;
     }
 
-    if (!has_data) {
-        return ERRORCODE(-1, "unkown error");
+    int64_t usage = 0;
+
+    if (!memory_usage_->Value(usage)) {
+        return ERRORCODE(-1, "format error: %s", memory_usage_->Path().c_str());
+    }
+
+    metrix->set_memory_used_in_byte(usage);
+
+    // optional, some kernels lack them
+    // v2 counts hits of memory.max in memory.events
+    static const char* const event_keys[] = {"max"};
+    int64_t failcnt = 0;
+
+    if (0 == memory_failcnt_->Read().Code()
+            && (unified_ ? 1 == memory_failcnt_->Values(event_keys, &failcnt, 1) : memory_failcnt_->Value(failcnt))) {
+        metrix->set_memory_fail_cnt(failcnt);
+    }
+
+    static const char* const v1_keys[] = {"cache", "rss"};
+    static const char* const v2_keys[] = {"file", "anon"};
+    int64_t values[] = {-1L, -1L};
+
+    if (0 == memory_stat_->Read().Code() && 2 == memory_stat_->Values(unified_ ? v2_keys : v1_keys, values, 2)) {
+        metrix->set_memory_cache_in_byte(values[0]);
+        metrix->set_memory_rss_in_byte(values[1]);
     }
 
-    metrix->set_system_cpu_time(cpu_time);
     return ERRORCODE_OK;
 }
 
+void CgroupCollector::CpuThrottleStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
+    assert(NULL != metrix.get());
 
-baidu::galaxy::util::ErrorCode CgroupCollector::MemoryStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
+    // optional, cpu subsystem is not mounted everywhere
+    if (NULL == cpu_stat_.get()) {
+        return;
+    }
+
+    // nr_periods 1234
+    // nr_throttled 56
+    // throttled_time 789000
+    static const char* const keys[] = {"nr_throttled", "throttled_time"};
+    // v2: throttled_usec, cpu.stat has been read by UnifiedCpuStat
+    static const char* const v2_keys[] = {"nr_throttled", "throttled_usec"};
+    int64_t values[] = {0L, 0L};
+
+    if (unified_) {
+        if (2 == cpu_stat_->Values(v2_keys, values, 2)) {
+            metrix->set_cpu_nr_throttled(values[0]);
+            metrix->set_cpu_throttled_time(values[1] * 1000L);
+        }
+
+        return;
+    }
+
+    if (0 == cpu_stat_->Read().Code() && 2 == cpu_stat_->Values(keys, values, 2)) {
+        metrix->set_cpu_nr_throttled(values[0]);
+        metrix->set_cpu_throttled_time(values[1]);
+    }
+}
+
+// optional, there is no psi in cgroup v1 or with psi=0
+static bool ReadPressure(StatReader* reader, baidu::galaxy::collector::PressureStat& stat) {
+    return NULL != reader
+           && 0 == reader->Read().Code()
+           && 0 == baidu::galaxy::collector::HostSampler::ParsePressure(reader->Data(),
+                   reader->Data() + reader->Size(), &stat).Code();
+}
+
+void CgroupCollector::PsiStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
+    assert(NULL != metrix.get());
+    baidu::galaxy::collector::PressureStat stat;
+
+    if (ReadPressure(cpu_pressure_.get(), stat)) {
+        baidu::galaxy::collector::HostSampler::FillPressure(stat, metrix->mutable_cpu_pressure());
+    }
+
+    if (ReadPressure(memory_pressure_.get(), stat)) {
+        baidu::galaxy::collector::HostSampler::FillPressure(stat, metrix->mutable_memory_pressure());
+    }
+
+    if (ReadPressure(io_pressure_.get(), stat)) {
+        baidu::galaxy::collector::HostSampler::FillPressure(stat, metrix->mutable_io_pressure());
+    }
+}
+
+void CgroupCollector::IoStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix) {
     assert(NULL != metrix.get());
-    const std::string& path = memory_path_;
-    baidu::galaxy::file::InputStreamFile in(path);
 
-    if (!in.IsOpen()) {
-        baidu::galaxy::util::ErrorCode ec = in.GetLastError();
-        return ERRORCODE(-1, "open file(%s) failed: %s",
-                path.c_str(),
-                ec.Message().c_str());
+    // optional, blkio subsystem is not mounted everywhere
+    if (NULL == io_bytes_.get() || 0 != io_bytes_->Read().Code()) {
+        return;
     }
 
-    std::string data;
-    baidu::galaxy::util::ErrorCode ec = in.ReadLine(data);
+    int64_t values[] = {0L, 0L, 0L, 0L};
+    const char* begin = io_bytes_->Data();
+    const char* end = begin + io_bytes_->Size();
 
-    if (ec.Code() != 0) {
-        return ERRORCODE(-1, "read failed: %s", ec.Message().c_str());
+    if (unified_) {
+        if (!ParseIoStat(begin, end, values)) {
+            return;
+        }
+    } else if (!ParseBlkioStat(begin, end, values[0], values[1])
+               || NULL == io_serviced_.get()
+               || 0 != io_serviced_->Read().Code()
+               || !ParseBlkioStat(io_serviced_->Data(),
+                                  io_serviced_->Data() + io_serviced_->Size(),
+                                  values[2],
+                                  values[3])) {
+        return;
     }
 
-    metrix->set_memory_used_in_byte(::atol(data.c_str()));
-    return ERRORCODE_OK;
+    metrix->set_io_read_bytes(values[0]);
+    metrix->set_io_write_bytes(values[1]);
+    metrix->set_io_read_ios(values[2]);
+    metrix->set_io_write_ios(values[3]);
+}
+
+void CgroupCollector::IoRate(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix, int64_t now) {
+    if (!metrix->has_io_read_bytes()) {
+        last_io_time_ = -1L;
+        return;
+    }
+
+    const int64_t values[] = {metrix->io_read_bytes(), metrix->io_write_bytes(),
+                              metrix->io_read_ios(), metrix->io_write_ios()
+                             };
+    const int64_t interval = now - last_io_time_;
+    bool valid = last_io_time_ > 0 && interval > 0;
+
+    for (int i = 0; i < 4 && valid; i++) {
+        // counters of a removed device are gone
+        valid = values[i] >= last_io_[i];
+    }
+
+    if (valid) {
+        metrix->set_io_read_bps((values[0] - last_io_[0]) * 1000000L / interval);
+        metrix->set_io_write_bps((values[1] - last_io_[1]) * 1000000L / interval);
+        metrix->set_io_read_iops((values[2] - last_io_[2]) * 1000000L / interval);
+        metrix->set_io_write_iops((values[3] - last_io_[3]) * 1000000L / interval);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        last_io_[i] = values[i];
+    }
+
+    last_io_time_ = now;
+}
+
+static const char* NextLine(const char* begin, const char* end) {
+    while (begin < end && '\n' != *begin) {
+        begin++;
+    }
+
+    return begin < end ? begin + 1 : end;
+}
+
+static const char* SkipSpace(const char* begin, const char* end) {
+    while (begin < end && (' ' == *begin || '\t' == *begin)) {
+        begin++;
+    }
+
+    return begin;
+}
+
+static const char* NextToken(const char* begin, const char* end) {
+    while (begin < end && ' ' != *begin && '\t' != *begin && '\n' != *begin) {
+        begin++;
+    }
+
+    return SkipSpace(begin, end);
+}
+
+bool CgroupCollector::ParseBlkioStat(const char* begin, const char* end, int64_t& read, int64_t& write) {
+    if (NULL == begin || begin >= end) {
+        return false;
+    }
+
+    // 8:0 Read 1234
+    // 8:0 Write 5678
+    // ...
+    // Total 6912
+    read = 0L;
+    write = 0L;
+
+    for (const char* line = begin; line < end; line = NextLine(line, end)) {
+        const char* op = NextToken(line, end);
+        const char* value = NextToken(op, end);
+        int64_t n = 0L;
+
+        if (value >= end || NULL == StatReader::ParseInt64(value, end, n)) {
+            continue;
+        }
+
+        if (0 == strncmp(op, "Read ", 5)) {
+            read += n;
+        } else if (0 == strncmp(op, "Write ", 6)) {
+            write += n;
+        }
+    }
+
+    return true;
+}
+
+bool CgroupCollector::ParseIoStat(const char* begin, const char* end, int64_t values[4]) {
+    if (NULL == begin || begin > end) {
+        return false;
+    }
+
+    // 8:0 rbytes=1234 wbytes=5678 rios=12 wios=34 dbytes=0 dios=0
+    static const char* const keys[] = {"rbytes=", "wbytes=", "rios=", "wios="};
+
+    for (int i = 0; i < 4; i++) {
+        values[i] = 0L;
+    }
+
+    for (const char* line = begin; line < end; line = NextLine(line, end)) {
+        for (const char* token = NextToken(line, end); token < end && '\n' != *token;
+                token = NextToken(token, end)) {
+            for (int i = 0; i < 4; i++) {
+                const size_t len = strlen(keys[i]);
+                int64_t n = 0L;
+
+                if (token + len < end
+                        && 0 == strncmp(token, keys[i], len)
+                        && NULL != StatReader::ParseInt64(token + len, end, n)) {
+                    values[i] += n;
+                    break;
+                }
+            }
+        }
+    }
+
+    return true;
 }
 
 }
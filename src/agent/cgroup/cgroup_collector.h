@@ -7,6 +7,7 @@
 
 #include "boost/thread/mutex.hpp"
 #include "boost/shared_ptr.hpp"
+#include "boost/scoped_ptr.hpp"
 
 namespace baidu {
 namespace galaxy {
@@ -16,6 +17,7 @@ class CgroupMetrix;
 
 namespace cgroup {
 class Cgroup;
+class StatReader;
 
 class CgroupCollector : public baidu::galaxy::collector::Collector {
 public:
@@ -32,20 +34,37 @@ public:
     std::string Name() const;
     void SetName(const std::string& name);
     boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> Statistics();
+    // when Statistics() was collected, unit us
+    int64_t SampleTime();
 
-    void SetCpuacctPath(const std::string& path) {
-        cpuacct_path_ = path;
-    }
+    // directory of cpuacct subsystem of the cgroup
+    void SetCpuacctPath(const std::string& path);
+    // directory of memory subsystem of the cgroup
+    void SetMemoryPath(const std::string& path);
+    // directory of cpu subsystem of the cgroup, for throttling
+    void SetCpuPath(const std::string& path);
+    // directory of blkio subsystem of the cgroup, for io statistics
+    void SetBlkioPath(const std::string& path);
+    // directory of the container in cgroup v2, instead of the four above
+    void SetUnifiedPath(const std::string& path);
 
-    void SetMemoryPath(const std::string& path) {
-        memory_path_ = path;
-    }
+    // sum of "Read" and "Write" lines over all devices,
+    // eg: blkio.throttle.io_service_bytes, blkio.throttle.io_serviced
+    static bool ParseBlkioStat(const char* begin, const char* end, int64_t& read, int64_t& write);
+    // sum of rbytes, wbytes, rios and wios over all devices of io.stat
+    static bool ParseIoStat(const char* begin, const char* end, int64_t values[4]);
 
 private:
     baidu::galaxy::util::ErrorCode Collect(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
     baidu::galaxy::util::ErrorCode ContainerCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
+    baidu::galaxy::util::ErrorCode UnifiedCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
     baidu::galaxy::util::ErrorCode SystemCpuStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
     baidu::galaxy::util::ErrorCode MemoryStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
+    void CpuThrottleStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
+    void PsiStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
+    void IoStat(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix);
+    void IoRate(boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix, int64_t now);
+    void CloseReaders();
 
     bool enabled_;
     int cycle_;
@@ -54,8 +73,28 @@ private:
 
     boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> metrix_;
     int64_t last_time_;
-    std::string cpuacct_path_;
-    std::string memory_path_;
+    // raw sample of last cycle, only touched by Collect()
+    int64_t last_container_cpu_time_;
+    int64_t last_system_cpu_time_;
+    int64_t last_io_time_;
+    int64_t last_io_[4];
+
+    // stat files are kept open while the collector is enabled
+    boost::mutex reader_mutex_;
+    boost::scoped_ptr<StatReader> cpuacct_stat_;
+    boost::scoped_ptr<StatReader> memory_usage_;
+    boost::scoped_ptr<StatReader> memory_failcnt_;
+    boost::scoped_ptr<StatReader> memory_stat_;
+    boost::scoped_ptr<StatReader> cpu_stat_;
+    // psi of the cgroup, v2 only
+    boost::scoped_ptr<StatReader> cpu_pressure_;
+    boost::scoped_ptr<StatReader> memory_pressure_;
+    boost::scoped_ptr<StatReader> io_pressure_;
+    // v1: blkio.throttle.io_service_bytes and io_serviced, v2: io.stat in io_bytes_
+    boost::scoped_ptr<StatReader> io_bytes_;
+    boost::scoped_ptr<StatReader> io_serviced_;
+    // v2: cpu_stat_ holds usage as well, memory_failcnt_ reads memory.events
+    bool unified_;
 };
 }
 }
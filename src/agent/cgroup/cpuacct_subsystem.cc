@@ -6,7 +6,7 @@
 #include "boost/filesystem/path.hpp"
 #include "boost/filesystem/operations.hpp"
 #include "util/input_stream_file.h"
-#include "boost/algorithm/string/predicate.hpp"
+#include "collector/host_sampler.h"
 
 #include "protocol/agent.pb.h"
 
@@ -108,70 +108,8 @@ baidu::galaxy::util::ErrorCode CpuacctSubsystem::CgroupCpuTime(int64_t& cpu_time
 }
 
 baidu::galaxy::util::ErrorCode CpuacctSubsystem::SystemCpuTime(int64_t& cpu_time) {
-    cpu_time = 0;
-    const static std::string  path("/proc/stat");
-    baidu::galaxy::file::InputStreamFile in(path);
-
-    if (!in.IsOpen()) {
-        baidu::galaxy::util::ErrorCode ec = in.GetLastError();
-        return ERRORCODE(-1, "open %s failed: %s", path.c_str(), ec.Message().c_str());
-    }
-
-    std::string line;
-    bool has_data = false;
-
-    while (!in.Eof()) {
-        baidu::galaxy::util::ErrorCode ec = in.ReadLine(line);
-
-        if (ec.Code() != 0) {
-            return ERRORCODE(-1, "read (%s) failed: %s", path.c_str(), ec.Message().c_str());
-        }
-
-        //cpu  19782368743 69952042 1588879335 90754227704 229233079 0 136086465 0 0
-        if (boost::starts_with(line, "cpu ")) {
-            char c[16];
-            long long int cpu_user_time = 0L;
-            long long int cpu_nice_time = 0L;
-            long long int cpu_system_time = 0L;
-            long long int cpu_idle_time = 0L;
-            long long int cpu_iowait_time = 0L;
-            long long int cpu_irq_time = 0L;
-            long long int cpu_softirq_time = 0L;
-            long long int cpu_stealstolen = 0L;
-            long long int cpu_guest = 0L;
-
-            if (10 == sscanf(line.c_str(), "%s %lld %lld %lld %lld %lld %lld %lld %lld %lld",
-                    c,
-                    &cpu_user_time,
-                    &cpu_nice_time,
-                    &cpu_system_time,
-                    &cpu_idle_time,
-                    &cpu_iowait_time,
-                    &cpu_irq_time,
-                    &cpu_softirq_time,
-                    &cpu_stealstolen,
-                    &cpu_guest)) {
-                cpu_time = cpu_user_time
-                           + cpu_nice_time
-                           + cpu_system_time
-                           + cpu_idle_time
-                           + cpu_iowait_time
-                           + cpu_irq_time
-                           + cpu_softirq_time
-                           + cpu_stealstolen
-                           + cpu_guest;
-                has_data = true;
-            }
-
-            break;
-        }
-    }
-
-    if (!has_data) {
-        return ERRORCODE(-1, "unkown error");
-    }
-
-    return ERRORCODE_OK;
+    // shared with all containers, /proc/stat is parsed once per tick
+    return baidu::galaxy::collector::HostSampler::GetInstance()->SystemCpuTime(2000000L, cpu_time);
 }
 
 }
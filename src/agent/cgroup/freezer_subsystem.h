@@ -14,8 +14,8 @@ public:
     FreezerSubsystem();
     ~FreezerSubsystem();
 
-    baidu::galaxy::util::ErrorCode Freeze();
-    baidu::galaxy::util::ErrorCode Thaw();
+    virtual baidu::galaxy::util::ErrorCode Freeze();
+    virtual baidu::galaxy::util::ErrorCode Thaw();
     bool Empty();
 
     baidu::galaxy::util::ErrorCode Collect(std::map<std::string, AutoValue>& stat);
@@ -0,0 +1,280 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "memory_pressure.h"
+
+#include "boost/bind.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include <algorithm>
+
+DECLARE_string(memory_psi_path);
+DECLARE_int64(memory_psi_some_threshold);
+DECLARE_int64(memory_psi_full_threshold);
+
+namespace baidu {
+namespace galaxy {
+namespace cgroup {
+
+MemoryPressure::MemoryPressure() :
+    stop_fd_(-1),
+    running_(false) {
+}
+
+MemoryPressure::~MemoryPressure() {
+    TearDown();
+}
+
+const char* MemoryPressure::LevelName(int level) {
+    switch (level) {
+    case kPressureMedium:
+        return "medium";
+
+    case kPressureCritical:
+        return "critical";
+
+    case kPressureOom:
+        return "oom";
+
+    default:
+        return "unknown";
+    }
+}
+
+baidu::galaxy::util::ErrorCode MemoryPressure::Setup(const std::string& cgroup_path, Callback callback) {
+    assert(!running_);
+    callback_ = callback;
+    baidu::galaxy::util::ErrorCode ec = RegisterV1(cgroup_path, "memory.pressure_level", "medium", kPressureMedium);
+
+    if (0 == ec.Code()) {
+        ec = RegisterV1(cgroup_path, "memory.pressure_level", "critical", kPressureCritical);
+    }
+
+    if (0 == ec.Code()) {
+        mode_ = "v1";
+        // no limit on the cgroup means no oom event, not an error
+        baidu::galaxy::util::ErrorCode oom = RegisterV1(cgroup_path, "memory.oom_control", "", kPressureOom);
+
+        if (0 != oom.Code()) {
+            LOG(WARNING) << "oom event is not available: " << oom.Message();
+        }
+    } else {
+        LOG(INFO) << "memory pressure level is not available, try psi: " << ec.Message();
+        CloseAll();
+        std::string path = cgroup_path + "/memory.pressure";
+
+        if (0 != ::access(path.c_str(), F_OK)) {
+            path = FLAGS_memory_psi_path;
+        }
+
+        char some[64];
+        char full[64];
+        // stall time(us) in a 1s window
+        snprintf(some, sizeof some, "some %lld 1000000", (long long)FLAGS_memory_psi_some_threshold);
+        snprintf(full, sizeof full, "full %lld 1000000", (long long)FLAGS_memory_psi_full_threshold);
+        ec = RegisterPsi(path, some, kPressureMedium);
+
+        if (0 == ec.Code()) {
+            ec = RegisterPsi(path, full, kPressureCritical);
+        }
+
+        if (0 != ec.Code()) {
+            CloseAll();
+            return ec;
+        }
+
+        mode_ = "psi";
+    }
+
+    // wakes up the thread on TearDown
+    stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (stop_fd_ < 0) {
+        CloseAll();
+        return PERRORCODE(-1, errno, "create eventfd failed");
+    }
+
+    running_ = true;
+
+    if (!thread_.Start(boost::bind(&MemoryPressure::PollRoutine, this))) {
+        running_ = false;
+        CloseAll();
+        ::close(stop_fd_);
+        stop_fd_ = -1;
+        return ERRORCODE(-1, "start memory pressure thread failed");
+    }
+
+    LOG(INFO) << "watch memory pressure of " << cgroup_path << " by " << mode_;
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode MemoryPressure::RegisterV1(const std::string& cgroup_path,
+        const std::string& file,
+        const std::string& args,
+        int level) {
+    const std::string path = cgroup_path + "/" + file;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", path.c_str());
+    }
+
+    files_.push_back(fd);
+    int efd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (efd < 0) {
+        return PERRORCODE(-1, errno, "create eventfd failed");
+    }
+
+    Source source;
+    source.fd = efd;
+    source.level = level;
+    source.psi = false;
+    sources_.push_back(source);
+
+    // <event_fd> <fd of file> [args]
+    char buf[256];
+    int len = snprintf(buf, sizeof buf, "%d %d %s", efd, fd, args.c_str());
+    const std::string control = cgroup_path + "/cgroup.event_control";
+    int cfd = ::open(control.c_str(), O_WRONLY | O_CLOEXEC);
+
+    if (cfd < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", control.c_str());
+    }
+
+    ssize_t ret = ::write(cfd, buf, len);
+    ::close(cfd);
+
+    if (ret != len) {
+        return PERRORCODE(-1, errno, "register %s event on %s failed", file.c_str(), cgroup_path.c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode MemoryPressure::RegisterPsi(const std::string& path, const std::string& trigger, int level) {
+    int fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", path.c_str());
+    }
+
+    Source source;
+    source.fd = fd;
+    source.level = level;
+    source.psi = true;
+    sources_.push_back(source);
+
+    // the trigger is bound to this fd, terminating null included
+    if (::write(fd, trigger.c_str(), trigger.size() + 1) < 0) {
+        return PERRORCODE(-1, errno, "write trigger \"%s\" to %s failed", trigger.c_str(), path.c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+void MemoryPressure::TearDown() {
+    if (running_) {
+        running_ = false;
+        uint64_t one = 1;
+
+        if (::write(stop_fd_, &one, sizeof one) < 0) {
+            LOG(WARNING) << "wake up memory pressure thread failed: " << strerror(errno);
+        }
+
+        thread_.Join();
+    }
+
+    CloseAll();
+
+    if (stop_fd_ >= 0) {
+        ::close(stop_fd_);
+        stop_fd_ = -1;
+    }
+}
+
+void MemoryPressure::CloseAll() {
+    for (size_t i = 0; i < sources_.size(); i++) {
+        ::close(sources_[i].fd);
+    }
+
+    sources_.clear();
+
+    for (size_t i = 0; i < files_.size(); i++) {
+        ::close(files_[i]);
+    }
+
+    files_.clear();
+}
+
+void MemoryPressure::PollRoutine() {
+    std::vector<struct pollfd> fds(sources_.size() + 1);
+
+    for (size_t i = 0; i < sources_.size(); i++) {
+        fds[i].fd = sources_[i].fd;
+        fds[i].events = sources_[i].psi ? POLLPRI : POLLIN;
+    }
+
+    fds.back().fd = stop_fd_;
+    fds.back().events = POLLIN;
+
+    while (running_) {
+        for (size_t i = 0; i < fds.size(); i++) {
+            fds[i].revents = 0;
+        }
+
+        int n = ::poll(&fds[0], fds.size(), -1);
+
+        if (n < 0) {
+            if (errno != EINTR) {
+                LOG(WARNING) << "poll memory pressure failed: " << strerror(errno);
+                ::usleep(100000);
+            }
+
+            continue;
+        }
+
+        int level = 0;
+
+        for (size_t i = 0; i < sources_.size(); i++) {
+            if (0 == fds[i].revents) {
+                continue;
+            }
+
+            if (!sources_[i].psi) {
+                uint64_t count = 0;
+
+                if (::read(fds[i].fd, &count, sizeof count) < 0 && errno != EAGAIN) {
+                    LOG(WARNING) << "read pressure event failed: " << strerror(errno);
+                }
+            } else if (fds[i].revents & POLLERR) {
+                // monitored file is gone, stop polling it
+                LOG(WARNING) << "psi trigger of level " << LevelName(sources_[i].level) << " is gone";
+                fds[i].fd = -1;
+                continue;
+            }
+
+            level = std::max(level, sources_[i].level);
+        }
+
+        if (level > 0 && running_) {
+            VLOG(10) << "memory pressure: " << LevelName(level);
+            callback_(level);
+        }
+    }
+}
+
+}
+}
+}
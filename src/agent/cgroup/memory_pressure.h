@@ -0,0 +1,73 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+
+#include "boost/function.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "thread.h"
+
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace cgroup {
+
+enum PressureLevel {
+    kPressureMedium = 1,
+    kPressureCritical = 2,
+    kPressureOom = 3
+};
+
+// Wakes up on memory pressure of a cgroup instead of polling usage.
+// cgroup v1: eventfds registered on memory.pressure_level (medium and
+// critical) and memory.oom_control through cgroup.event_control.
+// Otherwise PSI triggers on <cgroup>/memory.pressure or /proc/pressure/memory.
+class MemoryPressure : private boost::noncopyable {
+public:
+    typedef boost::function<void (int level)> Callback;
+
+    MemoryPressure();
+    ~MemoryPressure();
+
+    // callback runs on the monitor thread with the highest level fired
+    baidu::galaxy::util::ErrorCode Setup(const std::string& cgroup_path, Callback callback);
+    void TearDown();
+    // "v1" or "psi", empty before Setup
+    const std::string& Mode() const {
+        return mode_;
+    }
+
+    static const char* LevelName(int level);
+
+private:
+    struct Source {
+        int fd;         // polled fd
+        int level;
+        bool psi;       // POLLPRI on the pressure file instead of an eventfd
+    };
+
+    baidu::galaxy::util::ErrorCode RegisterV1(const std::string& cgroup_path,
+            const std::string& file,
+            const std::string& args,
+            int level);
+    baidu::galaxy::util::ErrorCode RegisterPsi(const std::string& path, const std::string& trigger, int level);
+    void CloseAll();
+    void PollRoutine();
+
+    std::vector<Source> sources_;
+    std::vector<int> files_;        // kept open while events are registered
+    int stop_fd_;
+    std::string mode_;
+    Callback callback_;
+    bool running_;
+    baidu::common::Thread thread_;
+};
+
+}
+}
+}
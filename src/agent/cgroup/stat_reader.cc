@@ -0,0 +1,182 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "stat_reader.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace baidu {
+namespace galaxy {
+namespace cgroup {
+
+StatReader::StatReader(const std::string& path, size_t buffer_size) :
+    path_(path),
+    fd_(-1),
+    size_(0),
+    buf_(buffer_size) {
+    assert(buffer_size > 0);
+}
+
+StatReader::~StatReader() {
+    Close();
+}
+
+void StatReader::Close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    size_ = 0;
+}
+
+baidu::galaxy::util::ErrorCode StatReader::Read() {
+    size_ = 0;
+
+    if (fd_ < 0) {
+        fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if (fd_ < 0) {
+            return PERRORCODE(-1, errno, "open %s failed", path_.c_str());
+        }
+    }
+
+    // seq files regenerate the content when read from offset 0, only a
+    // pread returning 0 tells the end, a full buffer is grown and kept
+    while (true) {
+        if (size_ == buf_.size()) {
+            buf_.resize(buf_.size() * 2);
+        }
+
+        ssize_t ret = ::pread(fd_, &buf_[size_], buf_.size() - size_, size_);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ret < 0) {
+            size_ = 0;
+            // the cgroup may have been removed, reopen next time
+            Close();
+            return PERRORCODE(-1, errno, "read %s failed", path_.c_str());
+        }
+
+        if (ret == 0) {
+            return ERRORCODE_OK;
+        }
+
+        size_ += ret;
+    }
+}
+
+const char* StatReader::ParseInt64(const char* begin, const char* end, int64_t& value) {
+    const char* p = begin;
+
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+
+    bool negative = false;
+
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+
+    if (p >= end || *p < '0' || *p > '9') {
+        return NULL;
+    }
+
+    int64_t v = 0;
+
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+
+    value = negative ? -v : v;
+    return p;
+}
+
+bool StatReader::Value(int64_t& value) const {
+    if (size_ == 0) {
+        return false;
+    }
+
+    return NULL != ParseInt64(&buf_[0], &buf_[0] + size_, value);
+}
+
+int StatReader::Values(const char* const keys[], int64_t values[], int n) const {
+    int found = 0;
+    const char* p = size_ > 0 ? &buf_[0] : NULL;
+    const char* end = p + size_;
+
+    while (p < end && found < n) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+
+        if (NULL == eol) {
+            eol = end;
+        }
+
+        const char* sep = static_cast<const char*>(memchr(p, ' ', eol - p));
+
+        if (NULL != sep) {
+            size_t len = sep - p;
+
+            for (int i = 0; i < n; i++) {
+                if (strncmp(keys[i], p, len) == 0 && keys[i][len] == '\0') {
+                    if (NULL != ParseInt64(sep, eol, values[i])) {
+                        found++;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        p = eol + 1;
+    }
+
+    return found;
+}
+
+bool StatReader::Sum(int64_t& sum) const {
+    bool has_data = false;
+    int64_t s = 0;
+    const char* p = size_ > 0 ? &buf_[0] : NULL;
+    const char* end = p + size_;
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+
+        if (NULL == eol) {
+            eol = end;
+        }
+
+        const char* sep = static_cast<const char*>(memchr(p, ' ', eol - p));
+        int64_t v = 0;
+
+        if (NULL == sep || NULL == ParseInt64(sep, eol, v)) {
+            return false;
+        }
+
+        s += v;
+        has_data = true;
+        p = eol + 1;
+    }
+
+    if (has_data) {
+        sum = s;
+    }
+
+    return has_data;
+}
+
+}
+}
+}
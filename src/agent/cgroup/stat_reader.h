@@ -0,0 +1,66 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+#include "boost/noncopyable.hpp"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace cgroup {
+
+// Reader of a cgroup stat file, eg: memory.usage_in_bytes, cpuacct.stat,
+// memory.stat or cpu.stat. The fd is opened on first read and kept until
+// Close(), every Read() preads the whole file into a buffer reused across
+// reads and grown only when the file does not fit, so sampling does not
+// allocate or format anything on success.
+class StatReader : public boost::noncopyable {
+public:
+    explicit StatReader(const std::string& path, size_t buffer_size = 4096);
+    ~StatReader();
+
+    baidu::galaxy::util::ErrorCode Read();
+    void Close();
+
+    const std::string& Path() const {
+        return path_;
+    }
+
+    // content of the last successful Read()
+    const char* Data() const {
+        return size_ > 0 ? &buf_[0] : NULL;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // first integer of the file, eg: memory.usage_in_bytes
+    bool Value(int64_t& value) const;
+
+    // values of "key value" lines, eg: memory.stat
+    // values[i] is left untouched if keys[i] is missing, return number of keys found
+    int Values(const char* const keys[], int64_t values[], int n) const;
+
+    // sum over all "key value" lines, eg: user + system of cpuacct.stat
+    bool Sum(int64_t& sum) const;
+
+    // return the position after the integer, NULL if there is no integer at begin
+    static const char* ParseInt64(const char* begin, const char* end, int64_t& value);
+
+private:
+    std::string path_;
+    int fd_;
+    size_t size_;
+    std::vector<char> buf_;
+};
+
+}
+}
+}
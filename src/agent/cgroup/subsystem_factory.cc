@@ -10,8 +10,26 @@
 #include "cpuacct_subsystem.h"
 #include "tcp_throt_subsystem.h"
 #include "blkio_subsystem.h"
+#include "unified_subsystem.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+#include <linux/magic.h>
+
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+DECLARE_string(cgroup_root_path);
+DECLARE_string(cgroup_version);
 
 namespace baidu {
 namespace galaxy {
@@ -23,7 +41,8 @@ boost::shared_ptr<Subsystem> galaxy_memory_;
 
 SubsystemFactory::SubsystemFactory() :
     memory_(new baidu::galaxy::cgroup::MemorySubsystem()),
-    galaxy_memory_(new baidu::galaxy::cgroup::GalaxyMemorySubsystem()) {
+    galaxy_memory_(new baidu::galaxy::cgroup::GalaxyMemorySubsystem()),
+    unified_(false) {
 }
 
 boost::shared_ptr<SubsystemFactory> SubsystemFactory::s_instance_(new SubsystemFactory());
@@ -42,11 +61,87 @@ SubsystemFactory* SubsystemFactory::Register(Subsystem* malloc_subsystem) {
 }
 
 void SubsystemFactory::Setup() {
+    unified_ = ProbeUnified();
+
+    if (unified_) {
+        LOG(INFO) << "use cgroup v2 mounted at " << FLAGS_cgroup_root_path;
+        SetupUnified();
+        this->Register(new baidu::galaxy::cgroup::UnifiedSubsystem());
+        return;
+    }
+
     this->Register(new baidu::galaxy::cgroup::CpuSubsystem())
     ->Register(new baidu::galaxy::cgroup::FreezerSubsystem())
     ->Register(new baidu::galaxy::cgroup::TcpThrotSubsystem())
     ->Register(new baidu::galaxy::cgroup::CpuacctSubsystem())
     ->Register(new baidu::galaxy::cgroup::NetclsSubsystem());
+
+    // blkio is optional, containers are not throttled if it is not mounted
+    if (0 == ::access(Subsystem::RootPath("blkio").c_str(), F_OK)) {
+        this->Register(new baidu::galaxy::cgroup::BlkioSubsystem());
+    } else {
+        LOG(WARNING) << "blkio is not mounted at " << Subsystem::RootPath("blkio")
+                     << ", io of containers will not be throttled";
+    }
+}
+
+bool SubsystemFactory::ProbeUnified() {
+    if ("v1" == FLAGS_cgroup_version) {
+        return false;
+    }
+
+    if ("v2" == FLAGS_cgroup_version) {
+        return true;
+    }
+
+    // v1 hierarchies are mounted below a tmpfs, v2 is mounted at the root itself
+    struct statfs st;
+
+    if (0 != ::statfs(FLAGS_cgroup_root_path.c_str(), &st)) {
+        LOG(WARNING) << "statfs " << FLAGS_cgroup_root_path << " failed: " << strerror(errno)
+                     << ", fall back to cgroup v1";
+        return false;
+    }
+
+    return CGROUP2_SUPER_MAGIC == (int64_t)st.f_type;
+}
+
+void SubsystemFactory::SetupUnified() {
+    boost::filesystem::path galaxy(FLAGS_cgroup_root_path);
+    galaxy.append("galaxy");
+    boost::system::error_code ec;
+
+    if (!boost::filesystem::exists(galaxy, ec)
+            && !boost::filesystem::create_directory(galaxy, ec)) {
+        LOG(WARNING) << "create " << galaxy.string() << " failed: " << ec.message();
+    }
+
+    // controllers must be enabled top down before children can use them,
+    // one by one so that a missing controller does not disable the others
+    static const char* const controllers[] = {"+cpu", "+memory", "+io"};
+    const std::string parents[] = {FLAGS_cgroup_root_path, galaxy.string()};
+
+    for (size_t i = 0; i < sizeof(parents) / sizeof(parents[0]); i++) {
+        boost::filesystem::path control(parents[i]);
+        control.append("cgroup.subtree_control");
+
+        for (size_t j = 0; j < sizeof(controllers) / sizeof(controllers[0]); j++) {
+            baidu::galaxy::util::ErrorCode err = baidu::galaxy::cgroup::Attach(control.string(), controllers[j], false);
+
+            if (0 != err.Code()) {
+                LOG(WARNING) << "enable " << controllers[j] << " in " << control.string()
+                             << " failed: " << err.Message();
+            }
+        }
+    }
+}
+
+std::string SubsystemFactory::HierarchyPath(const std::string& subsystem) const {
+    if (unified_) {
+        return FLAGS_cgroup_root_path;
+    }
+
+    return Subsystem::RootPath(subsystem);
 }
 
  
@@ -76,7 +171,11 @@ void SubsystemFactory::GetSubsystems(std::vector<std::string>& subsystems) {
         subsystems.push_back(iter->first);
         iter++;
     }
-    subsystems.push_back("memory");
+
+    // memory is cloned by use_galaxy_killer in v1, covered by unified in v2
+    if (!unified_) {
+        subsystems.push_back("memory");
+    }
 }
 
 } //namespace cgroup
@@ -18,18 +18,30 @@ namespace cgroup {
 class SubsystemFactory : public boost::noncopyable {
 public:
     static boost::shared_ptr<SubsystemFactory> GetInstance();
+    // probes the hierarchy mounted at cgroup_root_path unless cgroup_version is given
     void Setup();
 
     boost::shared_ptr<Subsystem> CreateSubsystem(const std::string& name, bool use_galaxy_killer = false);
     void GetSubsystems(std::vector<std::string>& subsystems);
 
+    // cgroup v2, every container has one directory for all controllers
+    bool Unified() const {
+        return unified_;
+    }
+
+    // mount point of the hierarchy holding subsystem
+    std::string HierarchyPath(const std::string& subsystem) const;
+
 private:
     SubsystemFactory();
     SubsystemFactory* Register(Subsystem* malloc_subsystem);
+    bool ProbeUnified();
+    void SetupUnified();
     static boost::shared_ptr<SubsystemFactory> s_instance_;
     std::map<const std::string, boost::shared_ptr<Subsystem> > cgroups_seed_;
     boost::shared_ptr<Subsystem> memory_;
     boost::shared_ptr<Subsystem> galaxy_memory_;
+    bool unified_;
 };
 
 } //namespace cgroup
@@ -0,0 +1,237 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unified_subsystem.h"
+#include "protocol/galaxy.pb.h"
+#include "gflags/gflags.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast/lexical_cast_old.hpp>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+DECLARE_string(cgroup_root_path);
+
+namespace baidu {
+namespace galaxy {
+namespace cgroup {
+
+UnifiedSubsystem::UnifiedSubsystem() {
+}
+
+UnifiedSubsystem::~UnifiedSubsystem() {
+}
+
+std::string UnifiedSubsystem::Name() {
+    return "unified";
+}
+
+std::string UnifiedSubsystem::Path() {
+    std::string id = container_id_ + "_" + cgroup_->id();
+    boost::filesystem::path path(FLAGS_cgroup_root_path);
+    path.append("galaxy");
+    path.append(id);
+    return path.string();
+}
+
+boost::shared_ptr<Subsystem> UnifiedSubsystem::Clone() {
+    boost::shared_ptr<Subsystem> ret(new UnifiedSubsystem());
+    return ret;
+}
+
+int64_t UnifiedSubsystem::ShareToWeight(int64_t share) {
+    if (share <= 0) {
+        return 100L;
+    }
+
+    // [2, 262144] -> [1, 10000]
+    int64_t weight = 1L + (share - 2L) * 9999L / 262142L;
+    return std::min(std::max(weight, 1L), 10000L);
+}
+
+int64_t UnifiedSubsystem::BlkioToIoWeight(int64_t weight) {
+    // default of blkio.weight is 500, of io.weight is 100
+    int64_t ret = weight * 100L / 500L;
+    return std::min(std::max(ret, 1L), 10000L);
+}
+
+std::string UnifiedSubsystem::CpuMax(int64_t millicore) {
+    int64_t quota = MilliCoreToCfs(millicore);
+    char buf[64];
+
+    if (quota <= 0) {
+        snprintf(buf, sizeof buf, "max %lld", (long long)MilliCoreToCfs(1000L));
+    } else {
+        snprintf(buf, sizeof buf, "%lld %lld", (long long)quota, (long long)MilliCoreToCfs(1000L));
+    }
+
+    return buf;
+}
+
+static std::string IoLimit(int64_t value) {
+    return value > 0 ? boost::lexical_cast<std::string>(value) : std::string("max");
+}
+
+std::string UnifiedSubsystem::IoMax(const baidu::galaxy::proto::BlkioThrottle& throttle) {
+    return throttle.device()
+           + " rbps=" + IoLimit(throttle.read_bps())
+           + " wbps=" + IoLimit(throttle.write_bps())
+           + " riops=" + IoLimit(throttle.read_iops())
+           + " wiops=" + IoLimit(throttle.write_iops());
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Write(const std::string& file, const std::string& value) {
+    boost::filesystem::path path(this->Path());
+    path.append(file);
+    baidu::galaxy::util::ErrorCode err = baidu::galaxy::cgroup::Attach(path.string(), value, false);
+
+    if (0 != err.Code()) {
+        return ERRORCODE(-1, "attach %s failed: %s",
+                file.c_str(),
+                err.Message().c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Construct() {
+    assert(NULL != cgroup_.get());
+    assert(!container_id_.empty());
+    boost::filesystem::path path(this->Path());
+    boost::system::error_code ec;
+
+    if (!boost::filesystem::exists(path, ec)
+            && !baidu::galaxy::file::create_directories(path, ec)) {
+        return ERRORCODE(-1, "failed in creating path %s: %s",
+                path.string().c_str(),
+                ec.message().c_str());
+    }
+
+    // cpu.weight shares the cpu under contention on both paths, cpu.max
+    // caps only the hard limited container and is reset for an excess one
+    baidu::galaxy::util::ErrorCode err = Write("cpu.weight", boost::lexical_cast<std::string>(
+                ShareToWeight(MilliCoreToShare(cgroup_->cpu().milli_core()))));
+
+    if (0 != err.Code()) {
+        return err;
+    }
+
+    err = Write("cpu.max", CpuMax(cgroup_->cpu().excess() ? 0L : cgroup_->cpu().milli_core()));
+
+    if (0 != err.Code()) {
+        return err;
+    }
+
+    // memory.max is the hard limit, an excess container is reclaimed and
+    // throttled above memory.high instead of being killed
+    const std::string size = boost::lexical_cast<std::string>(cgroup_->memory().size());
+
+    if (cgroup_->memory().excess()) {
+        err = Write("memory.high", size);
+
+        if (0 == err.Code()) {
+            err = Write("memory.max", "max");
+        }
+    } else {
+        err = Write("memory.max", size);
+
+        if (0 == err.Code()) {
+            err = Write("memory.high", "max");
+        }
+    }
+
+    if (0 != err.Code()) {
+        return err;
+    }
+
+    if (cgroup_->has_blkio() && cgroup_->blkio().weight() > 0) {
+        err = Write("io.weight", "default "
+                + boost::lexical_cast<std::string>(BlkioToIoWeight(cgroup_->blkio().weight())));
+
+        if (0 != err.Code()) {
+            return err;
+        }
+    }
+
+    for (int i = 0; i < cgroup_->blkio().throttles_size(); i++) {
+        const baidu::galaxy::proto::BlkioThrottle& throttle = cgroup_->blkio().throttles(i);
+
+        if (throttle.device().empty()) {
+            return ERRORCODE(-1, "device of %s is not resolved", throttle.path().c_str());
+        }
+
+        err = Write("io.max", IoMax(throttle));
+
+        if (0 != err.Code()) {
+            return err;
+        }
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Destroy() {
+    const std::string path = this->Path();
+
+    // control files can not be unlinked, the directory is removed by rmdir
+    // once the last task is gone, which takes a moment after SIGKILL
+    for (int i = 0; i < 100; i++) {
+        if (0 == ::rmdir(path.c_str()) || ENOENT == errno) {
+            return ERRORCODE_OK;
+        }
+
+        if (EBUSY != errno) {
+            break;
+        }
+
+        ::usleep(10000);
+    }
+
+    return PERRORCODE(-1, errno, "failed in removing %s", path.c_str());
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Freeze() {
+    return Write("cgroup.freeze", "1");
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Thaw() {
+    return Write("cgroup.freeze", "0");
+}
+
+void UnifiedSubsystem::Kill() {
+    // cgroup.kill kills every task atomically, no race with fork
+    boost::filesystem::path path(this->Path());
+    path.append("cgroup.kill");
+
+    if (0 == ::access(path.c_str(), W_OK)
+            && 0 == baidu::galaxy::cgroup::Attach(path.string(), "1", false).Code()) {
+        return;
+    }
+
+    Subsystem::Kill();
+}
+
+baidu::galaxy::util::ErrorCode UnifiedSubsystem::Attach(pid_t pid) {
+    // no tasks file in v2, threads of a process can not be split
+    boost::filesystem::path proc_path(this->Path());
+    proc_path.append("cgroup.procs");
+    boost::system::error_code ec;
+
+    if (!boost::filesystem::exists(proc_path, ec)) {
+        return ERRORCODE(-1, "no such file %s",
+                proc_path.string().c_str());
+    }
+
+    return baidu::galaxy::cgroup::Attach(proc_path.string(), int64_t(pid), true);
+}
+
+}
+}
+}
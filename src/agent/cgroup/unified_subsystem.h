@@ -0,0 +1,51 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "freezer_subsystem.h"
+
+#include <stdint.h>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class BlkioThrottle;
+}
+
+namespace cgroup {
+
+// cgroup v2: one directory per container under <cgroup_root_path>/galaxy
+// carries cpu, memory and io limits, and freezes by cgroup.freeze,
+// so it stands for the freezer of the container as well.
+class UnifiedSubsystem : public FreezerSubsystem {
+public:
+    UnifiedSubsystem();
+    ~UnifiedSubsystem();
+
+    std::string Name();
+    std::string Path();
+    baidu::galaxy::util::ErrorCode Construct();
+    baidu::galaxy::util::ErrorCode Destroy();
+    boost::shared_ptr<Subsystem> Clone();
+
+    baidu::galaxy::util::ErrorCode Freeze();
+    baidu::galaxy::util::ErrorCode Thaw();
+    void Kill();
+    baidu::galaxy::util::ErrorCode Attach(pid_t pid);
+
+    // cpu.shares -> cpu.weight, blkio.weight -> io.weight, same as systemd
+    static int64_t ShareToWeight(int64_t share);
+    static int64_t BlkioToIoWeight(int64_t weight);
+    // content of cpu.max
+    static std::string CpuMax(int64_t millicore);
+    // line of io.max, eg: "8:0 rbps=1048576 wbps=max riops=max wiops=100"
+    static std::string IoMax(const baidu::galaxy::proto::BlkioThrottle& throttle);
+
+private:
+    baidu::galaxy::util::ErrorCode Write(const std::string& file, const std::string& value);
+};
+
+}
+}
+}
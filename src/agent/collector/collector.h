@@ -5,6 +5,9 @@
 #pragma once
 #include "util/error_code.h"
 
+#include <stdint.h>
+#include <string>
+
 namespace baidu {
 namespace galaxy {
 namespace collector {
@@ -19,6 +22,10 @@ public:
     virtual bool Enabled() = 0;
     virtual bool Equal(const Collector*) = 0;
     virtual int Cycle() = 0;  // unit second
+    // override for sub-second cycles
+    virtual int64_t CycleInMs() {
+        return Cycle() * 1000L;
+    }
     virtual std::string Name() const = 0;
 };
 }
@@ -3,16 +3,24 @@
 // found in the LICENSE file.
 
 #include "collector_engine.h"
+#include "protocol/galaxy.pb.h"
 #include "timer.h"
 #include "thread_pool.h"
 #include "thread.h"
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <boost/bind.hpp>
 
 #include <assert.h>
 #include <unistd.h>
 
+#include <algorithm>
+
+DECLARE_int32(collector_tick_interval);
+DECLARE_int32(collector_threads);
+DECLARE_int32(slow_collector_threads);
+
 namespace baidu {
 namespace galaxy {
 namespace collector {
@@ -34,6 +42,17 @@ boost::shared_ptr<CollectorEngine> CollectorEngine::GetInstance()
     return instance_;
 }
 
+TimerWheel<boost::shared_ptr<CollectorEngine::RuntimeCollector> >* CollectorEngine::Wheel()
+{
+    // mutex_ is held
+    if (NULL == wheel_.get()) {
+        int64_t tick = FLAGS_collector_tick_interval > 0 ? FLAGS_collector_tick_interval : 100;
+        wheel_.reset(new TimerWheel<boost::shared_ptr<RuntimeCollector> >(tick * 1000L,
+                        baidu::common::timer::get_micros()));
+    }
+    return wheel_.get();
+}
+
 baidu::galaxy::util::ErrorCode CollectorEngine::Register(boost::shared_ptr<Collector> collector, bool fast)
 {
     assert(NULL != collector.get());
@@ -46,9 +65,10 @@ baidu::galaxy::util::ErrorCode CollectorEngine::Register(boost::shared_ptr<Colle
         }
     }
 
-    boost::shared_ptr<CollectorEngine::RuntimeCollector> rc(new CollectorEngine::RuntimeCollector(collector));
-    rc->SetFast(fast);
-
+    boost::shared_ptr<CollectorEngine::RuntimeCollector> rc(new CollectorEngine::RuntimeCollector(collector, fast));
+    int64_t now = baidu::common::timer::get_micros();
+    rc->SetNextTime(now);
+    Wheel()->Add(rc, now);
     collectors_.push_back(rc);
     return ERRORCODE_OK;
 }
@@ -72,6 +92,17 @@ int CollectorEngine::Setup()
     assert(!running_);
 //return 0;
 
+    int threads = FLAGS_collector_threads;
+    if (threads <= 0) {
+        // collections are short file reads, one thread per core is enough
+        threads = std::max(2L, std::min(sysconf(_SC_NPROCESSORS_ONLN), 32L));
+    }
+    fast_collector_pool_.reset(new baidu::common::ThreadPool(threads));
+    collector_pool_.reset(new baidu::common::ThreadPool(std::max(1, FLAGS_slow_collector_threads)));
+    LOG(INFO) << "collector engine starts with " << threads << " fast threads, "
+              << FLAGS_collector_tick_interval << "ms tick";
+
+    running_ = true;
     int ret = -1;
     if (main_collect_thread_.Start(boost::bind(&CollectorEngine::CollectMainThreadRoutine, this))) {
         ret = 0;
@@ -87,75 +118,100 @@ void CollectorEngine::TearDown()
 
 void CollectorEngine::CollectMainThreadRoutine()
 {
-    running_ = true;
+    std::vector<boost::shared_ptr<RuntimeCollector> > expired;
     while (running_) {
         int64_t now = baidu::common::timer::get_micros();
+        int64_t tick = 0;
         {
             boost::mutex::scoped_lock lock(mutex_);
-            VLOG(10) << "collector size: " << collectors_.size();
-            std::list<boost::shared_ptr<RuntimeCollector> >::iterator iter = collectors_.begin();
-            for (; iter != collectors_.end(); iter++) {
-                VLOG(10) << (*iter)->ToString();
-                if (!(*iter)->Enabled()) {
-                    continue;
-                }
-
-                if ((*iter)->Expired(now)) {
-                    if ((*iter)->IsRunning()) {
-                        LOG(WARNING) << "last collection is not commplete: "
-                                     << (*iter)->GetCollector()->Name();
-                        continue;
-                    }
-
-                    if (!(*iter)->GetCollector()->Enabled()) {
-                        LOG(WARNING) << "collector is not enabled: "
-                                     << (*iter)->GetCollector()->Name();
-                        continue;
-                    }
-
-                    if ((*iter)->Fast()) {
-                        (*iter)->SetRunning(true);
-                        fast_collector_pool_.AddTask(boost::bind(&CollectorEngine::CollectRoutine, this, *iter));
-                        (*iter)->UpdateNextRuntime();
-                        VLOG(10) << (*iter)->Name() << " set fast running true";
-                    } else {
-                        if (collector_pool_.PendingNum() == 0){
-                            collector_pool_.AddTask(boost::bind(&CollectorEngine::CollectRoutine,
-                                            this, 
-                                            *iter));
-                            (*iter)->UpdateNextRuntime();
-                            VLOG(10) << (*iter)->Name() << " set slow running true";
-                        } else {
-                            LOG(INFO) << "no thread for slow collector: " << (*iter)->Name();
-                        }
-                    }
-                }
-            }
+            TimerWheel<boost::shared_ptr<RuntimeCollector> >* wheel = Wheel();
+            tick = wheel->Tick();
+            expired.clear();
+            wheel->Advance(now, expired);
+            VLOG(10) << "collector size: " << collectors_.size()
+                     << ", expired: " << expired.size();
+            Dispatch(now, expired);
+        }
+        expired.clear();
 
-            iter = collectors_.begin();
-            while (iter != collectors_.end()) {
-                if (!(*iter)->Enabled() && (*iter)->IsRunning()) {
-                    LOG(WARNING) << "collector " << (*iter)->Name() << " is disabled, but is running";
-                    iter++;
-                } else if (!(*iter)->Enabled()) {
-                    collectors_.erase(iter++);
-                } else {
-                    iter++;
-                }
+        // wake up at the beginning of next tick
+        now = baidu::common::timer::get_micros();
+        ::usleep(tick - now % tick);
+    }
+}
+
+void CollectorEngine::Dispatch(int64_t now, const std::vector<boost::shared_ptr<RuntimeCollector> >& expired)
+{
+    // mutex_ is held
+    for (size_t i = 0; i < expired.size(); i++) {
+        const boost::shared_ptr<RuntimeCollector>& rc = expired[i];
+
+        if (!rc->GetCollector()->Enabled()) {
+            // a running collection holds its own reference
+            VLOG(10) << "remove disabled collector " << rc->Name();
+            collectors_.remove(rc);
+            continue;
+        }
+
+        if (!rc->TrySetRunning()) {
+            rc->OnOverrun();
+            LOG(WARNING) << "last collection is not commplete: " << rc->Name();
+        } else {
+            rc->OnDispatch(now - rc->NextTime());
+            if (rc->Fast()) {
+                fast_collector_pool_->AddTask(boost::bind(&CollectorEngine::CollectRoutine, this, rc));
+            } else {
+                collector_pool_->AddTask(boost::bind(&CollectorEngine::CollectRoutine, this, rc));
             }
         }
-        ::sleep(1);
+
+        rc->UpdateNextRuntime(now);
+        Wheel()->Add(rc, rc->NextTime());
     }
 }
 
 void CollectorEngine::CollectRoutine(boost::shared_ptr<CollectorEngine::RuntimeCollector> rc)
 {
     int64_t t0 = baidu::common::timer::get_micros();
-    VLOG(10) << "begin collect " << rc->Name();
     rc->GetCollector()->Collect();
-    rc->SetRunning(false);
     int64_t t1 = baidu::common::timer::get_micros();
-    VLOG(10) << rc->Name() << " set running false: " << t1 - t0;
+    rc->OnDone(t1 - t0);
+    rc->SetRunning(false);
+    VLOG(10) << rc->Name() << " collect cost: " << t1 - t0;
+}
+
+void CollectorEngine::GetStatistics(std::vector<CollectorStatistics>& stats)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    stats.resize(collectors_.size());
+    std::list<boost::shared_ptr<RuntimeCollector> >::iterator iter = collectors_.begin();
+    for (size_t i = 0; iter != collectors_.end(); iter++, i++) {
+        (*iter)->GetStatistics(stats[i]);
+    }
+}
+
+void CollectorEngine::GetStatistics(baidu::galaxy::proto::CollectorMetrix* metrix)
+{
+    assert(NULL != metrix);
+    std::vector<CollectorStatistics> stats;
+    GetStatistics(stats);
+    int64_t overruns = 0L;
+    int64_t max_lag = 0L;
+    int64_t max_duration = 0L;
+    std::string slowest;
+    for (size_t i = 0; i < stats.size(); i++) {
+        overruns += stats[i].overruns;
+        max_lag = std::max(max_lag, stats[i].last_lag);
+        if (stats[i].last_duration > max_duration) {
+            max_duration = stats[i].last_duration;
+            slowest = stats[i].name;
+        }
+    }
+    metrix->set_collectors(stats.size());
+    metrix->set_overruns(overruns);
+    metrix->set_max_lag(max_lag);
+    metrix->set_max_duration(max_duration);
+    metrix->set_slowest(slowest);
 }
 
 }
@@ -4,7 +4,10 @@
 
 #pragma once
 #include "collector.h"
+#include "timer_wheel.h"
 #include "util/error_code.h"
+#include "boost/atomic.hpp"
+#include "boost/scoped_ptr.hpp"
 #include "boost/shared_ptr.hpp"
 #include "boost/thread/mutex.hpp"
 #include "thread.h"
@@ -14,12 +17,30 @@
 #include <stdint.h>
 
 #include <list>
+#include <string>
+#include <vector>
 
 
 namespace baidu {
 namespace galaxy {
+namespace proto {
+class CollectorMetrix;
+}
+
 namespace collector {
 
+struct CollectorStatistics {
+    std::string name;
+    bool fast;
+    int64_t cycle;          // unit ms
+    int64_t runs;
+    int64_t overruns;       // due while the last collection was still running
+    int64_t last_lag;       // dispatch time - due time, unit us
+    int64_t max_lag;
+    int64_t last_duration;  // unit us
+    int64_t max_duration;
+};
+
 class CollectorEngine {
 public:
     ~CollectorEngine();
@@ -29,99 +50,140 @@ public:
     int Setup();
     void TearDown();
 
+    void GetStatistics(std::vector<CollectorStatistics>& stats);
+    void GetStatistics(baidu::galaxy::proto::CollectorMetrix* metrix);
+
 private:
     CollectorEngine();
     static boost::shared_ptr<CollectorEngine> instance_;
 
+    // state shared by the scheduling thread and the pool thread running the
+    // collection, all counters are atomic so no lock is taken per collector
     class RuntimeCollector {
     public:
-        RuntimeCollector(boost::shared_ptr<Collector> collector) :
+        RuntimeCollector(boost::shared_ptr<Collector> collector, bool fast) :
             collector_(collector),
+            name_(collector->Name()),
+            fast_(fast),
             next_time_(0),
-            is_running_(false),
-            fast_(false) {
+            running_(false),
+            runs_(0),
+            overruns_(0),
+            last_lag_(0),
+            max_lag_(0),
+            last_duration_(0),
+            max_duration_(0) {
         }
 
-        bool Expired(int64_t now) {
-            boost::mutex::scoped_lock lock(mutex_);
-            return next_time_ <= now;
+        // return false if the last collection is still running
+        bool TrySetRunning() {
+            bool expected = false;
+            return running_.compare_exchange_strong(expected, true);
         }
 
-        bool IsRunning() {
-            boost::mutex::scoped_lock lock(mutex_);
-            return is_running_;
+        void SetRunning(bool r) {
+            running_.store(r);
         }
 
-        void SetRunning(bool r) {
-            boost::mutex::scoped_lock lock(mutex_);
-            is_running_ = r;
+        bool IsRunning() const {
+            return running_.load();
         }
 
-        void SetFast(bool fast) {
-            boost::mutex::scoped_lock lock(mutex_);
-            fast_ = fast;
+        bool Fast() const {
+            return fast_;
+        }
 
+        const std::string& Name() const {
+            return name_;
         }
 
-        void UpdateNextRuntime() {
-            boost::mutex::scoped_lock lock(mutex_);
-            next_time_ += collector_->Cycle() * 1000000L;
-            int64_t now = baidu::common::timer::get_micros();
+        boost::shared_ptr<baidu::galaxy::collector::Collector> GetCollector() {
+            return collector_;
+        }
 
-            if (next_time_ < now) {
-                next_time_ = now;
+        // only touched by the scheduling thread
+        int64_t NextTime() const {
+            return next_time_;
+        }
+
+        void SetNextTime(int64_t t) {
+            next_time_ = t;
+        }
+
+        void UpdateNextRuntime(int64_t now) {
+            int64_t cycle = collector_->CycleInMs() * 1000L;
+
+            if (cycle <= 0) {
+                cycle = 1000000L;
             }
 
-            if (next_time_ > now + collector_->Cycle() * 1000000L * 2L) {
+            next_time_ += cycle;
+
+            if (next_time_ < now || next_time_ > now + cycle * 2L) {
                 next_time_ = now;
             }
-
         }
 
-        bool Fast() {
-            boost::mutex::scoped_lock lock(mutex_);
-            return fast_;
+        void OnDispatch(int64_t lag) {
+            runs_++;
+            last_lag_.store(lag);
+            UpdateMax(max_lag_, lag);
         }
 
-        bool Enabled() {
-            boost::mutex::scoped_lock lock(mutex_);
-            return collector_->Enabled();
+        void OnOverrun() {
+            overruns_++;
         }
 
-        std::string Name() {
-            boost::mutex::scoped_lock lock(mutex_);
-            return collector_->Name();
+        void OnDone(int64_t duration) {
+            last_duration_.store(duration);
+            UpdateMax(max_duration_, duration);
         }
 
-        boost::shared_ptr<baidu::galaxy::collector::Collector> GetCollector() {
-            return collector_;
+        void GetStatistics(CollectorStatistics& stat) {
+            stat.name = name_;
+            stat.fast = fast_;
+            stat.cycle = collector_->CycleInMs();
+            stat.runs = runs_.load();
+            stat.overruns = overruns_.load();
+            stat.last_lag = last_lag_.load();
+            stat.max_lag = max_lag_.load();
+            stat.last_duration = last_duration_.load();
+            stat.max_duration = max_duration_.load();
         }
 
-        std::string ToString() {
-            boost::mutex::scoped_lock lock(mutex_);
-            std::stringstream ss;
-            ss << "name:" << collector_->Name() << " "
-                <<"addr:" << (int64_t)collector_.get() << " "
-                << "next_time:"<< next_time_ << " "
-                << "running: " << is_running_;
-            return ss.str();
+    private:
+        static void UpdateMax(boost::atomic<int64_t>& max, int64_t value) {
+            int64_t old = max.load();
+
+            while (value > old && !max.compare_exchange_weak(old, value)) {
+            }
         }
 
-    private:
         boost::shared_ptr<baidu::galaxy::collector::Collector> collector_;
+        const std::string name_;
+        const bool fast_;
         int64_t next_time_;
-        bool is_running_;
-        bool fast_;
-        boost::mutex mutex_;
+        boost::atomic<bool> running_;
+        boost::atomic<int64_t> runs_;
+        boost::atomic<int64_t> overruns_;
+        boost::atomic<int64_t> last_lag_;
+        boost::atomic<int64_t> max_lag_;
+        boost::atomic<int64_t> last_duration_;
+        boost::atomic<int64_t> max_duration_;
     };
 
     void CollectRoutine(boost::shared_ptr<RuntimeCollector> rc);
     void CollectMainThreadRoutine();
+    void Dispatch(int64_t now, const std::vector<boost::shared_ptr<RuntimeCollector> >& expired);
+    TimerWheel<boost::shared_ptr<RuntimeCollector> >* Wheel();
+
     std::list<boost::shared_ptr<RuntimeCollector> > collectors_;
+    // created on first use, flags are not parsed yet when instance_ is built
+    boost::scoped_ptr<TimerWheel<boost::shared_ptr<RuntimeCollector> > > wheel_;
     boost::mutex mutex_;
-    bool running_;
-    baidu::common::ThreadPool fast_collector_pool_;  // for fast
-    baidu::common::ThreadPool collector_pool_;  // for slow
+    boost::atomic<bool> running_;
+    boost::scoped_ptr<baidu::common::ThreadPool> fast_collector_pool_;  // for fast
+    boost::scoped_ptr<baidu::common::ThreadPool> collector_pool_;  // for slow
     baidu::common::Thread main_collect_thread_;
 
 };
@@ -0,0 +1,463 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "host_sampler.h"
+#include "util/input_stream_file.h"
+#include "protocol/galaxy.pb.h"
+#include "timer.h"
+
+#include "boost/algorithm/string/predicate.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+
+namespace baidu {
+namespace galaxy {
+namespace collector {
+
+static const long CPU_CORES = sysconf(_SC_NPROCESSORS_CONF);
+
+boost::shared_ptr<HostSampler> HostSampler::instance_(new HostSampler());
+
+HostSampler::HostSampler() :
+    enabled_(false) {
+}
+
+HostSampler::~HostSampler() {
+}
+
+boost::shared_ptr<HostSampler> HostSampler::GetInstance() {
+    assert(NULL != instance_.get());
+    return instance_;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::Collect() {
+    boost::shared_ptr<HostSnapshot> snapshot(new HostSnapshot());
+    std::string content;
+    baidu::galaxy::util::ErrorCode ec = ReadFile("/proc/stat", content);
+
+    if (ec.Code() == 0) {
+        ec = ParseStat(content, snapshot.get());
+    }
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    ec = ReadFile("/proc/meminfo", content);
+
+    if (ec.Code() == 0) {
+        ec = ParseMeminfo(content, snapshot.get());
+    }
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    ec = ReadFile("/proc/loadavg", content);
+
+    if (ec.Code() == 0) {
+        ec = ParseLoadavg(content, snapshot.get());
+    }
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    ec = ReadFile("/proc/diskstats", content);
+
+    if (ec.Code() == 0) {
+        ec = ParseDiskstats(content, "/sys/class/block", snapshot.get());
+    }
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    // optional, kernels before 4.20 or booted with psi=0 have no /proc/pressure
+    static const char* const pressure_files[] = {"/proc/pressure/cpu", "/proc/pressure/memory", "/proc/pressure/io"};
+    PressureStat* pressures[] = {&snapshot->cpu_pressure, &snapshot->memory_pressure, &snapshot->io_pressure};
+
+    for (size_t i = 0; i < sizeof(pressures) / sizeof(pressures[0]); i++) {
+        if (0 == ReadFile(pressure_files[i], content).Code()) {
+            ParsePressure(content.data(), content.data() + content.size(), pressures[i]);
+        }
+    }
+
+    snapshot->time = baidu::common::timer::get_micros();
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (NULL != snapshot_.get()) {
+        CalculateRate(*snapshot_, snapshot.get());
+        snapshot->version = snapshot_->version + 1;
+    } else {
+        snapshot->version = 1;
+    }
+
+    snapshot_ = snapshot;
+    return ERRORCODE_OK;
+}
+
+void HostSampler::Enable(bool enable) {
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = enable;
+}
+
+bool HostSampler::Enabled() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return enabled_;
+}
+
+bool HostSampler::Equal(const Collector* c) {
+    assert(NULL != c);
+    return (int64_t)this == (int64_t)c;
+}
+
+int HostSampler::Cycle() {
+    return 1;
+}
+
+std::string HostSampler::Name() const {
+    return "host_sampler";
+}
+
+boost::shared_ptr<const HostSnapshot> HostSampler::Snapshot() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return snapshot_;
+}
+
+void HostSampler::Statistics(baidu::galaxy::proto::HostMetrix* metrix) {
+    assert(NULL != metrix);
+    boost::shared_ptr<const HostSnapshot> snapshot = Snapshot();
+
+    if (NULL == snapshot.get()) {
+        return;
+    }
+
+    metrix->set_time(snapshot->time);
+
+    if (snapshot->cpu_used_in_millicore >= 0) {
+        metrix->set_cpu_used_in_millicore(snapshot->cpu_used_in_millicore);
+    }
+
+    metrix->set_memory_total_in_byte(snapshot->memory_total);
+    metrix->set_memory_available_in_byte(snapshot->memory_available);
+    metrix->set_memory_cached_in_byte(snapshot->memory_cached);
+    metrix->set_load1(snapshot->load1);
+    metrix->set_load5(snapshot->load5);
+    metrix->set_load15(snapshot->load15);
+    std::map<std::string, DiskStat>::const_iterator iter = snapshot->disks.begin();
+
+    for (; iter != snapshot->disks.end(); iter++) {
+        baidu::galaxy::proto::DiskMetrix* disk = metrix->add_disks();
+        disk->set_device(iter->first);
+        disk->set_read_bytes_ps(iter->second.read_bytes_ps);
+        disk->set_write_bytes_ps(iter->second.write_bytes_ps);
+        disk->set_io_util(iter->second.io_util);
+    }
+
+    if (snapshot->cpu_pressure.valid) {
+        FillPressure(snapshot->cpu_pressure, metrix->mutable_cpu_pressure());
+    }
+
+    if (snapshot->memory_pressure.valid) {
+        FillPressure(snapshot->memory_pressure, metrix->mutable_memory_pressure());
+    }
+
+    if (snapshot->io_pressure.valid) {
+        FillPressure(snapshot->io_pressure, metrix->mutable_io_pressure());
+    }
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::SystemCpuTime(int64_t max_age, int64_t& cpu_time) {
+    boost::shared_ptr<const HostSnapshot> snapshot = Snapshot();
+
+    if (NULL != snapshot.get()
+            && snapshot->time + max_age >= baidu::common::timer::get_micros()) {
+        cpu_time = snapshot->cpu_total_time;
+        return ERRORCODE_OK;
+    }
+
+    // sampler is not running or lags behind
+    std::string content;
+    baidu::galaxy::util::ErrorCode ec = ReadFile("/proc/stat", content);
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    HostSnapshot tmp;
+    ec = ParseStat(content, &tmp);
+
+    if (ec.Code() != 0) {
+        return ERRORCODE(-1, "%s", ec.Message().c_str());
+    }
+
+    cpu_time = tmp.cpu_total_time;
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ReadFile(const std::string& path, std::string& content) {
+    content.clear();
+    baidu::galaxy::file::InputStreamFile in(path);
+
+    if (!in.IsOpen()) {
+        baidu::galaxy::util::ErrorCode ec = in.GetLastError();
+        return ERRORCODE(-1, "open %s failed: %s", path.c_str(), ec.Message().c_str());
+    }
+
+    while (!in.Eof()) {
+        char buf[4096];
+        size_t size = sizeof buf;
+        baidu::galaxy::util::ErrorCode ec = in.Read(buf, size);
+
+        if (ec.Code() != 0) {
+            return ERRORCODE(-1, "read %s failed: %s", path.c_str(), ec.Message().c_str());
+        }
+
+        content.append(buf, size);
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ParseStat(const std::string& content, HostSnapshot* snapshot) {
+    assert(NULL != snapshot);
+
+    //cpu  19782368743 69952042 1588879335 90754227704 229233079 0 136086465 0 0
+    if (!boost::starts_with(content, "cpu ")) {
+        return ERRORCODE(-1, "format error: /proc/stat");
+    }
+
+    long long int t[9] = {0L};
+    int n = sscanf(content.c_str(), "cpu %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+            &t[0], &t[1], &t[2], &t[3], &t[4], &t[5], &t[6], &t[7], &t[8]);
+
+    if (n < 4) {
+        return ERRORCODE(-1, "format error: /proc/stat");
+    }
+
+    snapshot->cpu_total_time = 0L;
+
+    for (int i = 0; i < n; i++) {
+        snapshot->cpu_total_time += t[i];
+    }
+
+    // idle + iowait
+    snapshot->cpu_idle_time = t[3] + t[4];
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ParseMeminfo(const std::string& content, HostSnapshot* snapshot) {
+    assert(NULL != snapshot);
+    std::stringstream ss(content);
+    std::string line;
+    bool has_available = false;
+    int64_t buffers = 0L;
+
+    while (std::getline(ss, line)) {
+        char key[64];
+        long long int value = 0L;
+
+        //MemTotal:       16318812 kB
+        if (2 != sscanf(line.c_str(), "%63[^:]: %lld", key, &value)) {
+            continue;
+        }
+
+        std::string k(key);
+        value *= 1024L;
+
+        if (k == "MemTotal") {
+            snapshot->memory_total = value;
+        } else if (k == "MemFree") {
+            snapshot->memory_free = value;
+        } else if (k == "MemAvailable") {
+            snapshot->memory_available = value;
+            has_available = true;
+        } else if (k == "Buffers") {
+            buffers = value;
+        } else if (k == "Cached") {
+            snapshot->memory_cached = value;
+        }
+    }
+
+    if (snapshot->memory_total <= 0) {
+        return ERRORCODE(-1, "format error: /proc/meminfo");
+    }
+
+    // kernels before 3.14 have no MemAvailable
+    if (!has_available) {
+        snapshot->memory_available = snapshot->memory_free + buffers + snapshot->memory_cached;
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ParseLoadavg(const std::string& content, HostSnapshot* snapshot) {
+    assert(NULL != snapshot);
+
+    //0.20 0.18 0.12 1/80 11206
+    if (3 != sscanf(content.c_str(), "%lf %lf %lf",
+            &snapshot->load1,
+            &snapshot->load5,
+            &snapshot->load15)) {
+        return ERRORCODE(-1, "format error: /proc/loadavg");
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ParseDiskstats(const std::string& content,
+        const std::string& block_path,
+        HostSnapshot* snapshot) {
+    assert(NULL != snapshot);
+    std::stringstream ss(content);
+    std::string line;
+
+    while (std::getline(ss, line)) {
+        int major = 0;
+        int minor = 0;
+        char name[64];
+        long long int v[10] = {0L};
+
+        //   8       0 sda 1234 0 5678 100 2345 0 6789 200 0 300 300
+        if (13 != sscanf(line.c_str(), "%d %d %63s %lld %lld %lld %lld %lld %lld %lld %lld %lld %lld",
+                &major, &minor, name,
+                &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9])) {
+            continue;
+        }
+
+        std::string device(name);
+
+        if (boost::starts_with(device, "loop") || boost::starts_with(device, "ram")) {
+            continue;
+        }
+
+        // count the whole disk only, names do not tell partitions from
+        // disks such as dm-10 and nvme0n10
+        const std::string partition = block_path + "/" + device + "/partition";
+
+        if (0 == ::access(partition.c_str(), F_OK)) {
+            continue;
+        }
+
+        DiskStat& stat = snapshot->disks[device];
+        stat.sectors_read = v[2];
+        stat.sectors_written = v[6];
+        stat.io_ticks = v[9];
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode HostSampler::ParsePressure(const char* begin, const char* end, PressureStat* stat) {
+    assert(NULL != stat);
+    *stat = PressureStat();
+    const char* p = begin;
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+
+        if (NULL == eol) {
+            eol = end;
+        }
+
+        // some avg10=0.12 avg60=0.05 avg300=0.00 total=123456
+        char line[256];
+        size_t len = std::min((size_t)(eol - p), sizeof line - 1);
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p = eol + 1;
+        char kind[8];
+        double avg10 = 0.0;
+        double avg60 = 0.0;
+        double avg300 = 0.0;
+        long long int total = 0L;
+
+        if (5 != sscanf(line, "%7s avg10=%lf avg60=%lf avg300=%lf total=%lld",
+                kind, &avg10, &avg60, &avg300, &total)) {
+            continue;
+        }
+
+        if (0 == strcmp(kind, "some")) {
+            stat->some_avg10 = avg10;
+            stat->some_avg60 = avg60;
+            stat->some_total = total;
+            stat->valid = true;
+        } else if (0 == strcmp(kind, "full")) {
+            // the host wide cpu file has no full line before 5.13
+            stat->full_avg10 = avg10;
+            stat->full_avg60 = avg60;
+            stat->full_total = total;
+        }
+    }
+
+    if (!stat->valid) {
+        return ERRORCODE(-1, "format error: pressure");
+    }
+
+    return ERRORCODE_OK;
+}
+
+void HostSampler::FillPressure(const PressureStat& stat, baidu::galaxy::proto::Pressure* pressure) {
+    assert(NULL != pressure);
+    pressure->set_some_avg10(stat.some_avg10);
+    pressure->set_some_avg60(stat.some_avg60);
+    pressure->set_some_total(stat.some_total);
+    pressure->set_full_avg10(stat.full_avg10);
+    pressure->set_full_avg60(stat.full_avg60);
+    pressure->set_full_total(stat.full_total);
+}
+
+void HostSampler::CalculateRate(const HostSnapshot& last, HostSnapshot* snapshot) {
+    assert(NULL != snapshot);
+    int64_t total = snapshot->cpu_total_time - last.cpu_total_time;
+    int64_t idle = snapshot->cpu_idle_time - last.cpu_idle_time;
+
+    if (total > 0 && idle >= 0 && idle <= total) {
+        snapshot->cpu_used_in_millicore = 1000L * CPU_CORES * (total - idle) / total;
+    }
+
+    int64_t interval = snapshot->time - last.time;
+
+    if (interval <= 0) {
+        return;
+    }
+
+    std::map<std::string, DiskStat>::iterator iter = snapshot->disks.begin();
+
+    for (; iter != snapshot->disks.end(); iter++) {
+        std::map<std::string, DiskStat>::const_iterator l = last.disks.find(iter->first);
+
+        if (l == last.disks.end()) {
+            continue;
+        }
+
+        DiskStat& stat = iter->second;
+        const DiskStat& last_stat = l->second;
+
+        if (stat.sectors_read >= last_stat.sectors_read) {
+            stat.read_bytes_ps = (stat.sectors_read - last_stat.sectors_read) * 512L * 1000000L / interval;
+        }
+
+        if (stat.sectors_written >= last_stat.sectors_written) {
+            stat.write_bytes_ps = (stat.sectors_written - last_stat.sectors_written) * 512L * 1000000L / interval;
+        }
+
+        if (stat.io_ticks >= last_stat.io_ticks) {
+            int64_t util = (stat.io_ticks - last_stat.io_ticks) * 1000000L / interval;
+            stat.io_util = util > 1000 ? 1000 : (int)util;
+        }
+    }
+}
+
+}
+}
+}
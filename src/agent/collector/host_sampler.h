@@ -0,0 +1,156 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "collector.h"
+#include "util/error_code.h"
+#include "boost/shared_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class HostMetrix;
+class Pressure;
+}
+
+namespace collector {
+
+struct DiskStat {
+    DiskStat() :
+        sectors_read(0L),
+        sectors_written(0L),
+        io_ticks(0L),
+        read_bytes_ps(0L),
+        write_bytes_ps(0L),
+        io_util(0) {
+    }
+
+    // raw counters of /proc/diskstats
+    int64_t sectors_read;
+    int64_t sectors_written;
+    int64_t io_ticks; // unit ms
+
+    // rates against the previous snapshot
+    int64_t read_bytes_ps;
+    int64_t write_bytes_ps;
+    int io_util; // unit permille
+};
+
+// pressure stall information, see Documentation/accounting/psi.rst
+struct PressureStat {
+    PressureStat() :
+        valid(false),
+        some_avg10(0.0),
+        some_avg60(0.0),
+        some_total(0L),
+        full_avg10(0.0),
+        full_avg60(0.0),
+        full_total(0L) {
+    }
+
+    bool valid;
+    double some_avg10; // unit percent
+    double some_avg60;
+    int64_t some_total; // unit us
+    double full_avg10;
+    double full_avg60;
+    int64_t full_total;
+};
+
+// host level counters read once per tick, shared by all collectors
+struct HostSnapshot {
+    HostSnapshot() :
+        version(0L),
+        time(0L),
+        cpu_total_time(0L),
+        cpu_idle_time(0L),
+        cpu_used_in_millicore(-1L),
+        memory_total(0L),
+        memory_free(0L),
+        memory_available(0L),
+        memory_cached(0L),
+        load1(0.0),
+        load5(0.0),
+        load15(0.0) {
+    }
+
+    int64_t version;
+    int64_t time; // unit us
+
+    // /proc/stat, unit jiffies
+    int64_t cpu_total_time;
+    int64_t cpu_idle_time;
+    int64_t cpu_used_in_millicore; // -1 until two snapshots are taken
+
+    // /proc/meminfo, unit byte
+    int64_t memory_total;
+    int64_t memory_free;
+    int64_t memory_available;
+    int64_t memory_cached;
+
+    // /proc/loadavg
+    double load1;
+    double load5;
+    double load15;
+
+    // /proc/diskstats, device name -> stat
+    std::map<std::string, DiskStat> disks;
+
+    // /proc/pressure, invalid if the kernel has no psi
+    PressureStat cpu_pressure;
+    PressureStat memory_pressure;
+    PressureStat io_pressure;
+};
+
+class HostSampler : public Collector {
+public:
+    ~HostSampler();
+    static boost::shared_ptr<HostSampler> GetInstance();
+
+    baidu::galaxy::util::ErrorCode Collect();
+    void Enable(bool enable);
+    bool Enabled();
+    bool Equal(const Collector* c);
+    int Cycle();
+    std::string Name() const;
+
+    // latest snapshot, NULL before the first successful collection
+    boost::shared_ptr<const HostSnapshot> Snapshot();
+    void Statistics(baidu::galaxy::proto::HostMetrix* metrix);
+
+    // total cpu time of the host from the snapshot if it is not older than
+    // max_age(unit us), otherwise read /proc/stat directly
+    baidu::galaxy::util::ErrorCode SystemCpuTime(int64_t max_age, int64_t& cpu_time);
+
+    static baidu::galaxy::util::ErrorCode ParseStat(const std::string& content, HostSnapshot* snapshot);
+    static baidu::galaxy::util::ErrorCode ParseMeminfo(const std::string& content, HostSnapshot* snapshot);
+    static baidu::galaxy::util::ErrorCode ParseLoadavg(const std::string& content, HostSnapshot* snapshot);
+    // partitions are told by <block_path>/<name>/partition, as in /sys/class/block
+    static baidu::galaxy::util::ErrorCode ParseDiskstats(const std::string& content,
+            const std::string& block_path,
+            HostSnapshot* snapshot);
+    // content of /proc/pressure/<resource> or <cgroup>/<resource>.pressure
+    static baidu::galaxy::util::ErrorCode ParsePressure(const char* begin, const char* end, PressureStat* stat);
+    static void FillPressure(const PressureStat& stat, baidu::galaxy::proto::Pressure* pressure);
+    static void CalculateRate(const HostSnapshot& last, HostSnapshot* snapshot);
+
+private:
+    HostSampler();
+    static boost::shared_ptr<HostSampler> instance_;
+    static baidu::galaxy::util::ErrorCode ReadFile(const std::string& path, std::string& content);
+
+    boost::mutex mutex_;
+    bool enabled_;
+    boost::shared_ptr<const HostSnapshot> snapshot_;
+};
+
+}
+}
+}
@@ -0,0 +1,187 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrix_ring.h"
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace baidu {
+namespace galaxy {
+namespace collector {
+
+MetrixRing::MetrixRing(const std::vector<Aggregation>& aggregations, int capacity, int block_size) :
+    aggregations_(aggregations),
+    block_size_(block_size > 0 ? block_size : 64),
+    // one more block so that a full window is kept while the last block fills
+    max_blocks_((std::max(capacity, 1) + block_size_ - 1) / block_size_ + 1),
+    size_(0) {
+}
+
+void MetrixRing::PutVarint(int64_t value, std::string& out) {
+    // zigzag, small negative deltas stay short
+    uint64_t v = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+
+    while (v >= 0x80) {
+        out.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+
+    out.push_back((char)v);
+}
+
+bool MetrixRing::GetVarint(const std::string& in, size_t& pos, int64_t& value) {
+    uint64_t v = 0;
+
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint64_t b = (unsigned char)in[pos++];
+        v |= (b & 0x7f) << shift;
+
+        if (b < 0x80) {
+            value = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void MetrixRing::Append(int64_t time, const int64_t values[]) {
+    assert(NULL != values);
+    const size_t columns = aggregations_.size() + 1;
+
+    if (blocks_.empty() || blocks_.back().count >= block_size_) {
+        if (blocks_.size() >= max_blocks_) {
+            size_ -= blocks_.front().count;
+            blocks_.pop_front();
+        }
+
+        blocks_.push_back(Block());
+        Block& b = blocks_.back();
+        b.count = 0;
+        b.columns.resize(columns);
+        b.last.resize(columns, 0L);
+
+        for (size_t i = 0; i < columns; i++) {
+            b.columns[i].reserve(block_size_ * 2);
+        }
+    }
+
+    Block& b = blocks_.back();
+
+    for (size_t i = 0; i < columns; i++) {
+        int64_t v = 0 == i ? time : values[i - 1];
+        PutVarint(v - b.last[i], b.columns[i]);
+        b.last[i] = v;
+    }
+
+    b.count++;
+    size_++;
+}
+
+int64_t MetrixRing::LastTime() const {
+    if (blocks_.empty()) {
+        return -1L;
+    }
+
+    return blocks_.back().last[0];
+}
+
+size_t MetrixRing::Bytes() const {
+    size_t ret = 0;
+
+    for (size_t i = 0; i < blocks_.size(); i++) {
+        for (size_t j = 0; j < blocks_[i].columns.size(); j++) {
+            ret += blocks_[i].columns[j].size();
+        }
+    }
+
+    return ret;
+}
+
+void MetrixRing::Query(int64_t start, int64_t end, int64_t interval,
+        std::vector<int64_t>& times,
+        std::vector<std::vector<int64_t> >& rows) const {
+    const size_t columns = aggregations_.size() + 1;
+    std::vector<int64_t> sample(columns);
+    std::vector<size_t> pos(columns);
+    // merging state of current interval
+    int64_t bucket = -1L;
+    int merged = 0;
+    std::vector<int64_t> acc(columns);
+
+    for (size_t i = 0; i < blocks_.size(); i++) {
+        const Block& b = blocks_[i];
+
+        // skip whole blocks out of range
+        if (b.last[0] < start) {
+            continue;
+        }
+
+        std::fill(sample.begin(), sample.end(), 0L);
+        std::fill(pos.begin(), pos.end(), 0);
+
+        for (int n = 0; n < b.count; n++) {
+            for (size_t c = 0; c < columns; c++) {
+                int64_t delta = 0;
+                bool ok = GetVarint(b.columns[c], pos[c], delta);
+                assert(ok);
+                (void)ok;
+                sample[c] += delta;
+            }
+
+            int64_t t = sample[0];
+
+            if (t < start) {
+                continue;
+            }
+
+            if (t >= end) {
+                break;
+            }
+
+            int64_t key = interval > 0 ? t / interval : t;
+
+            if (merged > 0 && key != bucket) {
+                times.push_back(acc[0]);
+                rows.push_back(std::vector<int64_t>(columns - 1));
+
+                for (size_t c = 1; c < columns; c++) {
+                    rows.back()[c - 1] = kAverage == aggregations_[c - 1] ? acc[c] / merged : acc[c];
+                }
+
+                merged = 0;
+            }
+
+            bucket = key;
+            acc[0] = t;
+
+            for (size_t c = 1; c < columns; c++) {
+                if (0 == merged || kLast == aggregations_[c - 1]) {
+                    acc[c] = sample[c];
+                } else if (kMax == aggregations_[c - 1]) {
+                    acc[c] = std::max(acc[c], sample[c]);
+                } else {
+                    acc[c] += sample[c];
+                }
+            }
+
+            merged++;
+        }
+    }
+
+    if (merged > 0) {
+        times.push_back(acc[0]);
+        rows.push_back(std::vector<int64_t>(columns - 1));
+
+        for (size_t c = 1; c < columns; c++) {
+            rows.back()[c - 1] = kAverage == aggregations_[c - 1] ? acc[c] / merged : acc[c];
+        }
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace collector {
+
+// Fixed size time series of several int64 columns. Samples are kept in
+// blocks, every column of a block is a byte string of zigzag varint deltas
+// against the previous sample, so slowly changing metrix cost one or two
+// bytes per sample. The oldest block is dropped when capacity is reached.
+class MetrixRing {
+public:
+    // how samples merged by downsampling are combined
+    enum Aggregation {
+        kAverage = 0,
+        kMax = 1,
+        kLast = 2       // for counters
+    };
+
+    MetrixRing(const std::vector<Aggregation>& aggregations, int capacity, int block_size = 64);
+
+    // time must not go backwards, values has one entry per column
+    void Append(int64_t time, const int64_t values[]);
+
+    // samples with start <= time < end; with interval > 0 samples falling in
+    // the same interval are merged into one stamped with the last time
+    void Query(int64_t start, int64_t end, int64_t interval,
+            std::vector<int64_t>& times,
+            std::vector<std::vector<int64_t> >& rows) const;
+
+    int Columns() const {
+        return (int)aggregations_.size();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // -1 if empty
+    int64_t LastTime() const;
+    // encoded bytes held
+    size_t Bytes() const;
+
+    static void PutVarint(int64_t value, std::string& out);
+    static bool GetVarint(const std::string& in, size_t& pos, int64_t& value);
+
+private:
+    struct Block {
+        int count;
+        // column 0 is time
+        std::vector<std::string> columns;
+        std::vector<int64_t> last;
+    };
+
+    const std::vector<Aggregation> aggregations_;
+    const int block_size_;
+    const size_t max_blocks_;
+    std::deque<Block> blocks_;
+    size_t size_;
+};
+
+}
+}
+}
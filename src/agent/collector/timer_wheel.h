@@ -0,0 +1,131 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <utility>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace collector {
+
+// Hierarchical timer wheel keyed by expire time (unit us). Level 0 has one
+// slot per tick, every upper level covers the whole lower level per slot and
+// is cascaded down when the lower level wraps, so Add and Advance cost O(1)
+// per entry no matter how many entries are waiting.
+template <typename T>
+class TimerWheel {
+public:
+    TimerWheel(int64_t tick, int64_t now) :
+        tick_(tick),
+        current_(now / tick),
+        size_(0) {
+        assert(tick > 0);
+
+        for (int i = 0; i < kLevels; i++) {
+            slots_[i].resize(kSlots);
+        }
+    }
+
+    int64_t Tick() const {
+        return tick_;
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    // entries already expired fire on the next tick
+    void Add(const T& value, int64_t expire_time) {
+        int64_t expire = expire_time / tick_;
+
+        if (expire <= current_) {
+            expire = current_ + 1;
+        }
+
+        Place(value, expire);
+        size_++;
+    }
+
+    // fire all entries expired at or before now, in order of ticks
+    void Advance(int64_t now, std::vector<T>& expired) {
+        int64_t target = now / tick_;
+
+        while (current_ < target) {
+            current_++;
+            Cascade(1);
+            std::list<std::pair<int64_t, T> >& slot = slots_[0][current_ & kMask];
+            typename std::list<std::pair<int64_t, T> >::iterator iter = slot.begin();
+
+            for (; iter != slot.end(); iter++) {
+                expired.push_back(iter->second);
+            }
+
+            size_ -= slot.size();
+            slot.clear();
+        }
+    }
+
+private:
+    static const int kLevels = 4;
+    static const int kBits = 6;
+    static const int kSlots = 1 << kBits;
+    static const int64_t kMask = kSlots - 1;
+
+    void Place(const T& value, int64_t expire) {
+        int64_t delta = expire - current_;
+        int level = 0;
+
+        while (level < kLevels - 1 && delta >= (1L << (kBits * (level + 1)))) {
+            level++;
+        }
+
+        // farther than the wheel covers, park in the farthest slot of the top
+        // level and place again when it is cascaded
+        int64_t slot_time = expire;
+
+        if (delta >= (1L << (kBits * kLevels))) {
+            slot_time = current_ + (1L << (kBits * kLevels)) - 1;
+        }
+
+        int64_t index = (slot_time >> (kBits * level)) & kMask;
+        slots_[level][index].push_back(std::make_pair(expire, value));
+    }
+
+    // move the slot of level that starts at current tick down one level
+    void Cascade(int level) {
+        if (level >= kLevels) {
+            return;
+        }
+
+        // lower level has not wrapped
+        if ((current_ & ((1L << (kBits * level)) - 1)) != 0) {
+            return;
+        }
+
+        Cascade(level + 1);
+        std::list<std::pair<int64_t, T> > entries;
+        entries.swap(slots_[level][(current_ >> (kBits * level)) & kMask]);
+        typename std::list<std::pair<int64_t, T> >::iterator iter = entries.begin();
+
+        for (; iter != entries.end(); iter++) {
+            Place(iter->second, iter->first);
+        }
+    }
+
+    int64_t tick_;
+    int64_t current_;
+    size_t size_;
+    std::vector<std::list<std::pair<int64_t, T> > > slots_[kLevels];
+};
+
+}
+}
+}
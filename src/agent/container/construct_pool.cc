@@ -0,0 +1,213 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "construct_pool.h"
+#include "protocol/galaxy.pb.h"
+#include "timer.h"
+
+#include "boost/bind.hpp"
+#include <glog/logging.h>
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+ConstructPool::ConstructPool(int threads, int per_disk, int capacity) :
+    threads_(std::max(1, threads)),
+    per_disk_(std::max(1, per_disk)),
+    capacity_((size_t)std::max(1, capacity)),
+    running_(false),
+    busy_(0),
+    rejected_(0L),
+    finished_(0L),
+    failed_(0L),
+    queue_latency_(0L),
+    max_queue_latency_(0L),
+    cgroup_latency_(0L),
+    volum_latency_(0L),
+    process_latency_(0L) {
+}
+
+ConstructPool::~ConstructPool() {
+    Stop();
+}
+
+void ConstructPool::Start() {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (running_) {
+        return;
+    }
+
+    running_ = true;
+
+    for (int i = 0; i < threads_; i++) {
+        workers_.create_thread(boost::bind(&ConstructPool::WorkRoutine, this));
+    }
+
+    LOG(INFO) << "construct pool started with " << threads_ << " threads, "
+              << per_disk_ << " per disk";
+}
+
+void ConstructPool::Stop() {
+    std::list<Job> dropped;
+    bool running = false;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        running = running_;
+        running_ = false;
+        dropped.swap(jobs_);
+        cond_.notify_all();
+    }
+
+    if (running) {
+        workers_.join_all();
+    }
+
+    if (!dropped.empty()) {
+        LOG(WARNING) << "construct pool stopped, cancel " << dropped.size() << " queued tasks";
+    }
+
+    for (std::list<Job>::iterator iter = dropped.begin(); iter != dropped.end(); iter++) {
+        if (iter->cancel) {
+            iter->cancel();
+        }
+    }
+}
+
+bool ConstructPool::Submit(const std::string& name,
+        int priority,
+        const std::vector<std::string>& disks,
+        const Task& task,
+        const Task& cancel) {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (jobs_.size() >= capacity_) {
+        rejected_++;
+        return false;
+    }
+
+    Job job;
+    job.name = name;
+    job.priority = priority;
+    job.submit_time = baidu::common::timer::get_micros();
+    job.disks = disks;
+    job.task = task;
+    job.cancel = cancel;
+    // keep the list in the order jobs are taken
+    std::list<Job>::iterator iter = jobs_.begin();
+
+    while (iter != jobs_.end() && iter->priority <= priority) {
+        iter++;
+    }
+
+    jobs_.insert(iter, job);
+    cond_.notify_one();
+    VLOG(10) << "submit construction of " << name << " with priority " << priority
+             << ", " << jobs_.size() << " queued";
+    return true;
+}
+
+bool ConstructPool::TakeRunnable(Job& job) {
+    for (std::list<Job>::iterator iter = jobs_.begin(); iter != jobs_.end(); iter++) {
+        bool busy = false;
+
+        for (size_t i = 0; i < iter->disks.size() && !busy; i++) {
+            std::map<std::string, int>::const_iterator disk = disk_running_.find(iter->disks[i]);
+            busy = disk_running_.end() != disk && disk->second >= per_disk_;
+        }
+
+        if (busy) {
+            continue;
+        }
+
+        job = *iter;
+        jobs_.erase(iter);
+
+        for (size_t i = 0; i < job.disks.size(); i++) {
+            disk_running_[job.disks[i]]++;
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+void ConstructPool::WorkRoutine() {
+    while (true) {
+        Job job;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            while (running_ && !TakeRunnable(job)) {
+                cond_.wait(lock);
+            }
+
+            if (!running_) {
+                return;
+            }
+
+            busy_++;
+            const int64_t latency = baidu::common::timer::get_micros() - job.submit_time;
+            queue_latency_ = Average(queue_latency_, latency);
+            max_queue_latency_ = std::max(max_queue_latency_, latency);
+        }
+
+        job.task();
+        boost::mutex::scoped_lock lock(mutex_);
+        busy_--;
+
+        for (size_t i = 0; i < job.disks.size(); i++) {
+            if (--disk_running_[job.disks[i]] <= 0) {
+                disk_running_.erase(job.disks[i]);
+            }
+        }
+
+        // jobs skipped for busy disks may be runnable now
+        cond_.notify_all();
+    }
+}
+
+int64_t ConstructPool::Average(int64_t avg, int64_t sample) {
+    // moving average over about the last 8 samples
+    return avg <= 0 ? sample : avg + (sample - avg) / 8;
+}
+
+void ConstructPool::RecordCost(bool ok, const ConstructCost& cost) {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (!ok) {
+        failed_++;
+        return;
+    }
+
+    finished_++;
+    cgroup_latency_ = Average(cgroup_latency_, cost.cgroup);
+    volum_latency_ = Average(volum_latency_, cost.volum);
+    process_latency_ = Average(process_latency_, cost.process);
+}
+
+void ConstructPool::Statistics(baidu::galaxy::proto::ConstructMetrix* metrix) {
+    assert(NULL != metrix);
+    boost::mutex::scoped_lock lock(mutex_);
+    metrix->set_queued((int32_t)jobs_.size());
+    metrix->set_running(busy_);
+    metrix->set_rejected(rejected_);
+    metrix->set_finished(finished_);
+    metrix->set_failed(failed_);
+    metrix->set_queue_latency(queue_latency_);
+    metrix->set_max_queue_latency(max_queue_latency_);
+    metrix->set_cgroup_latency(cgroup_latency_);
+    metrix->set_volum_latency(volum_latency_);
+    metrix->set_process_latency(process_latency_);
+}
+
+}
+}
+}
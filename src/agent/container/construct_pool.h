@@ -0,0 +1,96 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "icontainer.h"
+
+#include "boost/function.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class ConstructMetrix;
+}
+
+namespace container {
+
+// Runs container constructions off the rpc threads. Tasks are taken by
+// priority (smaller first, same as JobType) and then in order of submit,
+// skipping a task while any disk it touches already has per_disk tasks
+// running, so one slow disk does not hold all the threads.
+class ConstructPool : public boost::noncopyable {
+public:
+    typedef boost::function<void ()> Task;
+
+    ConstructPool(int threads, int per_disk, int capacity);
+    ~ConstructPool();
+
+    void Start();
+    // waits for running tasks, queued tasks are dropped and their cancel
+    // is called instead, so what they hold is given back
+    void Stop();
+
+    // false if capacity tasks are waiting already
+    bool Submit(const std::string& name,
+            int priority,
+            const std::vector<std::string>& disks,
+            const Task& task,
+            const Task& cancel);
+
+    // called by tasks when the construction is done
+    void RecordCost(bool ok, const ConstructCost& cost);
+    void Statistics(baidu::galaxy::proto::ConstructMetrix* metrix);
+
+private:
+    struct Job {
+        std::string name;
+        int priority;
+        int64_t submit_time;
+        std::vector<std::string> disks;
+        Task task;
+        Task cancel;
+    };
+
+    void WorkRoutine();
+    // first job in order whose disks are not busy, list is locked
+    bool TakeRunnable(Job& job);
+    static int64_t Average(int64_t avg, int64_t sample);
+
+    const int threads_;
+    const int per_disk_;
+    const size_t capacity_;
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::list<Job> jobs_;
+    std::map<std::string, int> disk_running_;
+    boost::thread_group workers_;
+    bool running_;
+    int busy_;
+
+    // statistics, protected by mutex_
+    int64_t rejected_;
+    int64_t finished_;
+    int64_t failed_;
+    int64_t queue_latency_;
+    int64_t max_queue_latency_;
+    int64_t cgroup_latency_;
+    int64_t volum_latency_;
+    int64_t process_latency_;
+};
+
+}
+}
+}
@@ -6,8 +6,10 @@
 
 #include "cgroup/subsystem_factory.h"
 #include "cgroup/cgroup.h"
+#include "cgroup/blkio_subsystem.h"
 #include "protocol/galaxy.pb.h"
 #include "volum/volum_group.h"
+#include "util/dag.h"
 #include "util/user.h"
 #include "util/path_tree.h"
 #include "util/error_code.h"
@@ -25,12 +27,15 @@
 #include <boost/lexical_cast/lexical_cast_old.hpp>
 #include <boost/bind.hpp>
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 
+#include <algorithm>
 #include <iosfwd>
 #include <fstream>
 #include <iostream>
@@ -43,11 +48,40 @@ DECLARE_string(agent_hostname);
 DECLARE_string(cmd_line);
 DECLARE_string(volum_resource);
 DECLARE_string(extra_volum_resource);
+DECLARE_int32(construct_step_concurrency);
 
 namespace baidu {
 namespace galaxy {
 namespace container {
 
+// a random secret known by the container and agent only, authenticating
+// requests of the container to agent, empty if it fails
+static std::string NewPackageToken() {
+    unsigned char buf[16];
+    int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return "";
+    }
+
+    ssize_t n = ::read(fd, buf, sizeof(buf));
+    ::close(fd);
+
+    if (n != (ssize_t)sizeof(buf)) {
+        return "";
+    }
+
+    std::string token;
+    char hex[3];
+
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        snprintf(hex, sizeof(hex), "%02x", buf[i]);
+        token += hex;
+    }
+
+    return token;
+}
+
 Container::Container(const ContainerId& id, const baidu::galaxy::proto::ContainerDescription& desc) :
     IContainer(id, desc),
     volum_group_(new baidu::galaxy::volum::VolumGroup()),
@@ -79,6 +113,7 @@ baidu::galaxy::util::ErrorCode Container::Construct() {
     }
 
     created_time_ = baidu::common::timer::get_micros();
+    package_token_ = NewPackageToken();
     // err && ec, return err not ec, ec is just a temporary var
     baidu::galaxy::util::ErrorCode err = Construct_();
 
@@ -158,32 +193,29 @@ baidu::galaxy::util::ErrorCode Container::Destroy() {
 
 baidu::galaxy::util::ErrorCode Container::Construct_() {
     assert(!id_.Empty());
-    // cgroup
-    LOG(INFO) << "to create cgroup for container " << id_.CompactId()
-              << ", expect cgroup size is " << desc_.cgroups_size();
-    int ret = ConstructCgroup();
-
-    if (0 != ret) {
-        LOG(WARNING) << "failed in constructing cgroup for contanier " << id_.CompactId();
-        return ERRORCODE(-1, "cgroup failed");
-    }
+    LOG(INFO) << "to construct container " << id_.CompactId()
+              << ", expect cgroup size is " << desc_.cgroups_size()
+              << ", data volum size is " << desc_.data_volums_size();
+    cost_ = ConstructCost();
+    PrepareVolumGroup();
+    // cgroups and volums do not depend on each other, appwork is cloned into
+    // the cgroups and mounts the volums, so it goes last
+    baidu::galaxy::util::Dag dag("construction of " + id_.CompactId());
+    dag.AddStep("cgroup",
+            boost::bind(&Container::ConstructCgroup, this),
+            boost::bind(&Container::DestroyCgroup, this));
+    const std::string volum = volum_group_->AddConstructSteps(&dag);
+    dag.AddStep("process", boost::bind(&Container::ConstructProcess, this));
+    dag.AddDependency("process", "cgroup");
+    dag.AddDependency("process", volum);
+    baidu::galaxy::util::ErrorCode ec = dag.Run(FLAGS_construct_step_concurrency);
+    cost_.cgroup = dag.Duration("cgroup");
+    cost_.volum = dag.Elapsed(volum);
+    cost_.process = dag.Duration("process");
 
-    LOG(INFO) << "succeed in constructing cgroup for contanier " << id_.CompactId();
-    ret = ConstructVolumGroup();
-
-    if (0 != ret) {
-        LOG(WARNING) << "failed in constructing volum group for container " << id_.CompactId();
-        return ERRORCODE(-1, "volum failed");
-    }
-
-    LOG(INFO) << "succeed in constructing volum group for container " << id_.CompactId();
-    // clone
-    LOG(INFO) << "to clone appwork process for container " << id_.CompactId();
-    ret = ConstructProcess();
-
-    if (0 != ret) {
-        LOG(WARNING) << "failed in constructing process for container " << id_.CompactId();
-        return ERRORCODE(-1, "clone failed");
+    if (0 != ec.Code()) {
+        LOG(WARNING) << "failed in constructing container " << id_.CompactId() << ": " << ec.Message();
+        return ec;
     }
 
     LOG(INFO) << "succeed in construct process (whose pid is " << process_->Pid()
@@ -194,16 +226,17 @@ baidu::galaxy::util::ErrorCode Container::Construct_() {
 baidu::galaxy::util::ErrorCode Container::Reload(boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> meta) {
     assert(!id_.Empty());
     created_time_ = meta->created_time();
+    package_token_ = meta->package_token();
     status_.EnterAllocating();
-    int ret = ConstructCgroup();
+    baidu::galaxy::util::ErrorCode ec = ConstructCgroup();
 
-    if (0 != ret) {
+    if (0 != ec.Code()) {
         status_.EnterError();
         return ERRORCODE(-1, "failed in constructing cgroup");
     }
 
     LOG(INFO) << "succeed in constructing cgroup for contanier " << id_.CompactId();
-    ret = ConstructVolumGroup();
+    int ret = ConstructVolumGroup();
 
     if (0 != ret) {
         status_.EnterError();
@@ -212,16 +245,29 @@ baidu::galaxy::util::ErrorCode Container::Reload(boost::shared_ptr<baidu::galaxy
 
     LOG(INFO) << "succeed in constructing volum group for container " << id_.CompactId();
     process_->Reload(meta->pid());
+
+    // the pid may be taken by another process while the agent is down, it is
+    // checked once here, the pidfd refers to the same process later
+    if (process_->PidFd() >= 0 && !HasContainerEnv()) {
+        LOG(WARNING) << "appwork " << meta->pid() << " of container " << id_.CompactId() << " is gone";
+        process_->Reload(-1);
+    }
+
     status_.EnterReady();
     return ERRORCODE_OK;
 }
 
-int Container::ConstructCgroup() {
+baidu::galaxy::util::ErrorCode Container::ConstructCgroup() {
     for (int i = 0; i < desc_.cgroups_size(); i++) {
         boost::shared_ptr<baidu::galaxy::cgroup::Cgroup> cg(new baidu::galaxy::cgroup::Cgroup(
                 baidu::galaxy::cgroup::SubsystemFactory::GetInstance()));
         boost::shared_ptr<baidu::galaxy::proto::Cgroup> desc(new baidu::galaxy::proto::Cgroup());
         desc->CopyFrom(desc_.cgroups(i));
+
+        if (0 != ResolveBlkioDevice(desc->mutable_blkio())) {
+            break;
+        }
+
         cg->SetContainerId(id_.SubId());
         cg->SetDescrition(desc);
         baidu::galaxy::util::ErrorCode err = cg->Construct();
@@ -241,24 +287,82 @@ int Container::ConstructCgroup() {
         LOG(WARNING) << "fail in constructing cgroup for container " << id_.CompactId()
                      << ", expect cgroup size is " << desc_.cgroups_size()
                      << " real size is " << cgroup_.size();
+        DestroyCgroup();
+        return ERRORCODE(-1, "cgroup failed");
+    }
 
-        for (size_t i = 0; i < cgroup_.size(); i++) {
-            baidu::galaxy::util::ErrorCode err = cgroup_[i]->Destroy();
+    LOG(INFO) << "succeed in constructing cgroup for contanier " << id_.CompactId();
+    return ERRORCODE_OK;
+}
+
+void Container::DestroyCgroup() {
+    for (size_t i = 0; i < cgroup_.size(); i++) {
+        baidu::galaxy::util::ErrorCode err = cgroup_[i]->Destroy();
+
+        if (err.Code() != 0) {
+            LOG(WARNING) << id_.CompactId()
+                         << " construc failed and destroy failed: "
+                         << err.Message();
+        }
+    }
+
+    cgroup_.clear();
+}
 
-            if (err.Code() != 0) {
-                LOG(WARNING) << id_.CompactId()
-                             << " construc failed and destroy failed: "
-                             << err.Message();
+// throttles refer to volums by dest_path, which are mapped to the disk
+// holding the source of the volum on the host
+int Container::ResolveBlkioDevice(baidu::galaxy::proto::BlkioRequired* blkio) {
+    for (int i = 0; i < blkio->throttles_size(); i++) {
+        baidu::galaxy::proto::BlkioThrottle* throttle = blkio->mutable_throttles(i);
+        std::string source_path;
+
+        if (desc_.workspace_volum().dest_path() == throttle->path()) {
+            source_path = desc_.workspace_volum().source_path();
+        }
+
+        for (int j = 0; source_path.empty() && j < desc_.data_volums_size(); j++) {
+            if (desc_.data_volums(j).dest_path() == throttle->path()) {
+                source_path = desc_.data_volums(j).source_path();
             }
         }
 
-        return -1;
+        if (source_path.empty()) {
+            LOG(WARNING) << "no volum is mounted at " << throttle->path()
+                         << " for blkio throttle of container " << id_.CompactId();
+            return -1;
+        }
+
+        std::string device;
+        baidu::galaxy::util::ErrorCode ec = baidu::galaxy::cgroup::BlkioSubsystem::GetDevice(source_path, device);
+
+        if (0 != ec.Code()) {
+            LOG(WARNING) << "fail in resolving device of " << throttle->path()
+                         << " for container " << id_.CompactId() << ": " << ec.Message();
+            return -1;
+        }
+
+        throttle->set_device(device);
+        VLOG(10) << "blkio throttle of " << throttle->path() << " is on device " << device
+                 << " for container " << id_.CompactId();
     }
 
     return 0;
 }
 
 int Container::ConstructVolumGroup() {
+    PrepareVolumGroup();
+    baidu::galaxy::util::ErrorCode ec = volum_group_->Construct();
+
+    if (0 != ec.Code()) {
+        LOG(WARNING) << "failed in constructing volum group for container " << id_.CompactId()
+                     << ", reason is: " << ec.Message();
+        return -1;
+    }
+
+    return 0;
+}
+
+void Container::PrepareVolumGroup() {
     assert(created_time_ > 0);
     volum_group_->SetContainerId(id_.SubId());
     volum_group_->SetWorkspaceVolum(desc_.workspace_volum());
@@ -309,19 +413,9 @@ int Container::ConstructVolumGroup() {
         volum_desc.set_origin(true);
         volum_group_->AddOriginVolum(volum_desc);
     }
-
-    baidu::galaxy::util::ErrorCode ec = volum_group_->Construct();
-
-    if (0 != ec.Code()) {
-        LOG(WARNING) << "failed in constructing volum group for container " << id_.CompactId()
-                     << ", reason is: " << ec.Message();
-        return -1;
-    }
-
-    return 0;
 }
 
-int Container::ConstructProcess() {
+baidu::galaxy::util::ErrorCode Container::ConstructProcess() {
     std::string container_root_path = baidu::galaxy::path::ContainerRootPath(id_.SubId());
     int now = (int)time(NULL);
     std::stringstream ss;
@@ -336,51 +430,48 @@ int Container::ConstructProcess() {
 
     if (pid <= 0) {
         LOG(INFO) << "fail in clonning appwork process for container " << id_.CompactId();
-        return -1;
+        return ERRORCODE(-1, "clone failed");
     }
 
-    return 0;
+    return ERRORCODE_OK;
 }
 
 baidu::galaxy::util::ErrorCode Container::Destroy_() {
-    // kill appwork
-    pid_t pid = process_->Pid();
+    // appwork is killed first, then cgroups and volums are destroyed
+    // at the same time
+    baidu::galaxy::util::Dag dag("destruction of " + id_.CompactId());
+    dag.AddStep("kill", boost::bind(&Container::KillAppwork, this));
 
-    if (pid > 0) {
-        baidu::galaxy::util::ErrorCode ec = Process::Kill(pid);
-
-        if (ec.Code() != 0) {
-            LOG(WARNING) << "failed in killing appwork for container "
-                         << id_.CompactId() << ": " << ec.Message();
-            return ERRORCODE(-1, "kill appworker");
-        }
+    for (size_t i = 0; i < cgroup_.size(); i++) {
+        const std::string step = "cgroup_" + boost::lexical_cast<std::string>(i);
+        dag.AddStep(step, boost::bind(&baidu::galaxy::cgroup::Cgroup::Destroy, cgroup_[i]));
+        dag.AddDependency(step, "kill");
     }
 
-    LOG(INFO) << "container " << id_.CompactId() << " suceed in killing appwork whose pid is " << pid;
+    volum_group_->AddDestroySteps(&dag, "kill");
+    baidu::galaxy::util::ErrorCode ec = dag.Run(FLAGS_construct_step_concurrency);
 
-    // destroy cgroup
-    for (size_t i = 0; i < cgroup_.size(); i++) {
-        baidu::galaxy::util::ErrorCode ec = cgroup_[i]->Destroy();
+    if (0 != ec.Code()) {
+        LOG(WARNING) << "failed in destroying container " << id_.CompactId() << ": " << ec.Message();
+        return ec;
+    }
 
-        if (0 != ec.Code()) {
-            LOG(WARNING) << "container " << id_.CompactId()
-                         << " failed in destroying cgroup: " << ec.Message();
-            return ERRORCODE(-1, "cgroup");
-        }
+    LOG(INFO) << "container " << id_.CompactId() << " suceed in destroy cgroup and volum";
+    return ERRORCODE_OK;
+}
 
-        LOG(INFO) << "container " << id_.CompactId() << " suceed in destroy cgroup";
-    }
+baidu::galaxy::util::ErrorCode Container::KillAppwork() {
+    pid_t pid = process_->Pid();
 
-    // destroy volum
-    baidu::galaxy::util::ErrorCode ec = volum_group_->Destroy();
+    if (pid > 0) {
+        baidu::galaxy::util::ErrorCode ec = process_->Signal(SIGKILL);
 
-    if (0 != ec.Code()) {
-        LOG(WARNING) << "failed in destroying volum group in container " << id_.CompactId()
-                     << " " << ec.Message();
-        return ERRORCODE(-1, "volum");
+        if (ec.Code() != 0) {
+            return ERRORCODE(-1, "failed in killing appwork: %s", ec.Message().c_str());
+        }
     }
 
-    LOG(INFO) << "container " << id_.CompactId() << " suceed in destroy volum";
+    LOG(INFO) << "container " << id_.CompactId() << " suceed in killing appwork whose pid is " << pid;
     return ERRORCODE_OK;
 }
 
@@ -469,6 +560,10 @@ void Container::ExportEnv() {
 
 void Container::ExportEnv(std::map<std::string, std::string>& env) {
     env["baidu_galaxy_containergroup_id"] = id_.GroupId();
+
+    if (!package_token_.empty()) {
+        env["baidu_galaxy_package_token"] = package_token_;
+    }
     env["baidu_galaxy_container_id"] = id_.SubId();
     std::string ids;
 
@@ -495,7 +590,8 @@ void Container::ExportEnv(std::map<std::string, std::string>& env) {
 void Container::KeepAlive() {
     int64_t now = baidu::common::timer::get_micros();
 
-    if (now - created_time_ < 10000000L) {
+    // no pidfd, environ of appwork may not be checked yet
+    if (process_->PidFd() < 0 && now - created_time_ < 10000000L) {
         return;
     }
 
@@ -531,6 +627,20 @@ void Container::KeepAlive() {
 }
 
 bool Container::Alive() {
+    // a pidfd tells the exit of the very process, environ is scanned on
+    // kernels without it
+    if (process_->PidFd() >= 0) {
+        return !process_->Exited();
+    }
+
+    return HasContainerEnv();
+}
+
+int Container::PidFd() {
+    return process_->PidFd();
+}
+
+bool Container::HasContainerEnv() {
     int pid = (int)process_->Pid();
 
     if (pid <= 0) {
@@ -604,7 +714,7 @@ bool Container::Expired() {
 }
 
 bool Container::TryKill() {
-    if (process_->Pid() > 0 && 0 == ::kill(process_->Pid(), SIGTERM)) {
+    if (process_->Pid() > 0 && 0 == process_->Signal(SIGTERM).Code()) {
         return true;
     }
 
@@ -628,6 +738,26 @@ boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> Container::ContainerInfo(
         ret->set_cpu_used(metrix->cpu_used_in_millicore());
     }
 
+    ret->set_memory_cache(metrix->memory_cache_in_byte());
+    ret->set_memory_rss(metrix->memory_rss_in_byte());
+    ret->set_memory_fail_cnt(metrix->memory_fail_cnt());
+    ret->set_io_read_bps(metrix->io_read_bps());
+    ret->set_io_write_bps(metrix->io_write_bps());
+    ret->set_io_read_iops(metrix->io_read_iops());
+    ret->set_io_write_iops(metrix->io_write_iops());
+
+    if (metrix->has_cpu_pressure()) {
+        ret->mutable_cpu_pressure()->CopyFrom(metrix->cpu_pressure());
+    }
+
+    if (metrix->has_memory_pressure()) {
+        ret->mutable_memory_pressure()->CopyFrom(metrix->memory_pressure());
+    }
+
+    if (metrix->has_io_pressure()) {
+        ret->mutable_io_pressure()->CopyFrom(metrix->io_pressure());
+    }
+
     baidu::galaxy::proto::ContainerDescription* cd = ret->mutable_container_desc();
 
     if (full_info) {
@@ -656,6 +786,25 @@ boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> Container::ContainerInfo(
     return ret;
 }
 
+void Container::ReportStamp(std::vector<int64_t>& stamp) {
+    // metrix change only when collectors sample
+    stamp.push_back(status_.Status());
+
+    for (size_t i = 0; i < cgroup_.size(); i++) {
+        stamp.push_back(cgroup_[i]->SampleTime());
+    }
+
+    boost::shared_ptr<baidu::galaxy::volum::Volum> wv = volum_group_->WorkspaceVolum();
+
+    if (NULL != wv) {
+        stamp.push_back(wv->Used());
+    }
+
+    for (int i = 0; i < volum_group_->DataVolumsSize(); i++) {
+        stamp.push_back(volum_group_->DataVolum(i)->Used());
+    }
+}
+
 boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> Container::ContainerMeta() {
     boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> ret(new baidu::galaxy::proto::ContainerMeta());
     ret->set_container_id(id_.SubId());
@@ -664,6 +813,7 @@ boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> Container::ContainerMeta(
     ret->set_pid(process_->Pid());
     ret->mutable_container()->CopyFrom(desc_);
     ret->set_destroy_time(destroy_time_);
+    ret->set_package_token(package_token_);
     return ret;
 }
 
@@ -672,6 +822,7 @@ boost::shared_ptr<ContainerProperty> Container::Property() {
     property->container_id_ = id_.SubId();
     property->group_id_ = id_.GroupId();
     property->created_time_ = created_time_;
+    property->package_token_ = package_token_;
     property->pid_ = process_->Pid();
     const boost::shared_ptr<baidu::galaxy::volum::Volum> wv = volum_group_->WorkspaceVolum();
     property->workspace_volum_.container_abs_path = wv->TargetPath();
@@ -703,10 +854,29 @@ const baidu::galaxy::proto::ContainerDescription& Container::Description() {
     return desc_;
 }
 
+// a container stalls as much as its most stalled cgroup, totals are summed
+static void MergePressure(const baidu::galaxy::proto::Pressure& from, baidu::galaxy::proto::Pressure* to) {
+    to->set_some_avg10(std::max(to->some_avg10(), from.some_avg10()));
+    to->set_some_avg60(std::max(to->some_avg60(), from.some_avg60()));
+    to->set_some_total(to->some_total() + from.some_total());
+    to->set_full_avg10(std::max(to->full_avg10(), from.full_avg10()));
+    to->set_full_avg60(std::max(to->full_avg60(), from.full_avg60()));
+    to->set_full_total(to->full_total() + from.full_total());
+}
+
 boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> Container::ContainerMetrix() {
     boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> cm(new baidu::galaxy::proto::ContainerMetrix);
     int64_t memory_used_in_byte = 0L;
     int64_t cpu_used_in_millicore = 0L;
+    int64_t memory_cache_in_byte = 0L;
+    int64_t memory_rss_in_byte = 0L;
+    int64_t memory_fail_cnt = 0L;
+    int64_t cpu_nr_throttled = 0L;
+    int64_t cpu_throttled_time = 0L;
+    int64_t io_read_bps = 0L;
+    int64_t io_write_bps = 0L;
+    int64_t io_read_iops = 0L;
+    int64_t io_write_iops = 0L;
 
     for (size_t i = 0; i < cgroup_.size(); i++) {
         boost::shared_ptr<baidu::galaxy::proto::CgroupMetrix> m = cgroup_[i]->Statistics();
@@ -714,11 +884,53 @@ boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> Container::ContainerMet
         if (NULL != cm.get()) {
             memory_used_in_byte += m->memory_used_in_byte();
             cpu_used_in_millicore += m->cpu_used_in_millicore();
+            memory_cache_in_byte += m->memory_cache_in_byte();
+            memory_rss_in_byte += m->memory_rss_in_byte();
+            memory_fail_cnt += m->memory_fail_cnt();
+            cpu_nr_throttled += m->cpu_nr_throttled();
+            cpu_throttled_time += m->cpu_throttled_time();
+            io_read_bps += m->io_read_bps();
+            io_write_bps += m->io_write_bps();
+            io_read_iops += m->io_read_iops();
+            io_write_iops += m->io_write_iops();
+
+            if (m->has_cpu_pressure()) {
+                MergePressure(m->cpu_pressure(), cm->mutable_cpu_pressure());
+            }
+
+            if (m->has_memory_pressure()) {
+                MergePressure(m->memory_pressure(), cm->mutable_memory_pressure());
+            }
+
+            if (m->has_io_pressure()) {
+                MergePressure(m->io_pressure(), cm->mutable_io_pressure());
+            }
         }
     }
 
+    int64_t volum_used_in_byte = 0L;
+    boost::shared_ptr<baidu::galaxy::volum::Volum> wv = volum_group_->WorkspaceVolum();
+
+    if (NULL != wv) {
+        volum_used_in_byte += wv->Used();
+    }
+
+    for (int i = 0; i < volum_group_->DataVolumsSize(); i++) {
+        volum_used_in_byte += volum_group_->DataVolum(i)->Used();
+    }
+
     cm->set_memory_used_in_byte(memory_used_in_byte);
     cm->set_cpu_used_in_millicore(cpu_used_in_millicore);
+    cm->set_memory_cache_in_byte(memory_cache_in_byte);
+    cm->set_memory_rss_in_byte(memory_rss_in_byte);
+    cm->set_memory_fail_cnt(memory_fail_cnt);
+    cm->set_cpu_nr_throttled(cpu_nr_throttled);
+    cm->set_cpu_throttled_time(cpu_throttled_time);
+    cm->set_io_read_bps(io_read_bps);
+    cm->set_io_write_bps(io_write_bps);
+    cm->set_io_read_iops(io_read_iops);
+    cm->set_io_write_iops(io_write_iops);
+    cm->set_volum_used_in_byte(volum_used_in_byte);
     cm->set_time(baidu::common::timer::get_micros());
     return cm;
 }
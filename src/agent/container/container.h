@@ -38,26 +38,35 @@ public:
     baidu::galaxy::util::ErrorCode Reload(boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> meta);
     const baidu::galaxy::proto::ContainerDescription& Description();
     boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ContainerInfo(bool full_info);
+    void ReportStamp(std::vector<int64_t>& stamp);
     boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> ContainerMeta();
     boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> ContainerMetrix();
     boost::shared_ptr<ContainerProperty> Property();
     std::string ContainerGcPath();
     void KeepAlive();
+    int PidFd();
 
 private:
     baidu::galaxy::util::ErrorCode Construct_();
     baidu::galaxy::util::ErrorCode Destroy_();
 
     bool Alive();
+    // appwork has the id of the container in its environ
+    bool HasContainerEnv();
 
     // container will be killed after rel_sec seconds
     void SetExpiredTimeIfAbsent(int32_t rel_sec);
     bool Expired();
     bool TryKill();
 
-    int ConstructCgroup();
+    baidu::galaxy::util::ErrorCode ConstructCgroup();
+    void DestroyCgroup();
+    int ResolveBlkioDevice(baidu::galaxy::proto::BlkioRequired* blkio);
+    // sets descriptions of volums without constructing them
+    void PrepareVolumGroup();
     int ConstructVolumGroup();
-    int ConstructProcess();
+    baidu::galaxy::util::ErrorCode ConstructProcess();
+    baidu::galaxy::util::ErrorCode KillAppwork();
 
     int RunRoutine(void*);
     void ExportEnv(std::map<std::string, std::string>& env);
@@ -68,6 +77,7 @@ private:
     boost::shared_ptr<Process> process_;
     baidu::galaxy::container::ContainerStatus status_;
     int64_t created_time_;
+    std::string package_token_;     // required by FetchPackage of the container
     int64_t destroy_time_;
     int64_t force_kill_time_;
 };
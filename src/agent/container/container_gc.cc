@@ -5,6 +5,7 @@
 #include "container_gc.h"
 #include "util/input_stream_file.h"
 #include "util/path_tree.h"
+#include "protocol/galaxy.pb.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 #include "timer.h"
@@ -13,23 +14,293 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 DECLARE_int64(gc_delay_time);
+DECLARE_int32(gc_threads_per_device);
+DECLARE_int64(gc_inodes_per_second);
+DECLARE_int64(gc_bytes_per_second);
+DECLARE_int32(gc_io_class);
+DECLARE_int32(gc_io_level);
+
 namespace baidu {
 namespace galaxy {
 namespace container {
+
+// seconds a failed gc dir waits before it is removed again
+static const int64_t kGcRetryInterval = 60;
+// reads of a dir removing what is listed, before giving up
+static const int kMaxRemovePasses = 8;
+
+// budget of one device shared by its workers, and what they removed
+class GcLimiter {
+public:
+    GcLimiter(int64_t inodes_rate, int64_t bytes_rate) :
+        inodes_rate_(inodes_rate),
+        bytes_rate_(bytes_rate),
+        inode_tokens_(0),
+        byte_tokens_(0),
+        last_(0),
+        removed_inodes_(0),
+        removed_bytes_(0) {
+    }
+
+    void Acquire(int64_t inodes, int64_t bytes) {
+        int64_t wait = 0;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            removed_inodes_ += inodes;
+            removed_bytes_ += bytes;
+            int64_t now = baidu::common::timer::get_micros();
+
+            if (last_ > 0) {
+                // no more than a second of budget is saved
+                const int64_t elapsed = std::min(now - last_, 1000000L);
+                inode_tokens_ = std::min(inodes_rate_, inode_tokens_ + elapsed * inodes_rate_ / 1000000L);
+                byte_tokens_ = std::min(bytes_rate_, byte_tokens_ + elapsed * bytes_rate_ / 1000000L);
+            }
+
+            last_ = now;
+            inode_tokens_ -= inodes;
+            byte_tokens_ -= bytes;
+
+            if (inodes_rate_ > 0 && inode_tokens_ < 0) {
+                wait = std::max(wait, -inode_tokens_ * 1000000L / inodes_rate_);
+            }
+
+            if (bytes_rate_ > 0 && byte_tokens_ < 0) {
+                wait = std::max(wait, -byte_tokens_ * 1000000L / bytes_rate_);
+            }
+        }
+
+        if (wait > 0) {
+            ::usleep(wait);
+        }
+    }
+
+    void Removed(int64_t& inodes, int64_t& bytes) {
+        boost::mutex::scoped_lock lock(mutex_);
+        inodes += removed_inodes_;
+        bytes += removed_bytes_;
+    }
+
+private:
+    const int64_t inodes_rate_;     // 0 means no limit
+    const int64_t bytes_rate_;
+    boost::mutex mutex_;
+    int64_t inode_tokens_;
+    int64_t byte_tokens_;
+    int64_t last_;
+    int64_t removed_inodes_;
+    int64_t removed_bytes_;
+};
+
+namespace {
+
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+baidu::galaxy::util::ErrorCode RemoveDir(int parent, const char* name, dev_t dev, GcLimiter* limiter);
+
+// unlinks what is listed in dir fd, dirs in it are removed as a whole
+baidu::galaxy::util::ErrorCode RemoveEntries(int fd, dev_t dev, std::vector<char>& buf, GcLimiter* limiter) {
+    while (true) {
+        long n = ::syscall(SYS_getdents64, fd, &buf[0], buf.size());
+
+        if (n < 0) {
+            return PERRORCODE(-1, errno, "read dir failed");
+        }
+
+        if (0 == n) {
+            return ERRORCODE_OK;
+        }
+
+        int64_t inodes = 0;
+        int64_t bytes = 0;
+
+        for (long off = 0; off < n;) {
+            LinuxDirent64* d = reinterpret_cast<LinuxDirent64*>(&buf[off]);
+            off += d->d_reclen;
+
+            if (0 == strcmp(d->d_name, ".") || 0 == strcmp(d->d_name, "..")) {
+                continue;
+            }
+
+            unsigned char type = d->d_type;
+            struct stat st;
+            st.st_nlink = 0;
+
+            // size of files is counted, type is not known on some filesystems
+            if (DT_REG == type || DT_UNKNOWN == type) {
+                if (0 != ::fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW)) {
+                    if (ENOENT == errno) {
+                        continue;
+                    }
+
+                    return PERRORCODE(-1, errno, "stat %s failed", d->d_name);
+                }
+
+                type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+            }
+
+            if (DT_DIR == type) {
+                baidu::galaxy::util::ErrorCode ec = RemoveDir(fd, d->d_name, dev, limiter);
+
+                if (0 != ec.Code()) {
+                    return ec;
+                }
+
+                continue;
+            }
+
+            if (0 != ::unlinkat(fd, d->d_name, 0) && ENOENT != errno) {
+                return PERRORCODE(-1, errno, "unlink %s failed", d->d_name);
+            }
+
+            inodes++;
+
+            // blocks of hard links are freed with the last one
+            if (1 == st.st_nlink) {
+                bytes += st.st_blocks * 512L;
+            }
+        }
+
+        limiter->Acquire(inodes, bytes);
+    }
+}
+
+baidu::galaxy::util::ErrorCode RemoveDir(int parent, const char* name, dev_t dev, GcLimiter* limiter) {
+    int fd = ::openat(parent, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd < 0) {
+        if (ENOENT == errno) {
+            return ERRORCODE_OK;
+        }
+
+        return PERRORCODE(-1, errno, "open %s failed", name);
+    }
+
+    struct stat st;
+
+    // a volum left mounted, what is in it belongs to another filesystem
+    if (0 != ::fstat(fd, &st) || st.st_dev != dev) {
+        ::close(fd);
+        return ERRORCODE(-1, "%s is a mount point", name);
+    }
+
+    std::vector<char> buf(32 * 1024);
+    baidu::galaxy::util::ErrorCode ec = ERRORCODE_OK;
+
+    // getdents64 may skip entries when others are unlinked while reading,
+    // the dir is read again until it can be removed
+    for (int pass = 1; ; pass++) {
+        ec = RemoveEntries(fd, dev, buf, limiter);
+
+        if (0 != ec.Code()) {
+            break;
+        }
+
+        if (0 == ::unlinkat(parent, name, AT_REMOVEDIR) || ENOENT == errno) {
+            limiter->Acquire(1, 0);
+            break;
+        }
+
+        if ((ENOTEMPTY != errno && EEXIST != errno) || pass >= kMaxRemovePasses) {
+            ec = PERRORCODE(-1, errno, "remove dir %s failed", name);
+            break;
+        }
+
+        ::lseek(fd, 0, SEEK_SET);
+    }
+
+    ::close(fd);
+    return ec;
+}
+
+// removes the tree of path by getdents64 and unlinkat relative to dir fds,
+// symlinks are not followed and no mount point is crossed
+baidu::galaxy::util::ErrorCode RemoveTree(const std::string& path, GcLimiter* limiter) {
+    std::string p = path;
+
+    while (p.size() > 1 && '/' == p[p.size() - 1]) {
+        p.erase(p.size() - 1);
+    }
+
+    struct stat st;
+
+    if (0 != ::lstat(p.c_str(), &st)) {
+        if (ENOENT == errno) {
+            return ERRORCODE_OK;
+        }
+
+        return PERRORCODE(-1, errno, "stat %s failed", p.c_str());
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        if (0 != ::unlink(p.c_str()) && ENOENT != errno) {
+            return PERRORCODE(-1, errno, "unlink %s failed", p.c_str());
+        }
+
+        limiter->Acquire(1, st.st_blocks * 512L);
+        return ERRORCODE_OK;
+    }
+
+    boost::filesystem::path bp(p);
+    const std::string parent_path = bp.has_parent_path() ? bp.parent_path().string() : ".";
+    int parent = ::open(parent_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (parent < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", parent_path.c_str());
+    }
+
+    baidu::galaxy::util::ErrorCode ec = RemoveDir(parent, bp.filename().string().c_str(), st.st_dev, limiter);
+    ::close(parent);
+
+    if (0 != ec.Code()) {
+        return ERRORCODE(-1, "remove %s failed: %s", p.c_str(), ec.Message().c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+}
+
 ContainerGc::ContainerGc() :
-    running_(true) {
+    finished_(0L),
+    failed_(0L),
+    running_(false) {
 }
 
 
 ContainerGc::~ContainerGc() {
-    running_ = false;
+    bool running = false;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        running = running_;
+        running_ = false;
+        cond_.notify_all();
+    }
+
+    if (running) {
+        gc_thread_.Join();
+        workers_.join_all();
+    }
 }
 
 baidu::galaxy::util::ErrorCode ContainerGc::Reload() {
@@ -46,6 +317,8 @@ baidu::galaxy::util::ErrorCode ContainerGc::Reload() {
         return ERRORCODE(-1, "create directory_iterator failed: %s", ec.message().c_str());
     }
 
+    boost::mutex::scoped_lock lock(mutex_);
+
     for (; iter != end; iter++) {
         if (!boost::filesystem::is_directory(iter->path(), ec)) {
             continue;
@@ -66,117 +339,248 @@ baidu::galaxy::util::ErrorCode ContainerGc::Reload() {
 baidu::galaxy::util::ErrorCode ContainerGc::Gc(const std::string& path) {
     int64_t destroy_time = baidu::common::timer::get_micros() / 1000000L;
     boost::mutex::scoped_lock lock(mutex_);
-    gc_swap_index_[path] = destroy_time + FLAGS_gc_delay_time;
+    gc_index_[path] = destroy_time + FLAGS_gc_delay_time;
     LOG(INFO) << path << " will be gc in " << destroy_time + FLAGS_gc_delay_time;
     return ERRORCODE_OK;
 }
 
 
 baidu::galaxy::util::ErrorCode ContainerGc::Setup() {
-    running_ = true;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        running_ = true;
+    }
 
     if (!gc_thread_.Start(boost::bind(&ContainerGc::GcRoutine, this))) {
+        boost::mutex::scoped_lock lock(mutex_);
+        running_ = false;
         return ERRORCODE(-1, "start gc thread failed");
     }
 
     return ERRORCODE_OK;
 }
 
+void ContainerGc::Statistics(baidu::galaxy::proto::GcMetrix* metrix) {
+    assert(NULL != metrix);
+    const int64_t now = baidu::common::timer::get_micros() / 1000000L;
+    int32_t delayed = 0;
+    int32_t backlog = 0;
+    int64_t max_wait = 0;
+    int32_t queued = 0;
+    int32_t running = 0;
+    int64_t inodes = 0;
+    int64_t bytes = 0;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, int64_t>::iterator iter = gc_index_.begin();
+
+    for (; iter != gc_index_.end(); iter++) {
+        if (iter->second > now) {
+            delayed++;
+        } else {
+            backlog++;
+            max_wait = std::max(max_wait, now - iter->second);
+        }
+    }
+
+    std::map<dev_t, Device>::iterator dev = devices_.begin();
+
+    for (; dev != devices_.end(); dev++) {
+        queued += (int32_t)dev->second.jobs.size();
+        running += dev->second.running;
+        dev->second.limiter->Removed(inodes, bytes);
+    }
+
+    metrix->set_delayed(delayed);
+    metrix->set_backlog(backlog);
+    metrix->set_max_wait(max_wait);
+    metrix->set_queued_paths(queued);
+    metrix->set_running_paths(running);
+    metrix->set_devices((int32_t)devices_.size());
+    metrix->set_removed_inodes(inodes);
+    metrix->set_removed_bytes(bytes);
+    metrix->set_finished(finished_);
+    metrix->set_failed(failed_);
+}
+
 void ContainerGc::GcRoutine() {
     while (running_) {
+        std::vector<std::string> due;
         {
             boost::mutex::scoped_lock lock(mutex_);
+            int64_t now = baidu::common::timer::get_micros() / 1000000L;
+            std::map<std::string, int64_t>::iterator iter = gc_index_.begin();
 
-            if (!gc_swap_index_.empty()) {
-                std::map<std::string, int64_t>::iterator iter = gc_swap_index_.begin();
-
-                while (iter != gc_swap_index_.end()) {
-                    gc_index_[iter->first] = iter->second;
-                    iter++;
+            for (; iter != gc_index_.end(); iter++) {
+                if (iter->second <= now && tasks_.end() == tasks_.find(iter->first)) {
+                    tasks_[iter->first] = Task();
+                    due.push_back(iter->first);
                 }
-
-                gc_swap_index_.clear();
             }
         }
-        std::map<std::string, int64_t>::iterator iter = gc_index_.begin();
-
-        while (iter != gc_index_.end()) {
-            int64_t now = baidu::common::timer::get_micros() / 1000000L;
 
-            if (iter->second <= now) {
-                baidu::galaxy::util::ErrorCode ec = DoGc(iter->first);
+        for (size_t i = 0; i < due.size() && running_; i++) {
+            Schedule(due[i]);
+        }
 
-                if (ec.Code() != 0) {
-                    LOG(WARNING) << iter->first << " gc failed: " << ec.Message();
-                    iter++;
-                    continue;
-                }
+        sleep(1);
+    }
+}
 
-                if (ec.Code() != 0) {
-                    LOG(WARNING) << iter->first << " rm gc recode failed";
-                }
+void ContainerGc::Schedule(const std::string& dir) {
+    struct stat st;
 
-                gc_index_.erase(iter++);
-                continue;
-            }
+    if (0 != ::stat(dir.c_str(), &st)) {
+        boost::mutex::scoped_lock lock(mutex_);
 
-            iter++;
+        if (ENOENT == errno) {
+            LOG(INFO) << dir << " donot exist";
+            tasks_.erase(dir);
+            gc_index_.erase(dir);
+        } else {
+            LOG(WARNING) << dir << " gc failed: " << strerror(errno);
+            Retry(dir);
         }
 
-        sleep(1);
+        return;
     }
-}
 
-baidu::galaxy::util::ErrorCode ContainerGc::DoGc(const std::string& path) {
+    std::vector<std::string> paths;
+    boost::filesystem::path property(dir);
+    property.append("container.property");
     boost::system::error_code ec;
 
-    if (!boost::filesystem::exists(path, ec)) {
-        return ERRORCODE(0, "%s donot exist", path.c_str());
+    if (boost::filesystem::exists(property, ec)) {
+        baidu::galaxy::util::ErrorCode err = ListGcPath(property.string(), paths);
+
+        if (err.Code() != 0) {
+            LOG(WARNING) << dir << " gc failed: " << err.Message();
+            boost::mutex::scoped_lock lock(mutex_);
+            Retry(dir);
+            return;
+        }
     }
 
-    boost::filesystem::path p(path);
-    p.append("container.property");
+    // a path on another disk goes to the queue of the disk
+    std::vector<std::pair<dev_t, std::string> > jobs;
 
-    if (!boost::filesystem::exists(p, ec)) {
-        boost::filesystem::remove_all(path, ec);
+    for (size_t i = 0; i < paths.size(); i++) {
+        struct stat s;
 
-        if (ec.value() != 0) {
-            return ERRORCODE(-1, "remove %s failed: %s",
-                    path.c_str(),
-                    ec.message().c_str());
+        if (0 == ::lstat(paths[i].c_str(), &s)) {
+            jobs.push_back(std::make_pair(s.st_dev, paths[i]));
+        } else if (ENOENT != errno) {
+            jobs.push_back(std::make_pair(st.st_dev, paths[i]));
         }
+    }
 
-        return ERRORCODE_OK;
+    boost::mutex::scoped_lock lock(mutex_);
+    Task& task = tasks_[dir];
+    task.dev = st.st_dev;
+
+    if (jobs.empty()) {
+        task.last = true;
+        task.pending = 1;
+        Enqueue(st.st_dev, dir, dir);
+        return;
     }
 
-    std::vector<std::string> gc_paths;
-    baidu::galaxy::util::ErrorCode err = ListGcPath(p.string(), gc_paths);
+    task.pending = (int)jobs.size();
 
-    if (err.Code() != 0) {
-        return ERRORCODE(-1, err.Message().c_str());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        Enqueue(jobs[i].first, dir, jobs[i].second);
     }
+}
 
-    for (size_t i = 0; i < gc_paths.size(); i++) {
-        err = Remove(gc_paths[i]);
+void ContainerGc::Enqueue(dev_t dev, const std::string& dir, const std::string& path) {
+    std::map<dev_t, Device>::iterator iter = devices_.find(dev);
 
-        if (err.Code() != 0) {
-            return ERRORCODE(-1, "remove %s failed: %s", gc_paths[i].c_str(), err.Message().c_str());
+    if (devices_.end() == iter) {
+        iter = devices_.insert(std::make_pair(dev, Device())).first;
+        iter->second.limiter.reset(new GcLimiter(FLAGS_gc_inodes_per_second, FLAGS_gc_bytes_per_second));
+        const int threads = std::max(1, FLAGS_gc_threads_per_device);
+
+        for (int i = 0; i < threads; i++) {
+            workers_.create_thread(boost::bind(&ContainerGc::WorkRoutine, this, dev));
         }
 
-        //LOG(INFO) << "succees in removing " << gc_paths[i] << std::endl;
+        LOG(INFO) << "start " << threads << " gc workers for device " << (int64_t)dev;
     }
 
-    boost::filesystem::remove_all(path, ec);
+    iter->second.jobs.push_back(Job(dir, path));
+    cond_.notify_all();
+}
 
-    if (ec.value() != 0) {
-        return ERRORCODE(-1, "remove %s failed: ",
-                path.c_str(),
-                ec.message().c_str());
+void ContainerGc::WorkRoutine(dev_t dev) {
+    if (FLAGS_gc_io_class > 0) {
+        ::syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0,
+                (FLAGS_gc_io_class << 13) | FLAGS_gc_io_level);
     }
 
-    return ERRORCODE_OK;
+    boost::mutex::scoped_lock lock(mutex_);
+    // never erased, it stays valid
+    Device& device = devices_[dev];
+
+    while (running_) {
+        if (device.jobs.empty()) {
+            cond_.timed_wait(lock, boost::posix_time::seconds(1));
+            continue;
+        }
+
+        Job job = device.jobs.front();
+        device.jobs.pop_front();
+        device.running++;
+        boost::shared_ptr<GcLimiter> limiter = device.limiter;
+        lock.unlock();
+        baidu::galaxy::util::ErrorCode ec = RemoveTree(job.second, limiter.get());
+
+        if (ec.Code() != 0) {
+            LOG(WARNING) << job.first << " gc failed: " << ec.Message();
+        } else {
+            VLOG(10) << "succeed in removing " << job.second;
+        }
+
+        lock.lock();
+        device.running--;
+        Done(job.first, 0 == ec.Code());
+    }
 }
 
+void ContainerGc::Done(const std::string& dir, bool ok) {
+    std::map<std::string, Task>::iterator iter = tasks_.find(dir);
+    assert(tasks_.end() != iter);
+    Task& task = iter->second;
+    task.pending--;
+    task.failed = task.failed || !ok;
+
+    if (task.pending > 0) {
+        return;
+    }
+
+    if (task.failed) {
+        failed_++;
+        Retry(dir);
+        return;
+    }
+
+    // the property listing the paths is removed once they are all gone
+    if (!task.last) {
+        task.last = true;
+        task.pending = 1;
+        Enqueue(task.dev, dir, dir);
+        return;
+    }
+
+    LOG(INFO) << "succeed in gc " << dir;
+    finished_++;
+    tasks_.erase(iter);
+    gc_index_.erase(dir);
+}
+
+void ContainerGc::Retry(const std::string& dir) {
+    tasks_.erase(dir);
+    gc_index_[dir] = baidu::common::timer::get_micros() / 1000000L + kGcRetryInterval;
+}
 
 baidu::galaxy::util::ErrorCode ContainerGc::ListGcPath(const std::string& property,
         std::vector<std::string>& paths) {
@@ -211,23 +615,6 @@ baidu::galaxy::util::ErrorCode ContainerGc::ListGcPath(const std::string& proper
     return ERRORCODE_OK;
 }
 
-baidu::galaxy::util::ErrorCode ContainerGc::Remove(const std::string& path) {
-    boost::system::error_code ec;
-
-    if (boost::filesystem::exists(path, ec)) {
-        boost::filesystem::remove_all(path, ec);
-
-        if (0 != ec.value()) {
-            return ERRORCODE(-1, "remove %s failed: %s",
-                    path.c_str(),
-                    ec.message().c_str());
-        }
-    }
-
-    return ERRORCODE_OK;
 }
-
 }
 }
-}
-
@@ -4,16 +4,33 @@
 
 #pragma once
 #include "boost/shared_ptr.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
 #include "container/container.h"
 #include "thread.h"
 
+#include <sys/types.h>
+
+#include <deque>
 #include <string>
 #include <map>
 
 namespace baidu {
 namespace galaxy {
+namespace proto {
+class GcMetrix;
+}
+
 namespace container {
 
+class GcLimiter;
+
+// Removes gc dirs of destroyed containers gc_delay_time seconds later.
+// Every device has a queue and workers of its own, so a slow disk does not
+// hold up the others, and removes within a budget of inodes and bytes per
+// second at a low io priority. Paths listed in container.property of a gc
+// dir are removed first, the gc dir holding it is the last.
 class ContainerGc {
 public:
     ContainerGc();
@@ -21,20 +38,59 @@ public:
     baidu::galaxy::util::ErrorCode Reload();
     baidu::galaxy::util::ErrorCode Gc(const std::string& path);
     baidu::galaxy::util::ErrorCode Setup();
+    void Statistics(baidu::galaxy::proto::GcMetrix* metrix);
 
 private:
+    // gc dir and path to remove
+    typedef std::pair<std::string, std::string> Job;
+
+    struct Device {
+        Device() :
+            running(0) {
+        }
+
+        std::deque<Job> jobs;
+        boost::shared_ptr<GcLimiter> limiter;
+        int running;
+    };
+
+    // a gc dir being removed
+    struct Task {
+        Task() :
+            dev(0),
+            pending(0),
+            failed(false),
+            last(false) {
+        }
+
+        dev_t dev;      // of the gc dir
+        int pending;    // jobs queued or running
+        bool failed;
+        bool last;      // the gc dir itself is being removed
+    };
+
     void GcRoutine();
-    baidu::galaxy::util::ErrorCode Remove(const std::string& path);
+    void WorkRoutine(dev_t dev);
+    // queues the paths of gc dir, all at once
+    void Schedule(const std::string& dir);
+    // mutex_ is held
+    void Enqueue(dev_t dev, const std::string& dir, const std::string& path);
+    void Done(const std::string& dir, bool ok);
+    void Retry(const std::string& dir);
+
     baidu::galaxy::util::ErrorCode ListGcPath(const std::string& path,
             std::vector<std::string>& paths);
 
-    baidu::galaxy::util::ErrorCode DoGc(const std::string& path);
-    std::map<std::string, int64_t> gc_index_;
-
     boost::mutex mutex_;
-    std::map<std::string, int64_t> gc_swap_index_;
+    boost::condition_variable cond_;
+    std::map<std::string, int64_t> gc_index_;   // gc dir -> time to remove, unit second
+    std::map<std::string, Task> tasks_;
+    std::map<dev_t, Device> devices_;
+    int64_t finished_;
+    int64_t failed_;
     bool running_;
     baidu::common::Thread gc_thread_;
+    boost::thread_group workers_;
 
 };
 }
@@ -6,15 +6,35 @@
 #include "container_manager.h"
 #include "util/path_tree.h"
 #include "thread.h"
+#include "timer.h"
 #include "util/output_stream_file.h"
+#include "collector/collector_engine.h"
+#include "collector/host_sampler.h"
+#include "cgroup/subsystem.h"
+#include "cgroup/subsystem_factory.h"
 
 #include "boost/bind.hpp"
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <functional>
+#include <utility>
+
 DECLARE_int32(check_assign_interval);
 DECLARE_int64(cpu_resource);
 DECLARE_int64(memory_resource);
 DECLARE_int32(assign_level);
+DECLARE_int32(metrix_history_window);
+DECLARE_int32(memory_reclaim_cooldown);
+DECLARE_int64(memory_reclaim_reserve);
+DECLARE_int32(construct_threads);
+DECLARE_int32(construct_per_disk);
+DECLARE_int32(construct_queue_size);
+DECLARE_int32(slot_pool_min_size);
+DECLARE_int32(slot_pool_max_size);
+DECLARE_int32(slot_pool_window);
+DECLARE_int32(reload_threads);
+DECLARE_int32(report_cache_interval);
 
 namespace baidu {
 namespace galaxy {
@@ -22,15 +42,25 @@ namespace container {
 
 ContainerManager::ContainerManager(boost::shared_ptr<baidu::galaxy::resource::ResourceManager> resman) :
     res_man_(resman),
+    changes_(0L),
     check_assign_pool_(1),
     running_(false),
+    reloading_(false),
+    reload_time_(0L),
+    last_reclaim_time_(0L),
     serializer_(new Serializer()),
-    container_gc_(new ContainerGc()) {
+    container_gc_(new ContainerGc()),
+    construct_pool_(FLAGS_construct_threads, FLAGS_construct_per_disk, FLAGS_construct_queue_size),
+    slot_pool_(FLAGS_slot_pool_min_size, FLAGS_slot_pool_max_size, FLAGS_slot_pool_window),
+    report_changes_(-1L) {
     assert(NULL != resman);
 }
 
 ContainerManager::~ContainerManager() {
     running_ = false;
+    construct_pool_.Stop();
+    memory_pressure_.TearDown();
+    process_watcher_.TearDown();
 }
 
 void ContainerManager::Setup() {
@@ -45,15 +75,18 @@ void ContainerManager::Setup() {
     }
 
     LOG(INFO) << "succeed in setting up serialize db: " << path;
-    int ret = Reload();
+    // reloaded containers are watched too
+    ec = process_watcher_.Setup();
 
-    if (0 != ret) {
-        LOG(WARNING) << "failed in recovering container from meta, agent will exit";
-        exit(-1);
-    } else {
-        LOG(INFO) << "succeed in recovering container from meta";
+    if (ec.Code() != 0) {
+        LOG(WARNING) << "watch exits of appworks failed, only poll: " << ec.Message();
     }
 
+    // containers are reloaded while the agent serves, it reports reloading
+    // and refuses to create or release containers until all are back
+    reloading_ = true;
+    reload_thread_.Start(boost::bind(&ContainerManager::ReloadRoutine, this));
+
     ec = container_gc_->Reload();
 
     if (ec.Code() != 0) {
@@ -70,9 +103,26 @@ void ContainerManager::Setup() {
     }
 
     LOG(INFO) << "setup container gc successful";
+    metrix_recorder_.reset(new MetrixRecorder(boost::bind(&ContainerManager::SampleMetrix, this, _1),
+            FLAGS_metrix_history_window));
+    metrix_recorder_->Enable(true);
+    baidu::galaxy::collector::CollectorEngine::GetInstance()->Register(metrix_recorder_, true);
+    LOG(INFO) << "keep metrix history of " << FLAGS_metrix_history_window << " seconds";
     running_ = true;
+    construct_pool_.Start();
+    slot_pool_.Start();
     this->keep_alive_thread_.Start(boost::bind(&ContainerManager::KeepAliveRoutine, this));
     if (FLAGS_assign_level > 0) {
+        // pressure events reclaim at once, polling still catches quota
+        // over assigned without pressure
+        std::string memory_root = baidu::galaxy::cgroup::SubsystemFactory::GetInstance()->HierarchyPath("memory") + "/galaxy";
+        ec = memory_pressure_.Setup(memory_root,
+                boost::bind(&ContainerManager::OnMemoryPressure, this, _1));
+
+        if (ec.Code() != 0) {
+            LOG(WARNING) << "watch memory pressure failed, only poll: " << ec.Message();
+        }
+
         this->check_assign_pool_.DelayTask(
             FLAGS_check_assign_interval,
             boost::bind(&ContainerManager::CheckAssignRoutine, this));
@@ -96,6 +146,34 @@ void ContainerManager::KeepAliveRoutine() {
 }
 
 void ContainerManager::CheckAssignRoutine() {
+    CheckAssign(0);
+    check_assign_pool_.DelayTask(
+        FLAGS_check_assign_interval,
+        boost::bind(&ContainerManager::CheckAssignRoutine, this));
+}
+
+void ContainerManager::OnMemoryPressure(int level) {
+    // usage is collected once per second, give evicted containers time to
+    // show up in it before reclaiming again; oom can not wait
+    int64_t now = baidu::common::timer::get_micros();
+
+    if (level < baidu::galaxy::cgroup::kPressureOom
+            && now - last_reclaim_time_ < FLAGS_memory_reclaim_cooldown * 1000L) {
+        return;
+    }
+
+    last_reclaim_time_ = now;
+    LOG(WARNING) << "memory pressure is " << baidu::galaxy::cgroup::MemoryPressure::LevelName(level)
+                 << ", reclaim now";
+    check_assign_pool_.AddTask(boost::bind(&ContainerManager::CheckAssign, this, level));
+}
+
+void ContainerManager::CheckAssign(int pressure_level) {
+    // containers not reloaded yet would be missed
+    if (Reloading()) {
+        return;
+    }
+
     std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> > cis;
     ListContainers(cis, true);
 
@@ -110,22 +188,14 @@ void ContainerManager::CheckAssignRoutine() {
             cpu_used += cis[i]->cpu_used();
             memory_used += cis[i]->memory_used();
         } else {
-            // calculate resource
-            for (int i = 0; i < desc.cgroups_size(); i++) {
-                cpu_deep_assigned += desc.cgroups(i).cpu().milli_core();
-                memory_deep_assigned += desc.cgroups(i).memory().size();
-            }
-            for (int i = 0; i < desc.data_volums_size(); i++) {
-                if (desc.data_volums(i).medium() == baidu::galaxy::proto::kTmpfs) {
-                    // tmpfs as assigned
-                    memory_deep_assigned += desc.data_volums(i).size();
-                }
-            }
+            cpu_deep_assigned += AssignedCpu(desc);
+            memory_deep_assigned += AssignedMemory(desc);
         }
     }
 
     VLOG(10)
         << "### check assign routine"
+        << ", pressure: " << pressure_level
         << ", cpu_used: " << cpu_used
         << ", cpu_deep_assigned: " << cpu_deep_assigned
         << ", cpu: " << (cpu_used + cpu_deep_assigned)
@@ -135,54 +205,112 @@ void ContainerManager::CheckAssignRoutine() {
         << ", memory: " << (memory_used + memory_deep_assigned)
         << ", memory_total: " << FLAGS_memory_resource;
 
-    if (memory_used + memory_deep_assigned > FLAGS_memory_resource) {
-        LOG(WARNING) << "memory_reserved is danger";
-        EvictAssignedContainer(cis, kEvictTypeMemory);
+    int64_t memory_deficit = memory_used + memory_deep_assigned - FLAGS_memory_resource;
+    // memory really to be freed on host, not only the assigned quota
+    int64_t used_deficit = 0L;
+
+    if (pressure_level >= baidu::galaxy::cgroup::kPressureCritical) {
+        boost::shared_ptr<const baidu::galaxy::collector::HostSnapshot> snapshot
+            = baidu::galaxy::collector::HostSampler::GetInstance()->Snapshot();
+
+        if (FLAGS_memory_reclaim_reserve > 0 && NULL != snapshot.get()) {
+            used_deficit = FLAGS_memory_reclaim_reserve - snapshot->memory_available;
+        }
+
+        // the kernel is about to kill, free at least one container
+        if (memory_deficit <= 0 && used_deficit <= 0) {
+            used_deficit = 1L;
+        }
+    }
+
+    if (memory_deficit > 0 || used_deficit > 0) {
+        LOG(WARNING) << "memory_reserved is danger, deficit: " << memory_deficit
+                     << ", host deficit: " << used_deficit;
+        EvictAssignedContainer(cis, kEvictTypeMemory, memory_deficit, used_deficit);
     } else {
         if (cpu_used + cpu_deep_assigned > FLAGS_cpu_resource) {
             LOG(WARNING) << "cpu_reserved is danger";
-            EvictAssignedContainer(cis, kEvictTypeCpu);
+            EvictAssignedContainer(cis, kEvictTypeCpu, cpu_used + cpu_deep_assigned - FLAGS_cpu_resource, 0L);
         }
     }
+}
 
-    check_assign_pool_.DelayTask(
-        FLAGS_check_assign_interval,
-        boost::bind(&ContainerManager::CheckAssignRoutine, this));
+int64_t ContainerManager::AssignedCpu(const baidu::galaxy::proto::ContainerDescription& desc) {
+    int64_t ret = 0L;
+
+    for (int i = 0; i < desc.cgroups_size(); i++) {
+        ret += desc.cgroups(i).cpu().milli_core();
+    }
+
+    return ret;
+}
+
+int64_t ContainerManager::AssignedMemory(const baidu::galaxy::proto::ContainerDescription& desc) {
+    int64_t ret = 0L;
+
+    for (int i = 0; i < desc.cgroups_size(); i++) {
+        ret += desc.cgroups(i).memory().size();
+    }
+
+    for (int i = 0; i < desc.data_volums_size(); i++) {
+        if (desc.data_volums(i).medium() == baidu::galaxy::proto::kTmpfs) {
+            // tmpfs as assigned
+            ret += desc.data_volums(i).size();
+        }
+    }
+
+    return ret;
 }
 
 void ContainerManager::EvictAssignedContainer(
         std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> >& cis,
-        EvictType evict_type) {
+        EvictType evict_type,
+        int64_t deficit,
+        int64_t used_deficit) {
     VLOG(10) << "evict assigned container, by: " << evict_type;
 
-    ContainerId container_id;
-    int64_t max_used = -1L;
+    // biggest first, fewest containers are killed
+    std::vector<std::pair<int64_t, size_t> > candidates;
     for (size_t i = 0; i < cis.size(); i++) {
         if (cis[i]->container_desc().priority() == baidu::galaxy::proto::kJobBestEffort) {
             LOG(INFO) << "find best effort container: " << cis[i]->id();
-            if (kEvictTypeMemory == evict_type) {
-                if (cis[i]->memory_used() > max_used) {
-                    max_used = cis[i]->memory_used();
-                    container_id.SetGroupId(cis[i]->group_id()).SetSubId(cis[i]->id());
-                }
-            } else {
-                if (cis[i]->cpu_used() > max_used) {
-                    max_used = cis[i]->cpu_used();
-                    container_id.SetGroupId(cis[i]->group_id()).SetSubId(cis[i]->id());
-                }
-            }
+            int64_t used = kEvictTypeMemory == evict_type ? cis[i]->memory_used() : cis[i]->cpu_used();
+            candidates.push_back(std::make_pair(used, i));
         }
     }
-    if (!container_id.Empty()) {
-        VLOG(10) << "will evict: " << container_id.ToString();
-        ReleaseContainer(container_id);
+    std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<int64_t, size_t> >());
+
+    // evicting a container takes back its assigned quota from deficit
+    // and its usage from used_deficit, stop when both are covered
+    std::vector<ContainerId> victims;
+    for (size_t i = 0; i < candidates.size() && (deficit > 0 || used_deficit > 0); i++) {
+        const baidu::galaxy::proto::ContainerInfo& ci = *cis[candidates[i].second];
+        const baidu::galaxy::proto::ContainerDescription& desc = ci.container_desc();
+        deficit -= kEvictTypeMemory == evict_type ? AssignedMemory(desc) : AssignedCpu(desc);
+        used_deficit -= candidates[i].first;
+        victims.push_back(ContainerId(ci.group_id(), ci.id()));
+    }
+
+    if (deficit > 0 || used_deficit > 0) {
+        LOG(WARNING) << "evicting all best effort containers can not cover deficit: "
+                     << deficit << ", host deficit: " << used_deficit;
+    }
+
+    for (size_t i = 0; i < victims.size(); i++) {
+        LOG(WARNING) << "will evict: " << victims[i].ToString();
+        ReleaseContainer(victims[i]);
     }
 }
 
 baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer(const ContainerId& id, const baidu::galaxy::proto::ContainerDescription& desc) {
-    // enter creating stage, every time only one thread does creating
-    ScopedCreatingStage lock_stage(stage_, id.SubId());
-    baidu::galaxy::util::ErrorCode ec = lock_stage.GetLastError();
+    if (Reloading()) {
+        LOG(WARNING) << "refuse to create container " << id.CompactId() << " while reloading";
+        return ERRORCODE(-1, "reloading");
+    }
+
+    // enter creating stage, every time only one thread does creating,
+    // the stage is left by ConstructRoutine once the container is built
+    baidu::galaxy::util::ErrorCode ec = stage_.EnterCreatingStage(id.SubId());
 
     if (ec.Code() == baidu::galaxy::util::kErrorRepeated) {
         LOG(WARNING) << "container " << id.CompactId() << " has been in creating stage already: " << ec.Message();
@@ -204,8 +332,14 @@ baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer(const Container
 
         if (work_containers_.end() != iter) {
             LOG(INFO) << "container " << id.CompactId() << " has already been created";
+            stage_.LeaveCreatingStage(id.SubId());
             return ERRORCODE_OK;
         }
+
+        // failed before, create it again
+        if (creating_containers_.erase(id) > 0) {
+            changes_++;
+        }
     }
 
     // allcate resource
@@ -215,31 +349,138 @@ baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer(const Container
         LOG(WARNING) << "fail in allocating resource for container "
                      << id.CompactId() << ", detail reason is: "
                      << ec.Message();
+        stage_.LeaveCreatingStage(id.SubId());
         return ERRORCODE(-1, "resource");
     } else {
         LOG(INFO) << "succeed in allocating resource for " << id.CompactId();
     }
 
-    // create container
-    baidu::galaxy::util::ErrorCode ret = CreateContainer_(id, desc);
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        CreatingContainer& cc = creating_containers_[id];
+        cc.desc.CopyFrom(desc);
+        cc.status = baidu::galaxy::proto::kContainerAllocating;
+        changes_++;
+    }
+
+    std::vector<std::string> disks;
+    ConstructDisks(desc, disks);
+
+    if (!construct_pool_.Submit(id.CompactId(), desc.priority(), disks,
+                boost::bind(&ContainerManager::ConstructRoutine, this, id),
+                boost::bind(&ContainerManager::CancelConstruct, this, id))) {
+        LOG(WARNING) << "construct queue is full, reject container " << id.CompactId();
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            creating_containers_.erase(id);
+            changes_++;
+        }
+
+        ec = res_man_->Release(desc);
+
+        if (ec.Code() != 0) {
+            LOG(FATAL) << "failed in releasing resource for container "
+                       << id.CompactId() << ", detail reason is: "
+                       << ec.Message();
+        }
+
+        stage_.LeaveCreatingStage(id.SubId());
+        return ERRORCODE(-1, "busy");
+    }
+
+    LOG(INFO) << "container " << id.CompactId() << " is accepted and waits for constructing";
+    return ERRORCODE_OK;
+}
+
+void ContainerManager::ConstructDisks(const baidu::galaxy::proto::ContainerDescription& desc,
+        std::vector<std::string>& disks) {
+    // tmpfs is memory, no disk is touched
+    if (desc.workspace_volum().medium() != baidu::galaxy::proto::kTmpfs
+            && !desc.workspace_volum().source_path().empty()) {
+        disks.push_back(desc.workspace_volum().source_path());
+    }
+
+    for (int i = 0; i < desc.data_volums_size(); i++) {
+        const baidu::galaxy::proto::VolumRequired& vr = desc.data_volums(i);
+
+        if (vr.medium() != baidu::galaxy::proto::kTmpfs
+                && !vr.source_path().empty()
+                && disks.end() == std::find(disks.begin(), disks.end(), vr.source_path())) {
+            disks.push_back(vr.source_path());
+        }
+    }
+}
+
+void ContainerManager::ConstructRoutine(const ContainerId& id) {
+    baidu::galaxy::proto::ContainerDescription desc;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        std::map<ContainerId, CreatingContainer>::iterator iter = creating_containers_.find(id);
+        assert(creating_containers_.end() != iter);
+        desc.CopyFrom(iter->second.desc);
+    }
+
+    ConstructCost cost;
+    baidu::galaxy::util::ErrorCode ret = CreateContainer_(id, desc, cost);
 
     if (0 != ret.Code()) {
         LOG(WARNING) <<  id.CompactId() << " create container failed " << ret.Message();
-        ec = res_man_->Release(desc);
+        baidu::galaxy::util::ErrorCode ec = res_man_->Release(desc);
 
         if (ec.Code() != 0) {
             LOG(FATAL) << "failed in releasing resource for container "
                        << id.CompactId() << ", detail reason is: "
                        << ec.Message();
         }
+
+        // reported as error, resman destroys it and schedules again
+        boost::mutex::scoped_lock lock(mutex_);
+        creating_containers_[id].status = baidu::galaxy::proto::kContainerError;
+        changes_++;
     } else {
-        LOG(INFO) << "success in creating container " << id.CompactId();
+        LOG(INFO) << "success in creating container " << id.CompactId()
+                  << ", cgroup cost " << cost.cgroup << "us"
+                  << ", volum cost " << cost.volum << "us"
+                  << ", process cost " << cost.process << "us";
+        boost::mutex::scoped_lock lock(mutex_);
+        creating_containers_.erase(id);
+        changes_++;
     }
 
-    return ret;
+    construct_pool_.RecordCost(0 == ret.Code(), cost);
+    stage_.LeaveCreatingStage(id.SubId());
+}
+
+void ContainerManager::CancelConstruct(const ContainerId& id) {
+    baidu::galaxy::proto::ContainerDescription desc;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        std::map<ContainerId, CreatingContainer>::iterator iter = creating_containers_.find(id);
+        assert(creating_containers_.end() != iter);
+        desc.CopyFrom(iter->second.desc);
+        creating_containers_.erase(iter);
+        changes_++;
+    }
+
+    LOG(WARNING) << "construction of " << id.CompactId() << " is canceled";
+    baidu::galaxy::util::ErrorCode ec = res_man_->Release(desc);
+
+    if (ec.Code() != 0) {
+        LOG(FATAL) << "failed in releasing resource for container "
+                   << id.CompactId() << ", detail reason is: "
+                   << ec.Message();
+    }
+
+    stage_.LeaveCreatingStage(id.SubId());
 }
 
 baidu::galaxy::util::ErrorCode ContainerManager::ReleaseContainer(const ContainerId& id) {
+    // the container may not be reloaded yet
+    if (Reloading()) {
+        LOG(WARNING) << "refuse to release container " << id.CompactId() << " while reloading";
+        return ERRORCODE(-1, "reloading");
+    }
+
     // enter destroying stage, only one thread do releasing at a moment
     ScopedDestroyingStage lock_stage(stage_, id.SubId());
     baidu::galaxy::util::ErrorCode ec = lock_stage.GetLastError();
@@ -265,7 +506,14 @@ baidu::galaxy::util::ErrorCode ContainerManager::ReleaseContainer(const Containe
         iter = work_containers_.find(id);
 
         if (work_containers_.end() == iter) {
-            LOG(WARNING) << "container " << id.CompactId() << " do not exist";
+            // failed in constructing, resource has been released
+            if (creating_containers_.erase(id) > 0) {
+                changes_++;
+                LOG(INFO) << "remove failed container " << id.CompactId();
+            } else {
+                LOG(WARNING) << "container " << id.CompactId() << " do not exist";
+            }
+
             return ERRORCODE_OK;
         }
 
@@ -292,8 +540,11 @@ baidu::galaxy::util::ErrorCode ContainerManager::ReleaseContainer(const Containe
             boost::mutex::scoped_lock lock(mutex_);
             // fix me
             work_containers_.erase(iter);
+            changes_++;
         }
 
+        process_watcher_.Unwatch(id.SubId());
+
         ec = serializer_->DeleteWork(id.GroupId(), id.SubId());
 
         if (ec.Code() != 0) {
@@ -316,7 +567,8 @@ baidu::galaxy::util::ErrorCode ContainerManager::ReleaseContainer(const Containe
 }
 
 baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer_(const ContainerId& id,
-        const baidu::galaxy::proto::ContainerDescription& desc) {
+        const baidu::galaxy::proto::ContainerDescription& desc,
+        ConstructCost& cost) {
     VLOG(10)
         << "container manager create container, volum_view:  "
         << baidu::galaxy::proto::VolumViewType_Name(desc.volum_view());
@@ -340,7 +592,14 @@ baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer_(const Containe
     }
 
     container->SetDependentVolums(depend_volums);
+
+    // a prepared slot saves making the first cgroup and the root dirs
+    if (desc.cgroups_size() > 0) {
+        slot_pool_.Claim(id.SubId(), desc.cgroups(0).id());
+    }
+
     err = container->Construct();
+    cost = container->Cost();
 
     if (0 != err.Code()) {
         LOG(WARNING) << "fail in constructing container " << id.CompactId() << " " << err.Message();
@@ -359,7 +618,9 @@ baidu::galaxy::util::ErrorCode ContainerManager::CreateContainer_(const Containe
     {
         boost::mutex::scoped_lock lock(mutex_);
         work_containers_[id] = container;
+        changes_++;
     }
+    WatchExit(container);
     DumpProperty(container);
     LOG(INFO) << "succeed in constructing container " << id.CompactId();
     return ERRORCODE_OK;
@@ -413,19 +674,205 @@ void ContainerManager::ListContainers(std::vector<boost::shared_ptr<baidu::galax
     }
 }
 
+void ContainerManager::ListCreatingContainers(std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> >& cis, bool fullinfo) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<ContainerId, CreatingContainer>::iterator iter = creating_containers_.begin();
 
-int ContainerManager::Reload() {
+    for (; iter != creating_containers_.end(); iter++) {
+        // constructed already, listed by ListContainers
+        if (work_containers_.end() != work_containers_.find(iter->first)) {
+            continue;
+        }
+
+        cis.push_back(CreatingContainerInfo(iter->first, iter->second, fullinfo));
+    }
+}
+
+boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ContainerManager::CreatingContainerInfo(const ContainerId& id,
+        const CreatingContainer& cc,
+        bool fullinfo) {
+    boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ci(new baidu::galaxy::proto::ContainerInfo());
+    ci->set_id(id.SubId());
+    ci->set_group_id(id.GroupId());
+    ci->set_created_time(0);
+    ci->set_status(cc.status);
+    ci->set_cpu_used(0);
+    ci->set_memory_used(0);
+
+    if (fullinfo) {
+        ci->mutable_container_desc()->CopyFrom(cc.desc);
+    } else {
+        ci->mutable_container_desc()->set_version(cc.desc.version());
+    }
+
+    return ci;
+}
+
+boost::shared_ptr<const ReportCache::Report> ContainerManager::ContainerReport() {
+    boost::mutex::scoped_lock report_lock(report_mutex_);
+    int64_t now = baidu::common::timer::get_micros();
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        // metrics of containers are sampled periodically, reporting them in
+        // a short while again is no use
+        if (NULL != report_.get()
+                && report_changes_ == changes_
+                && now - report_->build_time < FLAGS_report_cache_interval * 1000L) {
+            return report_;
+        }
+
+        report_changes_ = changes_;
+        report_cache_.Begin();
+        std::map<ContainerId, boost::shared_ptr<IContainer> >::iterator iter = work_containers_.begin();
+
+        for (; iter != work_containers_.end(); iter++) {
+            const std::string key = iter->first.CompactId();
+            const baidu::galaxy::proto::ContainerDescription& desc = iter->second->Description();
+            ReportCache::Stamp stamp;
+            iter->second->ReportStamp(stamp);
+
+            if (!report_cache_.Keep(key, desc.version(), stamp)) {
+                boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ci = iter->second->ContainerInfo(false);
+                report_cache_.Add(key, stamp, *ci, desc);
+            }
+        }
+
+        std::map<ContainerId, CreatingContainer>::iterator citer = creating_containers_.begin();
+
+        for (; citer != creating_containers_.end(); citer++) {
+            if (work_containers_.end() != work_containers_.find(citer->first)) {
+                continue;
+            }
+
+            const std::string key = citer->first.CompactId();
+            ReportCache::Stamp stamp(1, citer->second.status);
+
+            if (!report_cache_.Keep(key, citer->second.desc.version(), stamp)) {
+                boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ci
+                    = CreatingContainerInfo(citer->first, citer->second, false);
+                report_cache_.Add(key, stamp, *ci, citer->second.desc);
+            }
+        }
+    }
+
+    report_ = report_cache_.Finish(now);
+    VLOG(10) << "build container report of " << report_->brief.size() << " containers, "
+             << report_->rebuilt << " serialized again, cost "
+             << baidu::common::timer::get_micros() - now << "us";
+    return report_;
+}
+
+void ContainerManager::ConstructStatistics(baidu::galaxy::proto::ConstructMetrix* metrix) {
+    construct_pool_.Statistics(metrix);
+    slot_pool_.Statistics(metrix);
+}
+
+void ContainerManager::GcStatistics(baidu::galaxy::proto::GcMetrix* metrix) {
+    container_gc_->Statistics(metrix);
+}
+
+baidu::galaxy::util::ErrorCode ContainerManager::WorkspacePath(const ContainerId& id,
+        const std::string& token,
+        std::string& path) {
+    boost::shared_ptr<IContainer> container;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        std::map<ContainerId, boost::shared_ptr<IContainer> >::iterator iter = work_containers_.find(id);
+
+        if (work_containers_.end() == iter) {
+            return ERRORCODE(-1, "container %s not found", id.CompactId().c_str());
+        }
+
+        container = iter->second;
+    }
+
+    boost::shared_ptr<ContainerProperty> property = container->Property();
+
+    if (token.empty() || token != property->package_token_) {
+        return ERRORCODE(-1, "token of container %s mismatch", id.CompactId().c_str());
+    }
+
+    path = property->workspace_volum_.phy_source_path;
+
+    if (path.empty()) {
+        return ERRORCODE(-1, "container %s has no workspace", id.CompactId().c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+void ContainerManager::SampleMetrix(MetrixRecorder::Samples& samples) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::container::IContainer> >::iterator iter =  work_containers_.begin();
+
+    for (; iter != work_containers_.end(); iter++) {
+        samples.push_back(std::make_pair(iter->first, iter->second->ContainerMetrix()));
+    }
+}
+
+void ContainerManager::GetMetrics(const baidu::galaxy::proto::GetMetricsRequest& request,
+        baidu::galaxy::proto::GetMetricsResponse* response) {
+    assert(NULL != response);
+
+    if (NULL != metrix_recorder_.get()) {
+        metrix_recorder_->Query(request, response);
+    }
+}
+
+// containers shared by reload workers
+struct ContainerManager::ReloadQueue {
+    ReloadQueue() :
+        next(0),
+        failed(false) {
+    }
+
+    boost::mutex mutex;
     std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> > metas;
-    baidu::galaxy::util::ErrorCode ec = serializer_->LoadWork(metas);
+    std::vector<boost::shared_ptr<IContainer> > containers;
+    size_t next;
+    bool failed;
+};
+
+void ContainerManager::ReloadRoutine() {
+    int64_t start = baidu::common::timer::get_micros();
+    int ret = Reload();
+
+    if (0 != ret) {
+        LOG(WARNING) << "failed in recovering container from meta, agent will exit";
+        exit(-1);
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    reload_time_ = (baidu::common::timer::get_micros() - start) / 1000;
+    reloading_ = false;
+    LOG(INFO) << "succeed in recovering " << work_containers_.size()
+              << " containers from meta in " << reload_time_ << "ms";
+}
+
+bool ContainerManager::Reloading() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return reloading_;
+}
+
+void ContainerManager::ReloadStatistics(bool& reloading, int64_t& reload_time) {
+    boost::mutex::scoped_lock lock(mutex_);
+    reloading = reloading_;
+    reload_time = reload_time_;
+}
+
+int ContainerManager::Reload() {
+    ReloadQueue queue;
+    baidu::galaxy::util::ErrorCode ec = serializer_->LoadWork(queue.metas);
 
     if (ec.Code() != 0) {
         LOG(WARNING) << "load from db failed: " << ec.Message();
         return -1;
     }
 
-    for (size_t i = 0; i < metas.size(); i++) {
-        ec = res_man_->Allocate(metas[i]->container());
-        ContainerId id(metas[i]->group_id(), metas[i]->container_id());
+    for (size_t i = 0; i < queue.metas.size(); i++) {
+        ec = res_man_->Allocate(queue.metas[i]->container());
+        ContainerId id(queue.metas[i]->group_id(), queue.metas[i]->container_id());
 
         if (ec.Code() != 0) {
             LOG(WARNING) << "allocat failed for container " << id.CompactId()
@@ -433,18 +880,86 @@ int ContainerManager::Reload() {
             return -1;
         }
 
-        boost::shared_ptr<IContainer> container = IContainer::NewContainer(id, metas[i]->container());
-        ec = container->Reload(metas[i]);
+        queue.containers.push_back(IContainer::NewContainer(id, queue.metas[i]->container()));
+    }
+
+    // cgroups and volums of containers are found again independently, it
+    // is done by many threads like construction
+    const int threads = std::max(1, std::min(FLAGS_reload_threads, (int)queue.containers.size()));
+    boost::thread_group workers;
+
+    for (int i = 0; i < threads; i++) {
+        workers.create_thread(boost::bind(&ContainerManager::ReloadWorker, this, &queue));
+    }
+
+    workers.join_all();
+    return queue.failed ? -1 : 0;
+}
+
+void ContainerManager::ReloadWorker(ReloadQueue* queue) {
+    while (true) {
+        size_t i = 0;
+        {
+            boost::mutex::scoped_lock lock(queue->mutex);
+
+            if (queue->failed || queue->next >= queue->containers.size()) {
+                return;
+            }
+
+            i = queue->next++;
+        }
+
+        boost::shared_ptr<IContainer> container = queue->containers[i];
+        baidu::galaxy::util::ErrorCode ec = container->Reload(queue->metas[i]);
 
         if (0 != ec.Code()) {
-            LOG(WARNING) << id.CompactId() << " failed in reaload container " << ec.Message();
-            return -1;
+            LOG(WARNING) << container->Id().CompactId() << " failed in reaload container " << ec.Message();
+            boost::mutex::scoped_lock lock(queue->mutex);
+            queue->failed = true;
+            return;
         }
 
-        work_containers_[id] = container;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            work_containers_[container->Id()] = container;
+            changes_++;
+        }
+
+        WatchExit(container);
+    }
+}
+
+void ContainerManager::WatchExit(boost::shared_ptr<IContainer> container) {
+    const ContainerId& id = container->Id();
+
+    if (container->PidFd() < 0) {
+        VLOG(10) << "no pidfd of container " << id.CompactId() << ", keep alive by polling";
+        return;
+    }
+
+    baidu::galaxy::util::ErrorCode ec = process_watcher_.Watch(id.SubId(),
+            container->PidFd(),
+            boost::bind(&ContainerManager::OnAppworkExit, this, id));
+
+    if (ec.Code() != 0) {
+        LOG(WARNING) << "failed in watching appwork of container " << id.CompactId()
+                     << ", keep alive by polling: " << ec.Message();
+    }
+}
+
+void ContainerManager::OnAppworkExit(const ContainerId& id) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::container::IContainer> >::iterator iter
+        = work_containers_.find(id);
+
+    // released already
+    if (work_containers_.end() == iter) {
+        return;
     }
 
-    return 0;
+    LOG(INFO) << "appwork of container " << id.CompactId() << " exited";
+    iter->second->KeepAlive();
+    changes_++;
 }
 
 baidu::galaxy::util::ErrorCode ContainerManager::DependentVolums(const baidu::galaxy::proto::ContainerDescription& desc,
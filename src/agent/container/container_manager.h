@@ -10,9 +10,16 @@
 
 #include "boost/shared_ptr.hpp"
 #include "boost/thread/mutex.hpp" 
+#include "boost/thread/thread.hpp"
 #include "thread.h"
 #include "thread_pool.h"
 #include "container_gc.h"
+#include "metrix_recorder.h"
+#include "cgroup/memory_pressure.h"
+#include "construct_pool.h"
+#include "slot_pool.h"
+#include "process_watcher.h"
+#include "report_cache.h"
 
 #include <map>
 #include <string>
@@ -37,6 +44,24 @@ public:
 
     baidu::galaxy::util::ErrorCode ReleaseContainer(const ContainerId& id);
     void ListContainers(std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> >& cis, bool fullinfo);
+    // containers accepted but not constructed yet, or failed in constructing
+    void ListCreatingContainers(std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> >& cis, bool fullinfo);
+    // serialized infos of all containers for Query, built again if
+    // containers are created or released, or report_cache_interval later,
+    // only containers whose ReportStamp changed are asked for their info
+    boost::shared_ptr<const ReportCache::Report> ContainerReport();
+    void ConstructStatistics(baidu::galaxy::proto::ConstructMetrix* metrix);
+    // containers are being reloaded after a restart, and time the last
+    // reload took, unit ms
+    void ReloadStatistics(bool& reloading, int64_t& reload_time);
+    void GcStatistics(baidu::galaxy::proto::GcMetrix* metrix);
+    // path of workspace of the container on host, for requests of the
+    // container itself, token must be the package token of the container
+    baidu::galaxy::util::ErrorCode WorkspacePath(const ContainerId& id,
+            const std::string& token,
+            std::string& path);
+    void GetMetrics(const baidu::galaxy::proto::GetMetricsRequest& request,
+            baidu::galaxy::proto::GetMetricsResponse* response);
 
 private:
     baidu::galaxy::util::ErrorCode DependentVolums(const baidu::galaxy::proto::ContainerDescription& desc,
@@ -47,20 +72,57 @@ private:
             std::map<std::string, std::string>& check_volums);  // key: targe;  value: source, make sure uniq targe
 
     baidu::galaxy::util::ErrorCode CreateContainer_(const ContainerId& id,
-            const baidu::galaxy::proto::ContainerDescription& desc);
-
+            const baidu::galaxy::proto::ContainerDescription& desc,
+            ConstructCost& cost);
+    // run by construct pool, leaves the creating stage entered by CreateContainer
+    void ConstructRoutine(const ContainerId& id);
+    // a queued construction dropped by the pool, resource is released
+    void CancelConstruct(const ContainerId& id);
+    static void ConstructDisks(const baidu::galaxy::proto::ContainerDescription& desc,
+            std::vector<std::string>& disks);
+
+    // catches exits process_watcher_ can not watch, a container with a
+    // pidfd costs a poll(2) only
     void KeepAliveRoutine();
+    void WatchExit(boost::shared_ptr<IContainer> container);
+    void OnAppworkExit(const ContainerId& id);
+    void SampleMetrix(MetrixRecorder::Samples& samples);
     void CheckAssignRoutine();
+    // pressure_level is 0 for the periodic check
+    void CheckAssign(int pressure_level);
+    void OnMemoryPressure(int level);
+    // evict best effort containers until deficit of assigned quota and
+    // used_deficit of real usage are both covered
     void EvictAssignedContainer(
         std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> >& cis,
-        EvictType evict_type);
+        EvictType evict_type,
+        int64_t deficit,
+        int64_t used_deficit);
+    static int64_t AssignedCpu(const baidu::galaxy::proto::ContainerDescription& desc);
+    static int64_t AssignedMemory(const baidu::galaxy::proto::ContainerDescription& desc);
+    struct ReloadQueue;
+    void ReloadRoutine();
     int Reload();
+    void ReloadWorker(ReloadQueue* queue);
+    bool Reloading();
     void DumpProperty(boost::shared_ptr<IContainer> container);
 
     std::map<ContainerId, boost::shared_ptr<baidu::galaxy::container::IContainer> > work_containers_;
+
+    // accepted by CreateContainer, reported as kContainerAllocating until
+    // constructed, or as kContainerError until released if failed
+    struct CreatingContainer {
+        baidu::galaxy::proto::ContainerDescription desc;
+        baidu::galaxy::proto::ContainerStatus status;
+    };
+    std::map<ContainerId, CreatingContainer> creating_containers_;
+    static boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> CreatingContainerInfo(const ContainerId& id,
+            const CreatingContainer& cc,
+            bool fullinfo);
     //boost::scoped_ptr<baidu::common::ThreadPool> check_read_threadpool_;
     boost::shared_ptr<baidu::galaxy::resource::ResourceManager> res_man_;
     boost::mutex mutex_;
+    int64_t changes_;               // of containers listed, guarded by mutex_
 
     ContainerStage stage_;
 
@@ -68,9 +130,23 @@ private:
     baidu::common::Thread keep_alive_thread_;
     baidu::common::ThreadPool check_assign_pool_;
     bool running_;
+    bool reloading_;
+    int64_t reload_time_;
+    baidu::common::Thread reload_thread_;
+    baidu::galaxy::cgroup::MemoryPressure memory_pressure_;
+    int64_t last_reclaim_time_;     // only touched by memory pressure thread
 
     boost::shared_ptr<Serializer> serializer_;
     boost::shared_ptr<ContainerGc> container_gc_;
+    boost::shared_ptr<MetrixRecorder> metrix_recorder_;
+    ConstructPool construct_pool_;
+    SlotPool slot_pool_;
+    ProcessWatcher process_watcher_;
+
+    boost::mutex report_mutex_;
+    ReportCache report_cache_;
+    boost::shared_ptr<const ReportCache::Report> report_;
+    int64_t report_changes_;
 };
 
 } //namespace agent
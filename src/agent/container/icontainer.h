@@ -8,6 +8,7 @@
 #include "protocol/galaxy.pb.h"
 #include "protocol/agent.pb.h"
 #include <string>
+#include <vector>
 
 namespace baidu {
 namespace galaxy {
@@ -75,6 +76,19 @@ private:
 
 };
 
+// time spent in each stage of one construction, unit us
+struct ConstructCost {
+    ConstructCost() :
+        cgroup(0L),
+        volum(0L),
+        process(0L) {
+    }
+
+    int64_t cgroup;
+    int64_t volum;
+    int64_t process;
+};
+
 class IContainer {
 public:
     IContainer(const ContainerId& id,
@@ -94,16 +108,27 @@ public:
     virtual baidu::galaxy::util::ErrorCode Destroy() = 0;
     virtual baidu::galaxy::util::ErrorCode Reload(boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> meta) = 0;
     virtual void KeepAlive() = 0;
+    // pidfd of appwork, readable once it exits, -1 if there is none
+    virtual int PidFd() = 0;
 
     virtual boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> ContainerMeta() = 0;
     virtual boost::shared_ptr<baidu::galaxy::proto::ContainerInfo> ContainerInfo(bool full_info) = 0;
+    // what ContainerInfo(false) is made of, it is the same while they are
+    virtual void ReportStamp(std::vector<int64_t>& stamp) = 0;
     virtual boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> ContainerMetrix() = 0;
     virtual boost::shared_ptr<ContainerProperty> Property() = 0;
     virtual std::string ContainerGcPath() = 0;
+
+    // cost of the last Construct()
+    const ConstructCost& Cost() const {
+        return cost_;
+    }
+
 protected:
     ContainerId id_;
     const baidu::galaxy::proto::ContainerDescription desc_;
     std::map<std::string, std::string> dependent_volums_;
+    ConstructCost cost_;
 };
 
 }
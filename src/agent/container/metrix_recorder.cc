@@ -0,0 +1,188 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrix_recorder.h"
+#include "protocol/agent.pb.h"
+#include "timer.h"
+
+#include "glog/logging.h"
+
+#include <assert.h>
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+namespace {
+
+// order of columns in rings
+enum Column {
+    kCpuUsed = 0,
+    kMemoryUsed,
+    kMemoryRss,
+    kMemoryCache,
+    kMemoryFailCnt,
+    kVolumUsed,
+    kCpuNrThrottled,
+    kCpuThrottledTime,
+    kColumns
+};
+
+std::vector<baidu::galaxy::collector::MetrixRing::Aggregation> Aggregations() {
+    std::vector<baidu::galaxy::collector::MetrixRing::Aggregation> ret(kColumns,
+            baidu::galaxy::collector::MetrixRing::kAverage);
+    ret[kMemoryFailCnt] = baidu::galaxy::collector::MetrixRing::kLast;
+    ret[kVolumUsed] = baidu::galaxy::collector::MetrixRing::kLast;
+    ret[kCpuNrThrottled] = baidu::galaxy::collector::MetrixRing::kLast;
+    ret[kCpuThrottledTime] = baidu::galaxy::collector::MetrixRing::kLast;
+    return ret;
+}
+
+}
+
+MetrixRecorder::MetrixRecorder(Source source, int window) :
+    source_(source),
+    window_(window > 0 ? window : 1),
+    enabled_(false) {
+}
+
+MetrixRecorder::~MetrixRecorder() {
+}
+
+baidu::galaxy::util::ErrorCode MetrixRecorder::Collect() {
+    Samples samples;
+    source_(samples);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+        if (NULL != samples[i].second.get()) {
+            Record(samples[i].first, *samples[i].second);
+        }
+    }
+
+    Expire(baidu::common::timer::get_micros());
+    return ERRORCODE_OK;
+}
+
+void MetrixRecorder::Record(const ContainerId& id, const baidu::galaxy::proto::ContainerMetrix& metrix) {
+    int64_t values[kColumns];
+    values[kCpuUsed] = metrix.cpu_used_in_millicore();
+    values[kMemoryUsed] = metrix.memory_used_in_byte();
+    values[kMemoryRss] = metrix.memory_rss_in_byte();
+    values[kMemoryCache] = metrix.memory_cache_in_byte();
+    values[kMemoryFailCnt] = metrix.memory_fail_cnt();
+    values[kVolumUsed] = metrix.volum_used_in_byte();
+    values[kCpuNrThrottled] = metrix.cpu_nr_throttled();
+    values[kCpuThrottledTime] = metrix.cpu_throttled_time();
+
+    boost::mutex::scoped_lock lock(mutex_);
+    boost::shared_ptr<baidu::galaxy::collector::MetrixRing>& ring = rings_[id];
+
+    if (NULL == ring.get()) {
+        ring.reset(new baidu::galaxy::collector::MetrixRing(Aggregations(), window_));
+    }
+
+    // stale, or recorded already
+    if (metrix.time() <= ring->LastTime()) {
+        return;
+    }
+
+    ring->Append(metrix.time(), values);
+}
+
+void MetrixRecorder::Expire(int64_t now) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::collector::MetrixRing> >::iterator iter = rings_.begin();
+
+    while (iter != rings_.end()) {
+        if (iter->second->LastTime() < now - window_ * 1000000L) {
+            VLOG(10) << "forget metrix of " << iter->first.CompactId();
+            rings_.erase(iter++);
+        } else {
+            iter++;
+        }
+    }
+}
+
+void MetrixRecorder::Query(const baidu::galaxy::proto::GetMetricsRequest& request,
+        baidu::galaxy::proto::GetMetricsResponse* response) {
+    assert(NULL != response);
+    int64_t end = request.has_end_time() ? request.end_time() : baidu::common::timer::get_micros() + 1;
+    int64_t interval = request.interval() > 1 ? request.interval() * 1000000L : 0L;
+    std::vector<int64_t> times;
+    std::vector<std::vector<int64_t> > rows;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::collector::MetrixRing> >::iterator iter = rings_.begin();
+
+    for (; iter != rings_.end(); iter++) {
+        if (!request.id().empty() && request.id() != iter->first.SubId()) {
+            continue;
+        }
+
+        if (!request.container_group_id().empty()
+                && request.container_group_id() != iter->first.GroupId()) {
+            continue;
+        }
+
+        times.clear();
+        rows.clear();
+        iter->second->Query(request.start_time(), end, interval, times, rows);
+        baidu::galaxy::proto::ContainerMetrixHistory* history = response->add_histories();
+        history->set_id(iter->first.SubId());
+        history->set_group_id(iter->first.GroupId());
+
+        for (size_t i = 0; i < times.size(); i++) {
+            const std::vector<int64_t>& row = rows[i];
+            baidu::galaxy::proto::ContainerMetrix* m = history->add_metrix();
+            m->set_time(times[i]);
+            m->set_cpu_used_in_millicore(row[kCpuUsed]);
+            m->set_memory_used_in_byte(row[kMemoryUsed]);
+            m->set_memory_rss_in_byte(row[kMemoryRss]);
+            m->set_memory_cache_in_byte(row[kMemoryCache]);
+            m->set_memory_fail_cnt(row[kMemoryFailCnt]);
+            m->set_volum_used_in_byte(row[kVolumUsed]);
+            m->set_cpu_nr_throttled(row[kCpuNrThrottled]);
+            m->set_cpu_throttled_time(row[kCpuThrottledTime]);
+        }
+    }
+}
+
+size_t MetrixRecorder::Bytes() {
+    boost::mutex::scoped_lock lock(mutex_);
+    size_t ret = 0;
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::collector::MetrixRing> >::iterator iter = rings_.begin();
+
+    for (; iter != rings_.end(); iter++) {
+        ret += iter->second->Bytes();
+    }
+
+    return ret;
+}
+
+void MetrixRecorder::Enable(bool enable) {
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = enable;
+}
+
+bool MetrixRecorder::Enabled() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return enabled_;
+}
+
+bool MetrixRecorder::Equal(const Collector* c) {
+    assert(NULL != c);
+    return this == c;
+}
+
+int MetrixRecorder::Cycle() {
+    return 1;
+}
+
+std::string MetrixRecorder::Name() const {
+    return "metrix_recorder";
+}
+
+}
+}
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "icontainer.h"
+#include "collector/collector.h"
+#include "collector/metrix_ring.h"
+#include "util/error_code.h"
+
+#include "boost/function.hpp"
+#include "boost/shared_ptr.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class ContainerMetrix;
+class GetMetricsRequest;
+class GetMetricsResponse;
+}
+
+namespace container {
+
+// Keeps one sample per second of every container for the last window
+// seconds, a container is forgotten one window after it is gone.
+class MetrixRecorder : public baidu::galaxy::collector::Collector {
+public:
+    typedef std::vector<std::pair<ContainerId, boost::shared_ptr<baidu::galaxy::proto::ContainerMetrix> > > Samples;
+    typedef boost::function<void (Samples&)> Source;
+
+    MetrixRecorder(Source source, int window);
+    ~MetrixRecorder();
+
+    baidu::galaxy::util::ErrorCode Collect();
+    void Enable(bool enable);
+    bool Enabled();
+    bool Equal(const Collector* c);
+    int Cycle();
+    std::string Name() const;
+
+    void Record(const ContainerId& id, const baidu::galaxy::proto::ContainerMetrix& metrix);
+    void Query(const baidu::galaxy::proto::GetMetricsRequest& request,
+            baidu::galaxy::proto::GetMetricsResponse* response);
+    // encoded bytes of all containers
+    size_t Bytes();
+
+private:
+    void Expire(int64_t now);
+
+    Source source_;
+    const int window_;
+    bool enabled_;
+    boost::mutex mutex_;
+    std::map<ContainerId, boost::shared_ptr<baidu::galaxy::collector::MetrixRing> > rings_;
+};
+
+}
+}
+}
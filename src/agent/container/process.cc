@@ -5,12 +5,16 @@
 
 #include "util/util.h"
 
-#include <boost/filesystem/operations.hpp>
-#include <boost/system/error_code.hpp>
 #include <glog/logging.h>
 
+#include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/stat.h>
@@ -21,15 +25,45 @@
 #include <sstream>
 
 
+#ifndef SYS_close_range
+#define SYS_close_range 436
+#endif
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
+
+#ifndef CLONE_PIDFD
+#define CLONE_PIDFD 0x00001000
+#endif
+
 namespace baidu {
 namespace galaxy {
 namespace container {
 
+static const size_t CLONE_STACK_SIZE = 1024 * 1024;
+// ms waiting for exec of a routine
+static const int EXEC_REPORT_TIMEOUT = 60000;
+
+// written by a child whose routine failed before exec
+struct CloneReport {
+    int32_t ret;
+    int32_t err;
+};
+
 Process::Process() :
-    pid_(-1) {
+    pid_(-1),
+    pidfd_(-1) {
 }
 
 Process::~Process() {
+    if (pidfd_ >= 0) {
+        ::close(pidfd_);
+    }
 }
 
 pid_t Process::SelfPid() {
@@ -65,23 +99,14 @@ int Process::RedirectStdout(const std::string& path) {
 int Process::Clone(boost::function<int (void*) > routine, void* param, int32_t flag) {
     assert(!stderr_path_.empty());
     assert(!stdout_path_.empty());
-    std::vector<int> fds;
-    int pid = SelfPid();
-
-    if (0 != ListFds(pid, fds)) {
-        LOG(WARNING) << "failed to list opened fd of process " << pid;
-        return -1;
-    }
-
-    Context* context = new Context();
-    context->fds.swap(fds);
-    const int STD_FILE_OPEN_FLAG = O_CREAT | O_APPEND | O_WRONLY;
+    // fds opened here are close-on-exec, so they do not leak into children
+    // launched by other threads at the same time
+    const int STD_FILE_OPEN_FLAG = O_CREAT | O_APPEND | O_WRONLY | O_CLOEXEC;
     const int STD_FILE_OPEN_MODE = S_IRWXU | S_IRWXG | S_IROTH;
     int stdout_fd = ::open(stdout_path_.c_str(), STD_FILE_OPEN_FLAG, STD_FILE_OPEN_MODE);
 
     if (-1 == stdout_fd) {
         LOG(WARNING) << "open file failed: " << stdout_path_;
-        delete context;
         return -1;
     }
 
@@ -89,44 +114,198 @@ int Process::Clone(boost::function<int (void*) > routine, void* param, int32_t f
 
     if (-1 == stderr_fd) {
         LOG(WARNING) << "open file failed: " << stderr_path_;
-        delete context;
         ::close(stdout_fd);
         return -1;
     }
 
-    context->stderr_fd = stderr_fd;
-    context->stdout_fd = stdout_fd;
-    context->self = this;
-    context->routine = routine;
-    context->parameter = param;
+    int report[2];
+
+    if (0 != ::pipe2(report, O_CLOEXEC)) {
+        LOG(WARNING) << "create report pipe failed: " << strerror(errno);
+        ::close(stdout_fd);
+        ::close(stderr_fd);
+        return -1;
+    }
+
+    // every launch has a stack of its own, the child works on a copy of it
+    // as it does not share memory with the agent
+    void* stack = ::mmap(NULL, CLONE_STACK_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+
+    if (MAP_FAILED == stack) {
+        LOG(WARNING) << "alloc clone stack failed: " << strerror(errno);
+        ::close(stdout_fd);
+        ::close(stderr_fd);
+        ::close(report[0]);
+        ::close(report[1]);
+        return -1;
+    }
+
+    Context context;
+    context.stderr_fd = stderr_fd;
+    context.stdout_fd = stdout_fd;
+    context.report_fd = report[1];
+
+    // fds opened by other threads after listing are close-on-exec anyway
+    if (!HasCloseRange()) {
+        ListFds(context.fds);
+    }
+
+    context.self = this;
+    context.routine = routine;
+    context.parameter = param;
     const static int CLONE_FLAG = CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWUTS | SIGCHLD;
-    const static int CLONE_STACK_SIZE = 1024 * 1024;
-    static char CLONE_STACK[CLONE_STACK_SIZE];
-    pid = ::clone(&Process::CloneRoutine,
-            CLONE_STACK + CLONE_STACK_SIZE,
-            CLONE_FLAG,
-            context);
+    // the pidfd is got with the pid at once, so it can not refer to another
+    // process even if the child exits and is reaped at once
+    int pidfd = -1;
+    pid_t pid = ::clone(&Process::CloneRoutine,
+            (char*)stack + CLONE_STACK_SIZE,
+            CLONE_FLAG | CLONE_PIDFD,
+            &context,
+            &pidfd);
+
+    // CLONE_PIDFD is in linux 5.2 and later
+    if (-1 == pid && EINVAL == errno) {
+        pidfd = -1;
+        pid = ::clone(&Process::CloneRoutine,
+                (char*)stack + CLONE_STACK_SIZE,
+                CLONE_FLAG,
+                &context);
+
+        if (pid > 0) {
+            pidfd = PidfdOpen(pid);
+        }
+    }
+
     int en = errno;
+    ::munmap(stack, CLONE_STACK_SIZE);
+    ::close(stdout_fd);
+    ::close(stderr_fd);
+    ::close(report[1]);
 
-    if (pid != 0) {
-        ::close(context->stdout_fd);
-        ::close(context->stderr_fd);
-        pid_ = pid;
+    if (-1 == pid) {
+        ::close(report[0]);
+        LOG(WARNING) << "clone failed: " << strerror(en);
+        return -1;
     }
 
-    if (-1 == pid_) {
-        LOG(WARNING) << "clone failed: " << strerror(en);
+    baidu::galaxy::util::ErrorCode ec = WaitExec(pid, report[0]);
+    ::close(report[0]);
+
+    if (0 != ec.Code()) {
+        LOG(WARNING) << "process " << pid << " failed before exec: " << ec.Message();
+
+        if (pidfd >= 0) {
+            ::close(pidfd);
+        }
+
         return -1;
     }
 
+    Reset(pid, pidfd);
     return pid_;
 }
 
+int Process::PidfdOpen(pid_t pid) {
+    int fd = (int)::syscall(SYS_pidfd_open, pid, 0U);
+
+    if (fd < 0) {
+        VLOG(10) << "pidfd of " << pid << " is not available: " << strerror(errno);
+        return -1;
+    }
+
+    // pidfd_open(2) sets close-on-exec
+    return fd;
+}
+
+void Process::Reset(pid_t pid, int pidfd) {
+    if (pidfd_ >= 0) {
+        ::close(pidfd_);
+    }
+
+    pid_ = pid;
+    pidfd_ = pidfd;
+}
+
+baidu::galaxy::util::ErrorCode Process::WaitExec(pid_t pid, int report_fd) {
+    struct pollfd pfd;
+    pfd.fd = report_fd;
+    pfd.events = POLLIN;
+    int ret = 0;
+
+    while ((ret = ::poll(&pfd, 1, EXEC_REPORT_TIMEOUT)) < 0 && EINTR == errno) {
+    }
+
+    // a routine may hang in mounting, it is checked by keep alive later
+    if (ret <= 0) {
+        LOG(WARNING) << "process " << pid << " did not exec in " << EXEC_REPORT_TIMEOUT
+                     << "ms, take it as started";
+        return ERRORCODE_OK;
+    }
+
+    CloneReport report;
+    ssize_t size = 0;
+
+    while ((size = ::read(report_fd, &report, sizeof report)) < 0 && EINTR == errno) {
+    }
+
+    // closed by exec, or by exit of a routine not calling exec
+    if (size != (ssize_t)sizeof report) {
+        return ERRORCODE_OK;
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    return ERRORCODE(-1, "routine returned %d: %s", report.ret, strerror(report.err));
+}
+
+bool Process::HasCloseRange() {
+    // close_range(2) is in linux 5.9 and later, closing no fd tells
+    static const bool has = 0 == ::syscall(SYS_close_range, ~0U, ~0U, 0U);
+    return has;
+}
+
+void Process::ListFds(std::vector<int>& fds) {
+    DIR* dir = ::opendir("/proc/self/fd");
+
+    if (NULL == dir) {
+        LOG(WARNING) << "list fds failed: " << strerror(errno);
+        return;
+    }
+
+    struct dirent* entry = NULL;
+
+    while (NULL != (entry = ::readdir(dir))) {
+        int fd = atoi(entry->d_name);
+
+        if (fd > STDERR_FILENO && fd != ::dirfd(dir)) {
+            fds.push_back(fd);
+        }
+    }
+
+    ::closedir(dir);
+}
+
+void Process::CloseFds(int keep, const std::vector<int>& fds) {
+    // needs no listing of fds
+    if ((keep <= 3 || 0 == ::syscall(SYS_close_range, 3U, (unsigned int)keep - 1, 0U))
+            && 0 == ::syscall(SYS_close_range, (unsigned int)keep + 1, ~0U, 0U)) {
+        return;
+    }
+
+    for (size_t i = 0; i < fds.size(); i++) {
+        if (fds[i] != keep) {
+            ::close(fds[i]);
+        }
+    }
+}
+
 int Process::CloneRoutine(void* param) {
     assert(NULL != param);
     Context* context = (Context*) param;
     assert(context->stdout_fd > 0);
     assert(context->stderr_fd > 0);
+    assert(context->report_fd > 0);
     assert(NULL != context->self);
     assert(NULL != context->routine);
     close(STDOUT_FILENO);
@@ -141,24 +320,29 @@ int Process::CloneRoutine(void* param) {
             && errno == EINTR) {
     }
 
-    for (size_t i = 0; i < context->fds.size(); i++) {
-        if (STDOUT_FILENO == context->fds[i]
-                || STDERR_FILENO == context->fds[i]
-                || STDIN_FILENO == context->fds[i]) {
-            // not close std fds
-            continue;
-        }
+    // nothing opened by the agent is left to routine but the report pipe
+    CloseFds(context->report_fd, context->fds);
+    pid_t pid = SelfPid();
+    int ret = -1;
 
-        ::close(context->fds[i]);
+    if (0 == ::setpgid(pid, pid)) {
+        ret = context->routine(context->parameter);
     }
 
-    pid_t pid = SelfPid();
+    if (ret < 0) {
+        CloneReport report;
+        report.ret = ret;
+        report.err = errno;
 
-    if (0 != ::setpgid(pid, pid)) {
-        return -1;
+        // no stream in the child, stderr is the file of the container
+        if ((ssize_t)sizeof report != ::write(context->report_fd, &report, sizeof report)) {
+            static const char msg[] = "write exec report failed\n";
+            ssize_t written = ::write(STDERR_FILENO, msg, sizeof msg - 1);
+            (void) written;
+        }
     }
 
-    return context->routine(context->parameter);
+    return ret;
 }
 
 
@@ -184,39 +368,50 @@ int Process::Wait(int& status) {
     return 0;
 }
 
-int Process::ListFds(pid_t pid, std::vector<int>& fd) {
-    std::stringstream ss;
-    ss << "/proc/" << (int)pid << "/fd";
-    boost::filesystem::path path(ss.str());
-    boost::system::error_code ec;
+void Process::Reload(pid_t pid) {
+    Reset(pid, pid > 0 ? PidfdOpen(pid) : -1);
+}
 
-    if (!boost::filesystem::exists(path, ec)) {
-        return -1;
-    }
+int Process::PidFd() {
+    return pidfd_;
+}
 
-    boost::filesystem::directory_iterator begin(path, ec);
-    if (ec.value() != 0) {
-        return -1;
+bool Process::Exited() {
+    if (pidfd_ < 0) {
+        return false;
     }
 
-    boost::filesystem::directory_iterator end;
-    //
-    // exclude .. and .
-    for (boost::filesystem::directory_iterator iter = begin; iter != end; iter++) {
-        //std::string file_name = iter->filename();
-        std::string file_name = iter->path().filename().string();
+    // readable once the process exits, whether it is reaped or not
+    struct pollfd pfd;
+    pfd.fd = pidfd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, 0) > 0;
+}
 
-        if (file_name != "." && file_name != "..") {
-            fd.push_back(atoi(file_name.c_str()));
-        }
+baidu::galaxy::util::ErrorCode Process::Signal(int sig) {
+    int ret = -1;
+
+    if (pidfd_ >= 0) {
+        // never reaches another process taking the pid after an exit
+        ret = (int)::syscall(SYS_pidfd_send_signal, pidfd_, sig, NULL, 0U);
+    } else if (pid_ > 0) {
+        ret = ::kill(pid_, sig);
+    } else {
+        return ERRORCODE(-1, "no process");
     }
 
-    return 0;
-}
+    int err = errno;
+
+    if (0 == ret) {
+        return ERRORCODE_OK;
+    }
 
+    if (err == ESRCH) {
+        return PERRORCODE(0, err, "pid %d not exist", (int)pid_);
+    }
 
-void Process::Reload(pid_t pid) {
-    pid_ = pid;
+    return PERRORCODE(-1, err, "failed in signaling pid %d", (int)pid_);
 }
 
 } //namespace container
@@ -46,11 +46,22 @@ public:
     int RedirectStderr(const std::string& path);
     int RedirectStdout(const std::string& path);
 
+    // safe to be called by many threads at the same time. routine runs in
+    // new namespaces and is expected to exec, the pid is returned once it
+    // does, -1 if routine returns a negative value before
     int Clone(boost::function<int (void*)> routine, void* param, int32_t flag);
     int Fork(boost::function<int (void*)> routine, void* param);
     int Wait(int& status);
+    // opens a pidfd of pid, whose identity is to be checked by the caller
     void Reload(pid_t pid);
     pid_t Pid();
+    // refers to the process got by Clone or Reload even if its pid is
+    // taken by another one later, -1 on kernels before linux 5.3
+    int PidFd();
+    // by the pidfd, false if there is none
+    bool Exited();
+    // by the pidfd if there is one, ok if the process is gone
+    baidu::galaxy::util::ErrorCode Signal(int sig);
 
 private:
     class Context {
@@ -58,6 +69,7 @@ private:
         Context() : self(NULL),
             stdout_fd(-1),
             stderr_fd(-1),
+            report_fd(-1),
             routine(NULL),
             parameter(NULL) {
         }
@@ -66,16 +78,31 @@ private:
         Process* self;
         int stdout_fd;
         int stderr_fd;
+        // closed by exec, a routine returning a negative value writes
+        // a report to it before exit
+        int report_fd;
+        // fds of the agent listed before clone, closed by the child when
+        // close_range(2) is missing, so it neither allocates nor lists
+        std::vector<int> fds;
         boost::function<int (void*)> routine;
         void* parameter;
-        std::vector<int> fds;
     };
 
     static int CloneRoutine(void* self);
-
-    int ListFds(pid_t pid, std::vector<int>& fd);
+    static bool HasCloseRange();
+    // fds of /proc/self/fd above std fds
+    static void ListFds(std::vector<int>& fds);
+    // closes every fd but std fds and keep in the child, those in fds
+    // if close_range(2) fails
+    static void CloseFds(int keep, const std::vector<int>& fds);
+    // ok when the child execs or exits without report
+    static baidu::galaxy::util::ErrorCode WaitExec(pid_t pid, int report_fd);
+    static int PidfdOpen(pid_t pid);
+    // takes pidfd, the one held is closed
+    void Reset(pid_t pid, int pidfd);
 
     pid_t pid_;
+    int pidfd_;
 
     std::string user_;
     std::string _user_group;
@@ -0,0 +1,231 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "process_watcher.h"
+
+#include "boost/bind.hpp"
+#include "glog/logging.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#include <vector>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+static const int MAX_EPOLL_EVENTS = 64;
+
+ProcessWatcher::ProcessWatcher() :
+    epoll_fd_(-1),
+    stop_fd_(-1),
+    running_(false) {
+}
+
+ProcessWatcher::~ProcessWatcher() {
+    TearDown();
+}
+
+baidu::galaxy::util::ErrorCode ProcessWatcher::Setup() {
+    assert(!running_);
+    // pidfd_open(2) is in linux 5.3 and later
+    int fd = (int)::syscall(SYS_pidfd_open, ::getpid(), 0U);
+
+    if (fd < 0) {
+        return PERRORCODE(-1, errno, "pidfd is not supported");
+    }
+
+    ::close(fd);
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+
+    if (epoll_fd_ < 0) {
+        return PERRORCODE(-1, errno, "create epoll fd failed");
+    }
+
+    // wakes up the thread on TearDown
+    stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = stop_fd_;
+
+    if (stop_fd_ < 0 || 0 != ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &event)) {
+        int err = errno;
+        TearDown();
+        return ERRORCODE(-1, "create eventfd failed: %s", strerror(err));
+    }
+
+    running_ = true;
+
+    if (!thread_.Start(boost::bind(&ProcessWatcher::PollRoutine, this))) {
+        running_ = false;
+        TearDown();
+        return ERRORCODE(-1, "start process watcher thread failed");
+    }
+
+    LOG(INFO) << "watch exits of processes by pidfd";
+    return ERRORCODE_OK;
+}
+
+void ProcessWatcher::TearDown() {
+    if (running_) {
+        running_ = false;
+        uint64_t one = 1;
+
+        if (::write(stop_fd_, &one, sizeof one) < 0) {
+            LOG(WARNING) << "wake up process watcher thread failed: " << strerror(errno);
+        }
+
+        thread_.Join();
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while (!watched_.empty()) {
+        Remove(watched_.begin());
+    }
+
+    if (stop_fd_ >= 0) {
+        ::close(stop_fd_);
+        stop_fd_ = -1;
+    }
+
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+baidu::galaxy::util::ErrorCode ProcessWatcher::Watch(const std::string& key, int pidfd, Callback callback) {
+    if (epoll_fd_ < 0) {
+        return ERRORCODE(-1, "process watcher is not set up");
+    }
+
+    int fd = ::fcntl(pidfd, F_DUPFD_CLOEXEC, 0);
+
+    if (fd < 0) {
+        return PERRORCODE(-1, errno, "dup pidfd of %s failed", key.c_str());
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, Watched>::iterator iter = watched_.find(key);
+
+    if (watched_.end() != iter) {
+        Remove(iter);
+    }
+
+    // level triggered, a process exited already is reported at once
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+
+    if (0 != ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event)) {
+        int err = errno;
+        ::close(fd);
+        return ERRORCODE(-1, "watch pidfd of %s failed: %s", key.c_str(), strerror(err));
+    }
+
+    Watched& watched = watched_[key];
+    watched.fd = fd;
+    watched.callback = callback;
+    keys_[fd] = key;
+    VLOG(10) << "watch exit of " << key;
+    return ERRORCODE_OK;
+}
+
+void ProcessWatcher::Unwatch(const std::string& key) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, Watched>::iterator iter = watched_.find(key);
+
+    if (watched_.end() != iter) {
+        Remove(iter);
+    }
+}
+
+int ProcessWatcher::Size() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return (int)watched_.size();
+}
+
+void ProcessWatcher::Remove(std::map<std::string, Watched>::iterator iter) {
+    const int fd = iter->second.fd;
+
+    if (0 != ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL)) {
+        LOG(WARNING) << "unwatch pidfd of " << iter->first << " failed: " << strerror(errno);
+    }
+
+    ::close(fd);
+    keys_.erase(fd);
+    watched_.erase(iter);
+}
+
+void ProcessWatcher::PollRoutine() {
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (running_) {
+        int n = ::epoll_wait(epoll_fd_, events, MAX_EPOLL_EVENTS, -1);
+
+        if (n < 0) {
+            if (errno != EINTR) {
+                LOG(WARNING) << "wait for process exits failed: " << strerror(errno);
+                ::usleep(100000);
+            }
+
+            continue;
+        }
+
+        std::vector<std::pair<std::string, Callback> > exited;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            for (int i = 0; i < n; i++) {
+                const int fd = events[i].data.fd;
+                std::map<int, std::string>::iterator key = keys_.find(fd);
+
+                if (fd == stop_fd_ || keys_.end() == key) {
+                    continue;
+                }
+
+                // the fd may be unwatched and reused by a Watch since the
+                // event is got, it is checked again
+                struct pollfd pfd;
+                pfd.fd = fd;
+                pfd.events = POLLIN;
+                pfd.revents = 0;
+
+                if (::poll(&pfd, 1, 0) <= 0) {
+                    continue;
+                }
+
+                std::map<std::string, Watched>::iterator iter = watched_.find(key->second);
+                assert(watched_.end() != iter);
+                exited.push_back(std::make_pair(iter->first, iter->second.callback));
+                Remove(iter);
+            }
+        }
+
+        for (size_t i = 0; i < exited.size() && running_; i++) {
+            VLOG(10) << "process of " << exited[i].first << " exited";
+
+            if (exited[i].second) {
+                exited[i].second();
+            }
+        }
+    }
+}
+
+}
+}
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+
+#include "boost/function.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "thread.h"
+
+#include <map>
+#include <string>
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+// Wakes up when watched processes exit instead of scanning them. A pidfd
+// becomes readable once its process exits, all pidfds are polled by one
+// epoll fd, so an exit is seen at once and a pid taken by another process
+// later is never mistaken for the watched one.
+class ProcessWatcher : private boost::noncopyable {
+public:
+    typedef boost::function<void ()> Callback;
+
+    ProcessWatcher();
+    ~ProcessWatcher();
+
+    // fails if pidfds are not supported, exits are polled by the caller then
+    baidu::galaxy::util::ErrorCode Setup();
+    void TearDown();
+
+    // callback runs on the watcher thread once after the process exits,
+    // without any lock held, it may run even after Unwatch returns. pidfd
+    // is duplicated, the caller keeps its own. A key watched is replaced.
+    baidu::galaxy::util::ErrorCode Watch(const std::string& key, int pidfd, Callback callback);
+    void Unwatch(const std::string& key);
+    int Size();
+
+private:
+    struct Watched {
+        int fd;
+        Callback callback;
+    };
+
+    // mutex_ is held
+    void Remove(std::map<std::string, Watched>::iterator iter);
+    void PollRoutine();
+
+    int epoll_fd_;
+    int stop_fd_;
+    bool running_;
+    boost::mutex mutex_;
+    std::map<std::string, Watched> watched_;
+    std::map<int, std::string> keys_;       // fd -> key
+    baidu::common::Thread thread_;
+};
+
+}
+}
+}
@@ -0,0 +1,148 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "report_cache.h"
+#include "protocol/galaxy.pb.h"
+
+#include <google/protobuf/unknown_field_set.h>
+#include "boost/scoped_ptr.hpp"
+
+#include <assert.h>
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+ReportCache::ReportCache() :
+    build_(0L) {
+}
+
+ReportCache::~ReportCache() {
+}
+
+void ReportCache::Begin() {
+    building_.reset(new Report());
+    build_++;
+}
+
+bool ReportCache::Keep(const std::string& key,
+        const std::string& version,
+        const Stamp& stamp) {
+    assert(NULL != building_.get());
+    std::map<std::string, Entry>::iterator iter = entries_.find(key);
+
+    if (entries_.end() == iter
+            || iter->second.desc_version != version
+            || iter->second.stamp != stamp) {
+        return false;
+    }
+
+    iter->second.seen = build_;
+    Count(iter->second);
+    return true;
+}
+
+void ReportCache::Add(const std::string& key,
+        const Stamp& stamp,
+        const baidu::galaxy::proto::ContainerInfo& brief,
+        const baidu::galaxy::proto::ContainerDescription& desc) {
+    assert(NULL != building_.get());
+    Entry& entry = entries_[key];
+    entry.seen = build_;
+    entry.stamp = stamp;
+    entry.usage = Usage();
+    Usage& usage = entry.usage;
+
+    if (desc.priority() != baidu::galaxy::proto::kJobBestEffort) {
+        usage.cpu_used += brief.cpu_used();
+        usage.memory_used += brief.memory_used();
+    }
+
+    for (int i = 0; i < brief.volum_used_size(); i++) {
+        const baidu::galaxy::proto::Volum& volum = brief.volum_used(i);
+
+        if (volum.medium() == baidu::galaxy::proto::kTmpfs) {
+            usage.memory_volum_used += volum.used_size();
+        }
+
+        usage.volum_used[volum.device_path()] += volum.used_size();
+    }
+
+    buffer_.clear();
+    brief.AppendToString(&buffer_);
+
+    // a container of the same id may be created again by another version
+    if (NULL == entry.full_bytes.get() || entry.desc_version != desc.version()) {
+        baidu::galaxy::proto::ContainerInfo ci;
+        ci.mutable_container_desc()->CopyFrom(desc);
+        entry.desc.clear();
+        ci.AppendToString(&entry.desc);
+        entry.desc_version = desc.version();
+        entry.brief_bytes.reset();
+    }
+
+    if (NULL == entry.brief_bytes.get() || *entry.brief_bytes != buffer_) {
+        // parsing concatenated messages merges them, description of the
+        // brief info is completed by the one serialized alone
+        entry.brief_bytes.reset(new std::string(buffer_));
+        entry.full_bytes.reset(new std::string(buffer_ + entry.desc));
+        building_->rebuilt++;
+    }
+
+    Count(entry);
+}
+
+void ReportCache::Count(const Entry& entry) {
+    Usage& usage = building_->usage;
+    usage.cpu_used += entry.usage.cpu_used;
+    usage.memory_used += entry.usage.memory_used;
+    usage.memory_volum_used += entry.usage.memory_volum_used;
+    std::map<std::string, int64_t>::const_iterator iter = entry.usage.volum_used.begin();
+
+    for (; iter != entry.usage.volum_used.end(); iter++) {
+        usage.volum_used[iter->first] += iter->second;
+    }
+
+    building_->brief.push_back(entry.brief_bytes);
+    building_->full.push_back(entry.full_bytes);
+}
+
+boost::shared_ptr<const ReportCache::Report> ReportCache::Finish(int64_t now) {
+    assert(NULL != building_.get());
+    std::map<std::string, Entry>::iterator iter = entries_.begin();
+
+    while (entries_.end() != iter) {
+        if (iter->second.seen != build_) {
+            entries_.erase(iter++);
+        } else {
+            iter++;
+        }
+    }
+
+    building_->build_time = now;
+    boost::shared_ptr<const Report> report = building_;
+    building_.reset();
+    return report;
+}
+
+void ReportCache::Fill(const Report& report,
+        bool full,
+        baidu::galaxy::proto::AgentInfo* agent_info) {
+    const std::vector<boost::shared_ptr<const std::string> >& infos = full ? report.full : report.brief;
+    ::google::protobuf::UnknownFieldSet* fields = agent_info->mutable_unknown_fields();
+
+    for (size_t i = 0; i < infos.size(); i++) {
+        fields->AddLengthDelimited(baidu::galaxy::proto::AgentInfo::kContainerInfoFieldNumber, *infos[i]);
+    }
+}
+
+std::string ReportCache::DebugString(const ::google::protobuf::Message& message) {
+    boost::scoped_ptr< ::google::protobuf::Message> received(message.New());
+    received->ParseFromString(message.SerializeAsString());
+    return received->DebugString();
+}
+
+}
+}
+}
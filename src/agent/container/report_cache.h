@@ -0,0 +1,122 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "boost/shared_ptr.hpp"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace google {
+namespace protobuf {
+class Message;
+}
+}
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class AgentInfo;
+class ContainerInfo;
+class ContainerDescription;
+}
+
+namespace container {
+
+// Container infos reported by Query, kept serialized for both the brief and
+// the full report. A container is asked for its info and serialized again
+// only when its stamp changed since the last build, its description is
+// serialized once.
+class ReportCache {
+public:
+    // what the brief info of a container is made of, see IContainer::ReportStamp
+    typedef std::vector<int64_t> Stamp;
+
+    // resources used by the containers reported
+    struct Usage {
+        Usage() :
+            cpu_used(0L),
+            memory_used(0L),
+            memory_volum_used(0L) {
+        }
+
+        int64_t cpu_used;           // of containers not best effort
+        int64_t memory_used;        // of containers not best effort
+        int64_t memory_volum_used;  // of tmpfs volums
+        std::map<std::string, int64_t> volum_used;  // device path -> used
+    };
+
+    // result of a build, shared by queries until the next build
+    struct Report {
+        Report() :
+            build_time(0L),
+            rebuilt(0) {
+        }
+
+        std::vector<boost::shared_ptr<const std::string> > brief;
+        std::vector<boost::shared_ptr<const std::string> > full;
+        Usage usage;
+        int64_t build_time;         // unit us
+        int rebuilt;                // containers serialized again
+    };
+
+    ReportCache();
+    ~ReportCache();
+
+    // a build is Begin, Keep or Add for every container, then Finish
+    void Begin();
+    // reuses the info of the last build if the container has the same
+    // version and stamp, false if it has to be added
+    bool Keep(const std::string& key,
+            const std::string& version,
+            const Stamp& stamp);
+    // brief holds the version of description only
+    void Add(const std::string& key,
+            const Stamp& stamp,
+            const baidu::galaxy::proto::ContainerInfo& brief,
+            const baidu::galaxy::proto::ContainerDescription& desc);
+    // containers not kept or added since Begin are dropped
+    boost::shared_ptr<const Report> Finish(int64_t now);
+
+    // The only place serialized infos go into a message: they are appended
+    // to agent_info as unknown fields of container_info, which protobuf
+    // writes out as they are, so the receiver parses them as container_info.
+    // On this side container_info_size() of agent_info stays 0 and
+    // DebugString() shows the raw bytes, see DebugString below.
+    static void Fill(const Report& report,
+            bool full,
+            baidu::galaxy::proto::AgentInfo* agent_info);
+    // a message holding a filled agent_info as the receiver sees it, for logging
+    static std::string DebugString(const ::google::protobuf::Message& message);
+
+private:
+    struct Entry {
+        Entry() :
+            seen(0L) {
+        }
+
+        std::string desc;           // serialized info holding description only
+        std::string desc_version;
+        Stamp stamp;
+        Usage usage;                // of this container alone
+        boost::shared_ptr<const std::string> brief_bytes;
+        boost::shared_ptr<const std::string> full_bytes;
+        int64_t seen;               // the last build added in
+    };
+
+    // counts the entry in the report being built
+    void Count(const Entry& entry);
+
+    std::map<std::string, Entry> entries_;
+    boost::shared_ptr<Report> building_;
+    int64_t build_;
+    std::string buffer_;
+};
+
+}
+}
+}
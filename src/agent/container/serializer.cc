@@ -9,10 +9,27 @@
 
 #include "util/dict_file.h"
 
+#include "boost/bind.hpp"
+#include <glog/logging.h>
+
 
 namespace baidu {
 namespace galaxy {
 namespace container {
+
+static bool ParseWork(std::vector<boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> >* metas,
+        const leveldb::Slice& key,
+        const leveldb::Slice& value) {
+    boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> cm(new baidu::galaxy::proto::ContainerMeta);
+
+    if (!cm->ParseFromArray(value.data(), (int)value.size())) {
+        LOG(WARNING) << "bad work container meta, key is " << key.ToString();
+        return true;
+    }
+
+    metas->push_back(cm);
+    return true;
+}
 Serializer::Serializer() {
 }
 Serializer::~Serializer() {
@@ -81,8 +98,10 @@ baidu::galaxy::util::ErrorCode Serializer::LoadWork(std::vector<boost::shared_pt
     assert(dictfile_->IsOpen());
     std::string begin_key = "#_!";
     std::string end_key = "#_~";
-    std::vector<baidu::galaxy::file::DictFile::Kv> v;
-    baidu::galaxy::util::ErrorCode ec = dictfile_->Scan(begin_key, end_key, v);
+    // values are parsed in place, not copied out of leveldb first
+    baidu::galaxy::util::ErrorCode ec = dictfile_->Visit(begin_key,
+            end_key,
+            boost::bind(&ParseWork, &metas, _1, _2));
 
     if (ec.Code() != 0) {
         return ERRORCODE(-1,
@@ -90,12 +109,6 @@ baidu::galaxy::util::ErrorCode Serializer::LoadWork(std::vector<boost::shared_pt
                 ec.Message().c_str());
     }
 
-    for (size_t i = 0; i < v.size(); i++) {
-        boost::shared_ptr<baidu::galaxy::proto::ContainerMeta> cm(new baidu::galaxy::proto::ContainerMeta);
-        cm->ParseFromString(v[i].value);
-        metas.push_back(cm);
-    }
-
     return ERRORCODE_OK;
 }
 
@@ -0,0 +1,311 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "slot_pool.h"
+#include "cgroup/subsystem_factory.h"
+#include "protocol/galaxy.pb.h"
+#include "util/path_tree.h"
+#include "util/util.h"
+#include "timer.h"
+
+#include "boost/algorithm/string/classification.hpp"
+#include "boost/algorithm/string/predicate.hpp"
+#include "boost/algorithm/string/split.hpp"
+#include "boost/bind.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/filesystem/path.hpp"
+#include "boost/lexical_cast.hpp"
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+DECLARE_string(mount_templat);
+DECLARE_string(mount_cgroups);
+
+namespace baidu {
+namespace galaxy {
+namespace container {
+
+// container ids never start with a dot
+static const std::string kSlotPrefix = ".slot.";
+
+SlotPool::SlotPool(int min_size, int max_size, int window) :
+    min_size_(std::max(0, min_size)),
+    max_size_(std::max(0, max_size)),
+    window_(std::max(1, window) * 1000000L),
+    running_(false),
+    seq_(0L),
+    hit_(0L),
+    miss_(0L) {
+}
+
+SlotPool::~SlotPool() {
+    Stop();
+}
+
+void SlotPool::Start() {
+    boost::shared_ptr<baidu::galaxy::cgroup::SubsystemFactory> factory
+        = baidu::galaxy::cgroup::SubsystemFactory::GetInstance();
+    std::vector<std::string> subsystems;
+    factory->GetSubsystems(subsystems);
+    hierarchies_.clear();
+
+    // subsystems mounted together share one hierarchy, and only one slot
+    // directory can be renamed in it
+    for (size_t i = 0; i < subsystems.size(); i++) {
+        boost::system::error_code ec;
+        boost::filesystem::path path = boost::filesystem::canonical(factory->HierarchyPath(subsystems[i]), ec);
+
+        if (ec.value() != 0) {
+            LOG(WARNING) << "hierarchy of " << subsystems[i] << " is not mounted, no slot in it";
+            continue;
+        }
+
+        if (hierarchies_.end() == std::find(hierarchies_.begin(), hierarchies_.end(), path.string())) {
+            hierarchies_.push_back(path.string());
+        }
+    }
+
+    const std::string dirs = FLAGS_mount_templat + "," + FLAGS_mount_cgroups;
+    boost::split(skeleton_, dirs, boost::is_any_of(","));
+    skeleton_.erase(std::remove(skeleton_.begin(), skeleton_.end(), std::string()), skeleton_.end());
+    RemoveLeft();
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (running_ || max_size_ <= 0) {
+        return;
+    }
+
+    running_ = true;
+    refill_thread_.create_thread(boost::bind(&SlotPool::RefillRoutine, this));
+    LOG(INFO) << "slot pool started with " << min_size_ << " to " << max_size_
+              << " slots in " << hierarchies_.size() << " hierarchies";
+}
+
+void SlotPool::Stop() {
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if (!running_) {
+            return;
+        }
+
+        running_ = false;
+        cond_.notify_all();
+    }
+
+    // ready slots are removed by the next Start
+    refill_thread_.join_all();
+}
+
+bool SlotPool::Claim(const std::string& container_id, const std::string& cgroup_id) {
+    std::string slot;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if (!running_) {
+            return false;
+        }
+
+        claims_.push_back(baidu::common::timer::get_micros());
+        cond_.notify_all();
+
+        if (ready_.empty()) {
+            miss_++;
+            return false;
+        }
+
+        slot = ready_.front();
+        ready_.pop_front();
+    }
+
+    // whatever is renamed already is used by the construction as if it
+    // was made there
+    const std::string root = baidu::galaxy::path::ContainerRootPath(slot);
+    const std::string target = baidu::galaxy::path::ContainerRootPath(container_id);
+    bool ok = true;
+
+    if (0 != ::rename(root.c_str(), target.c_str())) {
+        LOG(WARNING) << "failed in renaming " << root << " to " << target << ": " << strerror(errno);
+        ok = false;
+    }
+
+    for (size_t i = 0; ok && i < hierarchies_.size(); i++) {
+        const std::string from = CgroupPath(hierarchies_[i], slot);
+        const std::string to = CgroupPath(hierarchies_[i], container_id + "_" + cgroup_id);
+
+        if (0 != ::rename(from.c_str(), to.c_str())) {
+            LOG(WARNING) << "failed in renaming " << from << " to " << to << ": " << strerror(errno);
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        Remove(slot);
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (ok) {
+        hit_++;
+        VLOG(10) << "container " << container_id << " claims slot " << slot;
+    } else {
+        miss_++;
+    }
+
+    return ok;
+}
+
+void SlotPool::Statistics(baidu::galaxy::proto::ConstructMetrix* metrix) {
+    assert(NULL != metrix);
+    boost::mutex::scoped_lock lock(mutex_);
+    metrix->set_slot_ready((int32_t)ready_.size());
+    metrix->set_slot_hit(hit_);
+    metrix->set_slot_miss(miss_);
+}
+
+int SlotPool::TargetSize(int64_t now) {
+    while (!claims_.empty() && claims_.front() < now - window_) {
+        claims_.pop_front();
+    }
+
+    return std::min(max_size_, std::max(min_size_, (int)claims_.size()));
+}
+
+void SlotPool::RefillRoutine() {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while (running_) {
+        const int target = TargetSize(baidu::common::timer::get_micros());
+
+        if ((int)ready_.size() < target) {
+            const std::string slot = kSlotPrefix + boost::lexical_cast<std::string>(seq_++);
+            lock.unlock();
+            baidu::galaxy::util::ErrorCode ec = Prepare(slot);
+
+            if (0 != ec.Code()) {
+                LOG(WARNING) << "failed in preparing slot " << slot << ": " << ec.Message();
+                Remove(slot);
+            }
+
+            lock.lock();
+
+            if (0 == ec.Code()) {
+                ready_.push_back(slot);
+                continue;
+            }
+        } else if ((int)ready_.size() > target) {
+            // one a round, a short lull does not drop all slots
+            const std::string slot = ready_.back();
+            ready_.pop_back();
+            lock.unlock();
+            Remove(slot);
+            lock.lock();
+        }
+
+        cond_.timed_wait(lock, boost::posix_time::seconds(1));
+    }
+}
+
+baidu::galaxy::util::ErrorCode SlotPool::Prepare(const std::string& slot) {
+    boost::system::error_code ec;
+
+    for (size_t i = 0; i < hierarchies_.size(); i++) {
+        boost::filesystem::path path(CgroupPath(hierarchies_[i], slot));
+
+        if (!baidu::galaxy::file::create_directories(path, ec)) {
+            return ERRORCODE(-1, "failed in creating %s: %s",
+                    path.string().c_str(),
+                    ec.message().c_str());
+        }
+    }
+
+    boost::filesystem::path root(baidu::galaxy::path::ContainerRootPath(slot));
+
+    if (!baidu::galaxy::file::create_directories(root, ec)) {
+        return ERRORCODE(-1, "failed in creating %s: %s",
+                root.string().c_str(),
+                ec.message().c_str());
+    }
+
+    // the same dirs as VolumGroup::MountRootfs
+    for (size_t i = 0; i < skeleton_.size(); i++) {
+        boost::filesystem::path path(root);
+        path.append(skeleton_[i]);
+
+        if (!baidu::galaxy::file::create_directories(path, ec)) {
+            return ERRORCODE(-1, "failed in creating %s: %s",
+                    path.string().c_str(),
+                    ec.message().c_str());
+        }
+    }
+
+    return ERRORCODE_OK;
+}
+
+void SlotPool::Remove(const std::string& slot) {
+    for (size_t i = 0; i < hierarchies_.size(); i++) {
+        const std::string path = CgroupPath(hierarchies_[i], slot);
+
+        if (0 != ::rmdir(path.c_str()) && ENOENT != errno) {
+            LOG(WARNING) << "failed in removing " << path << ": " << strerror(errno);
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(baidu::galaxy::path::ContainerRootPath(slot), ec);
+
+    if (ec.value() != 0) {
+        LOG(WARNING) << "failed in removing root of slot " << slot << ": " << ec.message();
+    }
+}
+
+void SlotPool::RemoveLeft() {
+    std::vector<std::string> dirs;
+    dirs.push_back(baidu::galaxy::path::WorkDir());
+
+    for (size_t i = 0; i < hierarchies_.size(); i++) {
+        dirs.push_back(CgroupPath(hierarchies_[i], ""));
+    }
+
+    std::vector<std::string> slots;
+
+    for (size_t i = 0; i < dirs.size(); i++) {
+        boost::system::error_code ec;
+        boost::filesystem::directory_iterator iter(dirs[i], ec);
+
+        for (; ec.value() == 0 && iter != boost::filesystem::directory_iterator(); iter.increment(ec)) {
+            const std::string name = iter->path().filename().string();
+
+            if (boost::starts_with(name, kSlotPrefix)
+                    && slots.end() == std::find(slots.begin(), slots.end(), name)) {
+                slots.push_back(name);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        LOG(INFO) << "remove slot " << slots[i] << " left by the last agent";
+        Remove(slots[i]);
+    }
+}
+
+std::string SlotPool::CgroupPath(const std::string& hierarchy, const std::string& name) {
+    boost::filesystem::path path(hierarchy);
+    path.append("galaxy");
+    path.append(name);
+    return path.string();
+}
+
+}
+}
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+
+#include "boost/noncopyable.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+#include <stdint.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class ConstructMetrix;
+}
+
+namespace container {
+
+// Keeps slots prepared before containers are created. A slot is an empty
+// cgroup directory in every hierarchy and a container root holding the
+// dirs appwork mounts the root fs on. Claiming a slot renames them to the
+// paths of the container, limits and volums are applied by the
+// construction as usual. There are as many slots as containers created in
+// the last window seconds, but no less than min_size and no more than
+// max_size.
+class SlotPool : public boost::noncopyable {
+public:
+    SlotPool(int min_size, int max_size, int window);
+    ~SlotPool();
+
+    // removes slots left by the last agent and starts refilling
+    void Start();
+    void Stop();
+
+    // moves a slot to the paths of cgroup cgroup_id of container_id, false
+    // if no slot is ready and the container is built from scratch
+    bool Claim(const std::string& container_id, const std::string& cgroup_id);
+    void Statistics(baidu::galaxy::proto::ConstructMetrix* metrix);
+
+private:
+    void RefillRoutine();
+    // slots wanted at now, mutex_ is held
+    int TargetSize(int64_t now);
+    baidu::galaxy::util::ErrorCode Prepare(const std::string& slot);
+    void Remove(const std::string& slot);
+    void RemoveLeft();
+    static std::string CgroupPath(const std::string& hierarchy, const std::string& name);
+
+    const int min_size_;
+    const int max_size_;
+    const int64_t window_;
+
+    // set up by Start, read only later
+    std::vector<std::string> hierarchies_;
+    std::vector<std::string> skeleton_;
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    boost::thread_group refill_thread_;
+    bool running_;
+    std::deque<std::string> ready_;
+    // times of claims in the window
+    std::deque<int64_t> claims_;
+    int64_t seq_;
+    int64_t hit_;
+    int64_t miss_;
+};
+
+}
+}
+}
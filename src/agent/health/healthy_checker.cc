@@ -47,6 +47,12 @@ void HealthChecker::LoadCgroup(const boost::shared_ptr<baidu::galaxy::cgroup::Su
     assert(NULL != fac.get());
     assert(cgroups_.empty());
     fac->GetSubsystems(cgroups_);
+
+    for (size_t i = 0; i < cgroups_.size(); i++) {
+        cgroup_roots_.push_back(fac->HierarchyPath(cgroups_[i]));
+    }
+
+    cgroup_filesystem_ = fac->Unified() ? "cgroup2" : "cgroup";
 }
 
 // fixme: detach
@@ -126,15 +132,17 @@ baidu::galaxy::util::ErrorCode HealthChecker::CheckCgroupMounter(const MMounter&
     assert(!cgroups_.empty());
 
     for (size_t i = 0; i < cgroups_.size(); i++) {
-        std::string path = baidu::galaxy::cgroup::Subsystem::RootPath(cgroups_[i]);
+        const std::string& path = cgroup_roots_[i];
         MMounter::const_iterator iter = mounters.find(path);
 
         if (iter == mounters.end()) {
             return ERRORCODE(CHECK_FAILURE, "%s donot exist", path.c_str());
         }
 
-        if (iter->second->filesystem != "cgroup") {
-            return ERRORCODE(CHECK_FAILURE, "filesystem is %s, cgroup is expected", iter->second->filesystem.c_str());
+        if (iter->second->filesystem != cgroup_filesystem_) {
+            return ERRORCODE(CHECK_FAILURE, "filesystem is %s, %s is expected",
+                    iter->second->filesystem.c_str(),
+                    cgroup_filesystem_.c_str());
         }
     }
 
@@ -53,6 +53,9 @@ private:
 
     std::vector<std::string> volums_;
     std::vector<std::string> cgroups_;
+    // mount point of each subsystem in cgroups_
+    std::vector<std::string> cgroup_roots_;
+    std::string cgroup_filesystem_;
     boost::mutex mutex_;
     bool running_;
     bool healthy_;
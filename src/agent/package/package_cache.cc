@@ -0,0 +1,567 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "package_cache.h"
+#include "container/process.h"
+#include "protocol/galaxy.pb.h"
+#include "timer.h"
+
+#include "boost/algorithm/string/predicate.hpp"
+#include "boost/bind.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/lexical_cast.hpp"
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include <assert.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <algorithm>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+DECLARE_int32(package_cache_download_timeout);
+
+namespace baidu {
+namespace galaxy {
+namespace package {
+
+namespace {
+
+const char* PACKAGE_SUFFIX = ".tar.gz";
+
+bool IsMd5(const std::string& version) {
+    if (version.size() != 32) {
+        return false;
+    }
+
+    for (size_t i = 0; i < version.size(); i++) {
+        if (!isxdigit(version[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int RunCommand(const std::string& cmd, void*) {
+    ::execl("/bin/sh", "sh", "-c", cmd.c_str(), (char*)NULL);
+    return -1;
+}
+
+// by the pidfd, or by the pid reaped by the SIGCHLD handler of agent
+bool Exited(baidu::galaxy::container::Process& process) {
+    if (process.PidFd() >= 0) {
+        return process.Exited();
+    }
+
+    return 0 != ::kill(process.Pid(), 0) && ESRCH == errno;
+}
+
+}
+
+PackageCache::PackageCache(const std::string& path, int64_t capacity, int threads) :
+    path_(path),
+    capacity_(capacity),
+    threads_(std::max(1, threads)),
+    size_(0L),
+    running_(false),
+    hits_(0L),
+    misses_(0L),
+    shared_(0L),
+    failed_(0L),
+    bytes_saved_(0L),
+    bytes_downloaded_(0L),
+    evicted_(0L),
+    linked_(0L),
+    copied_(0L) {
+}
+
+PackageCache::~PackageCache() {
+    TearDown();
+}
+
+baidu::galaxy::util::ErrorCode PackageCache::Setup() {
+    boost::system::error_code err;
+
+    if (!boost::filesystem::exists(path_, err)
+            && !boost::filesystem::create_directories(path_, err)) {
+        return ERRORCODE(-1, "create %s failed: %s", path_.c_str(), err.message().c_str());
+    }
+
+    DIR* dir = ::opendir(path_.c_str());
+
+    if (NULL == dir) {
+        return PERRORCODE(-1, errno, "open %s failed", path_.c_str());
+    }
+
+    // packages are used in order of their mtime, which is touched on hits
+    std::vector<std::pair<int64_t, std::pair<std::string, int64_t> > > packages;
+    struct dirent* dent = NULL;
+
+    while (NULL != (dent = ::readdir(dir))) {
+        const std::string name = dent->d_name;
+        const std::string file = path_ + "/" + name;
+
+        if (boost::ends_with(name, ".tmp") || boost::ends_with(name, ".log")) {
+            ::unlink(file.c_str());
+            continue;
+        }
+
+        struct stat st;
+
+        if (!boost::ends_with(name, PACKAGE_SUFFIX)
+                || 0 != ::stat(file.c_str(), &st)
+                || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+
+        const std::string key = name.substr(0, name.size() - strlen(PACKAGE_SUFFIX));
+        packages.push_back(std::make_pair((int64_t)st.st_mtime, std::make_pair(key, (int64_t)st.st_size)));
+    }
+
+    ::closedir(dir);
+    std::sort(packages.begin(), packages.end());
+    boost::mutex::scoped_lock lock(mutex_);
+
+    for (size_t i = 0; i < packages.size(); i++) {
+        const std::string& key = packages[i].second.first;
+        Entry& entry = entries_[key];
+        entry.size = packages[i].second.second;
+        entry.lru = lru_.insert(lru_.end(), key);
+        size_ += entry.size;
+    }
+
+    Evict();
+    running_ = true;
+
+    for (int i = 0; i < threads_; i++) {
+        workers_.create_thread(boost::bind(&PackageCache::DownloadRoutine, this));
+    }
+
+    LOG(INFO) << "package cache " << path_ << " is set up with " << entries_.size()
+              << " packages of " << size_ << " bytes, capacity is " << capacity_;
+    return ERRORCODE_OK;
+}
+
+void PackageCache::TearDown() {
+    std::vector<Waiter> waiters;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if (!running_) {
+            return;
+        }
+
+        running_ = false;
+
+        // downloads being run fail their waiters when killed
+        for (size_t i = 0; i < queue_.size(); i++) {
+            std::map<std::string, Download>::iterator iter = downloads_.find(queue_[i]);
+            assert(downloads_.end() != iter);
+            waiters.insert(waiters.end(), iter->second.waiters.begin(), iter->second.waiters.end());
+            downloads_.erase(iter);
+        }
+
+        queue_.clear();
+
+        for (size_t i = 0; i < deliveries_.size(); i++) {
+            entries_[deliveries_[i].key].users--;
+            waiters.push_back(deliveries_[i].waiter);
+        }
+
+        deliveries_.clear();
+        cond_.notify_all();
+    }
+
+    for (size_t i = 0; i < waiters.size(); i++) {
+        waiters[i].callback(ERRORCODE(-1, "package cache is torn down"), false);
+    }
+
+    workers_.join_all();
+}
+
+std::string PackageCache::Key(const std::string& source_path, const std::string& version) {
+    // fnv-1a, the key names the file so it is stable across restarts
+    uint64_t hash = 14695981039346656037ULL;
+    const std::string data = source_path + '\0' + version;
+
+    for (size_t i = 0; i < data.size(); i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+
+    char buf[32];
+    snprintf(buf, sizeof buf, "%016llx", (unsigned long long)hash);
+    return buf;
+}
+
+std::string PackageCache::FilePath(const std::string& key) const {
+    return path_ + "/" + key + PACKAGE_SUFFIX;
+}
+
+void PackageCache::Fetch(const std::string& source_path,
+        const std::string& version,
+        const std::string& target,
+        Callback callback) {
+    const std::string key = Key(source_path, version);
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if (!running_) {
+            lock.unlock();
+            callback(ERRORCODE(-1, "package cache is not set up"), false);
+            return;
+        }
+
+        std::map<std::string, Entry>::iterator iter = entries_.find(key);
+
+        if (entries_.end() == iter) {
+            Download& download = downloads_[key];
+
+            if (download.waiters.empty()) {
+                misses_++;
+                download.source_path = source_path;
+                download.version = version;
+                queue_.push_back(key);
+                cond_.notify_one();
+            } else {
+                shared_++;
+            }
+
+            Waiter waiter;
+            waiter.target = target;
+            waiter.callback = callback;
+            download.waiters.push_back(waiter);
+            VLOG(10) << "wait for downloading " << source_path << " as " << key;
+            return;
+        }
+
+        hits_++;
+        bytes_saved_ += iter->second.size;
+        iter->second.users++;
+        Touch(key, iter->second);
+        Delivery delivery;
+        delivery.key = key;
+        delivery.waiter.target = target;
+        delivery.waiter.callback = callback;
+        deliveries_.push_back(delivery);
+        cond_.notify_one();
+    }
+}
+
+void PackageCache::DownloadRoutine() {
+    while (true) {
+        std::string key;
+        Delivery delivery;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            while (running_ && queue_.empty() && deliveries_.empty()) {
+                cond_.wait(lock);
+            }
+
+            if (!running_) {
+                return;
+            }
+
+            // hits are quick, not kept behind downloads
+            if (!deliveries_.empty()) {
+                delivery = deliveries_.front();
+                deliveries_.pop_front();
+            } else {
+                key = queue_.front();
+                queue_.pop_front();
+            }
+        }
+
+        if (key.empty()) {
+            DeliverHit(delivery);
+        } else {
+            RunDownload(key);
+        }
+    }
+}
+
+void PackageCache::DeliverHit(const Delivery& delivery) {
+    bool linked = false;
+    baidu::galaxy::util::ErrorCode ec = Deliver(FilePath(delivery.key), delivery.waiter.target, linked);
+    Delivered(delivery.key, ec, linked);
+    delivery.waiter.callback(ec, true);
+}
+
+void PackageCache::RunDownload(const std::string& key) {
+    std::string source_path;
+    std::string version;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        const Download& download = downloads_[key];
+        source_path = download.source_path;
+        version = download.version;
+    }
+
+    int64_t start = baidu::common::timer::get_micros();
+    baidu::galaxy::util::ErrorCode ec = DownloadPackage(key, source_path, version);
+    int64_t size = 0L;
+    std::vector<Waiter> waiters;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        std::map<std::string, Download>::iterator iter = downloads_.find(key);
+        waiters.swap(iter->second.waiters);
+        downloads_.erase(iter);
+        struct stat st;
+
+        if (0 == ec.Code() && 0 != ::stat(FilePath(key).c_str(), &st)) {
+            ec = PERRORCODE(-1, errno, "stat package failed");
+        }
+
+        if (0 == ec.Code()) {
+            size = st.st_size;
+            Entry& entry = entries_[key];
+            entry.size = size;
+            entry.users = (int)waiters.size();
+            entry.lru = lru_.insert(lru_.end(), key);
+            size_ += size;
+            bytes_downloaded_ += size;
+            // the others waited for the same download
+            bytes_saved_ += size * (int64_t)(waiters.size() - 1);
+            Evict();
+        } else {
+            failed_++;
+        }
+    }
+
+    if (0 == ec.Code()) {
+        LOG(INFO) << "downloaded " << source_path << " as " << key << ", " << size
+                  << " bytes in " << (baidu::common::timer::get_micros() - start) / 1000 << "ms";
+    } else {
+        LOG(WARNING) << "download " << source_path << " failed: " << ec.Message();
+    }
+
+    for (size_t i = 0; i < waiters.size(); i++) {
+        if (0 != ec.Code()) {
+            waiters[i].callback(ec, false);
+            continue;
+        }
+
+        bool linked = false;
+        baidu::galaxy::util::ErrorCode err = Deliver(FilePath(key), waiters[i].target, linked);
+        Delivered(key, err, linked);
+        waiters[i].callback(err, false);
+    }
+}
+
+bool PackageCache::Running() {
+    boost::mutex::scoped_lock lock(mutex_);
+    return running_;
+}
+
+baidu::galaxy::util::ErrorCode PackageCache::DownloadPackage(const std::string& key,
+        const std::string& source_path,
+        const std::string& version) {
+    if (std::string::npos != source_path.find('\'')) {
+        return ERRORCODE(-1, "bad source path %s", source_path.c_str());
+    }
+
+    const std::string file = FilePath(key);
+    const std::string tmp = path_ + "/" + key + ".tmp";
+    const std::string log = path_ + "/" + key + ".log";
+    ::unlink(tmp.c_str());
+    ::unlink(log.c_str());
+    const std::string timeout = boost::lexical_cast<std::string>(FLAGS_package_cache_download_timeout);
+    std::string cmd;
+
+    // p2p or wget, as appworker does
+    if (boost::contains(source_path, "ftp://") || boost::contains(source_path, "http://")) {
+        cmd = "wget -q --timeout=" + timeout + " -O " + tmp + " '" + source_path + "'";
+    } else {
+        cmd = "gko3 down --hang-time " + timeout + " -n " + tmp + " -i '" + source_path + "'";
+    }
+
+    if (IsMd5(version)) {
+        cmd += " && echo '" + version + "  " + tmp + "' | md5sum -c --status";
+    }
+
+    // read only, deliveries only read it
+    cmd += " && chmod 444 " + tmp + " && mv -f " + tmp + " " + file;
+    baidu::galaxy::container::Process process;
+    process.RedirectStdout(log);
+    process.RedirectStderr(log);
+
+    if (process.Clone(boost::bind(&RunCommand, cmd, _1), NULL, 0) <= 0) {
+        return ERRORCODE(-1, "start downloading failed");
+    }
+
+    const int64_t deadline = baidu::common::timer::get_micros()
+        + FLAGS_package_cache_download_timeout * 1000000L;
+    bool killed = false;
+
+    while (!Exited(process)) {
+        if (!killed && (!Running() || baidu::common::timer::get_micros() > deadline)) {
+            process.Signal(SIGKILL);
+            killed = true;
+        }
+
+        ::usleep(100000);
+    }
+
+    ::unlink(tmp.c_str());
+
+    if (killed) {
+        return ERRORCODE(-1, "download is killed");
+    }
+
+    if (0 != ::access(file.c_str(), F_OK)) {
+        return ERRORCODE(-1, "download failed, see %s", log.c_str());
+    }
+
+    ::unlink(log.c_str());
+    return ERRORCODE_OK;
+}
+
+void PackageCache::Touch(const std::string& key, Entry& entry) {
+    lru_.splice(lru_.end(), lru_, entry.lru);
+
+    // the order is kept across restarts
+    if (0 != ::utimes(FilePath(key).c_str(), NULL)) {
+        VLOG(10) << "touch package " << key << " failed: " << strerror(errno);
+    }
+}
+
+void PackageCache::Evict() {
+    std::list<std::string>::iterator iter = lru_.begin();
+
+    while (size_ > capacity_ && lru_.end() != iter) {
+        std::map<std::string, Entry>::iterator entry = entries_.find(*iter);
+        assert(entries_.end() != entry);
+
+        if (entry->second.users > 0) {
+            iter++;
+            continue;
+        }
+
+        if (0 != ::unlink(FilePath(*iter).c_str()) && ENOENT != errno) {
+            LOG(WARNING) << "remove package " << *iter << " failed: " << strerror(errno);
+            iter++;
+            continue;
+        }
+
+        LOG(INFO) << "evict package " << *iter << " of " << entry->second.size << " bytes";
+        size_ -= entry->second.size;
+        evicted_++;
+        entries_.erase(entry);
+        lru_.erase(iter++);
+    }
+}
+
+void PackageCache::Delivered(const std::string& key,
+        const baidu::galaxy::util::ErrorCode& ec,
+        bool linked) {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, Entry>::iterator iter = entries_.find(key);
+    assert(entries_.end() != iter);
+    iter->second.users--;
+
+    if (0 != ec.Code()) {
+        failed_++;
+    } else if (linked) {
+        linked_++;
+    } else {
+        copied_++;
+    }
+
+    Evict();
+}
+
+baidu::galaxy::util::ErrorCode PackageCache::Deliver(const std::string& source,
+        const std::string& target,
+        bool& linked) {
+    linked = true;
+
+    // never a hardlink, a container writing the shared inode would corrupt
+    // the package for the others, a reflink shares blocks copied on write
+    int in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (in < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", source.c_str());
+    }
+
+    int out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0444);
+
+    if (out < 0) {
+        int err = errno;
+        ::close(in);
+        return ERRORCODE(-1, "create %s failed: %s", target.c_str(), strerror(err));
+    }
+
+    baidu::galaxy::util::ErrorCode ec = ERRORCODE_OK;
+
+    if (0 != ::ioctl(out, FICLONE, in)) {
+        linked = false;
+        struct stat st;
+        off_t offset = 0;
+
+        if (0 != ::fstat(in, &st)) {
+            ec = PERRORCODE(-1, errno, "stat %s failed", source.c_str());
+        }
+
+        while (0 == ec.Code() && offset < st.st_size) {
+            ssize_t n = ::sendfile(out, in, &offset, st.st_size - offset);
+
+            if (n < 0 && EINTR == errno) {
+                continue;
+            }
+
+            if (n <= 0) {
+                ec = PERRORCODE(-1, errno, "copy to %s failed", target.c_str());
+            }
+        }
+    }
+
+    ::close(in);
+
+    if (0 != ::close(out) && 0 == ec.Code()) {
+        ec = PERRORCODE(-1, errno, "close %s failed", target.c_str());
+    }
+
+    if (0 != ec.Code()) {
+        ::unlink(target.c_str());
+    }
+
+    return ec;
+}
+
+void PackageCache::Statistics(baidu::galaxy::proto::PackageCacheMetrix* metrix) {
+    assert(NULL != metrix);
+    boost::mutex::scoped_lock lock(mutex_);
+    metrix->set_hits(hits_);
+    metrix->set_misses(misses_);
+    metrix->set_shared(shared_);
+    metrix->set_failed(failed_);
+    metrix->set_bytes_saved(bytes_saved_);
+    metrix->set_bytes_downloaded(bytes_downloaded_);
+    metrix->set_size(size_);
+    metrix->set_packages((int32_t)entries_.size());
+    metrix->set_downloading((int32_t)downloads_.size());
+    metrix->set_evicted(evicted_);
+    metrix->set_linked(linked_);
+    metrix->set_copied(copied_);
+}
+
+}
+}
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+
+#include "boost/function.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+
+#include <stdint.h>
+
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class PackageCacheMetrix;
+}
+
+namespace package {
+
+// Packages downloaded once for all containers on agent, keyed by source path
+// and version, which is verified as md5 if it looks like one. Containers
+// asking for a package being downloaded wait for the same download. Packages
+// are delivered into workspaces by reflink, and copied if the file system
+// does not support it, never by hardlink, as containers must not share the
+// inode of a cached package. The least recently used ones are removed
+// when packages exceed the capacity.
+class PackageCache {
+public:
+    // hit if the package was cached before asked
+    typedef boost::function<void (const baidu::galaxy::util::ErrorCode& ec, bool hit)> Callback;
+
+    PackageCache(const std::string& path, int64_t capacity, int threads);
+    ~PackageCache();
+
+    // loads packages left by the last run
+    baidu::galaxy::util::ErrorCode Setup();
+    void TearDown();
+    // delivers the package to target, which must not exist. callback runs
+    // in a worker thread later, as delivering may copy the whole package
+    void Fetch(const std::string& source_path,
+            const std::string& version,
+            const std::string& target,
+            Callback callback);
+    void Statistics(baidu::galaxy::proto::PackageCacheMetrix* metrix);
+
+    static std::string Key(const std::string& source_path, const std::string& version);
+
+private:
+    struct Entry {
+        Entry() :
+            size(0L),
+            users(0) {
+        }
+
+        int64_t size;
+        int users;                          // delivering, not evicted
+        std::list<std::string>::iterator lru;
+    };
+
+    struct Waiter {
+        std::string target;
+        Callback callback;
+    };
+
+    struct Download {
+        std::string source_path;
+        std::string version;
+        std::vector<Waiter> waiters;
+    };
+
+    // a hit waiting for a worker
+    struct Delivery {
+        std::string key;
+        Waiter waiter;
+    };
+
+    void DownloadRoutine();
+    void RunDownload(const std::string& key);
+    void DeliverHit(const Delivery& delivery);
+    bool Running();
+    baidu::galaxy::util::ErrorCode DownloadPackage(const std::string& key,
+            const std::string& source_path,
+            const std::string& version);
+    // mutex_ is held
+    void Touch(const std::string& key, Entry& entry);
+    void Evict();
+    // linked is false if data is copied instead of reflinked
+    static baidu::galaxy::util::ErrorCode Deliver(const std::string& source,
+            const std::string& target,
+            bool& linked);
+    void Delivered(const std::string& key, const baidu::galaxy::util::ErrorCode& ec, bool linked);
+
+    std::string FilePath(const std::string& key) const;
+
+    const std::string path_;
+    const int64_t capacity_;            // unit byte
+    const int threads_;
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::map<std::string, Entry> entries_;
+    std::list<std::string> lru_;        // the least recently used first
+    std::map<std::string, Download> downloads_;
+    std::deque<std::string> queue_;     // keys of downloads not started
+    std::deque<Delivery> deliveries_;   // hits not delivered, before downloads
+    int64_t size_;
+    bool running_;
+    boost::thread_group workers_;
+
+    int64_t hits_;
+    int64_t misses_;
+    int64_t shared_;
+    int64_t failed_;
+    int64_t bytes_saved_;
+    int64_t bytes_downloaded_;
+    int64_t evicted_;
+    int64_t linked_;
+    int64_t copied_;
+};
+
+}
+}
+}
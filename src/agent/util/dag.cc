@@ -0,0 +1,206 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dag.h"
+#include "timer.h"
+
+#include "boost/bind.hpp"
+#include "boost/thread/thread.hpp"
+#include <glog/logging.h>
+
+#include <assert.h>
+
+#include <algorithm>
+
+namespace baidu {
+namespace galaxy {
+namespace util {
+
+Dag::Dag(const std::string& name) :
+    name_(name),
+    running_(0),
+    failed_(false),
+    start_(0L) {
+}
+
+Dag::~Dag() {
+}
+
+void Dag::AddStep(const std::string& step, const Action& action) {
+    AddStep(step, action, Rollback());
+}
+
+void Dag::AddStep(const std::string& step, const Action& action, const Rollback& rollback) {
+    assert(!HasStep(step));
+    Step s;
+    s.name = step;
+    s.action = action;
+    s.rollback = rollback;
+    s.depends = 0;
+    s.pending = 0;
+    s.start = -1L;
+    s.end = -1L;
+    index_[step] = steps_.size();
+    steps_.push_back(s);
+}
+
+void Dag::AddDependency(const std::string& step, const std::string& depend) {
+    assert(HasStep(step));
+    assert(HasStep(depend));
+    steps_[index_[depend]].children.push_back(index_[step]);
+    steps_[index_[step]].depends++;
+}
+
+bool Dag::HasStep(const std::string& step) const {
+    return index_.find(step) != index_.end();
+}
+
+bool Dag::HasCycle() const {
+    std::vector<int> pending(steps_.size());
+    std::vector<size_t> ready;
+
+    for (size_t i = 0; i < steps_.size(); i++) {
+        pending[i] = steps_[i].depends;
+
+        if (0 == pending[i]) {
+            ready.push_back(i);
+        }
+    }
+
+    size_t visited = 0;
+
+    while (!ready.empty()) {
+        size_t i = ready.back();
+        ready.pop_back();
+        visited++;
+
+        for (size_t j = 0; j < steps_[i].children.size(); j++) {
+            if (--pending[steps_[i].children[j]] == 0) {
+                ready.push_back(steps_[i].children[j]);
+            }
+        }
+    }
+
+    return visited != steps_.size();
+}
+
+baidu::galaxy::util::ErrorCode Dag::Run(int concurrency) {
+    if (HasCycle()) {
+        return ERRORCODE(-1, "dependency cycle in %s", name_.c_str());
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        ready_.clear();
+        done_.clear();
+        running_ = 0;
+        failed_ = false;
+        start_ = baidu::common::timer::get_micros();
+
+        for (size_t i = 0; i < steps_.size(); i++) {
+            steps_[i].pending = steps_[i].depends;
+            steps_[i].start = -1L;
+            steps_[i].end = -1L;
+
+            if (0 == steps_[i].depends) {
+                ready_.push_back(i);
+            }
+        }
+    }
+
+    // the calling thread works as well
+    int threads = std::min(std::max(1, concurrency), (int)steps_.size());
+    boost::thread_group workers;
+
+    for (int i = 1; i < threads; i++) {
+        workers.create_thread(boost::bind(&Dag::WorkRoutine, this));
+    }
+
+    WorkRoutine();
+    workers.join_all();
+
+    if (!failed_) {
+        VLOG(10) << name_ << " finished " << steps_.size() << " steps in "
+                 << baidu::common::timer::get_micros() - start_ << "us";
+        return ERRORCODE_OK;
+    }
+
+    for (std::vector<size_t>::reverse_iterator iter = done_.rbegin(); iter != done_.rend(); iter++) {
+        const Step& step = steps_[*iter];
+
+        if (!step.rollback.empty()) {
+            LOG(INFO) << name_ << " rolls back " << step.name;
+            step.rollback();
+        }
+    }
+
+    return error_;
+}
+
+void Dag::WorkRoutine() {
+    while (true) {
+        size_t i = 0;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            while (!failed_ && ready_.empty() && running_ > 0) {
+                cond_.wait(lock);
+            }
+
+            // nothing runnable and nothing running means all done
+            if (failed_ || ready_.empty()) {
+                return;
+            }
+
+            i = ready_.front();
+            ready_.pop_front();
+            running_++;
+            steps_[i].start = baidu::common::timer::get_micros();
+        }
+
+        baidu::galaxy::util::ErrorCode ec = steps_[i].action.empty() ? ERRORCODE_OK : steps_[i].action();
+        boost::mutex::scoped_lock lock(mutex_);
+        running_--;
+        steps_[i].end = baidu::common::timer::get_micros();
+
+        if (0 != ec.Code()) {
+            LOG(WARNING) << name_ << " failed in step " << steps_[i].name << ": " << ec.Message();
+
+            if (!failed_) {
+                failed_ = true;
+                error_ = ec;
+            }
+        } else {
+            done_.push_back(i);
+
+            for (size_t j = 0; j < steps_[i].children.size(); j++) {
+                if (--steps_[steps_[i].children[j]].pending == 0) {
+                    ready_.push_back(steps_[i].children[j]);
+                }
+            }
+        }
+
+        cond_.notify_all();
+    }
+}
+
+const Dag::Step& Dag::GetStep(const std::string& step) const {
+    std::map<std::string, size_t>::const_iterator iter = index_.find(step);
+    assert(iter != index_.end());
+    return steps_[iter->second];
+}
+
+int64_t Dag::Duration(const std::string& step) const {
+    const Step& s = GetStep(step);
+    return s.end < 0 ? -1L : s.end - s.start;
+}
+
+int64_t Dag::Elapsed(const std::string& step) const {
+    const Step& s = GetStep(step);
+    return s.end < 0 ? -1L : s.end - start_;
+}
+
+}
+}
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+
+#include "boost/function.hpp"
+#include "boost/noncopyable.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace util {
+
+// A small graph of steps with dependencies. Steps whose dependencies are
+// done run concurrently on up to concurrency threads. Once a step fails no
+// more steps are started, and the finished steps are rolled back in the
+// reverse order they finished in, so a step is always rolled back before
+// the steps it depends on.
+class Dag : public boost::noncopyable {
+public:
+    typedef boost::function<baidu::galaxy::util::ErrorCode ()> Action;
+    typedef boost::function<void ()> Rollback;
+
+    explicit Dag(const std::string& name);
+    ~Dag();
+
+    // step names are unique in one dag, an empty action does nothing and
+    // only joins the steps it depends on
+    void AddStep(const std::string& step, const Action& action);
+    void AddStep(const std::string& step, const Action& action, const Rollback& rollback);
+    // step starts after depend is done, both must be added already
+    void AddDependency(const std::string& step, const std::string& depend);
+    bool HasStep(const std::string& step) const;
+
+    // runs every step once, returns the error of the first failed step
+    baidu::galaxy::util::ErrorCode Run(int concurrency);
+
+    // in us, -1 if the step has not finished
+    int64_t Duration(const std::string& step) const;
+    // from the start of Run to the end of the step
+    int64_t Elapsed(const std::string& step) const;
+
+private:
+    struct Step {
+        std::string name;
+        Action action;
+        Rollback rollback;
+        std::vector<size_t> children;
+        int depends;
+        int pending;
+        int64_t start;
+        int64_t end;
+    };
+
+    void WorkRoutine();
+    bool HasCycle() const;
+    const Step& GetStep(const std::string& step) const;
+
+    const std::string name_;
+    std::vector<Step> steps_;
+    std::map<std::string, size_t> index_;
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<size_t> ready_;
+    // done steps in the order they finished
+    std::vector<size_t> done_;
+    int running_;
+    bool failed_;
+    baidu::galaxy::util::ErrorCode error_;
+    int64_t start_;
+};
+
+}
+}
+}
@@ -91,6 +91,34 @@ baidu::galaxy::util::ErrorCode DictFile::Scan(const std::string& begin_key,
 }
 
 
+baidu::galaxy::util::ErrorCode DictFile::Visit(const std::string& begin_key,
+            const std::string& end_key,
+            Visitor visitor) {
+    assert(NULL != db_);
+    const leveldb::Snapshot* snapshot = db_->GetSnapshot();
+    leveldb::ReadOptions ops;
+    ops.snapshot = snapshot;
+    ops.fill_cache = false;
+    leveldb::Iterator* it = db_->NewIterator(ops);
+    const leveldb::Slice end(end_key);
+
+    for (it->Seek(begin_key); it->Valid(); it->Next()) {
+        if (it->key().compare(end) > 0 || !visitor(it->key(), it->value())) {
+            break;
+        }
+    }
+
+    leveldb::Status status = it->status();
+    delete it;
+    db_->ReleaseSnapshot(snapshot);
+
+    if (!status.ok()) {
+        return ERRORCODE(-1, "visit failed: %s", status.ToString().c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
 baidu::galaxy::util::ErrorCode DictFile::Read(const std::string& key, std::string& value) {
     leveldb::ReadOptions ops;
     leveldb::Status status = db_->Get(ops, key, &value);
@@ -6,6 +6,8 @@
 #include "util/error_code.h"
 #include "leveldb/db.h"
 
+#include "boost/function.hpp"
+
 #include <string>
 #include <vector>
 
@@ -39,6 +41,14 @@ public:
                 const std::string& end_key,
                 std::vector<Kv>& v);
 
+    // key and value are valid in the call only, false stops the visit
+    typedef boost::function<bool (const leveldb::Slice& key, const leveldb::Slice& value)> Visitor;
+    // visits keys in [begin_key, end_key] of a snapshot by one iterator,
+    // nothing is copied and blocks read are not cached
+    baidu::galaxy::util::ErrorCode Visit(const std::string& begin_key,
+                const std::string& end_key,
+                Visitor visitor);
+
 private:
     const std::string path_;
     leveldb::DB* db_;
@@ -71,6 +71,14 @@ const std::string GcDir()
     return path.string();
 }
 
+const std::string PackageCacheDir()
+{
+    assert(!root_path_.empty());
+    boost::filesystem::path path(root_path_);
+    path.append("package_cache");
+    return path.string();
+}
+
 const std::string ContainerGcDir(const std::string& container_id, int gc_index)
 {
     assert(gc_index >= 0);
@@ -5,6 +5,7 @@
 /*
  * rootpath/
  * |-- gc_dir
+ * |-- package_cache
  * `-- work_dir
  *    |-- container1   // bind dir, ContainerRootPath
  *    |   |-- bin
@@ -26,6 +27,7 @@ namespace path {
 void SetRootPath(const std::string& root_path);
 const std::string RootPath();
 const std::string GcDir();
+const std::string PackageCacheDir();
 const std::string WorkDir();
 
 const std::string ContainerRootPath(const std::string& container_id);
@@ -7,13 +7,17 @@
 #include "util/user.h"
 #include "util/util.h"
 #include "glog/logging.h"
+#include "gflags/gflags.h"
 #include "collector/collector_engine.h"
+#include "usage_backend.h"
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include <sys/mount.h>
 
+DECLARE_int64(volum_fast_collect_cycle);
+
 namespace baidu {
 namespace galaxy {
 namespace volum {
@@ -30,6 +34,13 @@ baidu::galaxy::util::ErrorCode BindVolum::Construct() {
 
     if (err.Code() == 0) {
         vc_.reset(new VolumCollector(this->SourcePath()));
+        boost::shared_ptr<UsageBackend> backend = UsageBackend::Create(*Description(), this->SourcePath());
+        vc_->SetBackend(backend);
+
+        if (backend->Cheap()) {
+            vc_->SetCycle(FLAGS_volum_fast_collect_cycle);
+        }
+
         vc_->Enable(true);
         baidu::galaxy::collector::CollectorEngine::GetInstance()->Register(vc_);
     }
@@ -7,8 +7,10 @@
 #include "mounter.h"
 #include "util/error_code.h"
 #include "collector/collector_engine.h"
+#include "usage_backend.h"
 
 #include "glog/logging.h"
+#include "gflags/gflags.h"
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/operations.hpp>
@@ -18,6 +20,8 @@
 
 #include <sstream>
 
+DECLARE_int64(volum_fast_collect_cycle);
+
 namespace baidu {
 namespace galaxy {
 namespace volum {
@@ -31,6 +35,13 @@ baidu::galaxy::util::ErrorCode TmpfsVolum::Construct() {
 
     if (err.Code() == 0) {
         vc_.reset(new VolumCollector(this->TargetPath()));
+        boost::shared_ptr<UsageBackend> backend = UsageBackend::Create(*Description(), this->TargetPath());
+        vc_->SetBackend(backend);
+
+        if (backend->Cheap()) {
+            vc_->SetCycle(FLAGS_volum_fast_collect_cycle);
+        }
+
         vc_->Enable(true);
         baidu::galaxy::collector::CollectorEngine::GetInstance()->Register(vc_);
     }
@@ -0,0 +1,536 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "usage_backend.h"
+#include "mounter.h"
+#include "protocol/galaxy.pb.h"
+#include "timer.h"
+
+#include "boost/algorithm/string/split.hpp"
+#include "boost/algorithm/string/classification.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/thread.hpp"
+#include "boost/bind.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#include <linux/quota.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+DECLARE_string(volum_usage_backend);
+DECLARE_int32(volum_walk_threads);
+DECLARE_int64(volum_walk_rate);
+DECLARE_int32(volum_project_id_base);
+
+namespace baidu {
+namespace galaxy {
+namespace volum {
+
+namespace {
+
+const int kProjectIdRange = 1 << 20;
+boost::mutex project_id_mutex;
+std::set<uint32_t> project_ids;     // held by live backends of this agent
+
+// link count of a directory covers its subdirectories only
+bool IsEmptyDir(int fd, bool& empty) {
+    int dup_fd = ::dup(fd);
+    DIR* dir = dup_fd < 0 ? NULL : ::fdopendir(dup_fd);
+
+    if (NULL == dir) {
+        if (dup_fd >= 0) {
+            ::close(dup_fd);
+        }
+
+        return false;
+    }
+
+    empty = true;
+    struct dirent* dent = NULL;
+
+    while (empty && NULL != (dent = ::readdir(dir))) {
+        empty = 0 == strcmp(dent->d_name, ".") || 0 == strcmp(dent->d_name, "..");
+    }
+
+    ::closedir(dir);
+    return true;
+}
+
+// shared by all walks so that concurrent volums do not multiply the io load
+class WalkLimiter {
+public:
+    WalkLimiter() :
+        tokens_(0),
+        last_(0) {
+    }
+
+    void Acquire(int64_t entries) {
+        int64_t rate = FLAGS_volum_walk_rate;
+
+        if (rate <= 0 || entries <= 0) {
+            return;
+        }
+
+        int64_t wait = 0;
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            int64_t now = baidu::common::timer::get_micros();
+
+            if (last_ > 0) {
+                tokens_ = std::min(rate, tokens_ + (now - last_) * rate / 1000000L);
+            }
+
+            last_ = now;
+            tokens_ -= entries;
+
+            if (tokens_ < 0) {
+                wait = -tokens_ * 1000000L / rate;
+            }
+        }
+
+        if (wait > 0) {
+            ::usleep(wait);
+        }
+    }
+
+private:
+    boost::mutex mutex_;
+    int64_t tokens_;
+    int64_t last_;
+};
+
+WalkLimiter walk_limiter;
+
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+// state of one walk shared by its threads
+class Walk {
+public:
+    Walk(const std::string& root, dev_t dev) :
+        dev_(dev),
+        pending_(1),
+        used_(0) {
+        dirs_.push_back(root);
+    }
+
+    void Run() {
+        // idle class, only gets disk time nobody else wants
+        ::syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0,
+                (3 /* IOPRIO_CLASS_IDLE */ << 13));
+        std::vector<char> buf(32 * 1024);
+        std::vector<std::string> children;
+
+        while (true) {
+            std::string dir;
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+
+                while (dirs_.empty() && pending_ > 0) {
+                    cond_.wait(lock);
+                }
+
+                if (dirs_.empty()) {
+                    return;
+                }
+
+                dir = dirs_.front();
+                dirs_.pop_front();
+            }
+
+            children.clear();
+            int64_t used = ReadDir(dir, buf, children);
+            boost::mutex::scoped_lock lock(mutex_);
+            used_ += used;
+            dirs_.insert(dirs_.end(), children.begin(), children.end());
+            pending_ += children.size();
+            pending_--;
+
+            if (!children.empty() || pending_ == 0) {
+                cond_.notify_all();
+            }
+        }
+    }
+
+    int64_t Used() {
+        boost::mutex::scoped_lock lock(mutex_);
+        return used_;
+    }
+
+private:
+    int64_t ReadDir(const std::string& dir, std::vector<char>& buf, std::vector<std::string>& children) {
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if (fd < 0) {
+            return 0;
+        }
+
+        int64_t used = 0;
+        int64_t entries = 0;
+
+        while (true) {
+            long n = ::syscall(SYS_getdents64, fd, &buf[0], buf.size());
+
+            if (n <= 0) {
+                break;
+            }
+
+            for (long off = 0; off < n;) {
+                LinuxDirent64* d = reinterpret_cast<LinuxDirent64*>(&buf[off]);
+                off += d->d_reclen;
+
+                if (0 == strcmp(d->d_name, ".") || 0 == strcmp(d->d_name, "..")) {
+                    continue;
+                }
+
+                struct stat st;
+
+                if (0 != ::fstatat(fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW)) {
+                    continue;
+                }
+
+                entries++;
+
+                // other filesystems mounted below are not part of the volum
+                if (st.st_dev != dev_) {
+                    continue;
+                }
+
+                if (S_ISDIR(st.st_mode)) {
+                    children.push_back(dir + "/" + d->d_name);
+                } else if (st.st_nlink > 1 && !FirstLink(st.st_ino)) {
+                    continue;
+                }
+
+                used += st.st_blocks * 512L;
+            }
+        }
+
+        ::close(fd);
+        walk_limiter.Acquire(entries);
+        return used;
+    }
+
+    bool FirstLink(ino_t ino) {
+        boost::mutex::scoped_lock lock(mutex_);
+        return links_.insert(ino).second;
+    }
+
+    const dev_t dev_;
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<std::string> dirs_;
+    int64_t pending_;               // dirs queued or being read
+    int64_t used_;
+    std::set<ino_t> links_;
+};
+
+// mount point holding path, the one with the longest target prefix
+boost::shared_ptr<Mounter> FindMounter(const std::string& path) {
+    std::map<std::string, boost::shared_ptr<Mounter> > mounters;
+    boost::shared_ptr<Mounter> ret;
+
+    if (ListMounters(mounters).Code() != 0) {
+        return ret;
+    }
+
+    std::map<std::string, boost::shared_ptr<Mounter> >::iterator iter = mounters.begin();
+
+    for (; iter != mounters.end(); iter++) {
+        const std::string& target = iter->first;
+
+        if (path.compare(0, target.size(), target) != 0) {
+            continue;
+        }
+
+        if (path.size() != target.size() && target != "/" && path[target.size()] != '/') {
+            continue;
+        }
+
+        if (NULL == ret.get() || target.size() > ret->target.size()) {
+            ret = iter->second;
+        }
+    }
+
+    return ret;
+}
+
+std::string BackendOfMedium(const baidu::galaxy::proto::VolumRequired& vr) {
+    if (vr.exclusive()) {
+        return "statfs";
+    }
+
+    const std::string medium = baidu::galaxy::proto::VolumMedium_Name(vr.medium());
+    std::vector<std::string> items;
+    boost::split(items, FLAGS_volum_usage_backend, boost::is_any_of(","));
+
+    for (size_t i = 0; i < items.size(); i++) {
+        size_t pos = items[i].find(':');
+
+        if (pos != std::string::npos && items[i].substr(0, pos) == medium) {
+            return items[i].substr(pos + 1);
+        }
+    }
+
+    return "walk";
+}
+
+}
+
+boost::shared_ptr<UsageBackend> UsageBackend::Create(const baidu::galaxy::proto::VolumRequired& vr,
+        const std::string& path) {
+    boost::shared_ptr<UsageBackend> ret;
+    const std::string name = BackendOfMedium(vr);
+
+    if ("statfs" == name) {
+        ret.reset(new StatfsUsage(path));
+    } else if ("quota" == name) {
+        boost::shared_ptr<ProjectQuotaUsage> quota(new ProjectQuotaUsage(path));
+        baidu::galaxy::util::ErrorCode ec = quota->Setup(vr.size());
+
+        if (ec.Code() == 0) {
+            ret = quota;
+        } else {
+            LOG(WARNING) << "project quota is not available for " << path
+                         << ", walk instead: " << ec.Message();
+        }
+    }
+
+    if (NULL == ret.get()) {
+        ret.reset(new WalkUsage(path));
+    }
+
+    LOG(INFO) << "usage of volum " << path << " is collected by " << ret->Name();
+    return ret;
+}
+
+StatfsUsage::StatfsUsage(const std::string& path) :
+    path_(path) {
+}
+
+baidu::galaxy::util::ErrorCode StatfsUsage::Usage(int64_t& used) {
+    struct statfs st;
+
+    if (0 != ::statfs(path_.c_str(), &st)) {
+        return PERRORCODE(-1, errno, "statfs %s failed", path_.c_str());
+    }
+
+    used = (int64_t)(st.f_blocks - st.f_bfree) * st.f_bsize;
+    return ERRORCODE_OK;
+}
+
+ProjectQuotaUsage::ProjectQuotaUsage(const std::string& path) :
+    path_(path),
+    project_id_(0),
+    allocated_(false) {
+}
+
+ProjectQuotaUsage::~ProjectQuotaUsage() {
+    ReleaseId();
+}
+
+baidu::galaxy::util::ErrorCode ProjectQuotaUsage::Setup(int64_t quota) {
+    boost::shared_ptr<Mounter> m = FindMounter(path_);
+
+    if (NULL == m.get()) {
+        return ERRORCODE(-1, "no mount point found for %s", path_.c_str());
+    }
+
+    if (m->filesystem != "xfs" && m->filesystem != "ext4") {
+        return ERRORCODE(-1, "%s is on %s", path_.c_str(), m->filesystem.c_str());
+    }
+
+    device_ = m->source;
+#ifdef FS_IOC_FSGETXATTR
+    int fd = ::open(path_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return PERRORCODE(-1, errno, "open %s failed", path_.c_str());
+    }
+
+    struct fsxattr attr;
+
+    if (0 != ::ioctl(fd, FS_IOC_FSGETXATTR, &attr)) {
+        ::close(fd);
+        return PERRORCODE(-1, errno, "get project of %s failed", path_.c_str());
+    }
+
+    if (0 != attr.fsx_projid) {
+        // reloaded volum, already tagged
+        project_id_ = attr.fsx_projid;
+        boost::mutex::scoped_lock lock(project_id_mutex);
+        allocated_ = project_ids.insert(project_id_).second;
+    } else {
+        // files already there would not be accounted to the project
+        bool empty = false;
+
+        if (!IsEmptyDir(fd, empty) || !empty) {
+            ::close(fd);
+            return ERRORCODE(-1, "%s is not empty", path_.c_str());
+        }
+
+        baidu::galaxy::util::ErrorCode ec = AllocateId(project_id_);
+
+        if (ec.Code() != 0) {
+            ::close(fd);
+            return ec;
+        }
+
+        attr.fsx_projid = project_id_;
+        attr.fsx_xflags |= FS_XFLAG_PROJINHERIT;
+
+        if (0 != ::ioctl(fd, FS_IOC_FSSETXATTR, &attr)) {
+            ::close(fd);
+            ReleaseId();
+            return PERRORCODE(-1, errno, "set project of %s failed", path_.c_str());
+        }
+    }
+
+    ::close(fd);
+
+    if (quota > 0) {
+        baidu::galaxy::util::ErrorCode ec = SetLimit(project_id_, quota);
+
+        if (ec.Code() != 0) {
+            return ec;
+        }
+    }
+
+    int64_t used = 0L;
+    return Usage(used);
+#else
+    return ERRORCODE(-1, "project id is not supported by headers");
+#endif
+}
+
+baidu::galaxy::util::ErrorCode ProjectQuotaUsage::Usage(int64_t& used) {
+    int64_t inodes = 0L;
+    return GetQuota(project_id_, used, inodes);
+}
+
+baidu::galaxy::util::ErrorCode ProjectQuotaUsage::GetQuota(uint32_t id, int64_t& used, int64_t& inodes) {
+    struct if_dqblk dq;
+    memset(&dq, 0, sizeof dq);
+
+    if (0 != ::syscall(SYS_quotactl, QCMD(Q_GETQUOTA, PRJQUOTA), device_.c_str(), id, &dq)) {
+        return PERRORCODE(-1, errno, "get quota of project %u on %s failed", id, device_.c_str());
+    }
+
+    used = dq.dqb_curspace;
+    inodes = dq.dqb_curinodes;
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode ProjectQuotaUsage::SetLimit(uint32_t id, int64_t limit) {
+    struct if_dqblk dq;
+    memset(&dq, 0, sizeof dq);
+    // unit 1k block
+    dq.dqb_bhardlimit = (limit + 1023) / 1024;
+    dq.dqb_bsoftlimit = dq.dqb_bhardlimit;
+    dq.dqb_valid = QIF_BLIMITS;
+
+    if (0 != ::syscall(SYS_quotactl, QCMD(Q_SETQUOTA, PRJQUOTA), device_.c_str(), id, &dq)) {
+        return PERRORCODE(-1, errno, "set quota of project %u on %s failed", id, device_.c_str());
+    }
+
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode ProjectQuotaUsage::AllocateId(uint32_t& id) {
+    // start from the hash of path, so the same volum tends to get the same id
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < path_.size(); i++) {
+        h = (h ^ (unsigned char)path_[i]) * 16777619u;
+    }
+
+    boost::mutex::scoped_lock lock(project_id_mutex);
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t candidate = FLAGS_volum_project_id_base + (h + i) % kProjectIdRange;
+
+        if (project_ids.find(candidate) != project_ids.end()) {
+            continue;
+        }
+
+        // files of a destroyed volum may still wait for gc
+        int64_t used = 0L;
+        int64_t inodes = 0L;
+
+        if (GetQuota(candidate, used, inodes).Code() != 0 || inodes > 0) {
+            continue;
+        }
+
+        project_ids.insert(candidate);
+        allocated_ = true;
+        id = candidate;
+        return ERRORCODE_OK;
+    }
+
+    return ERRORCODE(-1, "no free project id for %s", path_.c_str());
+}
+
+void ProjectQuotaUsage::ReleaseId() {
+    if (!allocated_) {
+        return;
+    }
+
+    boost::mutex::scoped_lock lock(project_id_mutex);
+    project_ids.erase(project_id_);
+    allocated_ = false;
+}
+
+WalkUsage::WalkUsage(const std::string& path) :
+    path_(path) {
+}
+
+baidu::galaxy::util::ErrorCode WalkUsage::Usage(int64_t& used) {
+    struct stat st;
+
+    if (0 != ::lstat(path_.c_str(), &st)) {
+        return PERRORCODE(-1, errno, "%s donot exist", path_.c_str());
+    }
+
+    if (!S_ISDIR(st.st_mode)) {
+        used = st.st_blocks * 512L;
+        return ERRORCODE_OK;
+    }
+
+    Walk walk(path_, st.st_dev);
+    int threads = std::max(1, FLAGS_volum_walk_threads);
+    boost::thread_group group;
+
+    for (int i = 0; i < threads; i++) {
+        group.create_thread(boost::bind(&Walk::Run, &walk));
+    }
+
+    group.join_all();
+    used = st.st_blocks * 512L + walk.Used();
+    return ERRORCODE_OK;
+}
+
+}
+}
+}
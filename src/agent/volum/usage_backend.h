@@ -0,0 +1,105 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+#include "util/error_code.h"
+#include "boost/shared_ptr.hpp"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+namespace baidu {
+namespace galaxy {
+namespace proto {
+class VolumRequired;
+}
+
+namespace volum {
+
+// How VolumCollector measures the usage of a volum
+class UsageBackend {
+public:
+    virtual ~UsageBackend() {}
+    virtual std::string Name() const = 0;
+    virtual baidu::galaxy::util::ErrorCode Usage(int64_t& used) = 0;
+    // usage costs O(1), may be collected much more often than a walk
+    virtual bool Cheap() const = 0;
+
+    // backend for the medium of vr, configured by flag volum_usage_backend;
+    // falls back to walking path if the preferred backend can not be set up
+    static boost::shared_ptr<UsageBackend> Create(const baidu::galaxy::proto::VolumRequired& vr,
+            const std::string& path);
+};
+
+// used blocks of the filesystem, for volums owning the whole filesystem:
+// tmpfs and exclusive disks
+class StatfsUsage : public UsageBackend {
+public:
+    explicit StatfsUsage(const std::string& path);
+    std::string Name() const {
+        return "statfs";
+    }
+    baidu::galaxy::util::ErrorCode Usage(int64_t& used);
+    bool Cheap() const {
+        return true;
+    }
+
+private:
+    std::string path_;
+};
+
+// xfs or ext4 project quota, the directory gets a project id inherited by
+// everything created below it, the kernel accounts usage and enforces quota
+class ProjectQuotaUsage : public UsageBackend {
+public:
+    explicit ProjectQuotaUsage(const std::string& path);
+    ~ProjectQuotaUsage();
+    std::string Name() const {
+        return "quota";
+    }
+    // assign a project id to the directory and set the hard limit
+    baidu::galaxy::util::ErrorCode Setup(int64_t quota);
+    baidu::galaxy::util::ErrorCode Usage(int64_t& used);
+    bool Cheap() const {
+        return true;
+    }
+
+    uint32_t ProjectId() const {
+        return project_id_;
+    }
+
+private:
+    baidu::galaxy::util::ErrorCode GetQuota(uint32_t id, int64_t& used, int64_t& inodes);
+    baidu::galaxy::util::ErrorCode SetLimit(uint32_t id, int64_t limit);
+    baidu::galaxy::util::ErrorCode AllocateId(uint32_t& id);
+    void ReleaseId();
+
+    std::string path_;
+    std::string device_;
+    uint32_t project_id_;
+    bool allocated_;
+};
+
+// walks the tree with getdents64/fstatat on several threads at idle io
+// priority and a bounded rate, sums allocated blocks, hard links once
+class WalkUsage : public UsageBackend {
+public:
+    explicit WalkUsage(const std::string& path);
+    std::string Name() const {
+        return "walk";
+    }
+    baidu::galaxy::util::ErrorCode Usage(int64_t& used);
+    bool Cheap() const {
+        return false;
+    }
+
+private:
+    std::string path_;
+};
+
+}
+}
+}
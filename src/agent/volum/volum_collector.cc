@@ -2,10 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 #include "volum_collector.h"
-#include "boost/filesystem/path.hpp"
-#include "boost/filesystem/operations.hpp"
 #include "gflags/gflags.h"
 
+#include <assert.h>
+
 DECLARE_int64(volum_collect_cycle);
 
 namespace baidu {
@@ -16,6 +16,7 @@ VolumCollector::VolumCollector(const std::string& phy_path) :
     cycle_(FLAGS_volum_collect_cycle),
     name_(phy_path),
     phy_path_(phy_path),
+    backend_(new WalkUsage(phy_path)),
     size_(0) {
 }
 
@@ -23,55 +24,30 @@ VolumCollector::~VolumCollector() {
 }
 
 baidu::galaxy::util::ErrorCode VolumCollector::Collect() {
-    boost::filesystem::path path(phy_path_);
-    boost::system::error_code ec;
-
-    if (!boost::filesystem::exists(path, ec)) {
-        return ERRORCODE(-1, "%s donot exist: %s",
-                phy_path_.c_str(),
-                ec.message().c_str());
+    boost::shared_ptr<UsageBackend> backend;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        backend = backend_;
     }
 
     int64_t size = 0;
-    int64_t count = 0;
-    Du(path, size, count);
+    baidu::galaxy::util::ErrorCode ec = backend->Usage(size);
+
+    if (ec.Code() != 0) {
+        return ec;
+    }
+
     boost::mutex::scoped_lock lock(mutex_);
     size_ = size;
     return ERRORCODE_OK;
 }
 
-void VolumCollector::Du(const boost::filesystem::path& p, int64_t& size, int64_t& count) {
-    boost::system::error_code ec;
-
-    if (boost::filesystem::is_regular(p, ec)) {
-        size +=  boost::filesystem::file_size(p, ec);
-        count++;
-        return;
-    }
-
-    boost::filesystem::directory_iterator end;
-    boost::filesystem::directory_iterator iter(p, ec);
-    if (ec.value() != 0) {
-        return;
-    }
-
-    for (; iter != end; iter++) {
-        if (boost::filesystem::is_directory(iter->path(), ec)) {
-            Du(iter->path(), size, count);
-        } else if (boost::filesystem::is_symlink(iter->path(), ec)) {
-            //do nothing just ingor
-        } else if (boost::filesystem::is_regular(iter->path(), ec)) {
-            uint64_t s = boost::filesystem::file_size(iter->path(), ec);
-
-            if (static_cast<uintmax_t>(-1) != s) {
-                size += s;
-                count++;
-            }
-        }
-    }
+void VolumCollector::SetBackend(boost::shared_ptr<UsageBackend> backend) {
+    assert(NULL != backend.get());
+    boost::mutex::scoped_lock lock(mutex_);
+    backend_ = backend;
 }
 
-
 void VolumCollector::Enable(bool enable) {
     enable_ = enable;
 }
@@ -4,8 +4,9 @@
 
 #pragma once
 #include "collector/collector.h"
+#include "usage_backend.h"
 #include "util/error_code.h"
-#include "boost/filesystem/path.hpp"
+#include "boost/shared_ptr.hpp"
 #include "boost/thread/mutex.hpp"
 #include <string>
 namespace baidu {
@@ -25,16 +26,18 @@ public:
     std::string Path() const;
 
     void SetCycle(const int cycle);
+    // walks phy_path by default
+    void SetBackend(boost::shared_ptr<UsageBackend> backend);
 
     int64_t Size();
 private:
-    void Du(const boost::filesystem::path& p, int64_t& size, int64_t& counter);
     bool enable_;
     int cycle_;
     std::string name_;
     std::string phy_path_;
 
     boost::mutex mutex_;
+    boost::shared_ptr<UsageBackend> backend_;
     int64_t size_;
 };
 }
@@ -12,8 +12,11 @@
 #include "boost/algorithm/string/classification.hpp"
 #include "boost/filesystem/path.hpp"
 #include "boost/filesystem/operations.hpp"
+#include "util/dag.h"
 #include "util/error_code.h"
 #include "util/path_tree.h"
+#include "boost/algorithm/string/predicate.hpp"
+#include "boost/bind.hpp"
 #include "boost/lexical_cast/lexical_cast_old.hpp"
 
 #include <glog/logging.h>
@@ -23,6 +26,7 @@
 DECLARE_string(mount_templat);
 DECLARE_string(mount_cgroups);
 DECLARE_string(v2_prefix);
+DECLARE_int32(construct_step_concurrency);
 
 namespace baidu {
 namespace galaxy {
@@ -61,127 +65,207 @@ void VolumGroup::SetContainerId(const std::string& container_id) {
 }
 
 baidu::galaxy::util::ErrorCode VolumGroup::Construct() {
-    workspace_volum_ = Construct(this->ws_description_);
+    baidu::galaxy::util::Dag dag("volum group of " + container_id_);
+    AddConstructSteps(&dag);
+    return dag.Run(FLAGS_construct_step_concurrency);
+}
 
-    if (NULL == workspace_volum_.get()) {
-        return ERRORCODE(-1, "failed in constructing workspace volum");
-    }
+baidu::galaxy::util::ErrorCode VolumGroup::Destroy() {
+    baidu::galaxy::util::Dag dag("destroying volum group of " + container_id_);
+    AddDestroySteps(&dag, "");
+    return dag.Run(FLAGS_construct_step_concurrency);
+}
 
-    baidu::galaxy::util::ErrorCode ec;
+std::string VolumGroup::AddConstructSteps(baidu::galaxy::util::Dag* dag) {
+    assert(NULL != dag);
+    assert(NULL != ws_description_.get());
+    // steps fill the slots, which must not be resized while the dag runs
+    workspace_volum_.reset();
+    data_volum_.assign(dv_description_.size(), boost::shared_ptr<Volum>());
+    origin_volum_.assign(ov_description_.size(), boost::shared_ptr<Volum>());
+
+    std::vector<std::string> steps;
+    std::vector<std::string> paths;
+    steps.push_back("volum:workspace");
+    paths.push_back(ws_description_->dest_path());
+    dag->AddStep(steps.back(),
+            boost::bind(&VolumGroup::ConstructVolum, this, ws_description_, &workspace_volum_),
+            boost::bind(&VolumGroup::RollbackVolum, this, &workspace_volum_));
 
     for (size_t i = 0; i < dv_description_.size(); i++) {
-        boost::shared_ptr<Volum> v = Construct(dv_description_[i]);
-
-        if (v.get() == NULL) {
-            ec = ERRORCODE(-1,
-                    "construct volum(%s->%s) failed: ",
-                    dv_description_[i]->source_path().c_str(),
-                    dv_description_[i]->dest_path().c_str());
-            break;
-        }
+        steps.push_back("volum:data_" + boost::lexical_cast<std::string>(i));
+        paths.push_back(dv_description_[i]->dest_path());
+        dag->AddStep(steps.back(),
+                boost::bind(&VolumGroup::ConstructVolum, this, dv_description_[i], &data_volum_[i]),
+                boost::bind(&VolumGroup::RollbackVolum, this, &data_volum_[i]));
+    }
 
-        data_volum_.push_back(v);
+    for (size_t i = 0; i < ov_description_.size(); i++) {
+        steps.push_back("volum:origin_" + boost::lexical_cast<std::string>(i));
+        paths.push_back(ov_description_[i]->dest_path());
+        dag->AddStep(steps.back(),
+                boost::bind(&VolumGroup::ConstructVolum, this, ov_description_[i], &origin_volum_[i]),
+                boost::bind(&VolumGroup::RollbackVolum, this, &origin_volum_[i]));
     }
 
-    if (data_volum_.size() != dv_description_.size()) {
-        for (size_t i = 0; i < data_volum_.size(); i++) {
-            baidu::galaxy::util::ErrorCode err = data_volum_[i]->Destroy();
+    AddNestedDependencies(dag, steps, paths, true);
+    const std::string done = "volum:constructed";
+    dag->AddStep(done, baidu::galaxy::util::Dag::Action());
 
-            if (0 != err.Code()) {
-                LOG(WARNING) << "faild in destroying volum for container "
-                             << container_id_ << ": " << err.Message();
-            }
-        }
+    for (size_t i = 0; i < steps.size(); i++) {
+        dag->AddDependency(done, steps[i]);
+    }
+
+    return done;
+}
+
+std::string VolumGroup::AddDestroySteps(baidu::galaxy::util::Dag* dag, const std::string& after) {
+    assert(NULL != dag);
+    std::vector<std::string> steps;
+    std::vector<std::string> paths;
 
-        return ec;
+    if (workspace_volum_.get() != NULL) {
+        steps.push_back("volum:destroy_workspace");
+        paths.push_back(workspace_volum_->Description()->dest_path());
+        dag->AddStep(steps.back(), boost::bind(&VolumGroup::DestroyVolum, this, workspace_volum_, true));
     }
 
-    // origin volum
-    for (size_t i = 0; i < ov_description_.size(); i++) {
-        boost::shared_ptr<Volum> v = Construct(ov_description_[i]);
-
-        if (v.get() == NULL) {
-            ec = ERRORCODE(-1,
-                    "construct origin volum(%s->%s) failed: ",
-                    ov_description_[i]->source_path().c_str(),
-                    ov_description_[i]->dest_path().c_str());
-            break;
+    // slots are empty if the construction failed
+    for (size_t i = 0; i < data_volum_.size(); i++) {
+        if (data_volum_[i].get() != NULL) {
+            steps.push_back("volum:destroy_data_" + boost::lexical_cast<std::string>(i));
+            paths.push_back(data_volum_[i]->Description()->dest_path());
+            dag->AddStep(steps.back(), boost::bind(&VolumGroup::DestroyVolum, this, data_volum_[i], true));
         }
+    }
 
-        origin_volum_.push_back(v);
+    for (size_t i = 0; i < origin_volum_.size(); i++) {
+        if (origin_volum_[i].get() != NULL) {
+            steps.push_back("volum:destroy_origin_" + boost::lexical_cast<std::string>(i));
+            paths.push_back(origin_volum_[i]->Description()->dest_path());
+            dag->AddStep(steps.back(), boost::bind(&VolumGroup::DestroyVolum, this, origin_volum_[i], false));
+        }
     }
 
-    if (origin_volum_.size() != ov_description_.size()) {
-        for (size_t i = 0; i < origin_volum_.size(); i++) {
-            baidu::galaxy::util::ErrorCode err = origin_volum_[i]->Destroy();
+    AddNestedDependencies(dag, steps, paths, false);
+    const std::string done = "volum:gc";
+    dag->AddStep(done, boost::bind(&VolumGroup::GcContainerRoot, this));
 
-            if (0 != err.Code()) {
-                LOG(WARNING) << "faild in destroying origin volum for container "
-                    << container_id_ << ": " << err.Message();
-            }
+    if (!after.empty()) {
+        dag->AddDependency(done, after);
+    }
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (!after.empty()) {
+            dag->AddDependency(steps[i], after);
         }
 
-        return ec;
+        dag->AddDependency(done, steps[i]);
     }
 
-    return ERRORCODE_OK;
+    return done;
 }
 
-baidu::galaxy::util::ErrorCode VolumGroup::Destroy() {
-    baidu::galaxy::util::ErrorCode ec;
+bool VolumGroup::Contains(const std::string& parent, const std::string& child) {
+    std::string p = parent;
 
-    for (size_t i = 0; i < data_volum_.size(); i++) {
-        ec = data_volum_[i]->Destroy();
+    while (!p.empty() && p[p.size() - 1] == '/') {
+        p.erase(p.size() - 1);
+    }
 
-        if (0 != ec.Code()) {
-            return ERRORCODE(-1,
-                    "failed in destroying data volum: %s",
-                    ec.Message().c_str());
-        }
+    // the container root
+    if (p.empty()) {
+        return true;
     }
 
-    if (workspace_volum_.get() != NULL) {
-        ec = workspace_volum_->Destroy();
+    return child == p || boost::starts_with(child, p + "/");
+}
 
-        if (0 != ec.Code()) {
-            return ERRORCODE(-1,
-                    "failed in destroying workspace volum: %s",
-                    ec.Message().c_str());
+void VolumGroup::AddNestedDependencies(baidu::galaxy::util::Dag* dag,
+        const std::vector<std::string>& steps,
+        const std::vector<std::string>& paths,
+        bool parent_first) {
+    assert(steps.size() == paths.size());
+
+    for (size_t i = 0; i < steps.size(); i++) {
+        for (size_t j = i + 1; j < steps.size(); j++) {
+            size_t parent = i;
+            size_t child = j;
+
+            // the same dest path keeps the order volums are added in
+            if (Contains(paths[j], paths[i]) && !Contains(paths[i], paths[j])) {
+                parent = j;
+                child = i;
+            } else if (!Contains(paths[i], paths[j])) {
+                continue;
+            }
+
+            if (parent_first) {
+                dag->AddDependency(steps[child], steps[parent]);
+            } else {
+                dag->AddDependency(steps[parent], steps[child]);
+            }
         }
     }
+}
 
-    for (size_t i = 0; i < origin_volum_.size(); i++) {
-        ec = origin_volum_[i]->Destroy();
+baidu::galaxy::util::ErrorCode VolumGroup::ConstructVolum(boost::shared_ptr<baidu::galaxy::proto::VolumRequired> dp,
+        boost::shared_ptr<Volum>* volum) {
+    boost::shared_ptr<Volum> v = Construct(dp);
 
-        if (0 != ec.Code()) {
-            return ERRORCODE(-1,
-                    "failed in destroying origin volum: %s",
-                    ec.Message().c_str());
-        }
+    if (NULL == v.get()) {
+        return ERRORCODE(-1,
+                "construct volum(%s->%s) failed",
+                dp->source_path().c_str(),
+                dp->dest_path().c_str());
     }
 
-    // rm empty dir
-    // /home/diskx/galaxy/container_id/
-    for (size_t i = 0; i < data_volum_.size(); i++) {
-        ec = data_volum_[i]->Gc();
+    *volum = v;
+    return ERRORCODE_OK;
+}
 
-        if (0 != ec.Code()) {
-            return ERRORCODE(-1,
-                    "failed in gc data volum: %s",
-                    ec.Message().c_str());
-        }
+void VolumGroup::RollbackVolum(boost::shared_ptr<Volum>* volum) {
+    if (NULL == volum->get()) {
+        return;
     }
 
-    if (workspace_volum_.get() != NULL) {
-        ec = workspace_volum_->Gc();
+    baidu::galaxy::util::ErrorCode err = (*volum)->Destroy();
+
+    if (0 != err.Code()) {
+        LOG(WARNING) << "faild in destroying volum for container "
+                     << container_id_ << ": " << err.Message();
+    }
+
+    volum->reset();
+}
+
+baidu::galaxy::util::ErrorCode VolumGroup::DestroyVolum(boost::shared_ptr<Volum> volum, bool gc) {
+    baidu::galaxy::util::ErrorCode ec = volum->Destroy();
+
+    if (0 != ec.Code()) {
+        return ERRORCODE(-1,
+                "failed in destroying volum(%s): %s",
+                volum->Description()->dest_path().c_str(),
+                ec.Message().c_str());
+    }
+
+    // rm empty dir
+    // /home/diskx/galaxy/container_id/
+    if (gc) {
+        ec = volum->Gc();
 
         if (0 != ec.Code()) {
             return ERRORCODE(-1,
-                    "failed in gc workspace volum: %s",
+                    "failed in gc volum(%s): %s",
+                    volum->Description()->dest_path().c_str(),
                     ec.Message().c_str());
         }
     }
 
+    return ERRORCODE_OK;
+}
+
+baidu::galaxy::util::ErrorCode VolumGroup::GcContainerRoot() {
     // mv container root dir to gc_dir
     std::string container_root_path
         = baidu::galaxy::path::ContainerRootPath(container_id_);
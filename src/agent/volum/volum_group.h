@@ -17,6 +17,10 @@ namespace proto {
 class VolumRequired;
 }
 
+namespace util {
+class Dag;
+}
+
 namespace volum {
 
 class Volum;
@@ -42,6 +46,14 @@ public:
     baidu::galaxy::util::ErrorCode Construct();
     baidu::galaxy::util::ErrorCode  Destroy();
 
+    // one step per volum, a volum nested in the dest path of another one
+    // waits for it. returns the step done after all volums are constructed
+    std::string AddConstructSteps(baidu::galaxy::util::Dag* dag);
+    // nested volums are destroyed first, the container root is moved to
+    // the gc dir at last. every step starts after the step named after.
+    // returns the last step
+    std::string AddDestroySteps(baidu::galaxy::util::Dag* dag, const std::string& after);
+
     int ExportEnv(std::map<std::string, std::string>& env);
     int MountRootfs(bool vs_support);
     baidu::galaxy::util::ErrorCode MountSharedVolum(const std::map<std::string, std::string>& sv);
@@ -53,6 +65,17 @@ private:
     baidu::galaxy::util::ErrorCode MountDir_(const std::string& source, const std::string& target);
     boost::shared_ptr<Volum> Construct(boost::shared_ptr<baidu::galaxy::proto::VolumRequired> volum);
     boost::shared_ptr<Volum> NewVolum(boost::shared_ptr<baidu::galaxy::proto::VolumRequired> volum);
+    baidu::galaxy::util::ErrorCode ConstructVolum(boost::shared_ptr<baidu::galaxy::proto::VolumRequired> dp,
+            boost::shared_ptr<Volum>* volum);
+    void RollbackVolum(boost::shared_ptr<Volum>* volum);
+    baidu::galaxy::util::ErrorCode DestroyVolum(boost::shared_ptr<Volum> volum, bool gc);
+    baidu::galaxy::util::ErrorCode GcContainerRoot();
+    // both dest paths are relative to the container root
+    static bool Contains(const std::string& parent, const std::string& child);
+    static void AddNestedDependencies(baidu::galaxy::util::Dag* dag,
+            const std::vector<std::string>& steps,
+            const std::vector<std::string>& paths,
+            bool parent_first);
 
     int MountCgroups(const std::string& cg);
     int MountDirs(const std::string& t, bool v2_support);
@@ -205,6 +205,8 @@ void AppMasterImpl::BuildContainerDescription(const ::baidu::galaxy::proto::JobD
     for (int i = 0; i < job_desc.deploy().pools_size(); i++) {
         container_desc->add_pool_names(job_desc.deploy().pools(i));
     }
+    container_desc->mutable_spreads()->CopyFrom(job_desc.deploy().spreads());
+    container_desc->mutable_anti_affinities()->CopyFrom(job_desc.deploy().anti_affinities());
     container_desc->set_container_type(kNormalContainer);
     for (int i = 0; i < job_desc.volum_jobs_size(); i++) {
         container_desc->add_volum_jobs(job_desc.volum_jobs(i));
@@ -18,6 +18,7 @@ DEFINE_string(tag, "", "appworker tag, show appworker detail in command line ");
 DEFINE_string(appworker_agent_hostname_env, "BAIDU_GALAXY_AGENT_HOSTNAME", "agent hostname env name");
 DEFINE_string(appworker_agent_ip_env, "BAIDU_GALAXY_AGENT_IP", "agent ip env name");
 DEFINE_string(appworker_agent_port_env, "BAIDU_GALAXY_AGENT_PORT", "agent port env name");
+DEFINE_string(appworker_package_token_env, "BAIDU_GALAXY_PACKAGE_TOKEN", "package token env name");
 DEFINE_string(appworker_job_id_env, "BAIDU_GALAXY_CONTAINERGROUP_ID", "job id env name");
 DEFINE_string(appworker_pod_id_env, "BAIDU_GALAXY_CONTAINER_ID", "pod id env name");
 DEFINE_string(appworker_user_env, "BAIDU_GALAXY_CONTAINER_USER", "pod run user env name");
@@ -27,6 +28,8 @@ DEFINE_string(appworker_task_ids_env, "BAIDU_GALAXY_CONTAINER_CGROUP_IDS", "task
 DEFINE_string(appworker_cgroup_subsystems_env, "BAIDU_GALAXY_CGROUP_SUBSYSTEMS", "cgroup subsystems env names");
 DEFINE_string(appworker_exit_file, ".exit", "appworker exit file");
 DEFINE_string(appworker_dump_file, ".dump", "appworker dump file");
+DEFINE_bool(appworker_package_cache, true, "fetch packages from package cache of agent before downloading");
+DEFINE_int32(appworker_package_fetch_timeout, 600, "appworker fetch package from agent timeout, second");
 
 // pod_manager
 DEFINE_int32(pod_manager_change_pod_status_interval, 500, "pod manager check pod status change interval");
@@ -42,3 +45,13 @@ DEFINE_int32(process_manager_loop_wait_interval, 500, "process manager loop wait
 DEFINE_int32(process_manager_download_retry_times, 10 , "process nmanager download package fail retry times limit");
 DEFINE_int32(process_manager_download_timeout, 300, "process manager download package timeout, second");
 DEFINE_int32(process_manager_process_retry_delay, 30, "process manager wait time before retry, second");
+DEFINE_bool(process_manager_deploy_stream, true, "deploy http and ftp packages by streaming them into extracting instead of wget and tar");
+DEFINE_int32(process_manager_deploy_threads, 4, "process manager threads writing files extracted from a package");
+DEFINE_int32(process_manager_download_resume_times, 10, "process manager resume broken package download times limit");
+
+// deploy
+DEFINE_bool(deploy, false, "run as a deploy process, which streams a package into extracting");
+DEFINE_string(deploy_src_path, "", "deploy process source path of package");
+DEFINE_string(deploy_dst_path, "", "deploy process destination path of package");
+DEFINE_string(deploy_package, "", "deploy process package file, deployed instead of source path if exists");
+DEFINE_string(deploy_version, "", "deploy process package version, checked as md5 if it looks like one");
@@ -10,9 +10,19 @@
 #include <glog/logging.h>
 
 #include "appworker_impl.h"
+#include "package_deployer.h"
 #include "src/utils/setting_utils.h"
 #include "utils.h"
 
+DECLARE_bool(deploy);
+DECLARE_string(deploy_src_path);
+DECLARE_string(deploy_dst_path);
+DECLARE_string(deploy_package);
+DECLARE_string(deploy_version);
+DECLARE_int32(process_manager_deploy_threads);
+DECLARE_int32(process_manager_download_timeout);
+DECLARE_int32(process_manager_download_resume_times);
+
 static volatile bool s_quit = false;
 static volatile bool s_upgrade = false;
 
@@ -24,8 +34,38 @@ static void SignalHupHandler(int /*sig*/) {
     s_upgrade = true;
 }
 
+// deploy process exec'ed by process manager, messages go to stdout
+static int Deploy() {
+    // package delivered into workspace, or left by old deploys
+    bool local = baidu::galaxy::file::IsExists(FLAGS_deploy_package);
+    std::string src_path = local ? FLAGS_deploy_package : FLAGS_deploy_src_path;
+    std::string now_str_time;
+    baidu::galaxy::GetStrFTime(&now_str_time);
+    fprintf(stdout, "[%s] deploy %s into %s\n",
+            now_str_time.c_str(), src_path.c_str(), FLAGS_deploy_dst_path.c_str());
+    fflush(stdout);
+    baidu::galaxy::PackageDeployer deployer(FLAGS_deploy_dst_path,
+                                            FLAGS_process_manager_deploy_threads,
+                                            FLAGS_process_manager_download_timeout,
+                                            FLAGS_process_manager_download_resume_times);
+    int ret = deployer.Deploy(src_path, FLAGS_deploy_version);
+
+    // downloaded again by retrying
+    if (0 != ret && local) {
+        ::remove(FLAGS_deploy_package.c_str());
+    }
+
+    fflush(stdout);
+    return 0 == ret ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) {
     google::ParseCommandLineFlags(&argc, &argv, false);
+
+    if (FLAGS_deploy) {
+        return Deploy();
+    }
+
     google::InitGoogleLogging(argv[0]);
     std::string log_file = "appworker";
     if (baidu::galaxy::file::Mkdir(".appworker")) {
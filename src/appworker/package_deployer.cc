@@ -0,0 +1,1521 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "package_deployer.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <timer.h>
+
+#include "utils.h"
+
+namespace baidu {
+namespace galaxy {
+
+static const size_t READ_BUFFER_SIZE = 256 * 1024;
+static const size_t INFLATE_BUFFER_SIZE = 256 * 1024;
+static const int64_t MAX_INFLIGHT_BYTES = 64 * 1024 * 1024;
+static const size_t MAX_META_SIZE = 1024 * 1024;
+static const int MAX_REDIRECTS = 5;
+static const int64_t PROGRESS_INTERVAL = 10 * 1000000L;
+
+enum EntryType {
+    kEntrySkip = 0,
+    kEntryFile,
+    kEntryLongName,
+    kEntryLongLink,
+    kEntryPax
+};
+
+static void Print(const char* fmt, ...) {
+    std::string now_str_time;
+    GetStrFTime(&now_str_time);
+    char buffer[1024];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    fprintf(stdout, "[%s] %s\n", now_str_time.c_str(), buffer);
+    fflush(stdout);
+}
+
+static double Throughput(int64_t bytes, int64_t us) {
+    return us > 0 ? bytes * 1000000.0 / us / 1024 / 1024 : 0.0;
+}
+
+static bool IsMd5(const std::string& version) {
+    if (version.size() != 32) {
+        return false;
+    }
+
+    for (size_t i = 0; i < version.size(); i++) {
+        if (!isxdigit(version[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// sources of package
+
+class PackageSource {
+public:
+    virtual ~PackageSource() {}
+    // reads from offset of package on
+    virtual int Open(int64_t offset, std::string* err) = 0;
+    // 0 at the end, -1 if broken
+    virtual ssize_t Read(char* buf, size_t size) = 0;
+    // -1 if unknown
+    virtual int64_t Size() const = 0;
+
+protected:
+    // data before offset when the server starts from the beginning
+    int Skip(int64_t size, std::string* err) {
+        char buf[4096];
+
+        while (size > 0) {
+            ssize_t n = Read(buf, std::min(size, (int64_t)sizeof(buf)));
+
+            if (n <= 0) {
+                *err = "skip data failed";
+                return -1;
+            }
+
+            size -= n;
+        }
+
+        return 0;
+    }
+};
+
+namespace {
+
+struct Url {
+    std::string scheme;
+    std::string user;
+    std::string password;
+    std::string host;
+    std::string port;
+    std::string path;
+};
+
+static bool ParseUrl(const std::string& str, Url* url) {
+    std::string::size_type pos = str.find("://");
+
+    if (std::string::npos == pos) {
+        return false;
+    }
+
+    url->scheme = boost::to_lower_copy(str.substr(0, pos));
+    std::string rest = str.substr(pos + 3);
+    std::string::size_type slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    url->path = std::string::npos == slash ? "/" : rest.substr(slash);
+    std::string::size_type at = authority.rfind('@');
+
+    if (std::string::npos != at) {
+        std::string user_info = authority.substr(0, at);
+        authority = authority.substr(at + 1);
+        std::string::size_type colon = user_info.find(':');
+        url->user = user_info.substr(0, colon);
+
+        if (std::string::npos != colon) {
+            url->password = user_info.substr(colon + 1);
+        }
+    }
+
+    std::string::size_type colon = authority.rfind(':');
+
+    if (!authority.empty() && '[' == authority[0]) {
+        std::string::size_type close = authority.find(']');
+
+        if (std::string::npos == close) {
+            return false;
+        }
+
+        url->host = authority.substr(1, close - 1);
+        colon = close + 1 < authority.size() && ':' == authority[close + 1] ? close + 1 : std::string::npos;
+    } else {
+        url->host = authority.substr(0, colon);
+    }
+
+    if (std::string::npos != colon) {
+        url->port = authority.substr(colon + 1);
+    }
+
+    if (url->port.empty()) {
+        url->port = "ftp" == url->scheme ? "21" : "80";
+    }
+
+    return !url->host.empty();
+}
+
+static std::string Base64(const std::string& data) {
+    static const char* table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string res;
+
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t n = (unsigned char)data[i] << 16;
+        n |= i + 1 < data.size() ? (unsigned char)data[i + 1] << 8 : 0;
+        n |= i + 2 < data.size() ? (unsigned char)data[i + 2] : 0;
+        res.push_back(table[(n >> 18) & 0x3f]);
+        res.push_back(table[(n >> 12) & 0x3f]);
+        res.push_back(i + 1 < data.size() ? table[(n >> 6) & 0x3f] : '=');
+        res.push_back(i + 2 < data.size() ? table[n & 0x3f] : '=');
+    }
+
+    return res;
+}
+
+// buffered tcp connection, reads and writes time out
+class Connection {
+public:
+    Connection() :
+            fd_(-1),
+            begin_(0),
+            end_(0) {
+    }
+
+    ~Connection() {
+        Close();
+    }
+
+    bool Open(const std::string& host, const std::string& port,
+              int timeout, std::string* err) {
+        Close();
+        struct addrinfo hints;
+        struct addrinfo* addrs = NULL;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        int ret = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+
+        if (0 != ret) {
+            *err = "resolve " + host + " failed: " + gai_strerror(ret);
+            return false;
+        }
+
+        struct timeval tv;
+        tv.tv_sec = timeout;
+        tv.tv_usec = 0;
+
+        for (struct addrinfo* addr = addrs; NULL != addr; addr = addr->ai_next) {
+            fd_ = ::socket(addr->ai_family, addr->ai_socktype | SOCK_CLOEXEC, addr->ai_protocol);
+
+            if (fd_ < 0) {
+                continue;
+            }
+
+            // the send timeout limits connecting too
+            ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            ::setsockopt(fd_, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+            if (0 == ::connect(fd_, addr->ai_addr, addr->ai_addrlen)) {
+                break;
+            }
+
+            *err = "connect " + host + ":" + port + " failed: " + strerror(errno);
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+        ::freeaddrinfo(addrs);
+        return fd_ >= 0;
+    }
+
+    void Close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+
+        begin_ = end_ = 0;
+    }
+
+    bool Send(const std::string& data) {
+        size_t sent = 0;
+
+        while (sent < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+            if (n < 0 && EINTR == errno) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return false;
+            }
+
+            sent += n;
+        }
+
+        return true;
+    }
+
+    // without the line break
+    bool ReadLine(std::string* line) {
+        line->clear();
+
+        while (line->size() < 8192) {
+            if (begin_ == end_ && !Fill()) {
+                return false;
+            }
+
+            char c = buffer_[begin_++];
+
+            if ('\n' == c) {
+                if (!line->empty() && '\r' == (*line)[line->size() - 1]) {
+                    line->resize(line->size() - 1);
+                }
+
+                return true;
+            }
+
+            line->push_back(c);
+        }
+
+        return false;
+    }
+
+    // 0 if closed by peer
+    ssize_t Read(char* buf, size_t size) {
+        if (begin_ < end_) {
+            size_t n = std::min(size, end_ - begin_);
+            memcpy(buf, buffer_ + begin_, n);
+            begin_ += n;
+            return n;
+        }
+
+        while (true) {
+            ssize_t n = ::recv(fd_, buf, size, 0);
+
+            if (n < 0 && EINTR == errno) {
+                continue;
+            }
+
+            return n;
+        }
+    }
+
+private:
+    bool Fill() {
+        ssize_t n = Read(buffer_, sizeof(buffer_));
+
+        if (n <= 0) {
+            return false;
+        }
+
+        begin_ = 0;
+        end_ = n;
+        return true;
+    }
+
+private:
+    int fd_;
+    char buffer_[4096];
+    size_t begin_;
+    size_t end_;
+};
+
+class FileSource : public PackageSource {
+public:
+    explicit FileSource(const std::string& path) :
+            path_(path),
+            fd_(-1),
+            size_(-1) {
+    }
+
+    virtual ~FileSource() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    virtual int Open(int64_t offset, std::string* err) {
+        if (fd_ < 0) {
+            fd_ = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st;
+
+            if (fd_ < 0 || 0 != ::fstat(fd_, &st)) {
+                *err = "open " + path_ + " failed: " + strerror(errno);
+                return -1;
+            }
+
+            size_ = st.st_size;
+            ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+
+        if (::lseek(fd_, offset, SEEK_SET) < 0) {
+            *err = "seek " + path_ + " failed: " + strerror(errno);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    virtual ssize_t Read(char* buf, size_t size) {
+        while (true) {
+            ssize_t n = ::read(fd_, buf, size);
+
+            if (n < 0 && EINTR == errno) {
+                continue;
+            }
+
+            return n;
+        }
+    }
+
+    virtual int64_t Size() const {
+        return size_;
+    }
+
+private:
+    std::string path_;
+    int fd_;
+    int64_t size_;
+};
+
+class HttpSource : public PackageSource {
+public:
+    HttpSource(const std::string& url, int timeout) :
+            url_(url),
+            timeout_(timeout),
+            size_(-1),
+            left_(-1),
+            chunked_(false),
+            chunk_left_(0),
+            body_end_(false) {
+    }
+
+    virtual int Open(int64_t offset, std::string* err) {
+        std::string url = url_;
+
+        for (int i = 0; i <= MAX_REDIRECTS; i++) {
+            Url u;
+
+            if (!ParseUrl(url, &u) || "http" != u.scheme) {
+                *err = "bad url " + url;
+                return -1;
+            }
+
+            if (!conn_.Open(u.host, u.port, timeout_, err)) {
+                return -1;
+            }
+
+            std::string request = "GET " + u.path + " HTTP/1.1\r\n"
+                                   + "Host: " + u.host + ("80" == u.port ? "" : ":" + u.port) + "\r\n"
+                                   + "User-Agent: galaxy-appworker\r\n"
+                                   + "Accept: */*\r\n"
+                                   + "Connection: close\r\n";
+
+            if (!u.user.empty()) {
+                request += "Authorization: Basic " + Base64(u.user + ":" + u.password) + "\r\n";
+            }
+
+            if (offset > 0) {
+                request += "Range: bytes=" + boost::lexical_cast<std::string>(offset) + "-\r\n";
+            }
+
+            request += "\r\n";
+            std::string line;
+            int status = 0;
+
+            if (!conn_.Send(request)
+                    || !conn_.ReadLine(&line)
+                    || 1 != sscanf(line.c_str(), "HTTP/%*d.%*d %d", &status)) {
+                *err = "request " + url + " failed";
+                return -1;
+            }
+
+            int64_t length = -1;
+            int64_t range_start = -1;
+            int64_t range_size = -1;
+            std::string location;
+            chunked_ = false;
+
+            while (conn_.ReadLine(&line) && !line.empty()) {
+                std::string::size_type colon = line.find(':');
+
+                if (std::string::npos == colon) {
+                    continue;
+                }
+
+                std::string name = boost::to_lower_copy(boost::trim_copy(line.substr(0, colon)));
+                std::string value = boost::trim_copy(line.substr(colon + 1));
+
+                if ("content-length" == name) {
+                    length = atoll(value.c_str());
+                } else if ("transfer-encoding" == name) {
+                    chunked_ = boost::icontains(value, "chunked");
+                } else if ("location" == name) {
+                    location = value;
+                } else if ("content-range" == name) {
+                    long long start = -1;
+                    long long end = -1;
+                    long long total = -1;
+                    sscanf(value.c_str(), "bytes %lld-%lld/%lld", &start, &end, &total);
+                    range_start = start;
+                    range_size = total;
+                }
+            }
+
+            if (!line.empty()) {
+                *err = "read header of " + url + " failed";
+                return -1;
+            }
+
+            if (status >= 300 && status < 400 && !location.empty()) {
+                url = boost::contains(location, "://") ? location
+                      : u.scheme + "://" + u.host + ":" + u.port + location;
+                continue;
+            }
+
+            int64_t skip = 0;
+
+            if (200 == status) {
+                size_ = chunked_ ? -1 : length;
+                skip = offset;
+            } else if (206 == status && range_start == offset) {
+                size_ = range_size;
+            } else {
+                *err = "request " + url + " failed, status: " + boost::lexical_cast<std::string>(status);
+                return -1;
+            }
+
+            left_ = chunked_ ? -1 : length;
+            chunk_left_ = 0;
+            body_end_ = false;
+            return Skip(skip, err);
+        }
+
+        *err = "too many redirects of " + url_;
+        return -1;
+    }
+
+    virtual ssize_t Read(char* buf, size_t size) {
+        if (body_end_) {
+            return 0;
+        }
+
+        if (chunked_) {
+            if (0 == chunk_left_) {
+                std::string line;
+
+                // the line break ending the last chunk
+                while (conn_.ReadLine(&line) && line.empty()) {
+                }
+
+                char* end = NULL;
+                chunk_left_ = strtoll(line.c_str(), &end, 16);
+
+                if (end == line.c_str() || chunk_left_ < 0) {
+                    return -1;
+                }
+
+                if (0 == chunk_left_) {
+                    body_end_ = true;
+                    return 0;
+                }
+            }
+
+            ssize_t n = conn_.Read(buf, std::min((int64_t)size, chunk_left_));
+
+            if (n <= 0) {
+                return -1;
+            }
+
+            chunk_left_ -= n;
+            return n;
+        }
+
+        if (0 == left_) {
+            body_end_ = true;
+            return 0;
+        }
+
+        ssize_t n = conn_.Read(buf, left_ > 0 ? std::min((int64_t)size, left_) : size);
+
+        if (n < 0) {
+            return -1;
+        }
+
+        // closed before content length
+        if (0 == n) {
+            return left_ > 0 ? -1 : 0;
+        }
+
+        if (left_ > 0) {
+            left_ -= n;
+        }
+
+        return n;
+    }
+
+    virtual int64_t Size() const {
+        return size_;
+    }
+
+private:
+    std::string url_;
+    int timeout_;
+    Connection conn_;
+    int64_t size_;
+    int64_t left_;              // -1 if ended by closing
+    bool chunked_;
+    int64_t chunk_left_;
+    bool body_end_;
+};
+
+class FtpSource : public PackageSource {
+public:
+    FtpSource(const std::string& url, int timeout) :
+            url_(url),
+            timeout_(timeout),
+            size_(-1) {
+    }
+
+    virtual int Open(int64_t offset, std::string* err) {
+        Url u;
+
+        if (!ParseUrl(url_, &u) || "ftp" != u.scheme || u.path.size() <= 1) {
+            *err = "bad url " + url_;
+            return -1;
+        }
+
+        data_.Close();
+
+        if (!control_.Open(u.host, u.port, timeout_, err)) {
+            return -1;
+        }
+
+        // path of url is relative to the login directory
+        std::string path = u.path.substr(1);
+        std::string reply;
+        int code = Reply(&reply);
+
+        if (220 == code) {
+            code = Command("USER " + (u.user.empty() ? "anonymous" : u.user), &reply);
+        }
+
+        if (331 == code) {
+            code = Command("PASS " + (u.password.empty() ? "galaxy@" : u.password), &reply);
+        }
+
+        if (230 != code || 200 != Command("TYPE I", &reply)) {
+            *err = "login " + u.host + " failed: " + reply;
+            return -1;
+        }
+
+        if (213 == Command("SIZE " + path, &reply)) {
+            size_ = atoll(reply.c_str() + 4);
+        }
+
+        int h1, h2, h3, h4, p1, p2;
+        std::string::size_type pos = std::string::npos;
+
+        if (227 != Command("PASV", &reply)
+                || std::string::npos == (pos = reply.find('('))
+                || 6 != sscanf(reply.c_str() + pos, "(%d,%d,%d,%d,%d,%d)", &h1, &h2, &h3, &h4, &p1, &p2)) {
+            *err = "enter passive mode failed: " + reply;
+            return -1;
+        }
+
+        char host[64];
+        snprintf(host, sizeof(host), "%d.%d.%d.%d", h1, h2, h3, h4);
+
+        if (!data_.Open(host, boost::lexical_cast<std::string>(p1 * 256 + p2), timeout_, err)) {
+            return -1;
+        }
+
+        int64_t skip = 0;
+
+        if (offset > 0 && 350 != Command("REST " + boost::lexical_cast<std::string>(offset), &reply)) {
+            skip = offset;
+        }
+
+        code = Command("RETR " + path, &reply);
+
+        if (125 != code && 150 != code) {
+            *err = "retrieve " + path + " failed: " + reply;
+            return -1;
+        }
+
+        return Skip(skip, err);
+    }
+
+    virtual ssize_t Read(char* buf, size_t size) {
+        return data_.Read(buf, size);
+    }
+
+    virtual int64_t Size() const {
+        return size_;
+    }
+
+private:
+    int Command(const std::string& command, std::string* reply) {
+        if (!control_.Send(command + "\r\n")) {
+            *reply = "send " + command.substr(0, command.find(' ')) + " failed";
+            return -1;
+        }
+
+        return Reply(reply);
+    }
+
+    // the last line of a multiline reply
+    int Reply(std::string* reply) {
+        int code = -1;
+
+        while (control_.ReadLine(reply)) {
+            if (reply->size() < 4 || !isdigit((*reply)[0])) {
+                continue;
+            }
+
+            code = atoi(reply->c_str());
+
+            if ('-' != (*reply)[3]) {
+                return code;
+            }
+        }
+
+        return -1;
+    }
+
+private:
+    std::string url_;
+    int timeout_;
+    Connection control_;
+    Connection data_;
+    int64_t size_;
+};
+
+} // ending namespace
+
+// ---------------------------------------------------------------------------
+// tar format
+
+static bool IsZeroBlock(const char* block) {
+    for (size_t i = 0; i < 512; i++) {
+        if (0 != block[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// octal, or base-256 by gnu tar if the highest bit set
+static int64_t ParseNumber(const char* field, size_t size) {
+    int64_t value = 0;
+
+    if ((unsigned char)field[0] & 0x80) {
+        value = field[0] & 0x3f;
+
+        for (size_t i = 1; i < size; i++) {
+            value = (value << 8) | (unsigned char)field[i];
+        }
+
+        return value;
+    }
+
+    size_t i = 0;
+
+    while (i < size && (' ' == field[i] || 0 == field[i])) {
+        i++;
+    }
+
+    for (; i < size && field[i] >= '0' && field[i] <= '7'; i++) {
+        value = (value << 3) | (field[i] - '0');
+    }
+
+    return value;
+}
+
+static std::string ParseString(const char* field, size_t size) {
+    return std::string(field, strnlen(field, size));
+}
+
+// relative path inside the destination, false if it goes outside
+static bool SanitizePath(const std::string& name, std::string* path) {
+    std::vector<std::string> parts;
+    boost::split(parts, name, boost::is_any_of("/"));
+    path->clear();
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (parts[i].empty() || "." == parts[i]) {
+            continue;
+        }
+
+        if (".." == parts[i]) {
+            return false;
+        }
+
+        if (!path->empty()) {
+            path->push_back('/');
+        }
+
+        path->append(parts[i]);
+    }
+
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+
+// closed by the writer of its last data
+struct PackageDeployer::OutFile {
+    OutFile(PackageDeployer* d, int f, const std::string& p, int64_t t) :
+            deployer(d),
+            fd(f),
+            path(p),
+            mtime(t) {
+        MutexLock lock(&deployer->mutex_);
+        deployer->open_files_++;
+    }
+
+    ~OutFile() {
+        struct timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = mtime;
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+        ::futimens(fd, times);
+
+        if (0 != ::close(fd)) {
+            deployer->SetError("close " + path + " failed: " + strerror(errno));
+        }
+
+        MutexLock lock(&deployer->mutex_);
+        deployer->open_files_--;
+        deployer->cond_.Broadcast();
+    }
+
+    PackageDeployer* deployer;
+    int fd;
+    std::string path;
+    int64_t mtime;
+};
+
+PackageDeployer::PackageDeployer(const std::string& dst_path,
+                                 int threads,
+                                 int timeout,
+                                 int resume_times) :
+        dst_path_(dst_path),
+        timeout_(timeout),
+        resume_times_(resume_times),
+        zstream_(NULL),
+        inflated_(false),
+        inflate_buffer_(INFLATE_BUFFER_SIZE),
+        header_size_(0),
+        entry_type_(kEntrySkip),
+        entry_left_(0),
+        entry_padding_(0),
+        padding_left_(0),
+        entry_offset_(0),
+        pax_size_(-1),
+        zero_blocks_(0),
+        end_(false),
+        root_fd_(-1),
+        parent_fd_(-1),
+        mutex_(),
+        cond_(&mutex_),
+        inflight_(0),
+        open_files_(0),
+        pool_(std::max(1, threads)) {
+    memset(&statistics_, 0, sizeof(statistics_));
+}
+
+PackageDeployer::~PackageDeployer() {
+    if (NULL != zstream_) {
+        inflateEnd(zstream_);
+        delete zstream_;
+    }
+
+    if (parent_fd_ >= 0) {
+        ::close(parent_fd_);
+    }
+
+    if (root_fd_ >= 0) {
+        ::close(root_fd_);
+    }
+}
+
+bool PackageDeployer::IsStreamable(const std::string& src_path) {
+    return boost::starts_with(src_path, "http://")
+           || boost::starts_with(src_path, "ftp://");
+}
+
+const DeployStatistics& PackageDeployer::Statistics() const {
+    return statistics_;
+}
+
+int PackageDeployer::Deploy(const std::string& src_path, const std::string& version) {
+    int64_t start = common::timer::get_micros();
+    boost::scoped_ptr<PackageSource> source;
+    bool resumable = true;
+
+    if (boost::starts_with(src_path, "http://")) {
+        source.reset(new HttpSource(src_path, timeout_));
+    } else if (boost::starts_with(src_path, "ftp://")) {
+        source.reset(new FtpSource(src_path, timeout_));
+    } else {
+        source.reset(new FileSource(src_path));
+        resumable = false;
+    }
+
+    zstream_ = new z_stream;
+    memset(zstream_, 0, sizeof(z_stream));
+
+    // gzip header only
+    if (Z_OK != inflateInit2(zstream_, 16 + MAX_WBITS)) {
+        delete zstream_;
+        zstream_ = NULL;
+        Print("init inflating failed");
+        return -1;
+    }
+
+    int ret = -1;
+
+    if (!file::MkdirRecur(dst_path_)) {
+        SetError("create " + dst_path_ + " failed");
+    } else if ((root_fd_ = ::open(dst_path_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        SetError("open " + dst_path_ + " failed: " + strerror(errno));
+    } else {
+        ret = Stream(source.get(), resumable, version);
+    }
+
+    // files being written are waited even if streaming failed
+    if (0 != Finish()) {
+        ret = -1;
+    }
+
+    statistics_.elapsed = (common::timer::get_micros() - start) / 1000;
+
+    if (0 != ret) {
+        Print("deploy %s failed: %s", src_path.c_str(), error_.c_str());
+        return -1;
+    }
+
+    Print("deploy %s into %s done, "
+          "received %lld bytes in %lld ms, %.2f MB/s, "
+          "extracted %d files of %lld bytes, resumed %d times",
+          src_path.c_str(), dst_path_.c_str(),
+          (long long)statistics_.received, (long long)statistics_.elapsed,
+          Throughput(statistics_.received, common::timer::get_micros() - start),
+          statistics_.files, (long long)statistics_.extracted, statistics_.resumed);
+    return 0;
+}
+
+int PackageDeployer::Stream(PackageSource* source,
+                            bool resumable,
+                            const std::string& version) {
+    std::vector<char> buffer(READ_BUFFER_SIZE);
+    md5::Md5Stream md5;
+    int64_t offset = 0;
+    int64_t start = common::timer::get_micros();
+    int64_t last_progress = start;
+    std::string err;
+
+    while (true) {
+        ssize_t n = -1;
+
+        if (0 == source->Open(offset, &err)) {
+            // md5 and decoders go on from where the download broke
+            while ((n = source->Read(&buffer[0], buffer.size())) > 0) {
+                md5.Update(&buffer[0], n);
+                offset += n;
+                statistics_.received = offset;
+
+                if (0 != Inflate(&buffer[0], n)) {
+                    return -1;
+                }
+
+                int64_t now = common::timer::get_micros();
+
+                if (now - last_progress >= PROGRESS_INTERVAL) {
+                    last_progress = now;
+                    Print("received %lld of %lld bytes, %.2f MB/s",
+                          (long long)offset, (long long)source->Size(),
+                          Throughput(offset, now - start));
+                }
+            }
+
+            if (0 == n && source->Size() >= 0 && offset != source->Size()) {
+                n = -1;
+            }
+
+            if (0 == n) {
+                break;
+            }
+
+            err = "broken at " + boost::lexical_cast<std::string>(offset)
+                  + " of " + boost::lexical_cast<std::string>(source->Size()) + " bytes";
+        }
+
+        if (!resumable || statistics_.resumed >= resume_times_) {
+            SetError("read package failed, " + err);
+            return -1;
+        }
+
+        statistics_.resumed++;
+        Print("read package failed, %s, resume %d", err.c_str(), statistics_.resumed);
+        ::sleep(std::min(statistics_.resumed, 5));
+    }
+
+    if (!inflated_) {
+        SetError("package is truncated");
+        return -1;
+    }
+
+    if (!end_ && (entry_left_ > 0 || header_size_ > 0)) {
+        SetError("tar is truncated");
+        return -1;
+    }
+
+    if (IsMd5(version)) {
+        std::string md5sum = md5.Final();
+
+        if (!boost::iequals(md5sum, version)) {
+            SetError("md5 mismatch, package: " + md5sum + ", version: " + version);
+            return -1;
+        }
+    }
+
+    return Failed() ? -1 : 0;
+}
+
+int PackageDeployer::Inflate(const char* data, size_t size) {
+    zstream_->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zstream_->avail_in = size;
+
+    while (zstream_->avail_in > 0) {
+        if (inflated_) {
+            // padding after the end of archive
+            if (end_) {
+                return 0;
+            }
+
+            // gzip members concatenated
+            inflateReset(zstream_);
+            inflated_ = false;
+        }
+
+        zstream_->next_out = reinterpret_cast<Bytef*>(&inflate_buffer_[0]);
+        zstream_->avail_out = inflate_buffer_.size();
+        int ret = inflate(zstream_, Z_NO_FLUSH);
+
+        if (Z_OK != ret && Z_STREAM_END != ret) {
+            SetError(std::string("inflate package failed: ")
+                     + (NULL == zstream_->msg ? "" : zstream_->msg));
+            return -1;
+        }
+
+        size_t inflated = inflate_buffer_.size() - zstream_->avail_out;
+
+        if (inflated > 0 && 0 != Extract(&inflate_buffer_[0], inflated)) {
+            return -1;
+        }
+
+        inflated_ = Z_STREAM_END == ret;
+    }
+
+    return 0;
+}
+
+int PackageDeployer::Extract(const char* data, size_t size) {
+    while (size > 0 && !end_) {
+        size_t n = 0;
+
+        if (entry_left_ > 0) {
+            n = std::min((int64_t)size, entry_left_);
+
+            if (0 != ExtractData(data, n)) {
+                return -1;
+            }
+
+            entry_left_ -= n;
+
+            if (0 == entry_left_ && 0 != FinishEntry()) {
+                return -1;
+            }
+        } else if (padding_left_ > 0) {
+            n = std::min((int64_t)size, padding_left_);
+            padding_left_ -= n;
+        } else {
+            n = std::min(size, sizeof(header_) - header_size_);
+            memcpy(header_ + header_size_, data, n);
+            header_size_ += n;
+
+            if (sizeof(header_) == header_size_) {
+                header_size_ = 0;
+
+                if (0 != ExtractHeader()) {
+                    return -1;
+                }
+            }
+        }
+
+        data += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+int PackageDeployer::ExtractHeader() {
+    const char* h = header_;
+
+    if (IsZeroBlock(h)) {
+        end_ = ++zero_blocks_ >= 2;
+        return 0;
+    }
+
+    zero_blocks_ = 0;
+    int64_t checksum = 0;
+
+    for (size_t i = 0; i < sizeof(header_); i++) {
+        checksum += i >= 148 && i < 156 ? ' ' : (unsigned char)h[i];
+    }
+
+    if (checksum != ParseNumber(h + 148, 8)) {
+        SetError("bad tar header checksum");
+        return -1;
+    }
+
+    char type = h[156];
+    int64_t size = ParseNumber(h + 124, 12);
+    entry_left_ = size;
+    entry_padding_ = (512 - size % 512) % 512;
+    entry_offset_ = 0;
+    meta_.clear();
+
+    switch (type) {
+    case 'L':
+        entry_type_ = kEntryLongName;
+        break;
+
+    case 'K':
+        entry_type_ = kEntryLongLink;
+        break;
+
+    case 'x':
+        entry_type_ = kEntryPax;
+        break;
+
+    default:
+        entry_type_ = kEntrySkip;
+        break;
+    }
+
+    if (kEntrySkip != entry_type_) {
+        if (size > (int64_t)MAX_META_SIZE) {
+            SetError("tar meta data is too large");
+            return -1;
+        }
+
+        return 0 == entry_left_ ? FinishEntry() : 0;
+    }
+
+    // names of the last meta entries apply to this one
+    std::string name = long_name_;
+    std::string link = long_link_;
+
+    if (name.empty()) {
+        name = ParseString(h, 100);
+
+        if (0 == memcmp(h + 257, "ustar", 5) && 0 != h[345]) {
+            name = ParseString(h + 345, 155) + "/" + name;
+        }
+    }
+
+    if (link.empty()) {
+        link = ParseString(h + 157, 100);
+    }
+
+    if (pax_size_ >= 0) {
+        size = pax_size_;
+        entry_left_ = size;
+        entry_padding_ = (512 - size % 512) % 512;
+    }
+
+    long_name_.clear();
+    long_link_.clear();
+    pax_size_ = -1;
+    std::string rel;
+
+    if (!SanitizePath(name, &rel)) {
+        SetError("bad path in tar: " + name);
+        return -1;
+    }
+
+    mode_t mode = ParseNumber(h + 100, 8) & 0777;
+
+    // directories of old tars are regular files ending with '/'
+    if (('0' == type || 0 == type) && boost::ends_with(name, "/")) {
+        type = '5';
+    }
+
+    int ret = 0;
+
+    switch (type) {
+    case '0':
+    case '7':
+    case 0:
+        ret = rel.empty() ? -1 : CreateFile(rel, mode, ParseNumber(h + 136, 12));
+        break;
+
+    case '5':
+        if (!rel.empty()) {
+            int fd = OpenDir(rel, true);
+            ret = fd < 0 ? -1 : ::close(fd);
+            dirs_.push_back(std::make_pair(rel, mode));
+        }
+
+        break;
+
+    case '1': {
+        std::string target;
+
+        if (rel.empty() || !SanitizePath(link, &target) || target.empty()) {
+            SetError("bad hard link in tar: " + name + " -> " + link);
+            return -1;
+        }
+
+        ret = CreateHardLink(rel, target);
+        break;
+    }
+
+    case '2':
+        // created at last, so that no file is extracted through it
+        if (!rel.empty()) {
+            symlinks_.push_back(std::make_pair(rel, link));
+        }
+
+        break;
+
+    default:
+        Print("skip %s of type %c", name.c_str(), type);
+        break;
+    }
+
+    if (0 != ret) {
+        SetError("extract " + name + " failed");
+        return -1;
+    }
+
+    return 0 == entry_left_ ? FinishEntry() : 0;
+}
+
+int PackageDeployer::ExtractData(const char* data, size_t size) {
+    if (kEntryFile == entry_type_) {
+        {
+            MutexLock lock(&mutex_);
+
+            while (inflight_ > MAX_INFLIGHT_BYTES && error_.empty()) {
+                cond_.Wait();
+            }
+
+            if (!error_.empty()) {
+                return -1;
+            }
+
+            inflight_ += size;
+        }
+
+        boost::shared_ptr<std::string> chunk(new std::string(data, size));
+        pool_.AddTask(boost::bind(&PackageDeployer::Write, this,
+                                  entry_file_, chunk, entry_offset_));
+        entry_offset_ += size;
+    } else if (kEntrySkip != entry_type_) {
+        meta_.append(data, size);
+    }
+
+    return 0;
+}
+
+int PackageDeployer::FinishEntry() {
+    switch (entry_type_) {
+    case kEntryLongName:
+        long_name_ = meta_.c_str();
+        break;
+
+    case kEntryLongLink:
+        long_link_ = meta_.c_str();
+        break;
+
+    case kEntryPax: {
+        // records as "<length> <key>=<value>\n"
+        size_t pos = 0;
+
+        while (pos < meta_.size()) {
+            size_t length = atol(meta_.c_str() + pos);
+            size_t space = meta_.find(' ', pos);
+            size_t equal = meta_.find('=', pos);
+
+            if (0 == length || pos + length > meta_.size()
+                    || std::string::npos == space || std::string::npos == equal
+                    || equal > pos + length) {
+                SetError("bad pax header in tar");
+                return -1;
+            }
+
+            std::string key = meta_.substr(space + 1, equal - space - 1);
+            std::string value = meta_.substr(equal + 1, pos + length - equal - 2);
+
+            if ("path" == key) {
+                long_name_ = value;
+            } else if ("linkpath" == key) {
+                long_link_ = value;
+            } else if ("size" == key) {
+                pax_size_ = atoll(value.c_str());
+            }
+
+            pos += length;
+        }
+
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    // closed by the last writer
+    entry_file_.reset();
+    entry_type_ = kEntrySkip;
+    meta_.clear();
+    padding_left_ = entry_padding_;
+    return 0;
+}
+
+int PackageDeployer::OpenDir(const std::string& rel, bool create) {
+    int fd = ::dup(root_fd_);
+    std::vector<std::string> parts;
+
+    if (!rel.empty()) {
+        boost::split(parts, rel, boost::is_any_of("/"));
+    }
+
+    for (size_t i = 0; i < parts.size() && fd >= 0; i++) {
+        const char* part = parts[i].c_str();
+
+        if (create && 0 != ::mkdirat(fd, part, 0777) && EEXIST != errno) {
+            int err = errno;
+            ::close(fd);
+            errno = err;
+            fd = -1;
+            break;
+        }
+
+        int next = ::openat(fd, part, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        struct stat st;
+
+        if (next < 0 && create && (ELOOP == errno || ENOTDIR == errno)
+                && 0 == ::fstatat(fd, part, &st, AT_SYMLINK_NOFOLLOW) && S_ISLNK(st.st_mode)
+                && 0 == ::unlinkat(fd, part, 0) && 0 == ::mkdirat(fd, part, 0777)) {
+            next = ::openat(fd, part, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+
+        int err = errno;
+        ::close(fd);
+        errno = err;
+        fd = next;
+    }
+
+    if (fd < 0) {
+        Print("open directory %s/%s failed: %s", dst_path_.c_str(), rel.c_str(), strerror(errno));
+    }
+
+    return fd;
+}
+
+bool PackageDeployer::MakeParent(const std::string& rel, std::string* name) {
+    size_t pos = rel.rfind('/');
+    std::string parent = std::string::npos == pos ? "" : rel.substr(0, pos);
+    *name = std::string::npos == pos ? rel : rel.substr(pos + 1);
+
+    if (parent_fd_ >= 0 && parent == last_parent_) {
+        return true;
+    }
+
+    int fd = OpenDir(parent, true);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (parent_fd_ >= 0) {
+        ::close(parent_fd_);
+    }
+
+    parent_fd_ = fd;
+    last_parent_ = parent;
+    return true;
+}
+
+int PackageDeployer::CreateFile(const std::string& rel, mode_t mode, int64_t mtime) {
+    std::string path = dst_path_ + "/" + rel;
+    std::string name;
+
+    if (!MakeParent(rel, &name)) {
+        return -1;
+    }
+
+    // never write through an existing link, or into a running binary
+    if (0 != ::unlinkat(parent_fd_, name.c_str(), 0) && ENOENT != errno) {
+        Print("remove %s failed: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    int fd = ::openat(parent_fd_, name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, mode);
+
+    if (fd < 0) {
+        Print("create %s failed: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    entry_type_ = kEntryFile;
+    entry_file_.reset(new OutFile(this, fd, path, mtime));
+    statistics_.files++;
+    return 0;
+}
+
+int PackageDeployer::CreateHardLink(const std::string& rel, const std::string& target) {
+    std::string path = dst_path_ + "/" + rel;
+    std::string name;
+
+    if (!MakeParent(rel, &name)) {
+        return -1;
+    }
+
+    if (0 != ::unlinkat(parent_fd_, name.c_str(), 0) && ENOENT != errno) {
+        Print("remove %s failed: %s", path.c_str(), strerror(errno));
+        return -1;
+    }
+
+    size_t pos = target.rfind('/');
+    int target_fd = OpenDir(std::string::npos == pos ? "" : target.substr(0, pos), false);
+
+    if (target_fd < 0) {
+        return -1;
+    }
+
+    // the target itself is linked, not what it may point to
+    int ret = ::linkat(target_fd, std::string::npos == pos ? target.c_str() : target.c_str() + pos + 1,
+                       parent_fd_, name.c_str(), 0);
+
+    if (0 != ret) {
+        Print("link %s to %s failed: %s", path.c_str(), target.c_str(), strerror(errno));
+    }
+
+    ::close(target_fd);
+    return 0 == ret ? 0 : -1;
+}
+
+void PackageDeployer::Write(boost::shared_ptr<OutFile> file,
+                            boost::shared_ptr<std::string> data,
+                            int64_t offset) {
+    const char* buf = data->data();
+    size_t left = data->size();
+
+    while (left > 0) {
+        ssize_t n = ::pwrite(file->fd, buf, left, offset);
+
+        if (n < 0 && EINTR == errno) {
+            continue;
+        }
+
+        if (n <= 0) {
+            SetError("write " + file->path + " failed: " + strerror(errno));
+            break;
+        }
+
+        buf += n;
+        left -= n;
+        offset += n;
+    }
+
+    MutexLock lock(&mutex_);
+    inflight_ -= data->size();
+    statistics_.extracted += data->size() - left;
+    cond_.Broadcast();
+}
+
+int PackageDeployer::Finish() {
+    entry_file_.reset();
+    {
+        MutexLock lock(&mutex_);
+
+        while (inflight_ > 0 || open_files_ > 0) {
+            cond_.Wait();
+        }
+    }
+
+    if (Failed()) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < symlinks_.size(); i++) {
+        const std::string& rel = symlinks_[i].first;
+        std::string name;
+
+        if (!MakeParent(rel, &name)
+                || (0 != ::unlinkat(parent_fd_, name.c_str(), 0) && ENOENT != errno)
+                || 0 != ::symlinkat(symlinks_[i].second.c_str(), parent_fd_, name.c_str())) {
+            SetError("create symlink " + dst_path_ + "/" + rel + " failed: " + strerror(errno));
+            return -1;
+        }
+    }
+
+    // as tar does, after files in them created
+    mode_t mask = ::umask(0);
+    ::umask(mask);
+
+    for (size_t i = dirs_.size(); i > 0; i--) {
+        int fd = OpenDir(dirs_[i - 1].first, false);
+
+        if (fd >= 0) {
+            ::fchmod(fd, dirs_[i - 1].second & ~mask);
+            ::close(fd);
+        }
+    }
+
+    return 0;
+}
+
+void PackageDeployer::SetError(const std::string& error) {
+    MutexLock lock(&mutex_);
+
+    if (error_.empty()) {
+        error_ = error;
+    }
+
+    cond_.Broadcast();
+}
+
+bool PackageDeployer::Failed() {
+    MutexLock lock(&mutex_);
+    return !error_.empty();
+}
+
+} // ending namespace galaxy
+} // ending namespace baidu
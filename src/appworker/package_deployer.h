@@ -0,0 +1,120 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BAIDU_GALAXY_PACKAGE_DEPLOYER_H
+#define BAIDU_GALAXY_PACKAGE_DEPLOYER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <utility>
+
+#include <boost/shared_ptr.hpp>
+#include <mutex.h>
+#include <thread_pool.h>
+
+struct z_stream_s;
+
+namespace baidu {
+namespace galaxy {
+
+class PackageSource;
+
+struct DeployStatistics {
+    int64_t received;       // bytes of package read
+    int64_t extracted;      // bytes written into files
+    int32_t files;
+    int32_t resumed;        // times of download resumed from where it broke
+    int64_t elapsed;        // unit ms
+};
+
+// deploys a tar.gz package without saving it, the package is streamed
+// from http, ftp or a local file through gzip and tar decoders, files
+// are written by threads as their data arrives.
+// runs in deploy process, messages go to stdout as deploy commands do
+class PackageDeployer {
+public:
+    // timeout is for connecting and every read of network, unit second
+    PackageDeployer(const std::string& dst_path,
+                    int threads,
+                    int timeout,
+                    int resume_times);
+    ~PackageDeployer();
+    // src_path is an url of http or ftp, or a local file, version is
+    // verified as md5 of the package if it looks like one
+    int Deploy(const std::string& src_path, const std::string& version);
+    const DeployStatistics& Statistics() const;
+
+    static bool IsStreamable(const std::string& src_path);
+
+private:
+    struct OutFile;
+
+    int Stream(PackageSource* source, bool resumable, const std::string& version);
+    int Inflate(const char* data, size_t size);
+    int Extract(const char* data, size_t size);
+    int ExtractHeader();
+    int ExtractData(const char* data, size_t size);
+    int FinishEntry();
+    // entries are given relative to dst_path_ and made through directory
+    // fds, never following a symlink already in dst_path_
+    int CreateFile(const std::string& rel, mode_t mode, int64_t mtime);
+    int CreateHardLink(const std::string& rel, const std::string& target);
+    // opens the directory of rel into parent_fd_, name is the last part
+    bool MakeParent(const std::string& rel, std::string* name);
+    // fd of directory rel, opened part by part with O_NOFOLLOW, missing
+    // parts are created if create, as symlinks are replaced like tar does
+    int OpenDir(const std::string& rel, bool create);
+    void Write(boost::shared_ptr<OutFile> file,
+               boost::shared_ptr<std::string> data,
+               int64_t offset);
+    int Finish();
+    void SetError(const std::string& error);
+    bool Failed();
+
+private:
+    const std::string dst_path_;
+    const int timeout_;
+    const int resume_times_;
+    DeployStatistics statistics_;
+
+    struct z_stream_s* zstream_;
+    bool inflated_;                 // a gzip member ended
+    std::vector<char> inflate_buffer_;
+
+    // tar stream
+    char header_[512];
+    size_t header_size_;
+    int entry_type_;
+    int64_t entry_left_;            // data of the entry not extracted
+    int64_t entry_padding_;
+    int64_t padding_left_;
+    int64_t entry_offset_;
+    boost::shared_ptr<OutFile> entry_file_;
+    std::string meta_;              // data of gnu long names and pax headers
+    std::string long_name_;
+    std::string long_link_;
+    int64_t pax_size_;
+    int zero_blocks_;
+    bool end_;
+    int root_fd_;                   // of dst_path_
+    int parent_fd_;                 // of last_parent_
+    std::string last_parent_;
+    std::vector<std::pair<std::string, mode_t> > dirs_;             // relative
+    std::vector<std::pair<std::string, std::string> > symlinks_;    // relative -> link
+
+    Mutex mutex_;
+    CondVar cond_;
+    int64_t inflight_;              // bytes not written yet
+    int32_t open_files_;
+    std::string error_;
+    ThreadPool pool_;
+};
+
+} // ending namespace galaxy
+} // ending namespace baidu
+
+#endif // BAIDU_GALAXY_PACKAGE_DEPLOYER_H
@@ -0,0 +1,134 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "package_fetcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+
+DECLARE_string(appworker_agent_ip_env);
+DECLARE_string(appworker_agent_port_env);
+DECLARE_string(appworker_package_token_env);
+DECLARE_int32(appworker_package_fetch_timeout);
+
+namespace baidu {
+namespace galaxy {
+
+// suffix of the file delivered by agent, renamed to the package once
+// delivered, so that a late delivery never races with downloading
+static const char* DELIVERING_SUFFIX = ".cache";
+
+PackageFetcher::PackageFetcher() :
+        mutex_(),
+        agent_stub_(NULL) {
+    char* c_ip = getenv(FLAGS_appworker_agent_ip_env.c_str());
+    char* c_port = getenv(FLAGS_appworker_agent_port_env.c_str());
+
+    char* c_token = getenv(FLAGS_appworker_package_token_env.c_str());
+
+    // agent rejects requests without the token
+    if (NULL != c_ip && NULL != c_port && NULL != c_token) {
+        endpoint_ = std::string(c_ip) + ":" + std::string(c_port);
+        token_ = c_token;
+    }
+}
+
+PackageFetcher::~PackageFetcher() {
+    if (NULL != agent_stub_) {
+        delete agent_stub_;
+    }
+}
+
+bool PackageFetcher::Fetch(const std::string& job_id,
+                           const std::string& pod_id,
+                           const proto::Package& package,
+                           const std::string& file,
+                           Callback callback) {
+    MutexLock lock(&mutex_);
+
+    if (endpoint_.empty()) {
+        return false;
+    }
+
+    if (NULL == agent_stub_ && !rpc_client_.GetStub(endpoint_, &agent_stub_)) {
+        LOG(WARNING) << "get agent stub failed, agent: " << endpoint_;
+        return false;
+    }
+
+    // left by a delivery timed out before
+    std::string delivering = file + DELIVERING_SUFFIX;
+    ::remove(delivering.c_str());
+    std::string::size_type pos = delivering.rfind('/');
+
+    proto::FetchPackageRequest* request = new proto::FetchPackageRequest;
+    proto::FetchPackageResponse* response = new proto::FetchPackageResponse;
+    request->set_id(pod_id);
+    request->set_container_group_id(job_id);
+    request->mutable_package()->CopyFrom(package);
+    request->set_file(std::string::npos == pos ? delivering : delivering.substr(pos + 1));
+    request->set_token(token_);
+
+    boost::function<void (const proto::FetchPackageRequest*, proto::FetchPackageResponse*, bool, int)> fetch_callback;
+    fetch_callback = boost::bind(&PackageFetcher::FetchCallback,
+                                 this, file, callback, _1, _2, _3, _4);
+    rpc_client_.AsyncRequest(agent_stub_, &proto::Agent_Stub::FetchPackage,
+                             request, response, fetch_callback,
+                             FLAGS_appworker_package_fetch_timeout, 0);
+    return true;
+}
+
+void PackageFetcher::FetchCallback(std::string file,
+                                   Callback callback,
+                                   const proto::FetchPackageRequest* request,
+                                   proto::FetchPackageResponse* response,
+                                   bool failed, int error) {
+    boost::scoped_ptr<const proto::FetchPackageRequest> request_ptr(request);
+    boost::scoped_ptr<proto::FetchPackageResponse> response_ptr(response);
+    std::string delivering = file + DELIVERING_SUFFIX;
+    bool delivered = false;
+
+    do {
+        if (failed) {
+            LOG(WARNING) << "fetch package failed, rpc failed, err: " << error;
+            break;
+        }
+
+        if (proto::kOk != response_ptr->code().status()) {
+            LOG(WARNING)
+                    << "fetch package failed, "
+                    << "source: " << request_ptr->package().source_path() << ", "
+                    << "reason: " << response_ptr->code().reason();
+            break;
+        }
+
+        if (0 != ::rename(delivering.c_str(), file.c_str())) {
+            LOG(WARNING)
+                    << "rename package " << delivering << " failed, "
+                    << "errno: " << errno << ", err: " << strerror(errno);
+            break;
+        }
+
+        LOG(INFO)
+                << "package fetched from agent, "
+                << "source: " << request_ptr->package().source_path() << ", "
+                << "hit: " << response_ptr->hit();
+        delivered = true;
+    } while (0);
+
+    if (!delivered) {
+        ::remove(delivering.c_str());
+    }
+
+    callback(delivered);
+}
+
+} // ending namespace galaxy
+} // ending namespace baidu
@@ -0,0 +1,54 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BAIDU_GALAXY_PACKAGE_FETCHER_H
+#define BAIDU_GALAXY_PACKAGE_FETCHER_H
+
+#include <string>
+
+#include <boost/function.hpp>
+#include <mutex.h>
+
+#include "protocol/agent.pb.h"
+#include "rpc/rpc_client.h"
+
+namespace baidu {
+namespace galaxy {
+
+// asks the package cache of agent to deliver packages into workspace,
+// deploy processes find them there and skip downloading
+class PackageFetcher {
+public:
+    // delivered is false if agent failed or is not reachable, the package
+    // is downloaded by the deploy process then
+    typedef boost::function<void (bool delivered)> Callback;
+
+    PackageFetcher();
+    ~PackageFetcher();
+    // callback runs in rpc thread later, never in the calling thread
+    bool Fetch(const std::string& job_id,
+               const std::string& pod_id,
+               const proto::Package& package,
+               const std::string& file,
+               Callback callback);
+
+private:
+    void FetchCallback(std::string file,
+                       Callback callback,
+                       const proto::FetchPackageRequest* request,
+                       proto::FetchPackageResponse* response,
+                       bool failed, int error);
+
+private:
+    Mutex mutex_;
+    RpcClient rpc_client_;
+    std::string endpoint_;
+    std::string token_;             // proves requests are of this container
+    proto::Agent_Stub* agent_stub_;
+};
+
+} // ending namespace galaxy
+} // ending namespace baidu
+
+#endif // BAIDU_GALAXY_PACKAGE_FETCHER_H
@@ -21,11 +21,15 @@
 #include <gflags/gflags.h>
 
 #include "utils.h"
+#include "package_deployer.h"
 #include "protocol/galaxy.pb.h"
 
 DECLARE_int32(process_manager_loop_wait_interval);
 DECLARE_int32(process_manager_download_retry_times);
 DECLARE_int32(process_manager_download_timeout);
+DECLARE_bool(process_manager_deploy_stream);
+DECLARE_int32(process_manager_deploy_threads);
+DECLARE_int32(process_manager_download_resume_times);
 
 namespace baidu {
 namespace galaxy {
@@ -87,6 +91,39 @@ int ProcessManager::CreateProcess(const ProcessEnv& env,
         return -1;
     }
 
+    // package is streamed into extracting by appworker in deploy mode,
+    // which is exec'ed as the deployer starts threads and resolves hosts
+    const DownloadProcessContext* download_context = \
+            dynamic_cast<const DownloadProcessContext*>(context);
+    std::vector<std::string> deploy_args;
+    std::vector<char*> deploy_argv;
+    std::string deploy_cmd;
+
+    if (NULL != download_context
+            && FLAGS_process_manager_deploy_stream
+            && (file::IsExists(download_context->package)
+                || PackageDeployer::IsStreamable(download_context->src_path))) {
+        deploy_args.push_back("appworker");
+        deploy_args.push_back("--deploy");
+        deploy_args.push_back("--deploy_src_path=" + download_context->src_path);
+        deploy_args.push_back("--deploy_dst_path=" + download_context->dst_path);
+        deploy_args.push_back("--deploy_package=" + download_context->package);
+        deploy_args.push_back("--deploy_version=" + download_context->version);
+        deploy_args.push_back("--process_manager_deploy_threads="
+                              + boost::lexical_cast<std::string>(FLAGS_process_manager_deploy_threads));
+        deploy_args.push_back("--process_manager_download_timeout="
+                              + boost::lexical_cast<std::string>(FLAGS_process_manager_download_timeout));
+        deploy_args.push_back("--process_manager_download_resume_times="
+                              + boost::lexical_cast<std::string>(FLAGS_process_manager_download_resume_times));
+        deploy_cmd = boost::join(deploy_args, " ");
+
+        for (unsigned i = 0; i < deploy_args.size(); i++) {
+            deploy_argv.push_back(const_cast<char*>(deploy_args[i].c_str()));
+        }
+
+        deploy_argv.push_back(NULL);
+    }
+
     // 3. Fork
     pid_t child_pid = ::fork();
 
@@ -121,6 +158,12 @@ int ProcessManager::CreateProcess(const ProcessEnv& env,
 
         for (; c_it != env.cgroup_paths.end(); ++c_it) {
             std::string path = *c_it + "/tasks";
+
+            // cgroup v2 has cgroup.procs only
+            if (0 != ::access(path.c_str(), F_OK)) {
+                path = *c_it + "/cgroup.procs";
+            }
+
             std::string content = boost::lexical_cast<std::string>(my_pid);
             bool ok = file::Write(path, content);
 
@@ -139,10 +182,7 @@ int ProcessManager::CreateProcess(const ProcessEnv& env,
 
         std::string cmd = context->cmd;
         // 4.prepare cmd, different with deply and run
-        const DownloadProcessContext* download_context = \
-                dynamic_cast<const DownloadProcessContext*>(context);
-
-        if (NULL != download_context) {
+        if (NULL != download_context && deploy_args.empty()) {
             cmd = "mkdir -p " + download_context->dst_path
                   + " && tar -xzf " + download_context->package
                   + " -C " + download_context->dst_path
@@ -167,17 +207,29 @@ int ProcessManager::CreateProcess(const ProcessEnv& env,
         }
 
         // add delay time
-        if (context->delay_time > 0) {
+        if (context->delay_time > 0 && deploy_args.empty()) {
             cmd = "sleep " + boost::lexical_cast<std::string>(context->delay_time) + " && " + cmd;
         }
 
         // 5.prepare argv
-        char* argv[] = {
+        char* sh_argv[] = {
             const_cast<char*>("sh"),
             const_cast<char*>("-c"),
             const_cast<char*>(cmd.c_str()),
             NULL
         };
+        char** argv = sh_argv;
+        const char* path = "/bin/sh";
+
+        if (!deploy_args.empty()) {
+            if (context->delay_time > 0) {
+                ::sleep(context->delay_time);
+            }
+
+            argv = &deploy_argv[0];
+            path = "/proc/self/exe";
+            cmd.swap(deploy_cmd);
+        }
 
         fprintf(stdout, "[%s] cmd: %s, user: %s\n",
                 now_str_time.c_str(), cmd.c_str(), env.user.c_str());
@@ -192,7 +244,7 @@ int ProcessManager::CreateProcess(const ProcessEnv& env,
         }
 
         // 7.do exec
-        ::execve("/bin/sh", argv, envs);
+        ::execve(path, argv, envs);
         fprintf(stdout, "[%s] execve %s err[%d: %s]\n",
                 now_str_time.c_str(), cmd.c_str(), errno, strerror(errno));
         fflush(stdout);
@@ -18,6 +18,7 @@ DECLARE_int32(task_manager_loop_wait_interval);
 DECLARE_int32(task_manager_task_max_fail_retry_times);
 DECLARE_int32(process_manager_download_retry_times);
 DECLARE_int32(process_manager_process_retry_delay);
+DECLARE_bool(appworker_package_cache);
 
 namespace baidu {
 namespace galaxy {
@@ -61,6 +62,8 @@ int TaskManager::DeployTask(const std::string& task_id) {
     LOG(INFO) << "deplay task start, task: " << task_id;
     Task* task = it->second;
     task->packages_size = 0;
+    task->fetching = 0;
+    task->deploy_generation++;
 
     if (task->desc.has_exe_package()
             && task->desc.exe_package().has_package()) {
@@ -73,12 +76,7 @@ int TaskManager::DeployTask(const std::string& task_id) {
         context.package = context.work_dir + "/" + context.process_id
                           + "." + context.version + ".tar.gz";
 
-        // process env
-        ProcessEnv env;
-        MakeProcessEnv(task, env);
-
-        if (0 != process_manager_.CreateProcess(env, &context)) {
-            LOG(WARNING) << "command execute fail, command: " << context.cmd;
+        if (0 != DeployPackage(task, task->desc.exe_package().package(), context)) {
             return -1;
         }
 
@@ -97,11 +95,7 @@ int TaskManager::DeployTask(const std::string& task_id) {
             context.package = context.work_dir + "/" + context.process_id
                               + "." + context.version + ".tar.gz";
 
-            ProcessEnv env;
-            MakeProcessEnv(task, env);
-
-            if (0 != process_manager_.CreateProcess(env, &context)) {
-                LOG(WARNING) << "command execute fail, command: " << context.cmd;
+            if (0 != DeployPackage(task, task->desc.data_package().packages(i), context)) {
                 return -1;
             }
 
@@ -113,6 +107,78 @@ int TaskManager::DeployTask(const std::string& task_id) {
     return 0;
 }
 
+// fetch package from agent first if it is not in workspace,
+// deploy process is created after fetched
+int TaskManager::DeployPackage(Task* task,
+                               const Package& package,
+                               const DownloadProcessContext& context) {
+    mutex_.AssertHeld();
+
+    if (FLAGS_appworker_package_cache
+            && !file::IsExists(context.package)
+            && package_fetcher_.Fetch(task->env.job_id, task->env.pod_id,
+                                      package, context.package,
+                                      boost::bind(&TaskManager::OnPackageFetched,
+                                                  this, task->task_id,
+                                                  task->deploy_generation,
+                                                  context, _1))) {
+        task->fetching++;
+        return 0;
+    }
+
+    // process env
+    ProcessEnv env;
+    MakeProcessEnv(task, env);
+
+    if (0 != process_manager_.CreateProcess(env, &context)) {
+        LOG(WARNING) << "command execute fail, command: " << context.cmd;
+        return -1;
+    }
+
+    return 0;
+}
+
+void TaskManager::OnPackageFetched(std::string task_id,
+                                   int32_t deploy_generation,
+                                   DownloadProcessContext context,
+                                   bool delivered) {
+    LOG(INFO)
+            << "package fetched, "
+            << "process_id: " << context.process_id << ", "
+            << "delivered: " << delivered;
+    // not in rpc thread, which may run while deploying
+    background_pool_.AddTask(boost::bind(&TaskManager::DeployFetchedPackage,
+                                         this, task_id, deploy_generation, context));
+}
+
+void TaskManager::DeployFetchedPackage(std::string task_id,
+                                       int32_t deploy_generation,
+                                       DownloadProcessContext context) {
+    MutexLock lock(&mutex_);
+    std::map<std::string, Task*>::iterator it = tasks_.find(task_id);
+
+    // cleaned or deployed again while fetching
+    if (it == tasks_.end()
+            || it->second->status != proto::kTaskDeploying
+            || it->second->deploy_generation != deploy_generation
+            || it->second->fetching <= 0) {
+        LOG(WARNING) << "task: " << task_id << " not deploying, ignore fetched package";
+        return;
+    }
+
+    Task* task = it->second;
+    task->fetching--;
+
+    // package is downloaded by deploy process if not delivered
+    ProcessEnv env;
+    MakeProcessEnv(task, env);
+
+    if (0 != process_manager_.CreateProcess(env, &context)) {
+        LOG(WARNING) << "command execute fail, command: " << context.cmd;
+        task->status = proto::kTaskFailed;
+    }
+}
+
 // create task main process
 int TaskManager::DoStartTask(const std::string& task_id) {
     LOG(INFO) << "start task: " << task_id;
@@ -207,6 +273,11 @@ int TaskManager::CheckTask(const std::string& task_id, Task& task) {
     case proto::kTaskDeploying: {
         ProcessStatus process_status = proto::kProcessFinished;
 
+        // deploy processes are not created until packages fetched
+        if (it->second->fetching > 0) {
+            break;
+        }
+
         for (int i = 0; i < it->second->packages_size; i++) {
             process_id = task_id + "_deploy_" + boost::lexical_cast<std::string>(i);
 
@@ -383,6 +454,8 @@ int TaskManager::CleanTask(const std::string& task_id) {
     switch (it->second->prev_status) {
     case proto::kTaskDeploying:
         LOG(INFO) << "clean deploying task";
+        it->second->fetching = 0;
+        it->second->deploy_generation++;
 
         for (int i = 0; i < it->second->packages_size; i++) {
             process_id = task_id + "_deploy_"\
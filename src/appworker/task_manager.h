@@ -15,6 +15,7 @@
 #include "protocol/galaxy.pb.h"
 #include "protocol/appworker.pb.h"
 #include "process_manager.h"
+#include "package_fetcher.h"
 
 namespace baidu {
 namespace galaxy {
@@ -43,6 +44,8 @@ struct Task {
     TaskStatus prev_status;
     TaskStatus reload_status;
     int32_t packages_size;
+    int32_t fetching;
+    int32_t deploy_generation;  // fetched packages of former deploys are ignored
     int32_t fail_retry_times;
     TaskEnv env;
     int32_t timeout_point;
@@ -78,11 +81,22 @@ public:
 
 private:
     int DoStartTask(const std::string& task_id);
+    int DeployPackage(Task* task,
+                      const Package& package,
+                      const DownloadProcessContext& context);
+    void OnPackageFetched(std::string task_id,
+                          int32_t deploy_generation,
+                          DownloadProcessContext context,
+                          bool delivered);
+    void DeployFetchedPackage(std::string task_id,
+                              int32_t deploy_generation,
+                              DownloadProcessContext context);
 
 private:
     Mutex mutex_;
     std::map<std::string, Task*> tasks_;
     ProcessManager process_manager_;
+    PackageFetcher package_fetcher_;
     ThreadPool background_pool_;
 };
 
@@ -885,6 +885,33 @@ std::string Md5(std::string dat) {
     return Md5(dat.c_str(), dat.length());
 }
 
+Md5Stream::Md5Stream() :
+        ctx_(new MD5_CTX) {
+    MD5_Init(static_cast<MD5_CTX*>(ctx_));
+}
+
+Md5Stream::~Md5Stream() {
+    delete static_cast<MD5_CTX*>(ctx_);
+}
+
+void Md5Stream::Update(const void* dat, size_t len) {
+    MD5_Update(static_cast<MD5_CTX*>(ctx_), dat, len);
+}
+
+std::string Md5Stream::Final() {
+    std::string res;
+    unsigned char out[16];
+    MD5_Final(out, static_cast<MD5_CTX*>(ctx_));
+    MD5_Init(static_cast<MD5_CTX*>(ctx_));
+
+    for (size_t i = 0; i < 16; ++ i) {
+        res.push_back(hb2hex(out[i] >> 4));
+        res.push_back(hb2hex(out[i]));
+    }
+
+    return res;
+}
+
 /**
  * Generate shorter md5sum by something like base62
  * instead of base16 or base10.
@@ -75,6 +75,21 @@ std::string Md5File(FILE* file);
 std::string Md5Sum6(std::string dat);
 std::string Md5Sum6(const void* dat, size_t len);
 
+// md5 of data arriving in pieces, as Md5File reads a file
+class Md5Stream {
+public:
+    Md5Stream();
+    ~Md5Stream();
+    void Update(const void* dat, size_t len);
+    // hex digest, the stream restarts
+    std::string Final();
+
+private:
+    Md5Stream(const Md5Stream&);
+    Md5Stream& operator=(const Md5Stream&);
+    void* ctx_;
+};
+
 } // ending namespace md5
 
 namespace net {
@@ -1048,6 +1048,39 @@ bool JobAction::GenerateJson(const std::string& jobid) {
     obj_str.SetString(pools.c_str(), allocator);
     deploy.AddMember("pools", obj_str, allocator);
 
+    if (!job.deploy.spreads.empty()) {
+        rapidjson::Value spreads(rapidjson::kArrayType);
+        for (uint32_t i = 0; i < job.deploy.spreads.size(); ++i) {
+            rapidjson::Value spread(rapidjson::kObjectType);
+            obj_str.SetString(job.deploy.spreads[i].topology_key.c_str(), allocator);
+            spread.AddMember("topology_key", obj_str, allocator);
+            spread.AddMember("max_skew", job.deploy.spreads[i].max_skew, allocator);
+            spreads.PushBack(spread, allocator);
+        }
+        deploy.AddMember("spreads", spreads, allocator);
+    }
+
+    if (!job.deploy.anti_affinities.empty()) {
+        rapidjson::Value antis(rapidjson::kArrayType);
+        for (uint32_t i = 0; i < job.deploy.anti_affinities.size(); ++i) {
+            const ::baidu::galaxy::sdk::AntiAffinity& sdk_anti = job.deploy.anti_affinities[i];
+            rapidjson::Value anti(rapidjson::kObjectType);
+            obj_str.SetString(sdk_anti.topology_key.c_str(), allocator);
+            anti.AddMember("topology_key", obj_str, allocator);
+            std::string groups;
+            for (uint32_t j = 0; j < sdk_anti.container_groups.size(); ++j) {
+                groups += sdk_anti.container_groups[j];
+                if (j < sdk_anti.container_groups.size() - 1) {
+                    groups += ",";
+                }
+            }
+            obj_str.SetString(groups.c_str(), allocator);
+            anti.AddMember("container_groups", obj_str, allocator);
+            antis.PushBack(anti, allocator);
+        }
+        deploy.AddMember("anti_affinities", antis, allocator);
+    }
+
     root.AddMember("deploy", deploy, allocator);
 
     //pod节点
@@ -1127,6 +1160,23 @@ bool JobAction::GenerateJson(const std::string& jobid) {
 
         rapidjson::Value blkio(rapidjson::kObjectType);
         blkio.AddMember("weight", sdk_task.blkio.weight, allocator);
+        if (!sdk_task.blkio.throttles.empty()) {
+            rapidjson::Value throttles(rapidjson::kArrayType);
+            for (uint32_t j = 0; j < sdk_task.blkio.throttles.size(); ++j) {
+                const ::baidu::galaxy::sdk::BlkioThrottle& sdk_throttle = sdk_task.blkio.throttles[j];
+                rapidjson::Value throttle(rapidjson::kObjectType);
+                obj_str.SetString(sdk_throttle.path.c_str(), allocator);
+                throttle.AddMember("path", obj_str, allocator);
+                obj_str.SetString(StringUnit(sdk_throttle.read_bps).c_str(), allocator);
+                throttle.AddMember("read_bps", obj_str, allocator);
+                obj_str.SetString(StringUnit(sdk_throttle.write_bps).c_str(), allocator);
+                throttle.AddMember("write_bps", obj_str, allocator);
+                throttle.AddMember("read_iops", sdk_throttle.read_iops, allocator);
+                throttle.AddMember("write_iops", sdk_throttle.write_iops, allocator);
+                throttles.PushBack(throttle, allocator);
+            }
+            blkio.AddMember("throttles", throttles, allocator);
+        }
 
         rapidjson::Value ports(rapidjson::kArrayType);
         for (uint32_t j = 0; j < sdk_task.ports.size(); ++j) {
@@ -70,6 +70,60 @@ int ParseDeploy(const rapidjson::Value& deploy_json, ::baidu::galaxy::sdk::Deplo
         return -1;
     }
     deploy->pools.assign(pools.begin(), pools.end());
+
+    //deploy config:spreads, eg: [{"topology_key": "rack", "max_skew": 1}]
+    if (deploy_json.HasMember("spreads")) {
+        const rapidjson::Value& spreads_json = deploy_json["spreads"];
+        if (!spreads_json.IsArray()) {
+            fprintf(stderr, "spreads in deploy must be an array\n");
+            return -1;
+        }
+        for (rapidjson::SizeType i = 0; i < spreads_json.Size(); ++i) {
+            const rapidjson::Value& spread_json = spreads_json[i];
+            ::baidu::galaxy::sdk::TopologySpread spread;
+            if (!spread_json.HasMember("topology_key")) {
+                fprintf(stderr, "topology_key is needed in spread\n");
+                return -1;
+            }
+            spread.topology_key = spread_json["topology_key"].GetString();
+            boost::trim(spread.topology_key);
+            if (spread_json.HasMember("max_skew")) {
+                spread.max_skew = spread_json["max_skew"].GetInt();
+            }
+            deploy->spreads.push_back(spread);
+        }
+    }
+
+    //deploy config:anti_affinities, eg: [{"topology_key": "rack", "container_groups": "id1,id2"}]
+    if (deploy_json.HasMember("anti_affinities")) {
+        const rapidjson::Value& antis_json = deploy_json["anti_affinities"];
+        if (!antis_json.IsArray()) {
+            fprintf(stderr, "anti_affinities in deploy must be an array\n");
+            return -1;
+        }
+        for (rapidjson::SizeType i = 0; i < antis_json.Size(); ++i) {
+            const rapidjson::Value& anti_json = antis_json[i];
+            ::baidu::galaxy::sdk::AntiAffinity anti;
+            if (!anti_json.HasMember("topology_key")) {
+                fprintf(stderr, "topology_key is needed in anti_affinity\n");
+                return -1;
+            }
+            anti.topology_key = anti_json["topology_key"].GetString();
+            boost::trim(anti.topology_key);
+            if (!anti_json.HasMember("container_groups")) {
+                fprintf(stderr, "container_groups is needed in anti_affinity\n");
+                return -1;
+            }
+            std::string str_groups = anti_json["container_groups"].GetString();
+            boost::trim(str_groups);
+            ::baidu::common::SplitString(str_groups, ",", &anti.container_groups);
+            if (anti.container_groups.size() == 0) {
+                fprintf(stderr, "container_groups are needed in anti_affinity\n");
+                return -1;
+            }
+            deploy->anti_affinities.push_back(anti);
+        }
+    }
     return 0;
 }
 
@@ -408,6 +462,45 @@ int ParseBlkio(const rapidjson::Value& blkio_json, ::baidu::galaxy::sdk::BlkioRe
         return -1;
     }
     blkio->weight = blkio_json["weight"].GetInt();
+
+    if (!blkio_json.HasMember("throttles")) {
+        return 0;
+    }
+
+    const rapidjson::Value& throttles_json = blkio_json["throttles"];
+    if (!throttles_json.IsArray()) {
+        fprintf(stderr, "throttles in blkio must be an array\n");
+        return -1;
+    }
+
+    for (rapidjson::SizeType i = 0; i < throttles_json.Size(); ++i) {
+        const rapidjson::Value& throttle_json = throttles_json[i];
+        ::baidu::galaxy::sdk::BlkioThrottle throttle;
+        if (!throttle_json.HasMember("path")) {
+            fprintf(stderr, "path is needed in blkio throttle\n");
+            return -1;
+        }
+        throttle.path = throttle_json["path"].GetString();
+
+        // bps is in unit of byte, eg: 100M
+        if (throttle_json.HasMember("read_bps")
+                && 0 != UnitStringToByte(throttle_json["read_bps"].GetString(), &throttle.read_bps)) {
+            fprintf(stderr, "read_bps of blkio throttle is error\n");
+            return -1;
+        }
+        if (throttle_json.HasMember("write_bps")
+                && 0 != UnitStringToByte(throttle_json["write_bps"].GetString(), &throttle.write_bps)) {
+            fprintf(stderr, "write_bps of blkio throttle is error\n");
+            return -1;
+        }
+        if (throttle_json.HasMember("read_iops")) {
+            throttle.read_iops = throttle_json["read_iops"].GetInt64();
+        }
+        if (throttle_json.HasMember("write_iops")) {
+            throttle.write_iops = throttle_json["write_iops"].GetInt64();
+        }
+        blkio->throttles.push_back(throttle);
+    }
     return 0;
 }
 
@@ -80,6 +80,8 @@ bool ResAction::CreateContainerGroup(const std::string& json_file, const std::st
     //request.desc.cmd_line = "sh appworker.sh";
     request.desc.tag = job.deploy.tag;
     request.desc.pool_names.assign(job.deploy.pools.begin(), job.deploy.pools.end());
+    request.desc.spreads.assign(job.deploy.spreads.begin(), job.deploy.spreads.end());
+    request.desc.anti_affinities.assign(job.deploy.anti_affinities.begin(), job.deploy.anti_affinities.end());
 
     if (container_type.compare("normal") == 0) {
         for (uint32_t i = 0; i < job.pod.tasks.size(); ++i) {
@@ -158,6 +160,8 @@ bool ResAction::UpdateContainerGroup(const std::string& json_file, const std::st
     //request.desc.cmd_line = "sh appworker.sh";
     request.desc.tag = job.deploy.tag;
     request.desc.pool_names.assign(job.deploy.pools.begin(), job.deploy.pools.end());
+    request.desc.spreads.assign(job.deploy.spreads.begin(), job.deploy.spreads.end());
+    request.desc.anti_affinities.assign(job.deploy.anti_affinities.begin(), job.deploy.anti_affinities.end());
 
    
     if (container_type.compare("normal") == 0) {
@@ -1886,6 +1890,47 @@ bool ResAction::AddAgentToPool(const std::string& endpoint, const std::string& p
     return ret;
 }
 
+bool ResAction::SetAgentTopology(const std::string& endpoint, const std::string& labels) {
+    if (endpoint.empty()) {
+        return false;
+    }
+
+    //labels are key=value split by ,  empty labels clear the topology
+    std::vector<std::string> pairs;
+    ::baidu::common::SplitString(labels, ",", &pairs);
+    std::vector< ::baidu::galaxy::sdk::TopologyLabel> topology;
+    for (uint32_t i = 0; i < pairs.size(); ++i) {
+        size_t pos = pairs[i].find('=');
+        if (pos == std::string::npos) {
+            fprintf(stderr, "topology label %s must be key=value\n", pairs[i].c_str());
+            return false;
+        }
+        ::baidu::galaxy::sdk::TopologyLabel label;
+        label.key = pairs[i].substr(0, pos);
+        label.value = pairs[i].substr(pos + 1);
+        topology.push_back(label);
+    }
+
+    if(!this->Init()) {
+        return false;
+    }
+
+    ::baidu::galaxy::sdk::SetAgentTopologyRequest request;
+    ::baidu::galaxy::sdk::SetAgentTopologyResponse response;
+    request.user = user_;
+    request.endpoint = endpoint;
+    request.topology = topology;
+
+    bool ret = resman_->SetAgentTopology(request, &response);
+    if (ret) {
+        printf("Set topology of agent %s to [%s] successfully\n", endpoint.c_str(), labels.c_str());
+    } else {
+        printf("Set topology failed for reason %s:%s\n",
+                    StringStatus(response.error_code.status).c_str(), response.error_code.reason.c_str());
+    }
+    return ret;
+}
+
 bool ResAction::RemoveAgentFromPool(const std::string& endpoint, const std::string& pool) {
     if (endpoint.empty() || pool.empty()) {
         return false;
@@ -56,6 +56,7 @@ public:
 
     bool GetTagsByAgent(const std::string& endpoint);
     bool AddAgentToPool(const std::string& endpoint, const std::string& pool);
+    bool SetAgentTopology(const std::string& endpoint, const std::string& labels);
     //暂时不需要
     bool RemoveAgentFromPool(const std::string& endpoint, const std::string& pool);
 
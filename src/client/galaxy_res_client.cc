@@ -19,6 +19,7 @@ DEFINE_int32(r, 0, "specify replica");
 DEFINE_string(d, "", "specify disk size");
 DEFINE_string(s, "", "specify ssd size");
 DEFINE_string(m, "", "specify memory size");
+DEFINE_string(l, "", "specify topology labels, split by ,");
 
 DECLARE_string(flagfile);
 
@@ -34,6 +35,7 @@ const std::string kGalaxyUsage = "galaxy_res_client.\n"
                                  "  agent usage:\n"
                                  "      galaxy_res_client add_agent -p pool -e endpoint\n"
                                  "      galaxy_res_client set_agent -p pool -e endpoint\n"
+                                 "      galaxy_res_client set_topology -e endpoint [-l rack=yf01,zone=bj]\n"
                                  "      galaxy_res_client show_agent -e endpoint [-o cpu,mem,volums]\n"
                                  "      galaxy_res_client remove_agent -e endpoint\n"
                                  "      galaxy_res_client list_agents [-p pool -t tag -o cpu,mem,volums]\n"
@@ -73,6 +75,7 @@ const std::string kGalaxyUsage = "galaxy_res_client.\n"
                                  "      -d specify disk size, such as 1G\n"
                                  "      -s specify ssd size, such as 1G\n"
                                  "      -m specify memory size, such as 1G\n"
+                                 "      -l specify topology labels, such as rack=yf01,zone=bj, empty to clear\n"
                                  "      --flagfile specify flag file, default ./galaxy.flag\n";
 
 
@@ -185,6 +188,12 @@ int main(int argc, char** argv) {
             return -1;
         }
         ok =  resAction->AddAgentToPool(FLAGS_e, FLAGS_p);
+    } else if (strcmp(argv[1], "set_topology") == 0) {
+        if (FLAGS_e.empty()) {
+            fprintf(stderr, "-e is needed\n");
+            return -1;
+        }
+        ok = resAction->SetAgentTopology(FLAGS_e, FLAGS_l);
     } else if (strcmp(argv[1], "show_agent") == 0) { 
         if (FLAGS_e.empty()) {
             fprintf(stderr, "-e is needed\n");
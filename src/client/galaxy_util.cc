@@ -394,6 +394,21 @@ std::string StringResourceError(const ::baidu::galaxy::sdk::ResourceError& error
     case ::baidu::galaxy::sdk::kNoVolumContainer:
         result = "kNoVolumContainer";
         break;
+    case ::baidu::galaxy::sdk::kTooManyBatchPods:
+        result = "kTooManyBatchPods";
+        break;
+    case ::baidu::galaxy::sdk::kTopologySkew:
+        result = "kTopologySkew";
+        break;
+    case ::baidu::galaxy::sdk::kAntiAffinity:
+        result = "kAntiAffinity";
+        break;
+    case ::baidu::galaxy::sdk::kMemoryPressure:
+        result = "kMemoryPressure";
+        break;
+    case ::baidu::galaxy::sdk::kGcBacklog:
+        result = "kGcBacklog";
+        break;
     default:
         result = "";
     }
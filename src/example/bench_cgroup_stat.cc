@@ -0,0 +1,205 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares reading cgroup stat files of many containers per collect round:
+// open by path + InputStreamFile::ReadLine + sscanf, as collectors did,
+// against StatReader keeping the fds open and parsing from a fixed buffer.
+// usage: bench_cgroup_stat [dir] [cgroups] [rounds]
+
+#include "agent/cgroup/stat_reader.h"
+#include "agent/util/input_stream_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+static long long g_allocs = 0;
+
+void* operator new(size_t size) {
+    g_allocs++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    free(p);
+}
+
+void operator delete(void* p, size_t) throw() {
+    free(p);
+}
+
+static long long NowMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static void WriteFile(const std::string& path, const std::string& content) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (f == NULL) {
+        perror(path.c_str());
+        exit(1);
+    }
+    fwrite(content.data(), 1, content.size(), f);
+    fclose(f);
+}
+
+static const char* kMemoryStat =
+    "cache 1048576\nrss 2097152\nrss_huge 0\nmapped_file 4096\nswap 0\n"
+    "pgpgin 1234\npgpgout 567\npgfault 8910\npgmajfault 11\n"
+    "inactive_anon 0\nactive_anon 2097152\ninactive_file 524288\n"
+    "active_file 524288\nunevictable 0\nhierarchical_memory_limit 4294967296\n"
+    "total_cache 1048576\ntotal_rss 2097152\n";
+
+// the old path, one open and one heap line per read
+static bool OldRead(const std::string& dir, long long& cpu, long long& usage,
+                    long long& cache, long long& rss) {
+    {
+        baidu::galaxy::file::InputStreamFile in(dir + "/cpuacct.stat");
+        if (!in.IsOpen()) {
+            return false;
+        }
+        std::string line;
+        cpu = 0;
+        while (!in.Eof()) {
+            // ReadLine leaves the line untouched at eof
+            line.clear();
+            in.ReadLine(line);
+            char type[32];
+            long long t = 0;
+            if (2 == sscanf(line.c_str(), "%s %lld", type, &t)) {
+                cpu += t;
+            }
+        }
+    }
+    {
+        baidu::galaxy::file::InputStreamFile in(dir + "/memory.usage_in_bytes");
+        if (!in.IsOpen()) {
+            return false;
+        }
+        std::string data;
+        in.ReadLine(data);
+        usage = atol(data.c_str());
+    }
+    {
+        baidu::galaxy::file::InputStreamFile in(dir + "/memory.stat");
+        if (!in.IsOpen()) {
+            return false;
+        }
+        std::string line;
+        while (!in.Eof()) {
+            line.clear();
+            in.ReadLine(line);
+            char key[64];
+            long long v = 0;
+            if (2 != sscanf(line.c_str(), "%63s %lld", key, &v)) {
+                continue;
+            }
+            if (strcmp(key, "cache") == 0) {
+                cache = v;
+            } else if (strcmp(key, "rss") == 0) {
+                rss = v;
+            }
+        }
+    }
+    return true;
+}
+
+struct Readers {
+    boost::shared_ptr<baidu::galaxy::cgroup::StatReader> cpuacct;
+    boost::shared_ptr<baidu::galaxy::cgroup::StatReader> usage;
+    boost::shared_ptr<baidu::galaxy::cgroup::StatReader> stat;
+};
+
+static bool NewRead(Readers& r, long long& cpu, long long& usage,
+                    long long& cache, long long& rss) {
+    static const char* const keys[] = {"cache", "rss"};
+    int64_t values[] = {0, 0};
+    int64_t c = 0;
+    int64_t u = 0;
+    if (r.cpuacct->Read().Code() != 0 || !r.cpuacct->Sum(c)) {
+        return false;
+    }
+    if (r.usage->Read().Code() != 0 || !r.usage->Value(u)) {
+        return false;
+    }
+    if (r.stat->Read().Code() != 0 || r.stat->Values(keys, values, 2) != 2) {
+        return false;
+    }
+    cpu = c;
+    usage = u;
+    cache = values[0];
+    rss = values[1];
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string root = argc > 1 ? argv[1] : "/tmp/bench_cgroup_stat";
+    int cgroups = argc > 2 ? atoi(argv[2]) : 500;
+    int rounds = argc > 3 ? atoi(argv[3]) : 20;
+
+    mkdir(root.c_str(), 0755);
+    std::vector<std::string> dirs;
+    for (int i = 0; i < cgroups; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "/container_%d", i);
+        std::string dir = root + name;
+        mkdir(dir.c_str(), 0755);
+        WriteFile(dir + "/cpuacct.stat", "user 123456\nsystem 7890\n");
+        WriteFile(dir + "/memory.usage_in_bytes", "3145728\n");
+        WriteFile(dir + "/memory.stat", kMemoryStat);
+        dirs.push_back(dir);
+    }
+
+    long long cpu = 0, usage = 0, cache = 0, rss = 0;
+    long long sum = 0;
+    long long allocs = g_allocs;
+    long long t0 = NowMicros();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < dirs.size(); i++) {
+            if (OldRead(dirs[i], cpu, usage, cache, rss)) {
+                sum += cpu + usage + cache + rss;
+            }
+        }
+    }
+    long long old_time = NowMicros() - t0;
+    long long old_allocs = g_allocs - allocs;
+
+    std::vector<Readers> readers(dirs.size());
+    for (size_t i = 0; i < dirs.size(); i++) {
+        readers[i].cpuacct.reset(new baidu::galaxy::cgroup::StatReader(dirs[i] + "/cpuacct.stat", 256));
+        readers[i].usage.reset(new baidu::galaxy::cgroup::StatReader(dirs[i] + "/memory.usage_in_bytes", 64));
+        readers[i].stat.reset(new baidu::galaxy::cgroup::StatReader(dirs[i] + "/memory.stat", 4096));
+    }
+    long long new_sum = 0;
+    allocs = g_allocs;
+    t0 = NowMicros();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < readers.size(); i++) {
+            if (NewRead(readers[i], cpu, usage, cache, rss)) {
+                new_sum += cpu + usage + cache + rss;
+            }
+        }
+    }
+    long long new_time = NowMicros() - t0;
+    long long new_allocs = g_allocs - allocs;
+
+    printf("cgroups: %d, rounds: %d, checksum %s\n", cgroups, rounds,
+           sum == new_sum ? "match" : "MISMATCH");
+    printf("open+sscanf: %lld us/round, %.1f allocs/cgroup\n",
+           old_time / rounds, (double)old_allocs / rounds / cgroups);
+    printf("stat reader: %lld us/round, %.1f allocs/cgroup\n",
+           new_time / rounds, (double)new_allocs / rounds / cgroups);
+    return 0;
+}
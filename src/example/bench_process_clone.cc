@@ -0,0 +1,156 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Launches per second of many threads creating processes at the same time,
+// with the agent holding many fds: the old launch, listing /proc/self/fd
+// before every clone and sharing one static stack under a lock, against
+// Process::Clone with a stack per launch, close_range and the exec report.
+// Needs root for the new namespaces.
+// usage: bench_process_clone [creators] [launches] [fds]
+
+#include "agent/container/process.h"
+
+#include <boost/bind.hpp>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+static int g_launches = 0;
+static pthread_mutex_t g_stack_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static long long NowMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+static int ExecTrue(void*) {
+    char* const argv[] = {const_cast<char*>("/bin/true"), NULL};
+    execv("/bin/true", argv);
+    return -1;
+}
+
+static int ExecMissing(void*) {
+    char* const argv[] = {const_cast<char*>("/not/exist"), NULL};
+    execv("/not/exist", argv);
+    return -1;
+}
+
+struct OldContext {
+    std::vector<int> fds;
+};
+
+static int OldRoutine(void* param) {
+    OldContext* context = (OldContext*)param;
+    for (size_t i = 0; i < context->fds.size(); i++) {
+        if (context->fds[i] > 2) {
+            close(context->fds[i]);
+        }
+    }
+    return ExecTrue(NULL);
+}
+
+// the old path, fds are listed in the agent and the stack is shared
+static pid_t OldClone() {
+    OldContext context;
+    DIR* dir = opendir("/proc/self/fd");
+    if (dir == NULL) {
+        return -1;
+    }
+    struct dirent* entry = NULL;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            context.fds.push_back(atoi(entry->d_name));
+        }
+    }
+    closedir(dir);
+
+    static const int kStackSize = 1024 * 1024;
+    static char stack[kStackSize];
+    pthread_mutex_lock(&g_stack_mutex);
+    pid_t pid = clone(OldRoutine, stack + kStackSize,
+                      CLONE_NEWNS | CLONE_NEWPID | CLONE_NEWUTS | SIGCHLD, &context);
+    pthread_mutex_unlock(&g_stack_mutex);
+    return pid;
+}
+
+static void* OldCreator(void*) {
+    for (int i = 0; i < g_launches; i++) {
+        pid_t pid = OldClone();
+        if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+    }
+    return NULL;
+}
+
+static void* NewCreator(void* failed) {
+    for (int i = 0; i < g_launches; i++) {
+        baidu::galaxy::container::Process process;
+        process.RedirectStdout("/dev/null");
+        process.RedirectStderr("/dev/null");
+        if (process.Clone(boost::bind(ExecTrue, _1), NULL, 0) > 0) {
+            int status = 0;
+            process.Wait(status);
+        } else {
+            __sync_fetch_and_add((int*)failed, 1);
+        }
+    }
+    return NULL;
+}
+
+static double Run(int creators, void* (*creator)(void*), void* param) {
+    std::vector<pthread_t> threads(creators);
+    long long t0 = NowMicros();
+    for (int i = 0; i < creators; i++) {
+        pthread_create(&threads[i], NULL, creator, param);
+    }
+    for (int i = 0; i < creators; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    long long used = NowMicros() - t0;
+    return (double)creators * g_launches * 1000000 / (used > 0 ? used : 1);
+}
+
+int main(int argc, char** argv) {
+    int creators = argc > 1 ? atoi(argv[1]) : 16;
+    g_launches = argc > 2 ? atoi(argv[2]) : 50;
+    int fds = argc > 3 ? atoi(argv[3]) : 4000;
+
+    std::vector<int> opened;
+    for (int i = 0; i < fds; i++) {
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd < 0) {
+            perror("open");
+            break;
+        }
+        opened.push_back(fd);
+    }
+
+    int failed = 0;
+    double old_rate = Run(creators, OldCreator, NULL);
+    double new_rate = Run(creators, NewCreator, &failed);
+
+    // an exec failure must be reported, not taken as a started process
+    baidu::galaxy::container::Process process;
+    process.RedirectStdout("/dev/null");
+    process.RedirectStderr("/dev/null");
+    bool reported = process.Clone(boost::bind(ExecMissing, _1), NULL, 0) < 0;
+
+    printf("creators: %d, launches per creator: %d, open fds: %d\n",
+           creators, g_launches, (int)opened.size());
+    printf("list fds + shared stack: %.1f launches/s\n", old_rate);
+    printf("clone:                   %.1f launches/s, %d failed\n", new_rate, failed);
+    printf("exec failure %s\n", reported ? "reported" : "NOT REPORTED");
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Counts heap allocations of resman's agent query and create command path:
+// a fresh QueryResponse per poll with AgentInfo copied into the agent stat,
+// against a reused QueryResponse with AgentInfo swapped;
+// and ContainerDescription copied into each command, against shared.
+
+#include "protocol/agent.pb.h"
+#include "protocol/galaxy.pb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+static long long g_allocs = 0;
+
+void* operator new(size_t size) {
+    g_allocs++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    free(p);
+}
+
+void operator delete(void* p, size_t) throw() {
+    free(p);
+}
+
+namespace proto = baidu::galaxy::proto;
+
+static void BuildDesc(proto::ContainerDescription* desc) {
+    desc->set_priority(proto::kJobService);
+    desc->set_run_user("galaxy");
+    desc->set_version("ver_20160701_000000");
+    desc->set_cmd_line("sh appworker.sh --nexus_addr=a:1,b:2,c:3 --nexus_root_path=/galaxy3");
+    desc->mutable_workspace_volum()->set_size(10L << 30);
+    desc->mutable_workspace_volum()->set_medium(proto::kDisk);
+    desc->mutable_workspace_volum()->set_dest_path("/home/work");
+    for (int i = 0; i < 2; i++) {
+        proto::VolumRequired* vol = desc->add_data_volums();
+        vol->set_size(20L << 30);
+        vol->set_medium(proto::kDisk);
+        vol->set_dest_path("/home/disk" + std::string(1, '0' + i));
+    }
+    for (int i = 0; i < 2; i++) {
+        proto::Cgroup* cgroup = desc->add_cgroups();
+        cgroup->set_id("cgroup" + std::string(1, '0' + i));
+        cgroup->mutable_cpu()->set_milli_core(1000);
+        cgroup->mutable_memory()->set_size(1L << 30);
+        proto::PortRequired* port = cgroup->add_ports();
+        port->set_port_name("main");
+        port->set_port("dynamic");
+    }
+    desc->add_pool_names("main");
+}
+
+static void BuildResponse(int containers, std::string* data) {
+    proto::QueryResponse response;
+    response.mutable_code()->set_status(proto::kOk);
+    proto::AgentInfo* info = response.mutable_agent_info();
+    info->set_start_time(1467331200);
+    info->mutable_cpu_resource()->set_total(32000);
+    info->mutable_memory_resource()->set_total(128L << 30);
+    for (int i = 0; i < containers; i++) {
+        proto::ContainerInfo* container = info->add_container_info();
+        container->set_id("job_20160701_000000_foo_bar.pod_" + std::string(1, 'a' + i % 26));
+        container->set_group_id("job_20160701_000000_foo_bar");
+        container->set_status(proto::kContainerReady);
+        container->set_cpu_used(800);
+        container->set_memory_used(512L << 20);
+        BuildDesc(container->mutable_container_desc());
+        for (int j = 0; j < 3; j++) {
+            proto::Volum* volum = container->add_volum_used();
+            volum->set_used_size(1L << 30);
+            volum->set_path("/home/disk");
+            volum->set_medium(proto::kDisk);
+        }
+    }
+    response.SerializeToString(data);
+}
+
+int main(int argc, char** argv) {
+    int containers = argc > 1 ? atoi(argv[1]) : 40;
+    int polls = argc > 2 ? atoi(argv[2]) : 1000;
+    std::string data;
+    BuildResponse(containers, &data);
+
+    // before: new response per poll, AgentInfo copied into the agent stat
+    proto::AgentInfo stat_info;
+    long long begin = g_allocs;
+    for (int i = 0; i < polls; i++) {
+        proto::QueryResponse* response = new proto::QueryResponse();
+        response->ParseFromString(data);
+        stat_info = response->agent_info();
+        delete response;
+    }
+    long long query_before = g_allocs - begin;
+
+    // after: response reused across polls, AgentInfo swapped
+    boost::shared_ptr<proto::QueryResponse> reused(new proto::QueryResponse());
+    proto::AgentInfo stat_info2;
+    begin = g_allocs;
+    for (int i = 0; i < polls; i++) {
+        reused->ParseFromString(data);
+        stat_info2.Swap(reused->mutable_agent_info());
+    }
+    long long query_after = g_allocs - begin;
+
+    proto::ContainerDescription group_desc;
+    BuildDesc(&group_desc);
+    // before: desc copied into the command, then pushed and copied into the request
+    begin = g_allocs;
+    for (int i = 0; i < polls; i++) {
+        std::vector<proto::ContainerDescription> commands;
+        proto::ContainerDescription cmd_desc = group_desc;
+        commands.push_back(cmd_desc);
+        proto::ContainerDescription request;
+        request.CopyFrom(commands[0]);
+    }
+    long long cmd_before = g_allocs - begin;
+
+    // after: immutable desc shared with the group, copied once into the request
+    boost::shared_ptr<const proto::ContainerDescription> shared_desc(
+        new proto::ContainerDescription(group_desc));
+    begin = g_allocs;
+    for (int i = 0; i < polls; i++) {
+        std::vector<boost::shared_ptr<const proto::ContainerDescription> > commands;
+        commands.push_back(shared_desc);
+        proto::ContainerDescription request;
+        request.CopyFrom(*commands[0]);
+    }
+    long long cmd_after = g_allocs - begin;
+
+    printf("containers per agent: %d, polls: %d\n", containers, polls);
+    printf("query   allocs/poll before: %.1f, after: %.1f\n",
+           (double)query_before / polls, (double)query_after / polls);
+    printf("command allocs/cmd  before: %.1f, after: %.1f\n",
+           (double)cmd_before / polls, (double)cmd_after / polls);
+    return 0;
+}
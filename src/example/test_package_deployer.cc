@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include "src/appworker/package_deployer.h"
+#include "src/appworker/utils.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// serves one package over http on localhost, as a stand-in of package
+// servers, it may break the first response or ignore ranges
+class HttpServer {
+public:
+    HttpServer(const std::string& package) :
+            break_at_(-1),
+            ignore_range_(false),
+            requests_(0),
+            ranges_(0),
+            fd_(-1),
+            port_(0) {
+        std::ifstream in(package.c_str(), std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        data_ = ss.str();
+    }
+
+    ~HttpServer() {
+        ::shutdown(fd_, SHUT_RDWR);
+        ::close(fd_);
+        pthread_join(thread_, NULL);
+    }
+
+    int Start() {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+
+        if (0 != ::bind(fd_, (struct sockaddr*)&addr, sizeof(addr))
+                || 0 != ::listen(fd_, 16)
+                || 0 != ::getsockname(fd_, (struct sockaddr*)&addr, &len)) {
+            return -1;
+        }
+
+        port_ = ntohs(addr.sin_port);
+        return pthread_create(&thread_, NULL, &HttpServer::Run, this);
+    }
+
+    std::string Url() const {
+        char url[64];
+        snprintf(url, sizeof(url), "http://127.0.0.1:%d/package.tar.gz", port_);
+        return url;
+    }
+
+    int64_t break_at_;
+    bool ignore_range_;
+    int requests_;
+    int ranges_;
+
+private:
+    static void* Run(void* arg) {
+        HttpServer* server = static_cast<HttpServer*>(arg);
+        int conn = -1;
+
+        while ((conn = ::accept(server->fd_, NULL, NULL)) >= 0) {
+            server->Serve(conn);
+            ::close(conn);
+        }
+
+        return NULL;
+    }
+
+    void Serve(int conn) {
+        std::string request;
+        char buf[4096];
+
+        while (std::string::npos == request.find("\r\n\r\n")) {
+            ssize_t n = ::recv(conn, buf, sizeof(buf), 0);
+
+            if (n <= 0) {
+                return;
+            }
+
+            request.append(buf, n);
+        }
+
+        requests_++;
+        long long offset = 0;
+        std::string::size_type pos = request.find("Range: bytes=");
+
+        if (std::string::npos != pos && !ignore_range_) {
+            offset = atoll(request.c_str() + pos + strlen("Range: bytes="));
+            ranges_++;
+        }
+
+        char header[256];
+
+        if (offset > 0) {
+            snprintf(header, sizeof(header),
+                     "HTTP/1.1 206 Partial Content\r\nContent-Length: %lld\r\n"
+                     "Content-Range: bytes %lld-%lld/%lld\r\n\r\n",
+                     (long long)data_.size() - offset, offset,
+                     (long long)data_.size() - 1, (long long)data_.size());
+        } else {
+            snprintf(header, sizeof(header),
+                     "HTTP/1.1 200 OK\r\nContent-Length: %lld\r\n\r\n",
+                     (long long)data_.size());
+        }
+
+        int64_t end = data_.size();
+
+        if (break_at_ > offset) {
+            end = break_at_;
+            break_at_ = -1;
+        }
+
+        ::send(conn, header, strlen(header), MSG_NOSIGNAL);
+        ::send(conn, data_.data() + offset, end - offset, MSG_NOSIGNAL);
+    }
+
+    int fd_;
+    int port_;
+    pthread_t thread_;
+    std::string data_;
+};
+
+class TestPackageDeployer : public testing::Test {
+protected:
+    virtual void SetUp() {
+        ASSERT_EQ(0, system("rm -rf .deploy_test && mkdir -p .deploy_test/src/bin/a_directory_name_long_enough"
+                            "/to_make_the_path_longer_than_one_hundred_characters_in_tar_header"
+                            " && cd .deploy_test/src"
+                            " && echo hello > bin/hello.txt && touch bin/empty"
+                            " && echo deep > bin/a_directory_name_long_enough/to_make_the_path_longer"
+                            "_than_one_hundred_characters_in_tar_header/deep.txt"
+                            " && head -c 3000000 /dev/urandom > bin/large.bin"
+                            " && ln -s hello.txt bin/link && ln bin/hello.txt bin/hard.txt"
+                            " && tar -czf ../package.tar.gz bin"));
+        package_ = ".deploy_test/package.tar.gz";
+        md5_ = baidu::galaxy::md5::Md5File(package_.c_str());
+    }
+
+    virtual void TearDown() {
+        system("rm -rf .deploy_test");
+    }
+
+    static bool Same(const std::string& dst) {
+        std::string cmd = "diff -r --no-dereference .deploy_test/src/bin " + dst + "/bin";
+        return 0 == system(cmd.c_str());
+    }
+
+    std::string package_;
+    std::string md5_;
+};
+
+TEST_F(TestPackageDeployer, Http) {
+    HttpServer server(package_);
+    ASSERT_EQ(0, server.Start());
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/http", 4, 5, 3);
+    ASSERT_EQ(0, deployer.Deploy(server.Url(), md5_));
+    EXPECT_TRUE(Same(".deploy_test/http"));
+
+    const baidu::galaxy::DeployStatistics& statistics = deployer.Statistics();
+    struct stat st;
+    ASSERT_EQ(0, stat(package_.c_str(), &st));
+    EXPECT_EQ(st.st_size, statistics.received);
+    EXPECT_EQ(0, statistics.resumed);
+    // hard.txt is a link
+    EXPECT_EQ(4, statistics.files);
+    EXPECT_LT(3000000, statistics.extracted);
+}
+
+TEST_F(TestPackageDeployer, Resume) {
+    HttpServer server(package_);
+    ASSERT_EQ(0, server.Start());
+    server.break_at_ = 1000000;
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/resume", 4, 5, 3);
+    ASSERT_EQ(0, deployer.Deploy(server.Url(), md5_));
+    EXPECT_TRUE(Same(".deploy_test/resume"));
+    EXPECT_EQ(1, deployer.Statistics().resumed);
+    EXPECT_EQ(2, server.requests_);
+    EXPECT_EQ(1, server.ranges_);
+}
+
+TEST_F(TestPackageDeployer, ResumeWithoutRange) {
+    HttpServer server(package_);
+    ASSERT_EQ(0, server.Start());
+    server.break_at_ = 1000000;
+    server.ignore_range_ = true;
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/norange", 4, 5, 3);
+    ASSERT_EQ(0, deployer.Deploy(server.Url(), md5_));
+    EXPECT_TRUE(Same(".deploy_test/norange"));
+    EXPECT_EQ(1, deployer.Statistics().resumed);
+}
+
+TEST_F(TestPackageDeployer, Md5Mismatch) {
+    HttpServer server(package_);
+    ASSERT_EQ(0, server.Start());
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/md5", 4, 5, 3);
+    EXPECT_NE(0, deployer.Deploy(server.Url(), "0123456789abcdef0123456789abcdef"));
+}
+
+TEST_F(TestPackageDeployer, LocalFile) {
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/local", 2, 5, 3);
+    ASSERT_EQ(0, deployer.Deploy(package_, md5_));
+    EXPECT_TRUE(Same(".deploy_test/local"));
+}
+
+TEST_F(TestPackageDeployer, ExistingSymlink) {
+    // left by an old package, extracting must not go through them
+    ASSERT_EQ(0, system("mkdir -p .deploy_test/outside .deploy_test/symlink"
+                        " && ln -s ../outside .deploy_test/symlink/bin"));
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/symlink", 2, 5, 3);
+    ASSERT_EQ(0, deployer.Deploy(package_, md5_));
+    EXPECT_TRUE(Same(".deploy_test/symlink"));
+    EXPECT_EQ(0, system("test -z \"$(ls -A .deploy_test/outside)\""));
+}
+
+TEST_F(TestPackageDeployer, Truncated) {
+    ASSERT_EQ(0, system("head -c 500000 .deploy_test/package.tar.gz > .deploy_test/truncated.tar.gz"));
+    baidu::galaxy::PackageDeployer deployer(".deploy_test/truncated", 2, 5, 3);
+    EXPECT_NE(0, deployer.Deploy(".deploy_test/truncated.tar.gz", ""));
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    // Runs all tests using Google Test.
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <gflags/gflags.h>
+#include "src/resman/scheduler.h"
+
+#include <unistd.h>
+#include <boost/foreach.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+DECLARE_int64(sched_interval);
+
+using baidu::galaxy::sched::Agent;
+using baidu::galaxy::sched::DevicePath;
+using baidu::galaxy::sched::Scheduler;
+using baidu::galaxy::sched::TopologyLabels;
+using baidu::galaxy::sched::VolumInfo;
+namespace proto = baidu::galaxy::proto;
+
+// two pools sharing two racks: pool a has host0 in r0 and host2 in r1,
+// pool b has host1 in r0 and host3 in r1
+class TestScheduler : public testing::Test {
+protected:
+    void SetUp() {
+        // rounds may still run after Stop, it is left alive
+        scheduler_ = new Scheduler();
+        const char* pools[] = {"a", "b", "a", "b"};
+        const char* racks[] = {"r0", "r0", "r1", "r1"};
+        for (int i = 0; i < 4; i++) {
+            std::map<DevicePath, VolumInfo> volums;
+            VolumInfo volum;
+            volum.medium = proto::kDisk;
+            volum.size = 1000;
+            volum.exclusive = false;
+            volums["/home"] = volum;
+            TopologyLabels labels;
+            labels["rack"] = racks[i];
+            Agent::Ptr agent(new Agent(Endpoint(i), 10000, 10000, volums,
+                                       std::set<std::string>(), pools[i], labels));
+            proto::AgentInfo agent_info;
+            scheduler_->AddAgent(agent, agent_info);
+        }
+    }
+
+    void TearDown() {
+        scheduler_->Stop();
+    }
+
+    static std::string Endpoint(int i) {
+        char endpoint[32];
+        snprintf(endpoint, sizeof(endpoint), "host%d:1", i);
+        return endpoint;
+    }
+
+    static std::string Rack(const std::string& endpoint) {
+        return endpoint == Endpoint(0) || endpoint == Endpoint(1) ? "r0" : "r1";
+    }
+
+    static proto::ContainerDescription Desc(const std::string& pool_name,
+                                            const std::string& avoided) {
+        proto::ContainerDescription desc;
+        desc.add_pool_names(pool_name);
+        desc.set_version("v1");
+        desc.set_priority(proto::kJobService);
+        desc.mutable_workspace_volum()->set_size(1);
+        desc.mutable_workspace_volum()->set_medium(proto::kDisk);
+        proto::Cgroup* cgroup = desc.add_cgroups();
+        cgroup->mutable_cpu()->set_milli_core(100);
+        cgroup->mutable_memory()->set_size(100);
+        if (!avoided.empty()) {
+            proto::AntiAffinity* anti = desc.add_anti_affinities();
+            anti->set_topology_key("rack");
+            anti->add_container_groups(avoided);
+        }
+        return desc;
+    }
+
+    // racks of the allocated replicas, waits until count of them are there
+    std::set<std::string> Racks(const std::string& container_group_id, int count) {
+        std::set<std::string> racks;
+        for (int i = 0; i < 2000; i++) {
+            std::vector<proto::ContainerStatistics> containers;
+            scheduler_->ShowContainerGroup(container_group_id, containers);
+            racks.clear();
+            int allocated = 0;
+            for (size_t j = 0; j < containers.size(); j++) {
+                if (containers[j].status() == proto::kContainerAllocating) {
+                    racks.insert(Rack(containers[j].endpoint()));
+                    allocated++;
+                }
+            }
+            if (allocated >= count) {
+                break;
+            }
+            usleep(1000);
+        }
+        return racks;
+    }
+
+    Scheduler* scheduler_;
+};
+
+TEST_F(TestScheduler, AvoidedSideKeepsOff) {
+    std::string avoided = scheduler_->Submit("avoided", Desc("b", ""), 0, proto::kJobService, "u");
+    std::string avoiding = scheduler_->Submit("avoiding", Desc("a", avoided), 1,
+                                              proto::kJobService, "u");
+    scheduler_->Start();
+    std::set<std::string> avoiding_racks = Racks(avoiding, 1);
+    ASSERT_EQ(1u, avoiding_racks.size());
+
+    // replicas of the named group, in the other pool, go to the other rack
+    ASSERT_TRUE(scheduler_->ChangeReplica(avoided, 4));
+    std::set<std::string> avoided_racks = Racks(avoided, 4);
+    ASSERT_EQ(1u, avoided_racks.size());
+    EXPECT_NE(*avoiding_racks.begin(), *avoided_racks.begin());
+}
+
+TEST_F(TestScheduler, PlacedAtTheSameTime) {
+    for (int i = 0; i < 50; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "avoided%d", i);
+        std::string avoided = scheduler_->Submit(name, Desc("b", ""), 1, proto::kJobService, "u");
+        snprintf(name, sizeof(name), "avoiding%d", i);
+        std::string avoiding = scheduler_->Submit(name, Desc("a", avoided), 1,
+                                                  proto::kJobService, "u");
+        if (i == 0) {
+            scheduler_->Start();
+        }
+        std::set<std::string> avoiding_racks = Racks(avoiding, 1);
+        std::set<std::string> avoided_racks = Racks(avoided, 1);
+        BOOST_FOREACH(const std::string& rack, avoiding_racks) {
+            EXPECT_EQ(0u, avoided_racks.count(rack)) << name << " shares " << rack;
+        }
+        scheduler_->Kill(avoided);
+        scheduler_->Kill(avoiding);
+    }
+}
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    FLAGS_sched_interval = 1;
+    // Runs all tests using Google Test.
+    return RUN_ALL_TESTS();
+}
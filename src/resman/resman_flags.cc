@@ -11,6 +11,11 @@ DEFINE_int32(container_group_max_replica, 100000, "max replica allowed for one g
 DEFINE_double(safe_mode_percent, 0.85, "when agent alive percent bigger than this, leave safe mode");
 DEFINE_bool(check_container_version, false, "by default, AM will handle that");
 DEFINE_int32(max_batch_pods, 12, "max batch pods per agent");
+DEFINE_double(best_effort_max_memory_pressure, 0.0, "no best-effort container is placed on agents whose memory pressure(some avg10, percent) is above, 0 means no limit");
+DEFINE_int32(disk_volum_max_gc_backlog, 0, "no container with disk volums is placed on agents with more gc dirs overdue, 0 means no limit");
 
 DEFINE_int32(overassign_level, 2, "overassign level: {0, 1, 2, 3}");
 DEFINE_double(reserved_percent, 2.0, "resource reserved percent");
+DEFINE_double(reserved_usage_percentile, 0.95, "percentile of usage history used to derive reserved resource");
+DEFINE_int32(reserved_usage_half_life, 600, "half life of usage history, in seconds");
+DEFINE_int32(reserved_usage_min_samples, 3, "min usage samples before percentile is trusted");
@@ -277,6 +277,12 @@ void ResManImpl::Status(::google::protobuf::RpcController* controller,
     }
     response->set_total_containers(total_containers);
     response->set_total_groups(total_container_groups);
+    std::vector<sched::PoolStatistics> pool_stats;
+    scheduler_->ShowPoolStatistics(pool_stats);
+    std::map<std::string, sched::PoolStatistics> pool_sched;
+    for (size_t i = 0; i < pool_stats.size(); i++) {
+        pool_sched[pool_stats[i].pool_name] = pool_stats[i];
+    }
     std::map<std::string, int64_t >::const_iterator p_it;
     for (p_it = pool_total.begin(); p_it != pool_total.end(); p_it++) {
         const std::string& pool_name = p_it->first;
@@ -284,6 +290,15 @@ void ResManImpl::Status(::google::protobuf::RpcController* controller,
         pool_status->set_total_agents(p_it->second);
         pool_status->set_name(pool_name);
         pool_status->set_alive_agents(pool_alive[pool_name]);
+        const sched::PoolStatistics& sched_stat = pool_sched[pool_name];
+        pool_status->set_container_groups(sched_stat.container_groups);
+        pool_status->set_pending_containers(sched_stat.pending);
+        pool_status->set_sched_rounds(sched_stat.rounds);
+        pool_status->set_sched_placements(sched_stat.placements);
+        pool_status->set_avg_round_time(sched_stat.avg_round_time);
+        pool_status->set_avg_placement_latency(sched_stat.avg_placement_latency);
+        pool_status->set_try_put_cache_hits(sched_stat.try_put_hits);
+        pool_status->set_try_put_cache_misses(sched_stat.try_put_misses);
     }
     response->set_in_safe_mode(safe_mode_);
     VLOG(10) << "cluster status:" << response->DebugString();
@@ -317,27 +332,54 @@ void ResManImpl::QueryAgent(const std::string& agent_endpoint, bool is_first_que
     boost::scoped_ptr<proto::Agent_Stub> stub_guard(stub);
     boost::function<void (const proto::QueryRequest*, 
                           proto::QueryResponse*, bool, int)> callback;
+    boost::shared_ptr<proto::QueryResponse> response = agent.query_response;
+    agent.query_response.reset(); //owned by this poll until it comes back
+    if (!response) {
+        response.reset(new proto::QueryResponse());
+    }
     callback = boost::bind(&ResManImpl::QueryAgentCallback, this, 
-                           agent_endpoint, is_first_query,
+                           agent_endpoint, is_first_query, response,
                            _1, _2, _3, _4);
     proto::QueryRequest* request = new proto::QueryRequest();
     request->set_full_report(is_first_query);
-    proto::QueryResponse* response = new proto::QueryResponse();
     rpc_client_.AsyncRequest(stub, &proto::Agent_Stub::Query,
-                             request, response, callback, 5, 1);
+                             request, response.get(), callback, 5, 1);
     VLOG(10) << "send query command to:" << agent_endpoint;
 }
 
 void ResManImpl::QueryAgentCallback(std::string agent_endpoint,
                                     bool is_first_query,
+                                    boost::shared_ptr<proto::QueryResponse> response_holder,
                                     const proto::QueryRequest* request,
                                     proto::QueryResponse* response,
                                     bool rpc_fail, int err) {
     boost::scoped_ptr<const proto::QueryRequest> request_guard(request);
-    boost::scoped_ptr<proto::QueryResponse> response_guard(response);
     if (response->code().status() != proto::kOk || rpc_fail) {
         LOG(WARNING) << "failed to query on: " << agent_endpoint
                      << " err: " << err << ", rpc_fail:" << rpc_fail;
+        {
+            MutexLock lock(&mu_);
+            std::map<std::string, AgentStat>::iterator it = agent_stats_.find(agent_endpoint);
+            if (it != agent_stats_.end()) {
+                it->second.query_response = response_holder;
+            }
+        }
+        query_pool_.DelayTask(FLAGS_agent_query_interval * 1000,
+            boost::bind(&ResManImpl::QueryAgent, this, agent_endpoint, is_first_query)
+        );
+        return;
+    }
+    if (response->agent_info().reloading()) {
+        // containers reported are partial until the agent finishes reloading,
+        // it is neither added nor commanded before that
+        LOG(INFO) << "agent is reloading containers: " << agent_endpoint;
+        {
+            MutexLock lock(&mu_);
+            std::map<std::string, AgentStat>::iterator it = agent_stats_.find(agent_endpoint);
+            if (it != agent_stats_.end()) {
+                it->second.query_response = response_holder;
+            }
+        }
         query_pool_.DelayTask(FLAGS_agent_query_interval * 1000,
             boost::bind(&ResManImpl::QueryAgent, this, agent_endpoint, is_first_query)
         );
@@ -364,12 +406,17 @@ void ResManImpl::QueryAgentCallback(std::string agent_endpoint,
         }
         const std::set<std::string>& tags = agent_tags_[agent_endpoint];
         std::string pool_name = agent_meta.pool();
+        sched::TopologyLabels labels;
+        for (int i = 0; i < agent_meta.topology_size(); i++) {
+            labels[agent_meta.topology(i).key()] = agent_meta.topology(i).value();
+        }
         sched::Agent::Ptr agent(new sched::Agent(agent_endpoint,
                                                  cpu,
                                                  memory,
                                                  volums,
                                                  tags,
-                                                 pool_name));
+                                                 pool_name,
+                                                 labels));
         scheduler_->RemoveAgent(agent_endpoint);
         scheduler_->AddAgent(agent, agent_info);
         LOG(INFO) << "TRACE BEGIN, first query result from:" << agent_endpoint
@@ -392,7 +439,10 @@ void ResManImpl::QueryAgentCallback(std::string agent_endpoint,
             LOG(INFO) << "this agent may be removed, no need to query again";
             return;
         }
-        agent_stats_[agent_endpoint].info = response->agent_info();
+        AgentStat& agent_stat = agent_stats_[agent_endpoint];
+        // keep the fresh info, the stale one goes back to be parsed into next time
+        agent_stat.info.Swap(response->mutable_agent_info());
+        agent_stat.query_response = response_holder;
         if (!force_safe_mode_ &&
             safe_mode_ &&
             agent_stats_.size() > (double)agents_.size() * FLAGS_safe_mode_percent) {
@@ -427,7 +477,9 @@ void ResManImpl::SendCommandsToAgent(const std::string& agent_endpoint,
             proto::CreateContainerResponse* response = new proto::CreateContainerResponse();
             request->set_id(cmd.container_id);
             request->set_container_group_id(cmd.container_group_id);
-            request->mutable_container()->CopyFrom(cmd.desc);
+            proto::ContainerDescription* container_desc = request->mutable_container();
+            container_desc->CopyFrom(*cmd.desc);
+            sched::Scheduler::SetVolumsAndPorts(cmd, *container_desc);
             boost::function<void (const proto::CreateContainerRequest*,
                                   proto::CreateContainerResponse*,
                                   bool, int)> callback;
@@ -875,6 +927,7 @@ void ResManImpl::ListAgents(::google::protobuf::RpcController* controller,
         proto::AgentStatistics* agent_st = response->add_agents();
         agent_st->set_endpoint(endpoint);
         agent_st->set_pool(agent_meta.pool());
+        agent_st->mutable_topology()->CopyFrom(agent_meta.topology());
         const std::set<std::string>& tags = agent_tags_[endpoint];
         for (std::set<std::string>::iterator tag_it = tags.begin();
              tag_it != tags.end(); tag_it++) {
@@ -1003,6 +1056,7 @@ void ResManImpl::ListAgentsByTag(::google::protobuf::RpcController* controller,
         proto::AgentStatistics* agent_st = response->add_agents();
         agent_st->set_endpoint(endpoint);
         agent_st->set_pool(agent_meta.pool());
+        agent_st->mutable_topology()->CopyFrom(agent_meta.topology());
         const std::set<std::string>& tags = agent_tags_[endpoint];
         for (std::set<std::string>::iterator tag_it = tags.begin();
             tag_it != tags.end(); tag_it++) {
@@ -1085,6 +1139,52 @@ void ResManImpl::AddAgentToPool(::google::protobuf::RpcController* controller,
     done->Run();
 }
 
+void ResManImpl::SetAgentTopology(::google::protobuf::RpcController* controller,
+                                  const ::baidu::galaxy::proto::SetAgentTopologyRequest* request,
+                                  ::baidu::galaxy::proto::SetAgentTopologyResponse* response,
+                                  ::google::protobuf::Closure* done) {
+    const std::string& endpoint = request->endpoint();
+    sched::TopologyLabels labels;
+    for (int i = 0; i < request->topology_size(); i++) {
+        const proto::TopologyLabel& label = request->topology(i);
+        if (label.key().empty() || label.value().empty()
+            || label.key() == sched::Topology::kHostKey) {
+            response->mutable_error_code()->set_status(proto::kError);
+            response->mutable_error_code()->set_reason("invalid topology label: " + label.key());
+            done->Run();
+            return;
+        }
+        labels[label.key()] = label.value();
+    }
+    MutexLock topology_lock(&topology_mu_);
+    proto::AgentMeta agent_meta;
+    {
+        MutexLock lock(&mu_);
+        std::map<std::string, proto::AgentMeta>::iterator it = agents_.find(endpoint);
+        if (it == agents_.end()) {
+            response->mutable_error_code()->set_status(proto::kError);
+            response->mutable_error_code()->set_reason("agent not exist");
+            done->Run();
+            return;
+        }
+        agent_meta = it->second;
+    }
+    agent_meta.mutable_topology()->CopyFrom(request->topology());
+    bool ret = SaveObject(sAgentPrefix + "/" + endpoint, agent_meta);
+    if (!ret) {
+        response->mutable_error_code()->set_status(proto::kError);
+        response->mutable_error_code()->set_reason("fail to save agent meta to nexus");
+    } else {
+        {
+            MutexLock lock(&mu_);
+            agents_[endpoint].mutable_topology()->CopyFrom(request->topology());
+        }
+        scheduler_->SetTopology(endpoint, labels);
+        response->mutable_error_code()->set_status(proto::kOk);
+    }
+    done->Run();
+}
+
 void ResManImpl::RemoveAgentFromPool(::google::protobuf::RpcController* controller,
                                      const ::baidu::galaxy::proto::RemoveAgentFromPoolRequest* request,
                                      ::baidu::galaxy::proto::RemoveAgentFromPoolResponse* response,
@@ -1112,6 +1212,7 @@ void ResManImpl::ListAgentsByPool(::google::protobuf::RpcController* controller,
         proto::AgentStatistics* agent_st = response->add_agents();
         agent_st->set_endpoint(endpoint);
         agent_st->set_pool(agent_meta.pool());
+        agent_st->mutable_topology()->CopyFrom(agent_meta.topology());
         const std::set<std::string>& tags = agent_tags_[endpoint];
         for (std::set<std::string>::iterator tag_it = tags.begin();
             tag_it != tags.end(); tag_it++) {
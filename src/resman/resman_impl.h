@@ -25,6 +25,9 @@ struct AgentStat {
     proto::AgentStatus status;
     proto::AgentInfo info;
     int32_t last_heartbeat_time; //timestamp in seconds
+    // response of the last poll, parsed into again by the next one
+    // so that the nested messages are recycled instead of reallocated
+    boost::shared_ptr<proto::QueryResponse> query_response;
 };
 
 class ResManImpl : public baidu::galaxy::proto::ResMan {
@@ -113,6 +116,10 @@ public:
                          const ::baidu::galaxy::proto::AddAgentToPoolRequest* request,
                          ::baidu::galaxy::proto::AddAgentToPoolResponse* response,
                          ::google::protobuf::Closure* done);
+    void SetAgentTopology(::google::protobuf::RpcController* controller,
+                          const ::baidu::galaxy::proto::SetAgentTopologyRequest* request,
+                          ::baidu::galaxy::proto::SetAgentTopologyResponse* response,
+                          ::google::protobuf::Closure* done);
     void RemoveAgentFromPool(::google::protobuf::RpcController* controller,
                          const ::baidu::galaxy::proto::RemoveAgentFromPoolRequest* request,
                          ::baidu::galaxy::proto::RemoveAgentFromPoolResponse* response,
@@ -158,6 +165,7 @@ private:
     void QueryAgent(const std::string& agent_endpoint, bool is_first_query);
     void QueryAgentCallback(std::string agent_endpoint,
                             bool is_first_query,
+                            boost::shared_ptr<proto::QueryResponse> response_holder,
                             const proto::QueryRequest* request,
                             proto::QueryResponse* response,
                             bool fail , int err);
@@ -215,6 +223,8 @@ private:
     std::map<std::string, std::set<std::string> > users_can_remove_;
     std::map<std::string, std::set<std::string> >  users_can_list_;
     Mutex mu_;
+    // orders topology changes of agents, the scheduler is called out of mu_
+    Mutex topology_mu_;
     bool safe_mode_;
     bool force_safe_mode_;
     ThreadPool query_pool_;
@@ -12,6 +12,7 @@
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
+#include <boost/unordered_map.hpp>
 #include <glog/logging.h>
 #include <gflags/gflags.h>
 #include "timer.h"
@@ -21,6 +22,11 @@ DECLARE_int64(container_group_gc_check_interval);
 DECLARE_bool(check_container_version);
 DECLARE_int32(max_batch_pods);
 DECLARE_double(reserved_percent);
+DECLARE_double(reserved_usage_percentile);
+DECLARE_int32(reserved_usage_half_life);
+DECLARE_int32(reserved_usage_min_samples);
+DECLARE_double(best_effort_max_memory_pressure);
+DECLARE_int32(disk_volum_max_gc_backlog);
 
 namespace baidu {
 namespace galaxy {
@@ -35,7 +41,8 @@ Agent::Agent(const AgentEndpoint& endpoint,
             int64_t memory,
             const std::map<DevicePath, VolumInfo>& volums,
             const std::set<std::string>& tags,
-            const std::string& pool_name) {
+            const std::string& pool_name,
+            const TopologyLabels& labels) {
     endpoint_ = endpoint;
     cpu_total_ = cpu;
     cpu_assigned_ = 0;
@@ -51,7 +58,17 @@ Agent::Agent(const AgentEndpoint& endpoint,
     port_total_ = sMaxPort - sMinPort + 1;
     tags_ = tags;
     pool_name_ = pool_name;
+    labels_ = labels;
+    generation_ = 0;
+    try_put_generation_ = -1;
+    try_put_hits_ = 0;
+    try_put_misses_ = 0;
+    labels_[Topology::kHostKey] = endpoint;
     batch_container_count_ = 0;
+    memory_pressure_ = 0.0;
+    memory_pressured_ = false;
+    gc_backlog_ = 0;
+    gc_backlogged_ = false;
 }
 
 ContainerGroupId Agent::ExtractGroupId(const ContainerId& container_id) {
@@ -67,6 +84,12 @@ void Agent::SetAssignment(int64_t cpu_assigned,
                           const std::map<DevicePath, VolumInfo>& volum_assigned,
                           const std::set<std::string> port_assigned,
                           const std::map<ContainerId, Container::Ptr>& containers) {
+    generation_++;
+    if (topology_) {
+        BOOST_FOREACH(const ContainerMap::value_type& pair, containers_) {
+            topology_->Unplace(pair.second->container_group_id, labels_);
+        }
+    }
     cpu_assigned_ = cpu_assigned;
     cpu_deep_assigned_ = cpu_deep_assigned;
     memory_assigned_ = memory_assigned;
@@ -80,6 +103,9 @@ void Agent::SetAssignment(int64_t cpu_assigned,
     BOOST_FOREACH(const ContainerMap::value_type& pair, containers) {
         const Container::Ptr& container = pair.second;
         container_counts_[container->container_group_id] += 1;
+        if (topology_) {
+            topology_->Place(container->container_group_id, labels_);
+        }
         container->allocated_agent = endpoint_;
         VLOG(10) << "agent: " << endpoint_ << " has container: " << container->id
                  << " with type: " << proto::ContainerType_Name(container->require->container_type);
@@ -117,9 +143,75 @@ void Agent::SetReserved(int64_t cpu_reserved,
     cpu_deep_reserved_ = cpu_deep_reserved;
     memory_reserved_ = memory_reserved;
     memory_deep_reserved_ = memory_deep_reserved;
+    generation_++;
+}
+
+void Agent::SetPressure(const proto::HostMetrix& host_metrix) {
+    memory_pressure_ = host_metrix.memory_pressure().some_avg10();
+    bool pressured = FLAGS_best_effort_max_memory_pressure > 0.0
+                     && memory_pressure_ > FLAGS_best_effort_max_memory_pressure;
+    if (pressured != memory_pressured_) {
+        LOG(INFO) << "agent " << endpoint_ << (pressured ? " enters" : " leaves")
+                  << " memory pressure: " << memory_pressure_;
+        memory_pressured_ = pressured;
+        generation_++;
+    }
+}
+
+void Agent::SetGcBacklog(const proto::GcMetrix& gc_metrix) {
+    gc_backlog_ = gc_metrix.backlog();
+    bool backlogged = FLAGS_disk_volum_max_gc_backlog > 0
+                      && gc_backlog_ > FLAGS_disk_volum_max_gc_backlog;
+    if (backlogged != gc_backlogged_) {
+        LOG(INFO) << "agent " << endpoint_ << (backlogged ? " enters" : " leaves")
+                  << " gc backlog: " << gc_backlog_;
+        gc_backlogged_ = backlogged;
+        generation_++;
+    }
 }
 
 bool Agent::TryPut(const Container* container, ResourceError& err) {
+    // checks only depending on the shape of requirement and this agent
+    // are remembered until the agent changes
+    if (try_put_generation_ != generation_) {
+        try_put_cache_.clear();
+        try_put_generation_ = generation_;
+    }
+    std::string key = container->require->fingerprint;
+    key += (char)container->priority;
+    boost::unordered_map<std::string, ResourceError>::iterator cache_it = try_put_cache_.find(key);
+    if (cache_it != try_put_cache_.end()) {
+        try_put_hits_++;
+        err = cache_it->second;
+    } else {
+        try_put_misses_++;
+        err = proto::kResOk;
+        TryPutShape(container, err);
+        try_put_cache_[key] = err;
+    }
+    if (err != proto::kResOk) {
+        return false;
+    }
+
+    if (container->require->max_per_host > 0) {
+        ContainerGroupId container_group_id = container->container_group_id;
+        std::map<ContainerGroupId, int>::iterator it = container_counts_.find(container_group_id);
+        if (it != container_counts_.end()) {
+            int cur_counts = it->second;
+            if (cur_counts >= container->require->max_per_host) {
+                err = proto::kTooManyPods;
+                return false;
+            }
+        }
+    }
+
+    if (topology_ && !topology_->Check(container, labels_, err)) {
+        return false;
+    }
+    return true;
+}
+
+bool Agent::TryPutShape(const Container* container, ResourceError& err) {
     LOG(INFO)
         << "### TryPut, agent: " << endpoint_
         << ", container: " << container->id
@@ -138,18 +230,6 @@ bool Agent::TryPut(const Container* container, ResourceError& err) {
         return false;
     }
 
-    if (container->require->max_per_host > 0) {
-        ContainerGroupId container_group_id = container->container_group_id;
-        std::map<ContainerGroupId, int>::iterator it = container_counts_.find(container_group_id);
-        if (it != container_counts_.end()) {
-            int cur_counts = it->second;
-            if (cur_counts >= container->require->max_per_host) {
-                err = proto::kTooManyPods;
-                return false;
-            }
-        }
-    }
-
     if (container->priority != proto::kJobBestEffort) {
         if (container->require->CpuNeed() + cpu_assigned_ > cpu_total_) {
             err = proto::kNoCpu;
@@ -160,6 +240,11 @@ bool Agent::TryPut(const Container* container, ResourceError& err) {
             return false;
         }
     } else {
+        // best-effort containers would be the first to stall and be evicted
+        if (memory_pressured_) {
+            err = proto::kMemoryPressure;
+            return false;
+        }
         if (cpu_reserved_ + cpu_deep_assigned_ + container->require->CpuNeed() > cpu_total_) {
             err = proto::kNoCpu;
             return false;
@@ -194,6 +279,12 @@ bool Agent::TryPut(const Container* container, ResourceError& err) {
         }
     }
 
+    // disks of the agent are busy removing volums of destroyed containers
+    if (gc_backlogged_ && !volums_no_ramdisk.empty()) {
+        err = proto::kGcBacklog;
+        return false;
+    }
+
     std::vector<DevicePath> devices;
     if (!SelectDevices(volums_no_ramdisk, devices)) {
         err = proto::kNoDevice;
@@ -232,6 +323,7 @@ bool Agent::TryPut(const Container* container, ResourceError& err) {
 void Agent::Put(Container::Ptr container) {
     assert(container->status == kContainerPending);
     assert(container->allocated_agent.empty());
+    generation_++;
     if (container->priority != proto::kJobBestEffort) {
         //cpu
         cpu_assigned_ += container->require->CpuNeed();
@@ -285,6 +377,9 @@ void Agent::Put(Container::Ptr container) {
     container->last_res_err = proto::kResOk;
     containers_[container->id] = container;
     container_counts_[container->container_group_id] += 1;
+    if (topology_) {
+        topology_->Place(container->container_group_id, labels_);
+    }
 
     if (container->require->container_type == proto::kVolumContainer) {
         volum_jobs_free_[container->container_group_id].insert(container->id);
@@ -414,6 +509,7 @@ void Agent::Evict(Container::Ptr container) {
         LOG(WARNING) << "invalid evict, no such container:" << container->id;
         return;
     }
+    generation_++;
     if (container->priority != proto::kJobBestEffort) {
         //cpu
         cpu_assigned_ -= container->require->CpuNeed();
@@ -457,6 +553,9 @@ void Agent::Evict(Container::Ptr container) {
     if (container_counts_[container->container_group_id] <= 0) {
         container_counts_.erase(container->container_group_id);
     }
+    if (topology_) {
+        topology_->Unplace(container->container_group_id, labels_);
+    }
     if (container->require->container_type == proto::kVolumContainer) {
         volum_jobs_free_[container->container_group_id].erase(container->id);
         if (volum_jobs_free_[container->container_group_id].empty()) {
@@ -544,7 +643,137 @@ bool Agent::RecurSelectDevices(size_t i, const std::vector<proto::VolumRequired>
 }
 
 
-Scheduler::Scheduler() : stop_(true) {
+// taken by rpc and gc: the scheduler mutex and every partition in the lock
+// order, as what rounds of the partitions read changes only under all of them
+class Scheduler::GlobalLock {
+public:
+    explicit GlobalLock(Scheduler* scheduler) : scheduler_(scheduler) {
+        scheduler_->mu_.Lock();
+        scheduler_->coordinator_->mu.Lock();
+        std::map<std::string, PoolPartition::Ptr>::iterator it;
+        for (it = scheduler_->partitions_.begin(); it != scheduler_->partitions_.end(); it++) {
+            it->second->mu.Lock();
+            scheduler_->held_partitions_.push_back(it->second);
+        }
+    }
+    ~GlobalLock() {
+        std::vector<PoolPartition::Ptr>& held = scheduler_->held_partitions_;
+        for (size_t i = held.size(); i > 0; i--) {
+            held[i - 1]->mu.Unlock();
+        }
+        held.clear();
+        scheduler_->coordinator_->mu.Unlock();
+        scheduler_->mu_.Unlock();
+    }
+private:
+    Scheduler* scheduler_;
+};
+
+// taken for one agent by its queries and rpc: the partition of the agent's
+// pool, with owners of groups having containers on it if they are to be
+// changed, in the lock order, so rounds of the other pools go on. Owners
+// and the pool may change before all is held, then it is taken again.
+// With no such agent, mu_ is held instead, agent is NULL then
+class Scheduler::AgentLock {
+public:
+    AgentLock(Scheduler* scheduler, const AgentEndpoint& endpoint, bool with_owners)
+        : scheduler_(scheduler), mu_held_(false) {
+        for (;;) {
+            PoolPartition::Ptr pool;
+            scheduler_->mu_.Lock();
+            std::map<AgentEndpoint, Agent::Ptr>::iterator it = scheduler_->agents_.find(endpoint);
+            if (it == scheduler_->agents_.end()) {
+                mu_held_ = true;
+                return;
+            }
+            pool = scheduler_->partitions_.find(it->second->pool_name_)->second;
+            scheduler_->mu_.Unlock();
+
+            bool coordinate = false;
+            std::map<std::string, PoolPartition::Ptr> partitions;
+            {
+                MutexLock pool_lock(&pool->mu);
+                if (!Collect(pool, endpoint, with_owners, coordinate, partitions)) {
+                    continue;
+                }
+            }
+            if (coordinate) {
+                scheduler_->coordinator_->mu.Lock();
+                held_.push_back(&scheduler_->coordinator_->mu);
+            }
+            std::map<std::string, PoolPartition::Ptr>::iterator jt;
+            for (jt = partitions.begin(); jt != partitions.end(); jt++) {
+                jt->second->mu.Lock();
+                held_.push_back(&jt->second->mu);
+            }
+            bool coordinate_now = false;
+            std::map<std::string, PoolPartition::Ptr> partitions_now;
+            if (Collect(pool, endpoint, with_owners, coordinate_now, partitions_now)
+                && (coordinate || !coordinate_now)) {
+                bool covered = true;
+                for (jt = partitions_now.begin(); jt != partitions_now.end(); jt++) {
+                    if (partitions.find(jt->first) == partitions.end()) {
+                        covered = false;
+                        break;
+                    }
+                }
+                if (covered) {
+                    agent = scheduler_->agents_[endpoint];
+                    return;
+                }
+            }
+            Release();
+        }
+    }
+    ~AgentLock() {
+        Release();
+        if (mu_held_) {
+            scheduler_->mu_.Unlock();
+        }
+    }
+    Agent::Ptr agent;
+private:
+    // partitions to hold for the agent, false if it left the pool
+    bool Collect(PoolPartition::Ptr pool, const AgentEndpoint& endpoint, bool with_owners,
+                 bool& coordinate, std::map<std::string, PoolPartition::Ptr>& partitions) {
+        pool->mu.AssertHeld();
+        std::map<AgentEndpoint, Agent::Ptr>::iterator it = scheduler_->agents_.find(endpoint);
+        if (it == scheduler_->agents_.end() || it->second->pool_name_ != pool->pool_name) {
+            return false;
+        }
+        partitions[pool->pool_name] = pool;
+        if (!with_owners) {
+            return true;
+        }
+        BOOST_FOREACH(ContainerMap::value_type& pair, it->second->containers_) {
+            std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator group_it;
+            group_it = scheduler_->container_groups_.find(pair.second->container_group_id);
+            if (group_it == scheduler_->container_groups_.end()) {
+                continue;
+            }
+            PoolPartition::Ptr owner = scheduler_->Owner(group_it->second);
+            if (owner == scheduler_->coordinator_) {
+                coordinate = true;
+            } else {
+                partitions[owner->pool_name] = owner;
+            }
+        }
+        return true;
+    }
+    void Release() {
+        for (size_t i = held_.size(); i > 0; i--) {
+            held_[i - 1]->Unlock();
+        }
+        held_.clear();
+    }
+    Scheduler* scheduler_;
+    bool mu_held_;
+    std::vector<Mutex*> held_;
+};
+
+Scheduler::Scheduler() : coordinator_(new PoolPartition()),
+                         topology_(new Topology()),
+                         stop_(true) {
     srand(time(NULL));
 }
 
@@ -574,10 +803,48 @@ void Scheduler::SetRequirement(Requirement::Ptr require,
         require->volum_jobs.push_back(container_desc.volum_jobs(j));
     }
     require->container_type = container_desc.container_type();
+    for (int j = 0; j < container_desc.spreads_size(); j++) {
+        require->spreads.push_back(container_desc.spreads(j));
+    }
+    for (int j = 0; j < container_desc.anti_affinities_size(); j++) {
+        require->anti_affinities.push_back(container_desc.anti_affinities(j));
+    }
+    require->fingerprint = require->Fingerprint();
+}
+
+void Scheduler::UpdateReserved(Container::Ptr container,
+                               int64_t cpu_used, int64_t memory_used) {
+    int64_t now = common::timer::get_micros();
+    int64_t half_life = static_cast<int64_t>(FLAGS_reserved_usage_half_life) * 1000000L;
+    int64_t cpu_need = container->require->CpuNeed();
+    int64_t memory_need = container->require->MemoryNeed();
+    // count the reports that went over what we reserved last time
+    if (container->cpu_reserved > 0 && cpu_used > container->cpu_reserved) {
+        container->cpu_reserve_exceeded++;
+    }
+    if (container->memory_reserved > 0 && memory_used > container->memory_reserved) {
+        container->memory_reserve_exceeded++;
+    }
+    container->cpu_usage.Add(cpu_used, cpu_need, now, half_life);
+    container->memory_usage.Add(memory_used, memory_need, now, half_life);
+    int64_t cpu_base = container->cpu_usage.Percentile(FLAGS_reserved_usage_percentile,
+                                                       FLAGS_reserved_usage_min_samples);
+    int64_t memory_base = container->memory_usage.Percentile(FLAGS_reserved_usage_percentile,
+                                                             FLAGS_reserved_usage_min_samples);
+    if (cpu_base < 0) {
+        cpu_base = cpu_used; // not enough history yet
+    }
+    if (memory_base < 0) {
+        memory_base = memory_used;
+    }
+    container->cpu_reserved = std::min(
+        static_cast<int64_t>(cpu_base * FLAGS_reserved_percent), cpu_need);
+    container->memory_reserved = std::min(
+        static_cast<int64_t>(memory_base * FLAGS_reserved_percent), memory_need);
 }
 
 void Scheduler::AddAgent(Agent::Ptr agent, const proto::AgentInfo& agent_info) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
 
     int64_t cpu_assigned = 0;
     int64_t cpu_reserved = 0;
@@ -634,24 +901,17 @@ void Scheduler::AddAgent(Agent::Ptr agent, const proto::AgentInfo& agent_info) {
         container->priority = container_desc.priority();
         container->status = container_info.status();
         container->require = require;
+        UpdateReserved(container, container_info.cpu_used(), container_info.memory_used());
         if (container->priority != proto::kJobBestEffort) {
             cpu_assigned += require->CpuNeed();
-            cpu_reserved += std::min(
-                static_cast<int64_t>(container_info.cpu_used() * FLAGS_reserved_percent),
-                require->CpuNeed());
+            cpu_reserved += container->cpu_reserved;
             memory_assigned += require->MemoryNeed();
-            memory_reserved += std::min(
-                static_cast<int64_t>(container_info.memory_used() * FLAGS_reserved_percent),
-                require->MemoryNeed());
+            memory_reserved += container->memory_reserved;
         } else {
             cpu_deep_assigned += require->CpuNeed();
-            cpu_deep_reserved += std::min(
-                static_cast<int64_t>(container_info.cpu_used() * FLAGS_reserved_percent),
-                require->CpuNeed());
+            cpu_deep_reserved += container->cpu_reserved;
             memory_deep_assigned += require->MemoryNeed();
-            memory_deep_reserved += std::min(
-                static_cast<int64_t>(container_info.memory_used() * FLAGS_reserved_percent),
-                require->MemoryNeed());
+            memory_deep_reserved += container->memory_reserved;
         }
         for (int j = 0; j < container_desc.cgroups_size(); j++) {
             const proto::Cgroup& cgroup = container_desc.cgroups(j);
@@ -708,6 +968,9 @@ void Scheduler::AddAgent(Agent::Ptr agent, const proto::AgentInfo& agent_info) {
         container->allocated_agent = agent->endpoint_;
         ChangeStatus(container, container->status);
     }
+    agent->topology_ = topology_;
+    topology_->AddAgent(agent->pool_name_, agent->labels_);
+    GetPartition(agent->pool_name_)->agents.insert(agent->endpoint_);
     agent->SetAssignment(
         cpu_assigned, cpu_deep_assigned,
         memory_assigned, memory_deep_assigned,
@@ -716,11 +979,13 @@ void Scheduler::AddAgent(Agent::Ptr agent, const proto::AgentInfo& agent_info) {
         containers);
     agent->SetReserved(cpu_reserved, cpu_deep_reserved,
                        memory_reserved, memory_deep_reserved);
+    agent->SetPressure(agent_info.host_metrix());
+    agent->SetGcBacklog(agent_info.gc_metrix());
     agents_[agent->endpoint_] = agent;
 }
 
 void Scheduler::RemoveAgent(const AgentEndpoint& endpoint) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     std::map<AgentEndpoint, Agent::Ptr>::iterator it;
     it = agents_.find(endpoint);
     if (it == agents_.end()) {
@@ -743,40 +1008,68 @@ void Scheduler::RemoveAgent(const AgentEndpoint& endpoint) {
             }
         }
     }
+    topology_->RemoveAgent(agent->pool_name_, agent->labels_);
+    GetPartition(agent->pool_name_)->agents.erase(endpoint);
     agents_.erase(endpoint);
 }
 
 void Scheduler::AddTag(const AgentEndpoint& endpoint, const std::string& tag) {
-    MutexLock locker(&mu_);
-    std::map<AgentEndpoint, Agent::Ptr>::iterator it = agents_.find(endpoint);
-    if (it == agents_.end()) {
+    AgentLock locker(this, endpoint, false);
+    if (!locker.agent) {
         LOG(WARNING) << "add tag fail, no such agent:" << endpoint;
         return;
     }
-    Agent::Ptr agent = it->second;
+    Agent::Ptr agent = locker.agent;
     agent->tags_.insert(tag);
+    agent->generation_++;
 }
 
 void Scheduler::RemoveTag(const AgentEndpoint& endpoint, const std::string& tag) {
-    MutexLock locker(&mu_);
-    std::map<AgentEndpoint, Agent::Ptr>::iterator it = agents_.find(endpoint);
-    if (it == agents_.end()) {
+    AgentLock locker(this, endpoint, false);
+    if (!locker.agent) {
         LOG(WARNING) << "remove tag fail, no such agent:" << endpoint;
         return;
     }
-    Agent::Ptr agent = it->second;
+    Agent::Ptr agent = locker.agent;
     agent->tags_.erase(tag);
+    agent->generation_++;
 }
 
 void Scheduler::SetPool(const AgentEndpoint& endpoint, const std::string& pool_name) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     std::map<AgentEndpoint, Agent::Ptr>::iterator it = agents_.find(endpoint);
     if (it == agents_.end()) {
         LOG(WARNING) << "set pool fail, no such agent:" << endpoint;
         return;
     }
     Agent::Ptr agent = it->second;
+    topology_->RemoveAgent(agent->pool_name_, agent->labels_);
+    GetPartition(agent->pool_name_)->agents.erase(endpoint);
     agent->pool_name_ = pool_name;
+    agent->generation_++;
+    topology_->AddAgent(agent->pool_name_, agent->labels_);
+    GetPartition(agent->pool_name_)->agents.insert(endpoint);
+}
+
+void Scheduler::SetTopology(const AgentEndpoint& endpoint, const TopologyLabels& labels) {
+    AgentLock locker(this, endpoint, false);
+    if (!locker.agent) {
+        LOG(WARNING) << "set topology fail, no such agent:" << endpoint;
+        return;
+    }
+    Agent::Ptr agent = locker.agent;
+    // move the replicas already on this agent to the new domains
+    BOOST_FOREACH(ContainerMap::value_type& pair, agent->containers_) {
+        topology_->Unplace(pair.second->container_group_id, agent->labels_);
+    }
+    topology_->RemoveAgent(agent->pool_name_, agent->labels_);
+    agent->labels_ = labels;
+    agent->labels_[Topology::kHostKey] = endpoint;
+    agent->generation_++;
+    topology_->AddAgent(agent->pool_name_, agent->labels_);
+    BOOST_FOREACH(ContainerMap::value_type& pair, agent->containers_) {
+        topology_->Place(pair.second->container_group_id, agent->labels_);
+    }
 }
 
 ContainerGroupId Scheduler::GenerateContainerGroupId(const std::string& container_group_name) {
@@ -814,7 +1107,7 @@ ContainerGroupId Scheduler::Submit(const std::string& container_group_name,
                                    const proto::ContainerDescription& container_desc,
                                    int replica, int priority,
                                    const std::string& user_name) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     ContainerGroupId container_group_id = GenerateContainerGroupId(container_group_name);
     if (container_groups_.find(container_group_id) != container_groups_.end()) {
         LOG(WARNING) << "container_group id conflict:" << container_group_id;
@@ -826,11 +1119,13 @@ ContainerGroupId Scheduler::Submit(const std::string& container_group_name,
     container_group->require = req;
     container_group->id = container_group_id;
     container_group->priority = priority;
-    container_group->container_desc = container_desc;
+    container_group->container_desc.reset(new proto::ContainerDescription(container_desc));
     container_group->replica = replica;
     container_group->name = container_group_name;
     container_group->user_name = user_name;
     container_group->submit_time = common::timer::get_micros();
+    container_groups_[container_group_id] = container_group;
+    EnqueueContainerGroup(container_group);
     for (int i = 0 ; i < replica; i++) {
         Container::Ptr container(new Container());
         container->container_group_id = container_group->id;
@@ -840,13 +1135,11 @@ ContainerGroupId Scheduler::Submit(const std::string& container_group_name,
         container_group->containers[container->id] = container;
         ChangeStatus(container_group, container, kContainerPending);
     }
-    container_groups_[container_group_id] = container_group;
-    container_group_queue_.insert(container_group);
     return container_group->id;
 }
 
 void Scheduler::Reload(const proto::ContainerGroupMeta& container_group_meta) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     Requirement::Ptr req(new Requirement());
     ContainerGroup::Ptr container_group(new ContainerGroup());
     VLOG(10) << "reload desc:" << container_group_meta.desc().DebugString();
@@ -856,7 +1149,7 @@ void Scheduler::Reload(const proto::ContainerGroupMeta& container_group_meta) {
     container_group->priority = container_group_meta.desc().priority();
     container_group->replica = container_group_meta.replica();
     container_group->update_interval = container_group_meta.update_interval();
-    container_group->container_desc = container_group_meta.desc();
+    container_group->container_desc.reset(new proto::ContainerDescription(container_group_meta.desc()));
     container_group->name = container_group_meta.name();
     container_group->user_name = container_group_meta.user_name();
     container_group->submit_time = container_group_meta.submit_time();
@@ -868,11 +1161,11 @@ void Scheduler::Reload(const proto::ContainerGroupMeta& container_group_meta) {
     }
 
     container_groups_[container_group->id] = container_group;
-    container_group_queue_.insert(container_group);
+    EnqueueContainerGroup(container_group);
 }
 
 bool Scheduler::Kill(const ContainerGroupId& container_group_id) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
         LOG(WARNING) << "unkonw container_group id: " << container_group_id;
@@ -893,7 +1186,7 @@ bool Scheduler::Kill(const ContainerGroupId& container_group_id) {
 }
 
 void Scheduler::CheckContainerGroupGC(ContainerGroup::Ptr container_group) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     assert(container_group->terminated);
     bool all_container_terminated = true;
     BOOST_FOREACH(ContainerMap::value_type& pair, container_group->containers) {
@@ -905,7 +1198,7 @@ void Scheduler::CheckContainerGroupGC(ContainerGroup::Ptr container_group) {
     }
     if (all_container_terminated) {
         container_groups_.erase(container_group->id);
-        container_group_queue_.erase(container_group);
+        DequeueContainerGroup(container_group);
         //after this, all containers wish to be deleted
     } else {
         gc_pool_.DelayTask(FLAGS_container_group_gc_check_interval,
@@ -914,7 +1207,7 @@ void Scheduler::CheckContainerGroupGC(ContainerGroup::Ptr container_group) {
 }
 
 bool Scheduler::ChangeReplica(const ContainerGroupId& container_group_id, int replica) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
         LOG(WARNING) << "unkonw container_group id: " << container_group_id;
@@ -996,7 +1289,7 @@ void Scheduler::ScaleUp(ContainerGroup::Ptr container_group, int replica) {
 bool Scheduler::ChangeStatus(const ContainerGroupId& container_group_id,
                              const ContainerId& container_id,
                              ContainerStatus new_status) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
         LOG(WARNING) << "change status fail, no such container_group:" << container_group_id;
@@ -1015,7 +1308,6 @@ bool Scheduler::ChangeStatus(const ContainerGroupId& container_group_id,
 
 void Scheduler::ChangeStatus(Container::Ptr container,
                              ContainerStatus new_status) {
-    mu_.AssertHeld();
     ContainerGroupId container_group_id = container->container_group_id;
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
@@ -1029,7 +1321,7 @@ void Scheduler::ChangeStatus(Container::Ptr container,
 void Scheduler::ChangeStatus(ContainerGroup::Ptr container_group,
                              Container::Ptr container,
                              ContainerStatus new_status) {
-    mu_.AssertHeld();
+    Owner(container_group)->mu.AssertHeld();
     ContainerId container_id = container->id;
     if (container_group->containers.find(container_id) == container_group->containers.end()) {
         LOG(WARNING) << "change status fail, no such container id: " << container_id;
@@ -1053,8 +1345,13 @@ void Scheduler::ChangeStatus(ContainerGroup::Ptr container_group,
         container->allocated_volum_containers.clear();
         container->require = container_group->require;
         container->remote_info.Clear();
+        container->cpu_usage.Reset();
+        container->memory_usage.Reset();
+        container->cpu_reserved = 0;
+        container->memory_reserved = 0;
         if (new_status == kContainerPending) {
             container->allocated_agent.erase();
+            container->pending_time = common::timer::get_micros();
         }
     }
     container->status = new_status;
@@ -1063,11 +1360,14 @@ void Scheduler::ChangeStatus(ContainerGroup::Ptr container_group,
     }
 }
 
-void Scheduler::CheckTagAndPool(Agent::Ptr agent) {
-    mu_.AssertHeld();
+void Scheduler::CheckTagAndPool(PoolPartition::Ptr partition, Agent::Ptr agent) {
+    partition->mu.AssertHeld();
     ContainerMap containers = agent->containers_;
     BOOST_FOREACH(ContainerMap::value_type& pair, containers) {
         Container::Ptr container = pair.second;
+        if (!IsChecker(partition, agent, container)) {
+            continue;
+        }
         bool check_passed = CheckTagAndPoolOnce(agent, container);
         if (!check_passed) { //evit the container to pendings
             ChangeStatus(container, kContainerPending);
@@ -1080,7 +1380,7 @@ void Scheduler::Start() {
     std::vector<std::pair<ContainerGroupId, int> > replicas;
     std::set<ContainerGroupId> need_kill;
     {
-        MutexLock lock(&mu_);
+        GlobalLock lock(this);
         stop_ = false;
         std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
         for (it = container_groups_.begin(); it != container_groups_.end(); it++) {
@@ -1099,18 +1399,21 @@ void Scheduler::Start() {
             Kill(group_id);
         }
     }
-    AgentEndpoint fake_endpoint = "";
-    ScheduleNextAgent(fake_endpoint);
+    GlobalLock lock(this);
+    StartPartition(coordinator_);
+    std::map<std::string, PoolPartition::Ptr>::iterator it;
+    for (it = partitions_.begin(); it != partitions_.end(); it++) {
+        StartPartition(it->second);
+    }
 }
 
 void Scheduler::Stop() {
     LOG(INFO) << "scheduler stopped.";
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     stop_ = true;
 }
 
 bool Scheduler::CheckTagAndPoolOnce(Agent::Ptr agent, Container::Ptr container) {
-    mu_.AssertHeld();
     bool check_passed = true;
     if (!container->require->tag.empty()
         && agent->tags_.find(container->require->tag) == agent->tags_.end()) {
@@ -1125,11 +1428,14 @@ bool Scheduler::CheckTagAndPoolOnce(Agent::Ptr agent, Container::Ptr container)
     return check_passed;
 }
 
-void Scheduler::CheckVersion(Agent::Ptr agent) {
-    mu_.AssertHeld();
+void Scheduler::CheckVersion(PoolPartition::Ptr partition, Agent::Ptr agent) {
+    partition->mu.AssertHeld();
     ContainerMap containers = agent->containers_;
     BOOST_FOREACH(ContainerMap::value_type& pair, containers) {
         Container::Ptr container = pair.second;
+        if (!IsChecker(partition, agent, container)) {
+            continue;
+        }
         ContainerGroupId container_group_id = container->container_group_id;
         std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
         if (it == container_groups_.end()) {
@@ -1153,40 +1459,228 @@ void Scheduler::CheckVersion(Agent::Ptr agent) {
     }
 }
 
-void Scheduler::ScheduleNextAgent(AgentEndpoint pre_endpoint) {
-    VLOG(20) << "scheduling the agent after: " << pre_endpoint;
+PoolPartition::Ptr Scheduler::GetPartition(const std::string& pool_name) {
+    mu_.AssertHeld();
+    PoolPartition::Ptr& partition = partitions_[pool_name];
+    if (!partition) {
+        partition.reset(new PoolPartition());
+        partition->pool_name = pool_name;
+        // held along with the others till the global lock goes, nobody
+        // waits on a new partition, so it is safe out of the lock order
+        partition->mu.Lock();
+        held_partitions_.push_back(partition);
+        LOG(INFO) << "new scheduling partition for pool: " << pool_name;
+        if (!stop_) {
+            StartPartition(partition);
+        }
+    }
+    return partition;
+}
+
+void Scheduler::StartPartition(PoolPartition::Ptr partition) {
+    mu_.AssertHeld();
+    if (partition->started) {
+        return;
+    }
+    partition->started = true;
+    if (partition == coordinator_) {
+        partition->sched_pool->AddTask(
+            boost::bind(&Scheduler::CoordinateNextAgent, this, "")
+        );
+    } else {
+        partition->sched_pool->AddTask(
+            boost::bind(&Scheduler::ScheduleNextAgent, this, partition, "")
+        );
+    }
+}
+
+PoolPartition::Ptr Scheduler::Owner(ContainerGroup::Ptr container_group) {
+    const Requirement::Ptr& require = container_group->require;
+    // anti-affinity reads replicas of other groups, two groups keeping off
+    // each other must not be placed by two partitions at the same time,
+    // whichever side declares it
+    if (require->pool_names.size() != 1 || !require->anti_affinities.empty()
+        || topology_->Avoided(container_group->id)) {
+        return coordinator_;
+    }
+    std::map<std::string, PoolPartition::Ptr>::iterator it;
+    it = partitions_.find(*require->pool_names.begin());
+    if (it == partitions_.end()) {
+        return coordinator_;
+    }
+    return it->second;
+}
+
+bool Scheduler::IsChecker(PoolPartition::Ptr partition, Agent::Ptr agent,
+                          Container::Ptr container) {
+    // containers of groups owned by the pool of the agent are checked by
+    // the pool, the others (of the coordinator, or left by pool changes)
+    // by the coordinator
+    std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
+    it = container_groups_.find(container->container_group_id);
+    PoolPartition::Ptr owner = coordinator_;
+    if (it != container_groups_.end()) {
+        owner = Owner(it->second);
+    }
+    bool pool_owned = owner != coordinator_ && owner->pool_name == agent->pool_name_;
+    return pool_owned == (partition != coordinator_);
+}
+
+void Scheduler::EnqueueContainerGroup(ContainerGroup::Ptr container_group) {
+    mu_.AssertHeld();
+    BOOST_FOREACH(const std::string& pool_name, container_group->require->pool_names) {
+        GetPartition(pool_name);
+    }
+    topology_->AddAntiAffinities(container_group->id, container_group->require->anti_affinities);
+    Owner(container_group)->container_group_queue.insert(container_group);
+    RequeueAvoided(container_group);
+}
+
+void Scheduler::DequeueContainerGroup(ContainerGroup::Ptr container_group) {
+    mu_.AssertHeld();
+    EraseFromQueues(container_group);
+    topology_->RemoveAntiAffinities(container_group->id, container_group->require->anti_affinities);
+    RequeueAvoided(container_group);
+}
+
+void Scheduler::EraseFromQueues(ContainerGroup::Ptr container_group) {
+    coordinator_->container_group_queue.erase(container_group);
+    std::map<std::string, PoolPartition::Ptr>::iterator it;
+    for (it = partitions_.begin(); it != partitions_.end(); it++) {
+        it->second->container_group_queue.erase(container_group);
+    }
+}
+
+void Scheduler::RequeueAvoided(ContainerGroup::Ptr container_group) {
+    mu_.AssertHeld();
+    BOOST_FOREACH(const proto::AntiAffinity& anti, container_group->require->anti_affinities) {
+        for (int i = 0; i < anti.container_groups_size(); i++) {
+            std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
+            it = container_groups_.find(anti.container_groups(i));
+            if (it == container_groups_.end() || it->second == container_group) {
+                continue;
+            }
+            EraseFromQueues(it->second);
+            Owner(it->second)->container_group_queue.insert(it->second);
+        }
+    }
+}
+
+void Scheduler::ScheduleNextAgent(PoolPartition::Ptr partition, AgentEndpoint pre_endpoint) {
+    VLOG(20) << "scheduling the agent after: " << pre_endpoint
+             << " in pool: " << partition->pool_name;
     Agent::Ptr agent;
     AgentEndpoint endpoint;
-    MutexLock lock(&mu_);
-    if (stop_ || agents_.empty()) {
+    MutexLock lock(&partition->mu);
+    if (stop_ || partition->agents.empty()) {
         if (stop_) {
             VLOG(16) << "no scheduling, because scheduler is stoped.";
         }
-        if (agents_.empty()) {
-            VLOG(16) << "no alive agents for scheduler.";
+        if (partition->agents.empty()) {
+            VLOG(16) << "no alive agents in pool: " << partition->pool_name;
         }
-        sched_pool_.DelayTask(FLAGS_sched_interval,
-                    boost::bind(&Scheduler::ScheduleNextAgent, this, pre_endpoint));
+        partition->sched_pool->DelayTask(FLAGS_sched_interval,
+                    boost::bind(&Scheduler::ScheduleNextAgent, this, partition, pre_endpoint));
         return;
     }
-    std::map<AgentEndpoint, Agent::Ptr>::iterator it;
-    it = agents_.upper_bound(pre_endpoint);
-    if (it != agents_.end()) {
-        agent = it->second;
-        endpoint = it->first;
+    std::set<AgentEndpoint>::iterator it;
+    it = partition->agents.upper_bound(pre_endpoint);
+    std::map<AgentEndpoint, Agent::Ptr>::iterator agent_it = agents_.end();
+    if (it != partition->agents.end()) {
+        agent_it = agents_.find(*it);
+    }
+    if (agent_it != agents_.end()) {
+        agent = agent_it->second;
+        endpoint = agent_it->first;
     } else {
         // turn to the start
-        sched_pool_.AddTask(boost::bind(&Scheduler::ScheduleNextAgent, this, ""));
+        partition->sched_pool->AddTask(
+            boost::bind(&Scheduler::ScheduleNextAgent, this, partition, ""));
         return;
     }
 
+    int64_t round_start = common::timer::get_micros();
     if (FLAGS_check_container_version) {
-        CheckVersion(agent); //check containers version
+        CheckVersion(partition, agent); //check containers version
     }
-    CheckTagAndPool(agent); //may evict some containers
+    CheckTagAndPool(partition, agent); //may evict some containers
+    PutPendings(partition, agent);
+    partition->rounds++;
+    partition->round_time += common::timer::get_micros() - round_start;
+    //scheduling round for the next agent
+    partition->sched_pool->DelayTask(FLAGS_sched_interval,
+                    boost::bind(&Scheduler::ScheduleNextAgent, this, partition, endpoint));
+}
+
+void Scheduler::CoordinateNextAgent(AgentEndpoint pre_endpoint) {
+    VLOG(20) << "coordinating the agent after: " << pre_endpoint;
+    MutexLock lock(&coordinator_->mu);
+    if (stop_ || agents_.empty()) {
+        if (stop_) {
+            VLOG(16) << "no coordinating, because scheduler is stoped.";
+        }
+        coordinator_->sched_pool->DelayTask(FLAGS_sched_interval,
+                    boost::bind(&Scheduler::CoordinateNextAgent, this, pre_endpoint));
+        return;
+    }
+    std::map<AgentEndpoint, Agent::Ptr>::iterator agent_it = agents_.upper_bound(pre_endpoint);
+    if (agent_it == agents_.end()) {
+        // turn to the start
+        coordinator_->sched_pool->AddTask(
+            boost::bind(&Scheduler::CoordinateNextAgent, this, ""));
+        return;
+    }
+    Agent::Ptr agent = agent_it->second;
+    AgentEndpoint endpoint = agent_it->first;
+    PoolPartition::Ptr pool = partitions_.find(agent->pool_name_)->second;
+
+    // owners do not change while the coordinator is held, so partitions
+    // owning containers left on the agent by pool changes are found first,
+    // then locked along with the pool of the agent in the lock order
+    std::map<std::string, PoolPartition::Ptr> partitions;
+    {
+        MutexLock pool_lock(&pool->mu);
+        BOOST_FOREACH(ContainerMap::value_type& pair, agent->containers_) {
+            std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
+            it = container_groups_.find(pair.second->container_group_id);
+            if (it == container_groups_.end()) {
+                continue;
+            }
+            PoolPartition::Ptr owner = Owner(it->second);
+            if (owner != coordinator_) {
+                partitions[owner->pool_name] = owner;
+            }
+        }
+    }
+    partitions[pool->pool_name] = pool;
+    std::map<std::string, PoolPartition::Ptr>::iterator it;
+    for (it = partitions.begin(); it != partitions.end(); it++) {
+        it->second->mu.Lock();
+    }
+
+    int64_t round_start = common::timer::get_micros();
+    if (FLAGS_check_container_version) {
+        CheckVersion(coordinator_, agent);
+    }
+    CheckTagAndPool(coordinator_, agent);
+    PutPendings(coordinator_, agent);
+
+    std::map<std::string, PoolPartition::Ptr>::reverse_iterator rit;
+    for (rit = partitions.rbegin(); rit != partitions.rend(); rit++) {
+        rit->second->mu.Unlock();
+    }
+    coordinator_->rounds++;
+    coordinator_->round_time += common::timer::get_micros() - round_start;
+    coordinator_->sched_pool->DelayTask(FLAGS_sched_interval,
+                    boost::bind(&Scheduler::CoordinateNextAgent, this, endpoint));
+}
+
+void Scheduler::PutPendings(PoolPartition::Ptr partition, Agent::Ptr agent) {
+    partition->mu.AssertHeld();
     //for each container_group checking pending containers, try to put on...
     std::set<ContainerGroup::Ptr, ContainerGroupQueueLess>::iterator jt;
-    for (jt = container_group_queue_.begin(); jt != container_group_queue_.end(); jt++) {
+    for (jt = partition->container_group_queue.begin();
+         jt != partition->container_group_queue.end(); jt++) {
         ContainerGroup::Ptr container_group = *jt;
         if (container_group->states[kContainerPending].size() == 0) {
             continue; // no pending pods
@@ -1208,23 +1702,24 @@ void Scheduler::ScheduleNextAgent(AgentEndpoint pre_endpoint) {
                 container->last_res_err = res_err;
             }
             VLOG(10) << "try put fail: " << container->id
-                     << " agent:" << endpoint
+                     << " agent:" << agent->endpoint_
                      << ", err:" << proto::ResourceError_Name(res_err);
             continue; //no feasiable
         }
         agent->Put(container);
         ChangeStatus(container, kContainerAllocating);
+        partition->placements++;
+        if (container->pending_time > 0) {
+            partition->placement_latency += common::timer::get_micros() - container->pending_time;
+        }
     }
-    //scheduling round for the next agent
-    sched_pool_.DelayTask(FLAGS_sched_interval,
-                    boost::bind(&Scheduler::ScheduleNextAgent, this, endpoint));
 }
 
 bool Scheduler::ManualSchedule(const AgentEndpoint& endpoint,
                                const ContainerGroupId& container_group_id,
                                std::string& fail_reason) {
     LOG(INFO) << "manul scheduling: " << container_group_id << " @ " << endpoint;
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<AgentEndpoint, Agent::Ptr>::iterator agent_it;
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator container_group_it;
     agent_it = agents_.find(endpoint);
@@ -1292,7 +1787,7 @@ bool Scheduler::Update(const ContainerGroupId& container_group_id,
                        const proto::ContainerDescription& container_desc,
                        int update_interval,
                        std::string& new_version) {
-    MutexLock locker(&mu_);
+    GlobalLock locker(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
         LOG(WARNING) << "update fail, no such container_group: " << container_group_id;
@@ -1309,9 +1804,12 @@ bool Scheduler::Update(const ContainerGroupId& container_group_id,
     require->version = new_version;
     container_group->update_interval = update_interval;
     container_group->last_update_time = common::timer::now_time();
+    DequeueContainerGroup(container_group); //pools may change
     container_group->require = require;
-    container_group->container_desc = container_desc;
-    container_group->container_desc.set_version(new_version);
+    EnqueueContainerGroup(container_group);
+    proto::ContainerDescription* new_desc = new proto::ContainerDescription(container_desc);
+    new_desc->set_version(new_version);
+    container_group->container_desc.reset(new_desc);
     container_group->update_time = common::timer::get_micros();
     BOOST_FOREACH(ContainerMap::value_type& pair, container_group->states[kContainerPending]) {
         Container::Ptr pending_container = pair.second;
@@ -1323,13 +1821,12 @@ bool Scheduler::Update(const ContainerGroupId& container_group_id,
 void Scheduler::MakeCommand(const std::string& agent_endpoint,
                             const proto::AgentInfo& agent_info,
                             std::vector<AgentCommand>& commands) {
-    MutexLock locker(&mu_);
+    AgentLock locker(this, agent_endpoint, true);
     if (stop_) {
         LOG(INFO) << "no command to agent, when scheduler stopped.";
         return;
     }
-    std::map<AgentEndpoint, Agent::Ptr>::iterator it = agents_.find(agent_endpoint);
-    if (it == agents_.end()) {
+    if (!locker.agent) {
         LOG(WARNING) << "no such agent, will kill all containers, " << agent_endpoint;
         for (int i = 0; i < agent_info.container_info_size(); i++) {
             const proto::ContainerInfo& container_remote = agent_info.container_info(i);
@@ -1342,7 +1839,7 @@ void Scheduler::MakeCommand(const std::string& agent_endpoint,
         }
         return;
     }
-    Agent::Ptr agent = it->second;
+    Agent::Ptr agent = locker.agent;
 
     int64_t cpu_reserved = 0;
     int64_t cpu_deep_reserved = 0;
@@ -1364,22 +1861,15 @@ void Scheduler::MakeCommand(const std::string& agent_endpoint,
         }
 
         // get reserved
+        UpdateReserved(it_local->second, container_remote.cpu_used(), container_remote.memory_used());
         if (it_local->second->priority != proto::kJobBestEffort) {
-            cpu_reserved += std::min(
-                static_cast<int64_t>(container_remote.cpu_used() * FLAGS_reserved_percent),
-                it_local->second->require->CpuNeed());
+            cpu_reserved += it_local->second->cpu_reserved;
             memory_reserved += it_local->second->require->TmpfsNeed();
-            memory_reserved += std::min(
-                static_cast<int64_t>(container_remote.memory_used() * FLAGS_reserved_percent),
-                it_local->second->require->MemoryNeed());
+            memory_reserved += it_local->second->memory_reserved;
         } else {
-            cpu_deep_reserved += std::min(
-                static_cast<int64_t>(container_remote.cpu_used() * FLAGS_reserved_percent),
-                it_local->second->require->CpuNeed());
+            cpu_deep_reserved += it_local->second->cpu_reserved;
             memory_reserved += it_local->second->require->TmpfsNeed();
-            memory_deep_reserved += std::min(
-                static_cast<int64_t>(container_remote.memory_used() * FLAGS_reserved_percent),
-                it_local->second->require->MemoryNeed());
+            memory_deep_reserved += it_local->second->memory_reserved;
         }
 
         const std::string& local_version = it_local->second->require->version;
@@ -1404,6 +1894,8 @@ void Scheduler::MakeCommand(const std::string& agent_endpoint,
     // set resource reserved
     agent->SetReserved(cpu_reserved, cpu_deep_reserved,
                        memory_reserved, memory_deep_reserved);
+    agent->SetPressure(agent_info.host_metrix());
+    agent->SetGcBacklog(agent_info.gc_metrix());
 
     BOOST_FOREACH(ContainerMap::value_type& pair, containers_local) {
         Container::Ptr container_local = pair.second;
@@ -1433,7 +1925,11 @@ void Scheduler::MakeCommand(const std::string& agent_endpoint,
                 } else {
                     cmd.action = kCreateContainer;
                     cmd.desc = container_group->container_desc;
-                    SetVolumsAndPorts(container_local, cmd.desc);
+                    for (size_t i = 0; i < container_local->allocated_volums.size(); i++) {
+                        cmd.volum_paths.push_back(container_local->allocated_volums[i].first);
+                    }
+                    cmd.ports = container_local->allocated_ports;
+                    cmd.volum_containers = container_local->allocated_volum_containers;
                     commands.push_back(cmd);
                 }
                 break;
@@ -1495,6 +1991,24 @@ bool Scheduler::RequireHasDiff(const Requirement* v1, const Requirement* v2) {
     if (v1->max_per_host != v2->max_per_host) {
         return true;
     }
+    if (v1->spreads.size() != v2->spreads.size()) {
+        return true;
+    }
+    for (size_t i = 0; i < v1->spreads.size(); i++) {
+        if (v1->spreads[i].topology_key() != v2->spreads[i].topology_key()
+            || v1->spreads[i].max_skew() != v2->spreads[i].max_skew()) {
+            return true;
+        }
+    }
+    if (v1->anti_affinities.size() != v2->anti_affinities.size()) {
+        return true;
+    }
+    for (size_t i = 0; i < v1->anti_affinities.size(); i++) {
+        if (v1->anti_affinities[i].SerializeAsString()
+            != v2->anti_affinities[i].SerializeAsString()) {
+            return true;
+        }
+    }
     if (v1->cpu.size() != v2->cpu.size()) {
         return true;
     }
@@ -1560,56 +2074,68 @@ bool Scheduler::RequireHasDiff(const Requirement* v1, const Requirement* v2) {
     for (size_t i = 0; i < v1->blkios.size(); i++) {
         const proto::BlkioRequired& b1 = v1->blkios[i];
         const proto::BlkioRequired& b2 = v2->blkios[i];
-        if (b1.weight() != b2.weight()) {
+        if (b1.weight() != b2.weight()
+            || b1.throttles_size() != b2.throttles_size()) {
             return true;
         }
+        // device is resolved by agent, not part of the requirement
+        for (int j = 0; j < b1.throttles_size(); j++) {
+            const proto::BlkioThrottle& t1 = b1.throttles(j);
+            const proto::BlkioThrottle& t2 = b2.throttles(j);
+            if (t1.path() != t2.path()
+                || t1.read_bps() != t2.read_bps()
+                || t1.write_bps() != t2.write_bps()
+                || t1.read_iops() != t2.read_iops()
+                || t1.write_iops() != t2.write_iops()) {
+                return true;
+            }
+        }
     }
     return false;
 }
 
-void Scheduler::SetVolumsAndPorts(const Container::Ptr& container,
+void Scheduler::SetVolumsAndPorts(const AgentCommand& cmd,
                                   proto::ContainerDescription& container_desc) {
-    mu_.AssertHeld();
     size_t idx = 0;
     if (container_desc.workspace_volum().medium() != proto::kTmpfs) {
-        if (idx >= container->allocated_volums.size()) {
+        if (idx >= cmd.volum_paths.size()) {
             LOG(WARNING) << "fail to set allocated volums device path";
             return;
         }
         container_desc.mutable_workspace_volum()->set_source_path(
-            container->allocated_volums[idx++].first
+            cmd.volum_paths[idx++]
         );
     }
     for (int i = 0; i < container_desc.data_volums_size(); i++) {
-        if (idx >= container->allocated_volums.size()) {
+        if (idx >= cmd.volum_paths.size()) {
             break;
         }
         proto::VolumRequired* vol = container_desc.mutable_data_volums(i);
         if (vol->medium() != proto::kTmpfs) {
-            vol->set_source_path(container->allocated_volums[idx++].first);
+            vol->set_source_path(cmd.volum_paths[idx++]);
         }
     }
     idx = 0;
     for (int i = 0; i < container_desc.cgroups_size(); i++) {
         int one_cgropu_ports = container_desc.cgroups(i).ports_size();
         for (int j = 0; j < one_cgropu_ports; j++) {
-            if (idx >= container->allocated_ports.size()) {
+            if (idx >= cmd.ports.size()) {
                 LOG(WARNING) << "fail to set real port";
                 return;
             }
             container_desc.mutable_cgroups(i)->mutable_ports(j)->set_real_port(
-                container->allocated_ports[idx++]
+                cmd.ports[idx++]
             );
         }
     }
     container_desc.clear_volum_containers();
-    for (size_t i = 0; i < container->allocated_volum_containers.size(); i++) {
-        *container_desc.add_volum_containers() = container->allocated_volum_containers[i];
+    for (size_t i = 0; i < cmd.volum_containers.size(); i++) {
+        *container_desc.add_volum_containers() = cmd.volum_containers[i];
     }
 }
 
 bool Scheduler::ListContainerGroups(std::vector<proto::ContainerGroupStatistics>& container_groups) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
     for (it = container_groups_.begin(); it != container_groups_.end(); it++) {
         int64_t cpu_assigned = 0; //for one container group
@@ -1682,7 +2208,7 @@ bool Scheduler::ListContainerGroups(std::vector<proto::ContainerGroupStatistics>
 
 bool Scheduler::ShowContainerGroup(const ContainerGroupId& container_group_id,
                                    std::vector<proto::ContainerStatistics>& containers) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
     it = container_groups_.find(container_group_id);
     if (it == container_groups_.end()) {
@@ -1696,7 +2222,6 @@ bool Scheduler::ShowContainerGroup(const ContainerGroupId& container_group_id,
 
 void Scheduler::GetContainersStatistics(const ContainerMap& containers_map,
                                         std::vector<proto::ContainerStatistics>& containers) {
-    mu_.AssertHeld();
     BOOST_FOREACH(const ContainerMap::value_type& pair, containers_map) {
         Container::Ptr container = pair.second;
         proto::ContainerStatistics container_stat;
@@ -1738,26 +2263,68 @@ void Scheduler::GetContainersStatistics(const ContainerMap& containers_map,
         container_stat.mutable_cpu()->set_used(cpu_used);
         container_stat.mutable_memory()->set_assigned(memory_assigned);
         container_stat.mutable_memory()->set_used(memory_used);
+        container_stat.set_cpu_reserved(container->cpu_reserved);
+        container_stat.set_memory_reserved(container->memory_reserved);
+        container_stat.set_cpu_reserve_exceeded(container->cpu_reserve_exceeded);
+        container_stat.set_memory_reserve_exceeded(container->memory_reserve_exceeded);
         containers.push_back(container_stat);
     }
 }
 
 bool Scheduler::ShowAgent(const AgentEndpoint& endpoint,
                           std::vector<proto::ContainerStatistics>& containers) {
-    MutexLock lock(&mu_);
-    std::map<AgentEndpoint, Agent::Ptr>::iterator agent_it;
-    agent_it = agents_.find(endpoint);
-    if (agent_it == agents_.end()) {
+    AgentLock locker(this, endpoint, false);
+    if (!locker.agent) {
         LOG(WARNING) << "fail to show agent, not exist: " << endpoint;
         return false;
     }
-    Agent::Ptr agent = agent_it->second;
+    Agent::Ptr agent = locker.agent;
     GetContainersStatistics(agent->containers_, containers);
     return true;
 }
 
+void Scheduler::ShowPoolStatistics(std::vector<PoolStatistics>& pools) {
+    GlobalLock lock(this);
+    std::map<std::string, PoolPartition::Ptr>::iterator it;
+    for (it = partitions_.begin(); it != partitions_.end(); it++) {
+        const PoolPartition::Ptr& partition = it->second;
+        PoolStatistics stat;
+        stat.pool_name = partition->pool_name;
+        stat.container_groups = partition->container_group_queue.size();
+        std::set<ContainerGroup::Ptr, ContainerGroupQueueLess>::iterator jt;
+        for (jt = partition->container_group_queue.begin();
+             jt != partition->container_group_queue.end(); jt++) {
+            stat.pending += (*jt)->states[kContainerPending].size();
+        }
+        // groups of the coordinator count in every pool they ask for
+        for (jt = coordinator_->container_group_queue.begin();
+             jt != coordinator_->container_group_queue.end(); jt++) {
+            if ((*jt)->require->pool_names.count(partition->pool_name) > 0) {
+                stat.container_groups++;
+                stat.pending += (*jt)->states[kContainerPending].size();
+            }
+        }
+        BOOST_FOREACH(const AgentEndpoint& endpoint, partition->agents) {
+            std::map<AgentEndpoint, Agent::Ptr>::iterator agent_it = agents_.find(endpoint);
+            if (agent_it != agents_.end()) {
+                stat.try_put_hits += agent_it->second->try_put_hits_;
+                stat.try_put_misses += agent_it->second->try_put_misses_;
+            }
+        }
+        stat.rounds = partition->rounds;
+        stat.placements = partition->placements;
+        if (partition->rounds > 0) {
+            stat.avg_round_time = partition->round_time / partition->rounds;
+        }
+        if (partition->placements > 0) {
+            stat.avg_placement_latency = partition->placement_latency / partition->placements;
+        }
+        pools.push_back(stat);
+    }
+}
+
 void Scheduler::ShowUserAlloc(const std::string& user_name, proto::Quota& alloc) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
     int64_t cpu_alloc = 0; //for one user
     int64_t memory_alloc = 0;
@@ -1816,7 +2383,7 @@ void Scheduler::MetaToQuota(const proto::ContainerGroupMeta& meta, proto::Quota&
 
 bool Scheduler::IsBeingShared(const ContainerGroupId& container_group_id,
                               ContainerGroupId& top_container_group_id) {
-    MutexLock lock(&mu_);
+    GlobalLock lock(this);
     std::map<ContainerGroupId, ContainerGroup::Ptr>::iterator it;
     for (it = container_groups_.begin(); it != container_groups_.end(); it++) {
         ContainerGroup::Ptr& container_group = it->second;
@@ -9,10 +9,14 @@
 #include <vector>
 #include <string>
 #include <utility>
+#include <sstream>
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
 #include "src/protocol/galaxy.pb.h"
 #include "mutex.h"
 #include "thread_pool.h"
+#include "usage_histogram.h"
+#include "topology.h"
 
 namespace baidu {
 namespace galaxy {
@@ -44,7 +48,12 @@ struct AgentCommand {
     AgentCommandAction action;
     ContainerId container_id;
     ContainerGroupId container_group_id;
-    proto::ContainerDescription desc;
+    // shared with the container group, never modified,
+    // volums and ports of this container are filled in when sending
+    boost::shared_ptr<const proto::ContainerDescription> desc;
+    std::vector<DevicePath> volum_paths;
+    std::vector<std::string> ports;
+    std::vector<ContainerId> volum_containers;
 };
 
 struct Requirement {
@@ -59,7 +68,10 @@ struct Requirement {
     std::vector<proto::TcpthrotRequired> tcp_throts;
     std::vector<proto::BlkioRequired> blkios;
     std::vector<std::string> volum_jobs;
+    std::vector<proto::TopologySpread> spreads;
+    std::vector<proto::AntiAffinity> anti_affinities;
     proto::ContainerType container_type;
+    std::string fingerprint; //same shape, same fingerprint, see Fingerprint()
     Requirement() : max_per_host(0) , container_type(proto::kNormalContainer) {};
     int64_t CpuNeed() {
         int64_t total = 0;
@@ -102,6 +114,37 @@ struct Requirement {
         }
         return total;
     }
+    // everything Agent::TryPutShape looks at, but nothing about the group
+    std::string Fingerprint() const {
+        std::stringstream ss;
+        ss << tag << "|";
+        for (std::set<std::string>::const_iterator it = pool_names.begin();
+             it != pool_names.end(); it++) {
+            ss << *it << ",";
+        }
+        ss << "|";
+        for (size_t i = 0; i < cpu.size(); i++) {
+            ss << cpu[i].milli_core() << ",";
+        }
+        ss << "|";
+        for (size_t i = 0; i < memory.size(); i++) {
+            ss << memory[i].size() << ",";
+        }
+        ss << "|";
+        for (size_t i = 0; i < volums.size(); i++) {
+            ss << volums[i].medium() << ":" << volums[i].size()
+               << ":" << volums[i].exclusive() << ",";
+        }
+        ss << "|";
+        for (size_t i = 0; i < ports.size(); i++) {
+            ss << ports[i].port() << ",";
+        }
+        ss << "|";
+        for (size_t i = 0; i < volum_jobs.size(); i++) {
+            ss << volum_jobs[i] << ",";
+        }
+        return ss.str();
+    }
     typedef boost::shared_ptr<Requirement> Ptr;
 };
 
@@ -124,7 +167,17 @@ struct Container {
     ResourceError last_res_err;
     proto::ContainerInfo remote_info;
     std::vector<ContainerId> allocated_volum_containers;
-    Container() : priority(proto::kJobService), status(kContainerPending), last_res_err(proto::kResOk) {}
+    UsageHistogram cpu_usage;
+    UsageHistogram memory_usage;
+    int64_t cpu_reserved;
+    int64_t memory_reserved;
+    int64_t cpu_reserve_exceeded;
+    int64_t memory_reserve_exceeded;
+    int64_t pending_time;
+    Container() : priority(proto::kJobService), status(kContainerPending), last_res_err(proto::kResOk),
+                  cpu_reserved(0), memory_reserved(0),
+                  cpu_reserve_exceeded(0), memory_reserve_exceeded(0),
+                  pending_time(0) {}
     typedef boost::shared_ptr<Container> Ptr;
 };
 
@@ -148,7 +201,7 @@ struct ContainerGroup {
     int replica;
     std::string name;
     std::string user_name;
-    proto::ContainerDescription container_desc;
+    boost::shared_ptr<const proto::ContainerDescription> container_desc; //replaced on update, never modified
     int64_t submit_time;
     int64_t update_time;
     std::string last_sched_container_id;
@@ -175,7 +228,8 @@ public:
                    int64_t memory,
                    const std::map<DevicePath, VolumInfo>& volums,
                    const std::set<std::string>& tags,
-                   const std::string& pool_name);
+                   const std::string& pool_name,
+                   const TopologyLabels& labels);
     void SetAssignment(int64_t cpu_assigned,
                        int64_t cpu_deep_assigned,
                        int64_t memory_assigned,
@@ -187,11 +241,16 @@ public:
                      int64_t cpu_deep_reserved,
                      int64_t memory_reserved,
                      int64_t memory_deep_reserved);
+    // host pressure reported by agent, placement signal of best-effort containers
+    void SetPressure(const proto::HostMetrix& host_metrix);
+    // gc backlog reported by agent, removal competes for disks with new volums
+    void SetGcBacklog(const proto::GcMetrix& gc_metrix);
     bool TryPut(const Container* container, ResourceError& err);
     void Put(Container::Ptr container);
     void Evict(Container::Ptr container);
     typedef boost::shared_ptr<Agent> Ptr;
 private:
+    bool TryPutShape(const Container* container, ResourceError& err);
     bool SelectDevices(const std::vector<proto::VolumRequired>& volums,
                        std::vector<DevicePath>& devices);
     bool RecurSelectDevices(size_t i, const std::vector<proto::VolumRequired>& volums,
@@ -206,6 +265,8 @@ private:
     AgentEndpoint endpoint_;
     std::set<std::string> tags_;
     std::string pool_name_;
+    TopologyLabels labels_;
+    Topology::Ptr topology_;
     int64_t cpu_total_;
     int64_t cpu_assigned_;
     int64_t cpu_reserved_;
@@ -224,6 +285,15 @@ private:
     std::map<ContainerGroupId, int> container_counts_;
     std::map<ContainerGroupId, std::set<ContainerId> > volum_jobs_free_;
     int32_t batch_container_count_;
+    int64_t generation_; //bumped whenever the result of TryPutShape may change
+    int64_t try_put_generation_;
+    boost::unordered_map<std::string, ResourceError> try_put_cache_;
+    int64_t try_put_hits_;
+    int64_t try_put_misses_;
+    double memory_pressure_; // memory some avg10 of host, percent
+    bool memory_pressured_;
+    int32_t gc_backlog_; // gc dirs overdue on agent
+    bool gc_backlogged_;
 };
 
 struct ContainerGroupQueueLess {
@@ -238,6 +308,46 @@ struct ContainerGroupQueueLess {
     }
 };
 
+// one scheduling partition per pool: agents of the pool are visited
+// round-robin on its own thread under its own lock, and only groups owned
+// by the partition are tried, so pools are scheduled in parallel.
+// Groups spanning several pools or keeping off other groups are owned by
+// the coordinating partition, which walks the agents of all pools
+struct PoolPartition {
+    std::string pool_name;      //empty for the coordinating partition
+    Mutex mu;                   //guards the partition, owned groups and agents of the pool
+    std::set<AgentEndpoint> agents;
+    std::set<ContainerGroup::Ptr, ContainerGroupQueueLess> container_group_queue;
+    boost::shared_ptr<ThreadPool> sched_pool;
+    bool started;
+    int64_t rounds;
+    int64_t placements;
+    int64_t round_time;         //total time spent in rounds, in microseconds
+    int64_t placement_latency;  //total time from pending to allocating, in microseconds
+    PoolPartition() : sched_pool(new ThreadPool(1)),
+                      started(false),
+                      rounds(0),
+                      placements(0),
+                      round_time(0),
+                      placement_latency(0) {}
+    typedef boost::shared_ptr<PoolPartition> Ptr;
+};
+
+struct PoolStatistics {
+    std::string pool_name;
+    int container_groups;
+    int pending;
+    int64_t rounds;
+    int64_t placements;
+    int64_t avg_round_time;
+    int64_t avg_placement_latency;
+    int64_t try_put_hits;
+    int64_t try_put_misses;
+    PoolStatistics() : container_groups(0), pending(0), rounds(0), placements(0),
+                       avg_round_time(0), avg_placement_latency(0),
+                       try_put_hits(0), try_put_misses(0) {}
+};
+
 class Scheduler {
 public:
     explicit Scheduler();
@@ -268,6 +378,7 @@ public:
     void AddTag(const AgentEndpoint& endpoint, const std::string& tag);
     void RemoveTag(const AgentEndpoint& endpoint, const std::string& tag);
     void SetPool(const AgentEndpoint& endpoint, const std::string& pool_name);
+    void SetTopology(const AgentEndpoint& endpoint, const TopologyLabels& labels);
     void MakeCommand(const std::string& agent_endpoint,
                      const proto::AgentInfo& agent_info,
                      std::vector<AgentCommand>& commands);
@@ -285,6 +396,9 @@ public:
     void MetaToQuota(const proto::ContainerGroupMeta& meta, proto::Quota& quota);
     bool IsBeingShared(const ContainerGroupId& container_group_id,
                        ContainerGroupId& top_container_group_id);
+    void ShowPoolStatistics(std::vector<PoolStatistics>& pools);
+    static void SetVolumsAndPorts(const AgentCommand& cmd,
+                                  proto::ContainerDescription& container_desc);
 private:
     void ChangeStatus(Container::Ptr container,
                       proto::ContainerStatus new_status);
@@ -296,22 +410,44 @@ private:
 
     ContainerGroupId GenerateContainerGroupId(const std::string& container_group_name);
     ContainerId GenerateContainerId(const ContainerGroupId& container_group_id, int offset);
-    void ScheduleNextAgent(AgentEndpoint pre_endpoint);
-    void CheckTagAndPool(Agent::Ptr agent);
-    void CheckVersion(Agent::Ptr agent);
+    void ScheduleNextAgent(PoolPartition::Ptr partition, AgentEndpoint pre_endpoint);
+    void CoordinateNextAgent(AgentEndpoint pre_endpoint);
+    void PutPendings(PoolPartition::Ptr partition, Agent::Ptr agent);
+    PoolPartition::Ptr GetPartition(const std::string& pool_name);
+    PoolPartition::Ptr Owner(ContainerGroup::Ptr container_group);
+    bool IsChecker(PoolPartition::Ptr partition, Agent::Ptr agent, Container::Ptr container);
+    void StartPartition(PoolPartition::Ptr partition);
+    void EnqueueContainerGroup(ContainerGroup::Ptr container_group);
+    void DequeueContainerGroup(ContainerGroup::Ptr container_group);
+    void EraseFromQueues(ContainerGroup::Ptr container_group);
+    // groups named by the anti-affinities move to their owner, as they gain
+    // or lose the group keeping off them
+    void RequeueAvoided(ContainerGroup::Ptr container_group);
+    void CheckTagAndPool(PoolPartition::Ptr partition, Agent::Ptr agent);
+    void CheckVersion(PoolPartition::Ptr partition, Agent::Ptr agent);
     bool CheckTagAndPoolOnce(Agent::Ptr agent, Container::Ptr container);
     void CheckContainerGroupGC(ContainerGroup::Ptr container_group);
     bool RequireHasDiff(const Requirement* v1, const Requirement* v2);
     void SetRequirement(Requirement::Ptr require,
                         const proto::ContainerDescription& container_desc);
-    void SetVolumsAndPorts(const Container::Ptr& container,
-                           proto::ContainerDescription& container_desc);
+    // feed usage history and derive reserved resource from its percentile,
+    // under the partition of the container's agent
+    void UpdateReserved(Container::Ptr container,
+                        int64_t cpu_used, int64_t memory_used);
     std::string GetNewVersion();
+    class GlobalLock;
+    class AgentLock;
+    // lock order: mu_, coordinator_->mu, then partitions_ by pool name.
+    // agents_, container_groups_, partitions_, requirements of groups and
+    // stop_ change only under all of them, so any one is enough to read.
+    // An agent and containers on it are guarded by the partition of its pool
     std::map<AgentEndpoint, Agent::Ptr> agents_;
     std::map<ContainerGroupId, ContainerGroup::Ptr> container_groups_;
-    std::set<ContainerGroup::Ptr, ContainerGroupQueueLess> container_group_queue_;
+    std::map<std::string, PoolPartition::Ptr> partitions_;
+    PoolPartition::Ptr coordinator_;
+    std::vector<PoolPartition::Ptr> held_partitions_;
+    Topology::Ptr topology_;
     Mutex mu_;
-    ThreadPool sched_pool_;
     ThreadPool gc_pool_;
     bool stop_;
 };
@@ -0,0 +1,250 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "topology.h"
+
+#include <boost/foreach.hpp>
+#include "scheduler.h"
+
+namespace baidu {
+namespace galaxy {
+namespace sched {
+
+const std::string Topology::kHostKey = "host";
+
+void DomainCounter::Inc(const std::string& domain) {
+    int& count = counts_[domain];
+    if (count > 0 && --count_freq_[count] == 0) {
+        count_freq_.erase(count);
+    }
+    count++;
+    count_freq_[count]++;
+}
+
+void DomainCounter::Dec(const std::string& domain) {
+    std::map<std::string, int>::iterator it = counts_.find(domain);
+    if (it == counts_.end()) {
+        return;
+    }
+    int count = it->second;
+    if (--count_freq_[count] == 0) {
+        count_freq_.erase(count);
+    }
+    count--;
+    if (count > 0) {
+        it->second = count;
+        count_freq_[count]++;
+    } else {
+        counts_.erase(it);
+    }
+}
+
+int DomainCounter::Count(const std::string& domain) const {
+    std::map<std::string, int>::const_iterator it = counts_.find(domain);
+    if (it == counts_.end()) {
+        return 0;
+    }
+    return it->second;
+}
+
+int DomainCounter::MinCount(size_t total) const {
+    if (counts_.size() < total || count_freq_.empty()) {
+        return 0;
+    }
+    return count_freq_.begin()->first;
+}
+
+void Topology::AddAgent(const std::string& pool_name, const TopologyLabels& labels) {
+    MutexLock lock(&mu_);
+    BOOST_FOREACH(const TopologyLabels::value_type& label, labels) {
+        domains_[label.first][pool_name][label.second]++;
+    }
+    domains_cache_.clear();
+}
+
+void Topology::RemoveAgent(const std::string& pool_name, const TopologyLabels& labels) {
+    MutexLock lock(&mu_);
+    BOOST_FOREACH(const TopologyLabels::value_type& label, labels) {
+        std::map<std::string, int>& domains = domains_[label.first][pool_name];
+        if (--domains[label.second] <= 0) {
+            domains.erase(label.second);
+        }
+    }
+    domains_cache_.clear();
+}
+
+void Topology::Place(const std::string& container_group_id, const TopologyLabels& labels) {
+    MutexLock lock(&mu_);
+    std::map<std::string, DomainCounter>& counters = counters_[container_group_id];
+    BOOST_FOREACH(const TopologyLabels::value_type& label, labels) {
+        counters[label.first].Inc(label.second);
+    }
+}
+
+void Topology::Unplace(const std::string& container_group_id, const TopologyLabels& labels) {
+    MutexLock lock(&mu_);
+    std::map<std::string, std::map<std::string, DomainCounter> >::iterator it;
+    it = counters_.find(container_group_id);
+    if (it == counters_.end()) {
+        return;
+    }
+    bool empty = true;
+    BOOST_FOREACH(const TopologyLabels::value_type& label, labels) {
+        DomainCounter& counter = it->second[label.first];
+        counter.Dec(label.second);
+        empty = empty && counter.Empty();
+    }
+    if (empty) {
+        counters_.erase(it);
+    }
+}
+
+void Topology::AddAntiAffinities(const std::string& container_group_id,
+                                 const std::vector<proto::AntiAffinity>& anti_affinities) {
+    MutexLock lock(&mu_);
+    BOOST_FOREACH(const proto::AntiAffinity& anti, anti_affinities) {
+        for (int i = 0; i < anti.container_groups_size(); i++) {
+            avoiders_[anti.container_groups(i)].insert(
+                std::make_pair(container_group_id, anti.topology_key()));
+        }
+    }
+}
+
+void Topology::RemoveAntiAffinities(const std::string& container_group_id,
+                                    const std::vector<proto::AntiAffinity>& anti_affinities) {
+    MutexLock lock(&mu_);
+    BOOST_FOREACH(const proto::AntiAffinity& anti, anti_affinities) {
+        for (int i = 0; i < anti.container_groups_size(); i++) {
+            std::map<std::string, std::multiset<std::pair<std::string, std::string> > >::iterator it;
+            it = avoiders_.find(anti.container_groups(i));
+            if (it == avoiders_.end()) {
+                continue;
+            }
+            std::multiset<std::pair<std::string, std::string> >::iterator jt;
+            jt = it->second.find(std::make_pair(container_group_id, anti.topology_key()));
+            if (jt != it->second.end()) {
+                it->second.erase(jt);
+            }
+            if (it->second.empty()) {
+                avoiders_.erase(it);
+            }
+        }
+    }
+}
+
+bool Topology::Avoided(const std::string& container_group_id) {
+    MutexLock lock(&mu_);
+    return avoiders_.find(container_group_id) != avoiders_.end();
+}
+
+const DomainCounter* Topology::FindCounter(const std::string& container_group_id,
+                                           const std::string& key) const {
+    std::map<std::string, std::map<std::string, DomainCounter> >::const_iterator it;
+    it = counters_.find(container_group_id);
+    if (it == counters_.end()) {
+        return NULL;
+    }
+    std::map<std::string, DomainCounter>::const_iterator jt = it->second.find(key);
+    if (jt == it->second.end()) {
+        return NULL;
+    }
+    return &jt->second;
+}
+
+size_t Topology::DomainsInPools(const std::string& key,
+                                const std::set<std::string>& pool_names) {
+    std::map<std::string, std::map<std::string, std::map<std::string, int> > >::iterator it;
+    it = domains_.find(key);
+    if (it == domains_.end()) {
+        return 0;
+    }
+    if (pool_names.size() == 1) {
+        std::map<std::string, std::map<std::string, int> >::iterator jt;
+        jt = it->second.find(*pool_names.begin());
+        return jt == it->second.end() ? 0 : jt->second.size();
+    }
+    std::string cache_key = key;
+    BOOST_FOREACH(const std::string& pool_name, pool_names) {
+        cache_key += "," + pool_name;
+    }
+    std::map<std::string, size_t>::iterator cache_it = domains_cache_.find(cache_key);
+    if (cache_it != domains_cache_.end()) {
+        return cache_it->second;
+    }
+    std::set<std::string> domains;
+    BOOST_FOREACH(const std::string& pool_name, pool_names) {
+        std::map<std::string, std::map<std::string, int> >::iterator jt;
+        jt = it->second.find(pool_name);
+        if (jt == it->second.end()) {
+            continue;
+        }
+        std::map<std::string, int>::iterator kt;
+        for (kt = jt->second.begin(); kt != jt->second.end(); kt++) {
+            domains.insert(kt->first);
+        }
+    }
+    domains_cache_[cache_key] = domains.size();
+    return domains.size();
+}
+
+bool Topology::Check(const Container* container, const TopologyLabels& labels,
+                     proto::ResourceError& err) {
+    MutexLock lock(&mu_);
+    const Requirement::Ptr& require = container->require;
+    BOOST_FOREACH(const proto::TopologySpread& spread, require->spreads) {
+        TopologyLabels::const_iterator it = labels.find(spread.topology_key());
+        if (it == labels.end()) {
+            // agents outside of the topology can not keep the skew
+            err = proto::kTopologySkew;
+            return false;
+        }
+        const DomainCounter* counter = FindCounter(container->container_group_id,
+                                                   spread.topology_key());
+        if (counter == NULL) {
+            continue;
+        }
+        size_t total = DomainsInPools(spread.topology_key(), require->pool_names);
+        int skew = counter->Count(it->second) + 1 - counter->MinCount(total);
+        if (skew > spread.max_skew()) {
+            err = proto::kTopologySkew;
+            return false;
+        }
+    }
+    BOOST_FOREACH(const proto::AntiAffinity& anti, require->anti_affinities) {
+        TopologyLabels::const_iterator it = labels.find(anti.topology_key());
+        if (it == labels.end()) {
+            continue;
+        }
+        for (int i = 0; i < anti.container_groups_size(); i++) {
+            const DomainCounter* counter = FindCounter(anti.container_groups(i),
+                                                       anti.topology_key());
+            if (counter != NULL && counter->Count(it->second) > 0) {
+                err = proto::kAntiAffinity;
+                return false;
+            }
+        }
+    }
+    // and the groups keeping off this one
+    std::map<std::string, std::multiset<std::pair<std::string, std::string> > >::iterator it;
+    it = avoiders_.find(container->container_group_id);
+    if (it == avoiders_.end()) {
+        return true;
+    }
+    std::multiset<std::pair<std::string, std::string> >::iterator jt;
+    for (jt = it->second.begin(); jt != it->second.end(); jt++) {
+        TopologyLabels::const_iterator label = labels.find(jt->second);
+        if (label == labels.end()) {
+            continue;
+        }
+        const DomainCounter* counter = FindCounter(jt->first, jt->second);
+        if (counter != NULL && counter->Count(label->second) > 0) {
+            err = proto::kAntiAffinity;
+            return false;
+        }
+    }
+    return true;
+}
+
+} //namespace sched
+} //namespace galaxy
+} //namespace baidu
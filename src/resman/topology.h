@@ -0,0 +1,78 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "src/protocol/galaxy.pb.h"
+#include "mutex.h"
+
+namespace baidu {
+namespace galaxy {
+namespace sched {
+
+struct Container;
+
+// topology key -> domain, e.g. "rack" -> "yf01"
+typedef std::map<std::string, std::string> TopologyLabels;
+
+// replica counts of one container group over the domains of one topology key
+class DomainCounter {
+public:
+    void Inc(const std::string& domain);
+    void Dec(const std::string& domain);
+    int Count(const std::string& domain) const;
+    // smallest count among total domains, domains without replica count as zero
+    int MinCount(size_t total) const;
+    bool Empty() const {
+        return counts_.empty();
+    }
+private:
+    std::map<std::string, int> counts_; // only domains holding replicas
+    std::map<int, int> count_freq_;     // replica count -> number of domains
+};
+
+// Per-domain replica counters, maintained incrementally by Agent::Put/Evict,
+// so that checking spread and anti-affinity does not walk the agents.
+// Partitions of the scheduler place in parallel, so it locks by itself.
+class Topology {
+public:
+    static const std::string kHostKey;
+    void AddAgent(const std::string& pool_name, const TopologyLabels& labels);
+    void RemoveAgent(const std::string& pool_name, const TopologyLabels& labels);
+    void Place(const std::string& container_group_id, const TopologyLabels& labels);
+    void Unplace(const std::string& container_group_id, const TopologyLabels& labels);
+    // anti-affinities declared by a group, indexed by the groups they name,
+    // so that a replica of a named group keeps off the declaring group too
+    void AddAntiAffinities(const std::string& container_group_id,
+                           const std::vector<proto::AntiAffinity>& anti_affinities);
+    void RemoveAntiAffinities(const std::string& container_group_id,
+                              const std::vector<proto::AntiAffinity>& anti_affinities);
+    // whether another group keeps off this one
+    bool Avoided(const std::string& container_group_id);
+    bool Check(const Container* container, const TopologyLabels& labels,
+               proto::ResourceError& err);
+    typedef boost::shared_ptr<Topology> Ptr;
+private:
+    // number of domains of the key in any of the pools
+    size_t DomainsInPools(const std::string& key, const std::set<std::string>& pool_names);
+    const DomainCounter* FindCounter(const std::string& container_group_id,
+                                     const std::string& key) const;
+    // key -> pool -> domain -> number of agents
+    std::map<std::string, std::map<std::string, std::map<std::string, int> > > domains_;
+    // container group -> key -> counter
+    std::map<std::string, std::map<std::string, DomainCounter> > counters_;
+    // named group -> (declaring group, key), one for each declaration
+    std::map<std::string, std::multiset<std::pair<std::string, std::string> > > avoiders_;
+    // union of domains over several pools, dropped whenever agents change
+    std::map<std::string, size_t> domains_cache_;
+    Mutex mu_;
+};
+
+} //namespace sched
+} //namespace galaxy
+} //namespace baidu
@@ -0,0 +1,78 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "usage_histogram.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace baidu {
+namespace galaxy {
+namespace sched {
+
+UsageHistogram::UsageHistogram() : weights_(kBuckets, 0.0),
+                                   total_weight_(0.0),
+                                   need_(0),
+                                   last_time_(0),
+                                   samples_(0) {
+
+}
+
+void UsageHistogram::Reset() {
+    weights_.assign(kBuckets, 0.0);
+    total_weight_ = 0.0;
+    need_ = 0;
+    last_time_ = 0;
+    samples_ = 0;
+}
+
+void UsageHistogram::Decay(int64_t now, int64_t half_life) {
+    if (last_time_ == 0 || now <= last_time_ || half_life <= 0) {
+        return;
+    }
+    double factor = pow(0.5, static_cast<double>(now - last_time_) / half_life);
+    for (int i = 0; i < kBuckets; i++) {
+        weights_[i] *= factor;
+    }
+    total_weight_ *= factor;
+}
+
+void UsageHistogram::Add(int64_t used, int64_t need, int64_t now, int64_t half_life) {
+    if (need <= 0) {
+        return;
+    }
+    if (need != need_) {
+        // buckets are relative to need, the old ones mean nothing now
+        Reset();
+        need_ = need;
+    }
+    Decay(now, half_life);
+    last_time_ = now;
+    int bucket = kBuckets - 1;
+    if (used < need) {
+        bucket = static_cast<int>(std::max(used, (int64_t)0) * (kBuckets - 1) / need);
+    }
+    weights_[bucket] += 1.0;
+    total_weight_ += 1.0;
+    samples_++;
+}
+
+int64_t UsageHistogram::Percentile(double percentile, int min_samples) const {
+    if (samples_ < min_samples || samples_ == 0 || total_weight_ <= 0.0) {
+        return -1;
+    }
+    double threshold = total_weight_ * percentile;
+    double sum = 0.0;
+    for (int i = 0; i < kBuckets - 1; i++) {
+        sum += weights_[i];
+        if (sum >= threshold) {
+            // upper bound of the bucket, never under-estimate
+            return need_ * (i + 1) / (kBuckets - 1);
+        }
+    }
+    return need_;
+}
+
+} //namespace sched
+} //namespace galaxy
+} //namespace baidu
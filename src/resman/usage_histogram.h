@@ -0,0 +1,40 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace baidu {
+namespace galaxy {
+namespace sched {
+
+// Decayed histogram of resource usage, bucketed by percent of the need.
+// Older samples lose half of their weight every half_life microseconds,
+// so Percentile() follows recent usage without keeping raw samples.
+class UsageHistogram {
+public:
+    UsageHistogram();
+    void Add(int64_t used, int64_t need, int64_t now, int64_t half_life);
+    // return -1 if less than min_samples have been added since last reset
+    int64_t Percentile(double percentile, int min_samples) const;
+    void Reset();
+    int Samples() const {
+        return samples_;
+    }
+
+private:
+    void Decay(int64_t now, int64_t half_life);
+    // bucket i holds usage in [i%, (i+1)%) of need, the last one holds overflow
+    static const int kBuckets = 101;
+    std::vector<double> weights_;
+    double total_weight_;
+    int64_t need_;
+    int64_t last_time_;
+    int samples_;
+};
+
+} //namespace sched
+} //namespace galaxy
+} //namespace baidu
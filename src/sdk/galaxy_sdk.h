@@ -75,6 +75,11 @@ enum ResourceError {
     kPoolMismatch = 9,
     kTooManyPods = 10,
     kNoVolumContainer = 11,
+    kTooManyBatchPods = 12,
+    kTopologySkew = 13,
+    kAntiAffinity = 14,
+    kMemoryPressure = 15,
+    kGcBacklog = 16,
 };
 
 struct VolumResource {
@@ -110,8 +115,22 @@ struct TcpthrotRequired {
     int64_t send_bps_quota;
     bool send_bps_excess;
 };
+struct BlkioThrottle {
+    BlkioThrottle() :
+        read_bps(0),
+        write_bps(0),
+        read_iops(0),
+        write_iops(0) {}
+
+    std::string path; // dest_path of workspace or data volum
+    int64_t read_bps; // 0 means no limit
+    int64_t write_bps;
+    int64_t read_iops;
+    int64_t write_iops;
+};
 struct BlkioRequired {
     int32_t weight;
+    std::vector<BlkioThrottle> throttles;
 };
 struct PortRequired {
     std::string port_name;
@@ -192,6 +211,22 @@ struct DataPackage {
     std::vector<Package> packages;
     std::string reload_cmd;
 };
+// topology key is one of agent topology labels, e.g. rack/switch/zone,
+// "host" always refers to the agent itself
+struct TopologySpread {
+    TopologySpread() : max_skew(1) {}
+
+    std::string topology_key;
+    int32_t max_skew; // replicas a domain may hold more than the emptiest one
+};
+struct AntiAffinity {
+    std::string topology_key;
+    std::vector<std::string> container_groups; // ids of groups not to share a domain with
+};
+struct TopologyLabel {
+    std::string key;
+    std::string value;
+};
 struct Deploy {
     Deploy() : replica(1),
     step(1),
@@ -209,6 +244,8 @@ struct Deploy {
     std::vector<std::string> pools;
     uint32_t update_break_count;
     uint32_t stop_timeout;
+    std::vector<TopologySpread> spreads;
+    std::vector<AntiAffinity> anti_affinities;
 };
 struct Service {
     std::string service_name;
@@ -272,6 +309,8 @@ struct ContainerDescription {
     std::vector<std::string> pool_names;
     std::vector<std::string> volum_jobs; //dependent volum jobs' id 
     ContainerType container_type;
+    std::vector<TopologySpread> spreads;
+    std::vector<AntiAffinity> anti_affinities;
 };
 enum ContainerStatus {
     kContainerPending = 1,
@@ -387,6 +426,7 @@ struct AgentStatistics {
     Resource memory;
     std::vector<VolumResource> volums;
     uint32_t total_containers;
+    std::vector<TopologyLabel> topology;
 };
 struct ListAgentsResponse {
     ErrorCode error_code;
@@ -454,6 +494,14 @@ struct GetPoolByAgentResponse {
     ErrorCode error_code;
     std::string pool;
 };
+struct SetAgentTopologyRequest {
+    User user;
+    std::string endpoint;
+    std::vector<TopologyLabel> topology;
+};
+struct SetAgentTopologyResponse {
+    ErrorCode error_code;
+};
 struct AddUserRequest {
     User admin;
     User user;
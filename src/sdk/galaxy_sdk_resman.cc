@@ -68,6 +68,8 @@ public:
     bool ListAgentsByPool(const ListAgentsByPoolRequest& request, 
                           ListAgentsByPoolResponse* response);
     bool GetPoolByAgent(const GetPoolByAgentRequest& request, GetPoolByAgentResponse* response);
+    bool SetAgentTopology(const SetAgentTopologyRequest& request, 
+                          SetAgentTopologyResponse* response);
     bool AddUser(const AddUserRequest& request, AddUserResponse* response);
     bool RemoveUser(const RemoveUserRequest& request, RemoveUserResponse* response);
     bool ListUsers(const ListUsersRequest& request, ListUsersResponse* response);
@@ -451,6 +453,18 @@ bool ResourceManagerImpl::ShowContainerGroup(const ShowContainerGroupRequest& re
         response->desc.pool_names.push_back(pb_response.desc().pool_names(i));
     }
 
+    for (int i = 0; i < pb_response.desc().spreads().size(); ++i) {
+        TopologySpread spread;
+        FillSdkTopologySpread(pb_response.desc().spreads(i), &spread);
+        response->desc.spreads.push_back(spread);
+    }
+
+    for (int i = 0; i < pb_response.desc().anti_affinities().size(); ++i) {
+        AntiAffinity anti;
+        FillSdkAntiAffinity(pb_response.desc().anti_affinities(i), &anti);
+        response->desc.anti_affinities.push_back(anti);
+    }
+
     response->desc.workspace_volum.size = pb_response.desc().workspace_volum().size();
     response->desc.workspace_volum.type = (VolumType)pb_response.desc().workspace_volum().type();
     response->desc.workspace_volum.medium = (VolumMedium)pb_response.desc().workspace_volum().medium();
@@ -482,7 +496,7 @@ bool ResourceManagerImpl::ShowContainerGroup(const ShowContainerGroupRequest& re
         cgroup.cpu.excess = pb_cgroup.cpu().excess();
         cgroup.memory.size = pb_cgroup.memory().size();
         cgroup.memory.excess = pb_cgroup.memory().excess();
-        cgroup.blkio.weight = pb_cgroup.blkio().weight();
+        FillSdkBlkioRequired(pb_cgroup.blkio(), &cgroup.blkio);
         cgroup.tcp_throt.recv_bps_quota = pb_cgroup.tcp_throt().recv_bps_quota();
         cgroup.tcp_throt.recv_bps_excess = pb_cgroup.tcp_throt().recv_bps_excess();
         cgroup.tcp_throt.send_bps_quota = pb_cgroup.tcp_throt().send_bps_quota();
@@ -778,6 +792,13 @@ bool ResourceManagerImpl::ListAgents(const ListAgentsRequest& request,
         for (int j = 0; j < pb_agent.tags().size(); ++j) {
             agent.tags.push_back(pb_agent.tags(j));
         }
+
+        for (int j = 0; j < pb_agent.topology().size(); ++j) {
+            TopologyLabel label;
+            label.key = pb_agent.topology(j).key();
+            label.value = pb_agent.topology(j).value();
+            agent.topology.push_back(label);
+        }
         response->agents.push_back(agent);
     }
 
@@ -917,6 +938,13 @@ bool ResourceManagerImpl::ListAgentsByTag(const ListAgentsByTagRequest& request,
         for (int j = 0; j < pb_agent.tags().size(); ++j) {
             agent.tags.push_back(pb_agent.tags(j));
         }
+
+        for (int j = 0; j < pb_agent.topology().size(); ++j) {
+            TopologyLabel label;
+            label.key = pb_agent.topology(j).key();
+            label.value = pb_agent.topology(j).value();
+            agent.topology.push_back(label);
+        }
         response->agents.push_back(agent);
     }
 
@@ -1090,6 +1118,13 @@ bool ResourceManagerImpl::ListAgentsByPool(const ListAgentsByPoolRequest& reques
         for (int j = 0; j < pb_agent.tags().size(); ++j) {
             agent.tags.push_back(pb_agent.tags(j));
         }
+
+        for (int j = 0; j < pb_agent.topology().size(); ++j) {
+            TopologyLabel label;
+            label.key = pb_agent.topology(j).key();
+            label.value = pb_agent.topology(j).value();
+            agent.topology.push_back(label);
+        }
         response->agents.push_back(agent);
     }
 
@@ -1130,6 +1165,44 @@ bool ResourceManagerImpl::GetPoolByAgent(const GetPoolByAgentRequest& request,
     return true;
 }
 
+bool ResourceManagerImpl::SetAgentTopology(const SetAgentTopologyRequest& request, 
+                                           SetAgentTopologyResponse* response) {
+    ::baidu::galaxy::proto::SetAgentTopologyRequest pb_request;
+    ::baidu::galaxy::proto::SetAgentTopologyResponse pb_response;
+    
+    if (!FillUser(request.user, pb_request.mutable_user())) {
+        return false;
+    }
+    
+    std::string endpoint = Strim(request.endpoint);
+    if (endpoint.empty() || !CheckEndPoint(endpoint)) {
+        fprintf(stderr, "endpoint is needed\n");
+        return false;
+    }
+    pb_request.set_endpoint(endpoint);
+
+    for (size_t i = 0; i < request.topology.size(); ++i) {
+        if (!FillTopologyLabel(request.topology[i], pb_request.add_topology())) {
+            return false;
+        }
+    }
+
+    bool ok = rpc_client_->SendRequest(res_stub_, 
+                                        &::baidu::galaxy::proto::ResMan_Stub::SetAgentTopology, 
+                                        &pb_request, &pb_response, 5, 1);
+    if (!ok) {
+        response->error_code.reason = "ResourceManager Rpc SendRequest failed";
+        return false;
+    }
+
+    response->error_code.status = (::baidu::galaxy::sdk::Status)pb_response.error_code().status();
+    response->error_code.reason = pb_response.error_code().reason();
+    if (response->error_code.status != kOk) {
+        return false;
+    }
+    return true;
+}
+
 bool ResourceManagerImpl::AddUser(const AddUserRequest& request, AddUserResponse* response) {
     ::baidu::galaxy::proto::AddUserRequest pb_request;
     ::baidu::galaxy::proto::AddUserResponse pb_response;
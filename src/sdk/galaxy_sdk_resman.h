@@ -66,6 +66,9 @@ public:
                                   ListAgentsByPoolResponse* response) = 0;
     virtual bool GetPoolByAgent(const GetPoolByAgentRequest& request, 
                                 GetPoolByAgentResponse* response) = 0;
+    //Topology
+    virtual bool SetAgentTopology(const SetAgentTopologyRequest& request, 
+                                  SetAgentTopologyResponse* response) = 0;
 
     //User
     virtual bool AddUser(const AddUserRequest& request, AddUserResponse* response) = 0;
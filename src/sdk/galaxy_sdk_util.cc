@@ -171,6 +171,106 @@ bool FillBlkioRequired(const BlkioRequired& sdk_blk,
         return false;
     }
     blk->set_weight(sdk_blk.weight);
+    for (size_t i = 0; i < sdk_blk.throttles.size(); ++i) {
+        const BlkioThrottle& sdk_throttle = sdk_blk.throttles[i];
+        if (sdk_throttle.path.empty()) {
+            fprintf(stderr, "path of blkio throttle is needed\n");
+            return false;
+        }
+        if (sdk_throttle.read_bps < 0 || sdk_throttle.write_bps < 0
+                || sdk_throttle.read_iops < 0 || sdk_throttle.write_iops < 0) {
+            fprintf(stderr, "blkio throttle of %s must not be negative\n", sdk_throttle.path.c_str());
+            return false;
+        }
+        ::baidu::galaxy::proto::BlkioThrottle* throttle = blk->add_throttles();
+        throttle->set_path(sdk_throttle.path);
+        throttle->set_read_bps(sdk_throttle.read_bps);
+        throttle->set_write_bps(sdk_throttle.write_bps);
+        throttle->set_read_iops(sdk_throttle.read_iops);
+        throttle->set_write_iops(sdk_throttle.write_iops);
+    }
+    return true;
+}
+
+void FillSdkBlkioRequired(const ::baidu::galaxy::proto::BlkioRequired& blk,
+                          BlkioRequired* sdk_blk) {
+    sdk_blk->weight = blk.weight();
+    sdk_blk->throttles.clear();
+    for (int i = 0; i < blk.throttles_size(); ++i) {
+        BlkioThrottle sdk_throttle;
+        sdk_throttle.path = blk.throttles(i).path();
+        sdk_throttle.read_bps = blk.throttles(i).read_bps();
+        sdk_throttle.write_bps = blk.throttles(i).write_bps();
+        sdk_throttle.read_iops = blk.throttles(i).read_iops();
+        sdk_throttle.write_iops = blk.throttles(i).write_iops();
+        sdk_blk->throttles.push_back(sdk_throttle);
+    }
+}
+
+bool FillTopologySpread(const TopologySpread& sdk_spread,
+                        ::baidu::galaxy::proto::TopologySpread* spread) {
+    std::string topology_key = Strim(sdk_spread.topology_key);
+    if (topology_key.empty()) {
+        fprintf(stderr, "topology_key of spread is needed\n");
+        return false;
+    }
+    if (sdk_spread.max_skew < 1) {
+        fprintf(stderr, "max_skew of spread on %s must be greater than 0\n", topology_key.c_str());
+        return false;
+    }
+    spread->set_topology_key(topology_key);
+    spread->set_max_skew(sdk_spread.max_skew);
+    return true;
+}
+
+void FillSdkTopologySpread(const ::baidu::galaxy::proto::TopologySpread& spread,
+                           TopologySpread* sdk_spread) {
+    sdk_spread->topology_key = spread.topology_key();
+    sdk_spread->max_skew = spread.max_skew();
+}
+
+bool FillAntiAffinity(const AntiAffinity& sdk_anti,
+                      ::baidu::galaxy::proto::AntiAffinity* anti) {
+    std::string topology_key = Strim(sdk_anti.topology_key);
+    if (topology_key.empty()) {
+        fprintf(stderr, "topology_key of anti_affinity is needed\n");
+        return false;
+    }
+    if (sdk_anti.container_groups.size() == 0) {
+        fprintf(stderr, "container_groups of anti_affinity on %s is needed\n", topology_key.c_str());
+        return false;
+    }
+    anti->set_topology_key(topology_key);
+    for (size_t i = 0; i < sdk_anti.container_groups.size(); ++i) {
+        std::string container_group = Strim(sdk_anti.container_groups[i]);
+        if (container_group.empty()) {
+            fprintf(stderr, "container_groups[%d] of anti_affinity must not be empty\n", (int)i);
+            return false;
+        }
+        anti->add_container_groups(container_group);
+    }
+    return true;
+}
+
+void FillSdkAntiAffinity(const ::baidu::galaxy::proto::AntiAffinity& anti,
+                         AntiAffinity* sdk_anti) {
+    sdk_anti->topology_key = anti.topology_key();
+    sdk_anti->container_groups.clear();
+    for (int i = 0; i < anti.container_groups_size(); ++i) {
+        sdk_anti->container_groups.push_back(anti.container_groups(i));
+    }
+}
+
+bool FillTopologyLabel(const TopologyLabel& sdk_label,
+                       ::baidu::galaxy::proto::TopologyLabel* label) {
+    std::string key = Strim(sdk_label.key);
+    std::string value = Strim(sdk_label.value);
+    if (key.empty() || value.empty()) {
+        fprintf(stderr, "topology label must be key=value\n");
+        return false;
+    }
+    label->set_key(key);
+    label->set_value(value);
     return true;
 }
 
@@ -346,6 +446,18 @@ bool FillContainerDescription(const ContainerDescription& sdk_container,
         return false;
     }
 
+    for (size_t i = 0; i < sdk_container.spreads.size(); ++i) {
+        if (!FillTopologySpread(sdk_container.spreads[i], container->add_spreads())) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < sdk_container.anti_affinities.size(); ++i) {
+        if (!FillAntiAffinity(sdk_container.anti_affinities[i], container->add_anti_affinities())) {
+            return false;
+        }
+    }
+
     if(sdk_container.container_type == kVolumContainer) {
         container->set_container_type(::baidu::galaxy::proto::kVolumContainer);
     } else if (sdk_container.container_type == kNormalContainer) {
@@ -715,7 +827,22 @@ bool FillDeploy(const Deploy& sdk_deploy, ::baidu::galaxy::proto::Deploy* deploy
         }
         deploy->add_pools(pool);
     }
-    return ok;
+    if (!ok) {
+        return false;
+    }
+
+    for (size_t i = 0; i < sdk_deploy.spreads.size(); ++i) {
+        if (!FillTopologySpread(sdk_deploy.spreads[i], deploy->add_spreads())) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < sdk_deploy.anti_affinities.size(); ++i) {
+        if (!FillAntiAffinity(sdk_deploy.anti_affinities[i], deploy->add_anti_affinities())) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool FillJobDescription(const JobDescription& sdk_job,
@@ -869,6 +996,18 @@ void PbJobDescription2SdkJobDescription(const ::baidu::galaxy::proto::JobDescrip
     for (int i = 0; i < pb_job.deploy().pools().size(); ++i) {
         job->deploy.pools.push_back(pb_job.deploy().pools(i));
     }
+
+    for (int i = 0; i < pb_job.deploy().spreads().size(); ++i) {
+        TopologySpread spread;
+        FillSdkTopologySpread(pb_job.deploy().spreads(i), &spread);
+        job->deploy.spreads.push_back(spread);
+    }
+
+    for (int i = 0; i < pb_job.deploy().anti_affinities().size(); ++i) {
+        AntiAffinity anti;
+        FillSdkAntiAffinity(pb_job.deploy().anti_affinities(i), &anti);
+        job->deploy.anti_affinities.push_back(anti);
+    }
     
     job->pod.workspace_volum.size = pb_job.pod().workspace_volum().size();
     job->pod.workspace_volum.type = (VolumType)pb_job.pod().workspace_volum().type();
@@ -906,7 +1045,7 @@ void PbJobDescription2SdkJobDescription(const ::baidu::galaxy::proto::JobDescrip
         task.tcp_throt.recv_bps_excess = pb_job.pod().tasks(i).tcp_throt().recv_bps_excess();
         task.tcp_throt.send_bps_quota = pb_job.pod().tasks(i).tcp_throt().send_bps_quota();
         task.tcp_throt.send_bps_excess = pb_job.pod().tasks(i).tcp_throt().send_bps_excess();
-        task.blkio.weight = pb_job.pod().tasks(i).blkio().weight();
+        FillSdkBlkioRequired(pb_job.pod().tasks(i).blkio(), &task.blkio);
         for (int j = 0; j < pb_job.pod().tasks(i).ports().size(); ++j) {
             PortRequired port;
             port.port_name = pb_job.pod().tasks(i).ports(j).port_name();
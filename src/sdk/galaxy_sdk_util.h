@@ -19,6 +19,12 @@ bool FillCpuRequired(const CpuRequired& sdk_cpu, ::baidu::galaxy::proto::CpuRequ
 bool FillMemRequired(const MemoryRequired& sdk_mem, ::baidu::galaxy::proto::MemoryRequired* mem);
 bool FillTcpthrotRequired(const TcpthrotRequired& sdk_tcp, ::baidu::galaxy::proto::TcpthrotRequired* tcp);
 bool FillBlkioRequired(const BlkioRequired& sdk_blk, ::baidu::galaxy::proto::BlkioRequired* blk);
+void FillSdkBlkioRequired(const ::baidu::galaxy::proto::BlkioRequired& blk, BlkioRequired* sdk_blk);
+bool FillTopologySpread(const TopologySpread& sdk_spread, ::baidu::galaxy::proto::TopologySpread* spread);
+void FillSdkTopologySpread(const ::baidu::galaxy::proto::TopologySpread& spread, TopologySpread* sdk_spread);
+bool FillAntiAffinity(const AntiAffinity& sdk_anti, ::baidu::galaxy::proto::AntiAffinity* anti);
+void FillSdkAntiAffinity(const ::baidu::galaxy::proto::AntiAffinity& anti, AntiAffinity* sdk_anti);
+bool FillTopologyLabel(const TopologyLabel& sdk_label, ::baidu::galaxy::proto::TopologyLabel* label);
 bool FillPortRequired(const PortRequired& sdk_port, ::baidu::galaxy::proto::PortRequired* port);
 bool FillCgroup(const Cgroup& sdk_cgroup, 
                 ::baidu::galaxy::proto::Cgroup* cgroup,
@@ -0,0 +1,56 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_CGROUP_COLLECTOR_ON
+#include "agent/cgroup/cgroup_collector.h"
+
+#include <string.h>
+
+TEST(TestCgroupCollector, ParseBlkioStat) {
+    const char* content = "8:16 Read 4096\n"
+                          "8:16 Write 8192\n"
+                          "8:16 Sync 8192\n"
+                          "8:16 Async 4096\n"
+                          "8:16 Total 12288\n"
+                          "8:0 Read 100\n"
+                          "8:0 Write 200\n"
+                          "8:0 Total 300\n"
+                          "Total 12588\n";
+    int64_t read = -1;
+    int64_t write = -1;
+    EXPECT_TRUE(baidu::galaxy::cgroup::CgroupCollector::ParseBlkioStat(content,
+                content + strlen(content), read, write));
+    EXPECT_EQ(4196, read);
+    EXPECT_EQ(8392, write);
+
+    // no io yet
+    const char* empty = "Total 0\n";
+    EXPECT_TRUE(baidu::galaxy::cgroup::CgroupCollector::ParseBlkioStat(empty,
+                empty + strlen(empty), read, write));
+    EXPECT_EQ(0, read);
+    EXPECT_EQ(0, write);
+    EXPECT_FALSE(baidu::galaxy::cgroup::CgroupCollector::ParseBlkioStat(NULL, NULL, read, write));
+}
+
+TEST(TestCgroupCollector, ParseIoStat) {
+    const char* content = "8:16 rbytes=4096 wbytes=8192 rios=1 wios=2 dbytes=0 dios=0\n"
+                          "8:0 rbytes=100 wbytes=200 rios=3 wios=4 dbytes=0 dios=0\n";
+    int64_t values[] = {-1L, -1L, -1L, -1L};
+    EXPECT_TRUE(baidu::galaxy::cgroup::CgroupCollector::ParseIoStat(content,
+                content + strlen(content), values));
+    EXPECT_EQ(4196, values[0]);
+    EXPECT_EQ(8392, values[1]);
+    EXPECT_EQ(4, values[2]);
+    EXPECT_EQ(6, values[3]);
+
+    // io.stat is empty until the cgroup does io
+    const char* empty = "";
+    EXPECT_TRUE(baidu::galaxy::cgroup::CgroupCollector::ParseIoStat(empty, empty, values));
+    EXPECT_EQ(0, values[0]);
+    EXPECT_EQ(0, values[3]);
+}
+
+#endif
@@ -0,0 +1,127 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_CONSTRUCT_POOL_ON
+#include "agent/container/construct_pool.h"
+#include "protocol/galaxy.pb.h"
+
+#include "boost/bind.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+class TestConstructPool : public testing::Test {
+public:
+    TestConstructPool() :
+        running_(0),
+        max_running_(0) {
+    }
+
+    void Record(int value) {
+        boost::mutex::scoped_lock lock(mutex_);
+        order_.push_back(value);
+    }
+
+    void Block(int usec) {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            running_++;
+            max_running_ = std::max(max_running_, running_);
+        }
+
+        ::usleep(usec);
+        boost::mutex::scoped_lock lock(mutex_);
+        running_--;
+    }
+
+protected:
+    boost::mutex mutex_;
+    std::vector<int> order_;
+    int running_;
+    int max_running_;
+};
+
+TEST_F(TestConstructPool, Priority) {
+    baidu::galaxy::container::ConstructPool pool(1, 1, 16);
+    std::vector<std::string> disks;
+    // queued before start, so they are taken in order of priority
+    EXPECT_TRUE(pool.Submit("batch", 200, disks, boost::bind(&TestConstructPool::Record, this, 200), NULL));
+    EXPECT_TRUE(pool.Submit("service1", 100, disks, boost::bind(&TestConstructPool::Record, this, 100), NULL));
+    EXPECT_TRUE(pool.Submit("best_effort", 300, disks, boost::bind(&TestConstructPool::Record, this, 300), NULL));
+    EXPECT_TRUE(pool.Submit("service2", 100, disks, boost::bind(&TestConstructPool::Record, this, 101), NULL));
+    pool.Start();
+
+    for (int i = 0; i < 100 && order_.size() < 4; i++) {
+        ::usleep(10000);
+    }
+
+    pool.Stop();
+    ASSERT_EQ(4u, order_.size());
+    EXPECT_EQ(100, order_[0]);
+    EXPECT_EQ(101, order_[1]);
+    EXPECT_EQ(200, order_[2]);
+    EXPECT_EQ(300, order_[3]);
+}
+
+TEST_F(TestConstructPool, Capacity) {
+    baidu::galaxy::container::ConstructPool pool(1, 1, 2);
+    std::vector<std::string> disks;
+    EXPECT_TRUE(pool.Submit("c1", 100, disks, boost::bind(&TestConstructPool::Record, this, 1), NULL));
+    EXPECT_TRUE(pool.Submit("c2", 100, disks, boost::bind(&TestConstructPool::Record, this, 2), NULL));
+    EXPECT_FALSE(pool.Submit("c3", 100, disks, boost::bind(&TestConstructPool::Record, this, 3), NULL));
+    baidu::galaxy::proto::ConstructMetrix metrix;
+    pool.Statistics(&metrix);
+    EXPECT_EQ(2, metrix.queued());
+    EXPECT_EQ(1, metrix.rejected());
+}
+
+TEST_F(TestConstructPool, CancelOnStop) {
+    baidu::galaxy::container::ConstructPool pool(1, 1, 16);
+    std::vector<std::string> disks;
+    EXPECT_TRUE(pool.Submit("c1", 100, disks, boost::bind(&TestConstructPool::Record, this, 1),
+                boost::bind(&TestConstructPool::Record, this, -1)));
+    EXPECT_TRUE(pool.Submit("c2", 100, disks, boost::bind(&TestConstructPool::Record, this, 2),
+                boost::bind(&TestConstructPool::Record, this, -2)));
+    // never started, both are given back
+    pool.Stop();
+    ASSERT_EQ(2u, order_.size());
+    EXPECT_EQ(-1, order_[0]);
+    EXPECT_EQ(-2, order_[1]);
+    baidu::galaxy::proto::ConstructMetrix metrix;
+    pool.Statistics(&metrix);
+    EXPECT_EQ(0, metrix.queued());
+}
+
+TEST_F(TestConstructPool, PerDisk) {
+    baidu::galaxy::container::ConstructPool pool(4, 1, 16);
+    std::vector<std::string> disks(1, "/home/disk1");
+    pool.Start();
+
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(pool.Submit("c", 100, disks, boost::bind(&TestConstructPool::Block, this, 20000), NULL));
+    }
+
+    ::usleep(200000);
+    pool.Stop();
+    // four threads, but only one construction on the disk at a time
+    EXPECT_EQ(1, max_running_);
+
+    baidu::galaxy::container::ConstructCost cost;
+    cost.cgroup = 1000;
+    cost.volum = 8000;
+    pool.RecordCost(true, cost);
+    pool.RecordCost(false, cost);
+    baidu::galaxy::proto::ConstructMetrix metrix;
+    pool.Statistics(&metrix);
+    EXPECT_EQ(1, metrix.finished());
+    EXPECT_EQ(1, metrix.failed());
+    EXPECT_EQ(1000, metrix.cgroup_latency());
+    EXPECT_EQ(8000, metrix.volum_latency());
+}
+
+#endif
@@ -0,0 +1,114 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_CONTAINER_GC_ON
+#include "agent/container/container_gc.h"
+#include "protocol/galaxy.pb.h"
+#include "timer.h"
+
+#include "boost/filesystem/operations.hpp"
+#include "boost/lexical_cast.hpp"
+#include <gflags/gflags.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+
+DECLARE_int64(gc_delay_time);
+DECLARE_int64(gc_inodes_per_second);
+
+class TestContainerGc : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+        FLAGS_gc_delay_time = 0;
+    }
+
+    static void TearDownTestCase() {
+        boost::filesystem::remove_all("./gc_test");
+    }
+
+    // a gc dir whose property lists a volum with files files
+    static std::string Prepare(const std::string& name, int files) {
+        const std::string dir = "./gc_test/gc/" + name;
+        const std::string volum = "./gc_test/volum/" + name;
+        boost::filesystem::create_directories(dir + "/root/etc");
+        boost::filesystem::create_directories(volum + "/a/b/c");
+        boost::filesystem::create_directories("./gc_test/keep");
+        std::ofstream keep("./gc_test/keep/file");
+        keep << "keep";
+        keep.close();
+
+        for (int i = 0; i < files; i++) {
+            std::ofstream f((volum + "/a/b/" + boost::lexical_cast<std::string>(i)).c_str());
+            f << "data of " << i;
+        }
+
+        // not followed
+        ::symlink("../../keep", (volum + "/a/link").c_str());
+        std::ofstream property((dir + "/container.property").c_str());
+        property << "phy_gc_root_path : " << volum << "\n";
+        return dir;
+    }
+
+    // until finished gc dirs are expect
+    static bool Wait(baidu::galaxy::container::ContainerGc& gc, int expect, int wait_ms) {
+        for (int i = 0; i < wait_ms / 10; i++) {
+            baidu::galaxy::proto::GcMetrix metrix;
+            gc.Statistics(&metrix);
+
+            if (metrix.finished() == expect) {
+                return true;
+            }
+
+            ::usleep(10000);
+        }
+
+        return false;
+    }
+};
+
+TEST_F(TestContainerGc, Gc) {
+    const std::string dir = Prepare("container1", 10);
+    baidu::galaxy::container::ContainerGc gc;
+    gc.Gc(dir);
+    baidu::galaxy::proto::GcMetrix metrix;
+    gc.Statistics(&metrix);
+    EXPECT_EQ(1, metrix.backlog());
+    EXPECT_EQ(0, gc.Setup().Code());
+
+    EXPECT_TRUE(Wait(gc, 1, 3000));
+    EXPECT_FALSE(boost::filesystem::exists(dir));
+    EXPECT_FALSE(boost::filesystem::exists("./gc_test/volum/container1"));
+    EXPECT_TRUE(boost::filesystem::exists("./gc_test/keep/file"));
+
+    metrix.Clear();
+    gc.Statistics(&metrix);
+    EXPECT_EQ(0, metrix.backlog());
+    EXPECT_EQ(1, metrix.finished());
+    EXPECT_EQ(0, metrix.failed());
+    // 10 files, a link, 4 dirs in volum, 1 file and 3 dirs in gc dir
+    EXPECT_EQ(19, metrix.removed_inodes());
+    EXPECT_GT(metrix.removed_bytes(), 0);
+}
+
+TEST_F(TestContainerGc, Throttle) {
+    FLAGS_gc_inodes_per_second = 100;
+    const std::string dir = Prepare("container2", 150);
+    baidu::galaxy::container::ContainerGc gc;
+    gc.Gc(dir);
+    int64_t start = baidu::common::timer::get_micros();
+    EXPECT_EQ(0, gc.Setup().Code());
+
+    EXPECT_TRUE(Wait(gc, 1, 5000));
+    EXPECT_GE(baidu::common::timer::get_micros() - start, 1400000);
+    baidu::galaxy::proto::GcMetrix metrix;
+    gc.Statistics(&metrix);
+    EXPECT_EQ(1, metrix.devices());
+    EXPECT_FALSE(boost::filesystem::exists(dir));
+}
+
+#endif
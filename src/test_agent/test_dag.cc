@@ -0,0 +1,133 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_DAG_ON
+#include "agent/util/dag.h"
+#include "timer.h"
+
+#include "boost/bind.hpp"
+#include "boost/lexical_cast.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+class TestDag : public testing::Test {
+public:
+    TestDag() :
+        running_(0),
+        max_running_(0) {
+    }
+
+    baidu::galaxy::util::ErrorCode Run(const std::string& step, int usec, bool ok) {
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+            running_++;
+            max_running_ = std::max(max_running_, running_);
+        }
+
+        ::usleep(usec);
+        boost::mutex::scoped_lock lock(mutex_);
+        running_--;
+        order_.push_back(step);
+        return ok ? ERRORCODE_OK : ERRORCODE(-1, "%s failed", step.c_str());
+    }
+
+    void Rollback(const std::string& step) {
+        boost::mutex::scoped_lock lock(mutex_);
+        rollback_.push_back(step);
+    }
+
+    int Index(const std::string& step) {
+        return std::find(order_.begin(), order_.end(), step) - order_.begin();
+    }
+
+protected:
+    boost::mutex mutex_;
+    std::vector<std::string> order_;
+    std::vector<std::string> rollback_;
+    int running_;
+    int max_running_;
+};
+
+TEST_F(TestDag, Order) {
+    baidu::galaxy::util::Dag dag("order");
+    dag.AddStep("cgroup", boost::bind(&TestDag::Run, this, "cgroup", 20000, true));
+    dag.AddStep("workspace", boost::bind(&TestDag::Run, this, "workspace", 1000, true));
+    dag.AddStep("data", boost::bind(&TestDag::Run, this, "data", 1000, true));
+    dag.AddStep("process", boost::bind(&TestDag::Run, this, "process", 1000, true));
+    dag.AddDependency("data", "workspace");
+    dag.AddDependency("process", "cgroup");
+    dag.AddDependency("process", "data");
+    EXPECT_EQ(0, dag.Run(4).Code());
+    EXPECT_EQ(4u, order_.size());
+    EXPECT_LT(Index("workspace"), Index("data"));
+    EXPECT_LT(Index("cgroup"), Index("process"));
+    EXPECT_LT(Index("data"), Index("process"));
+    EXPECT_GE(dag.Duration("cgroup"), 20000);
+    EXPECT_GE(dag.Elapsed("process"), dag.Elapsed("cgroup"));
+}
+
+TEST_F(TestDag, Concurrency) {
+    baidu::galaxy::util::Dag dag("concurrency");
+    dag.AddStep("join", baidu::galaxy::util::Dag::Action());
+
+    for (int i = 0; i < 6; i++) {
+        std::string step = "volum" + boost::lexical_cast<std::string>(i);
+        dag.AddStep(step, boost::bind(&TestDag::Run, this, step, 100000, true));
+        dag.AddDependency("join", step);
+    }
+
+    int64_t start = baidu::common::timer::get_micros();
+    EXPECT_EQ(0, dag.Run(8).Code());
+    EXPECT_LT(baidu::common::timer::get_micros() - start, 300000);
+    EXPECT_EQ(6, max_running_);
+
+    // runs again with one thread
+    max_running_ = 0;
+    EXPECT_EQ(0, dag.Run(1).Code());
+    EXPECT_EQ(1, max_running_);
+    EXPECT_EQ(12u, order_.size());
+}
+
+TEST_F(TestDag, Rollback) {
+    baidu::galaxy::util::Dag dag("rollback");
+    dag.AddStep("cgroup",
+            boost::bind(&TestDag::Run, this, "cgroup", 1000, true),
+            boost::bind(&TestDag::Rollback, this, "cgroup"));
+    dag.AddStep("workspace",
+            boost::bind(&TestDag::Run, this, "workspace", 1000, true),
+            boost::bind(&TestDag::Rollback, this, "workspace"));
+    dag.AddStep("data",
+            boost::bind(&TestDag::Run, this, "data", 50000, false),
+            boost::bind(&TestDag::Rollback, this, "data"));
+    dag.AddStep("process",
+            boost::bind(&TestDag::Run, this, "process", 1000, true),
+            boost::bind(&TestDag::Rollback, this, "process"));
+    dag.AddDependency("cgroup", "workspace");
+    dag.AddDependency("process", "cgroup");
+    dag.AddDependency("process", "data");
+    EXPECT_NE(0, dag.Run(4).Code());
+    // process never starts, the failed step is not rolled back
+    EXPECT_EQ(3u, order_.size());
+    EXPECT_EQ(-1, dag.Duration("process"));
+    ASSERT_EQ(2u, rollback_.size());
+    EXPECT_EQ("cgroup", rollback_[0]);
+    EXPECT_EQ("workspace", rollback_[1]);
+}
+
+TEST_F(TestDag, Cycle) {
+    baidu::galaxy::util::Dag dag("cycle");
+    dag.AddStep("a", boost::bind(&TestDag::Run, this, "a", 0, true));
+    dag.AddStep("b", boost::bind(&TestDag::Run, this, "b", 0, true));
+    dag.AddDependency("a", "b");
+    dag.AddDependency("b", "a");
+    EXPECT_NE(0, dag.Run(2).Code());
+    EXPECT_TRUE(order_.empty());
+}
+
+#endif
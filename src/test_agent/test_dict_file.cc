@@ -5,6 +5,7 @@
 #include "unit_test.h"
 #ifdef TEST_DICT_FILE_ON
 #include "agent/util/dict_file.h"
+#include "boost/bind.hpp"
 #include <sstream>
 
 namespace baidu {
@@ -12,6 +13,16 @@ namespace galaxy {
 namespace test {
 
 class TestDictFile : public testing::Test {
+public:
+    // collects up to limit values
+    static bool Collect(std::vector<std::string>* values,
+            size_t limit,
+            const leveldb::Slice& key,
+            const leveldb::Slice& value) {
+        values->push_back(value.ToString());
+        return values->size() < limit;
+    }
+
 protected:
     static void SetUpTestCase() {}
     static void TearDownTestCase() {
@@ -70,6 +81,34 @@ TEST_F(TestDictFile, nornal) {
         EXPECT_STREQ(v[3].value.c_str(), "70");
     }
 }
+
+TEST_F(TestDictFile, Visit) {
+    baidu::galaxy::file::DictFile df("./unittest_dict_file_visit");
+    EXPECT_TRUE(df.IsOpen());
+
+    for (int i = 0; i < 10; i ++) {
+        std::stringstream ss1;
+        ss1 << i;
+        std::stringstream ss2;
+        ss2 << i * 10;
+        EXPECT_EQ(df.Write(ss1.str(), ss2.str()).Code(), 0);
+    }
+
+    std::vector<std::string> values;
+    baidu::galaxy::util::ErrorCode ec = df.Visit("3", "8",
+            boost::bind(&TestDictFile::Collect, &values, 100, _1, _2));
+    EXPECT_EQ(ec.Code(), 0) << ec.Message();
+    EXPECT_EQ(values.size(), (size_t)6);
+    EXPECT_STREQ(values[0].c_str(), "30");
+    EXPECT_STREQ(values[5].c_str(), "80");
+
+    // stopped by the visitor
+    values.clear();
+    ec = df.Visit("0", "9", boost::bind(&TestDictFile::Collect, &values, 2, _1, _2));
+    EXPECT_EQ(ec.Code(), 0) << ec.Message();
+    EXPECT_EQ(values.size(), (size_t)2);
+    system("rm unittest_dict_file_visit -rf");
+}
 }
 }
 }
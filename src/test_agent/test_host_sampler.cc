@@ -0,0 +1,136 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_HOST_SAMPLER_ON
+#include "agent/collector/host_sampler.h"
+#include "agent/util/error_code.h"
+
+#include <stdlib.h>
+
+class TestHostSampler : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+    }
+
+    static void TearDownTestCase() {
+    }
+};
+
+TEST_F(TestHostSampler, Parse)
+{
+    baidu::galaxy::collector::HostSnapshot snapshot;
+    baidu::galaxy::util::ErrorCode ec = baidu::galaxy::collector::HostSampler::ParseStat(
+            "cpu  100 10 50 800 40 0 0 0 0 0\ncpu0 100 10 50 800 40 0 0 0 0 0\n", &snapshot);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(1000, snapshot.cpu_total_time);
+    EXPECT_EQ(840, snapshot.cpu_idle_time);
+
+    ec = baidu::galaxy::collector::HostSampler::ParseMeminfo(
+            "MemTotal:       1000 kB\nMemFree:         200 kB\nMemAvailable:    600 kB\nCached:          300 kB\n", &snapshot);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(1000 * 1024, snapshot.memory_total);
+    EXPECT_EQ(600 * 1024, snapshot.memory_available);
+    EXPECT_EQ(300 * 1024, snapshot.memory_cached);
+
+    ec = baidu::galaxy::collector::HostSampler::ParseLoadavg("0.20 0.18 0.12 1/80 11206\n", &snapshot);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_DOUBLE_EQ(0.20, snapshot.load1);
+
+    // partitions as in /sys/class/block
+    ASSERT_EQ(0, system("rm -rf ./host_sampler_block && mkdir -p ./host_sampler_block/sda1"
+                " ./host_sampler_block/nvme0n1p1 && touch ./host_sampler_block/sda1/partition"
+                " ./host_sampler_block/nvme0n1p1/partition"));
+    ec = baidu::galaxy::collector::HostSampler::ParseDiskstats(
+            "   8       0 sda 10 0 100 5 20 0 200 10 0 300 15\n"
+            "   8       1 sda1 10 0 100 5 20 0 200 10 0 300 15\n"
+            "   7       0 loop0 1 0 1 0 0 0 0 0 0 0 0\n"
+            " 259       0 nvme0n1 10 0 100 5 20 0 200 10 0 300 15\n"
+            " 259       1 nvme0n1p1 10 0 100 5 20 0 200 10 0 300 15\n"
+            " 259       9 nvme0n10 10 0 100 5 20 0 200 10 0 300 15\n"
+            " 253       1 dm-1 10 0 100 5 20 0 200 10 0 300 15\n"
+            " 253      10 dm-10 10 0 100 5 20 0 200 10 0 300 15\n",
+            "./host_sampler_block", &snapshot);
+    system("rm -rf ./host_sampler_block");
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(5, snapshot.disks.size());
+    EXPECT_EQ(200, snapshot.disks["sda"].sectors_written);
+    EXPECT_EQ(300, snapshot.disks["nvme0n1"].io_ticks);
+    EXPECT_EQ(1, snapshot.disks.count("nvme0n10"));
+    EXPECT_EQ(1, snapshot.disks.count("dm-10"));
+    EXPECT_EQ(0, snapshot.disks.count("sda1"));
+}
+
+TEST_F(TestHostSampler, CalculateRate)
+{
+    baidu::galaxy::collector::HostSnapshot last;
+    last.time = 1000000L;
+    last.cpu_total_time = 1000;
+    last.cpu_idle_time = 800;
+    last.disks["sda"].sectors_written = 0;
+    last.disks["sda"].io_ticks = 0;
+
+    baidu::galaxy::collector::HostSnapshot snapshot;
+    snapshot.time = 2000000L;
+    snapshot.cpu_total_time = 2000;
+    snapshot.cpu_idle_time = 1300;
+    snapshot.disks["sda"].sectors_written = 2048;
+    snapshot.disks["sda"].io_ticks = 500;
+
+    baidu::galaxy::collector::HostSampler::CalculateRate(last, &snapshot);
+    EXPECT_EQ(500L * sysconf(_SC_NPROCESSORS_CONF), snapshot.cpu_used_in_millicore);
+    EXPECT_EQ(2048 * 512, snapshot.disks["sda"].write_bytes_ps);
+    EXPECT_EQ(500, snapshot.disks["sda"].io_util);
+}
+
+TEST_F(TestHostSampler, ParsePressure)
+{
+    const std::string content = "some avg10=1.50 avg60=0.75 avg300=0.10 total=123456\n"
+                                "full avg10=0.50 avg60=0.25 avg300=0.00 total=6543\n";
+    baidu::galaxy::collector::PressureStat stat;
+    baidu::galaxy::util::ErrorCode ec = baidu::galaxy::collector::HostSampler::ParsePressure(content.data(),
+            content.data() + content.size(), &stat);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_TRUE(stat.valid);
+    EXPECT_DOUBLE_EQ(1.5, stat.some_avg10);
+    EXPECT_DOUBLE_EQ(0.75, stat.some_avg60);
+    EXPECT_EQ(123456, stat.some_total);
+    EXPECT_DOUBLE_EQ(0.5, stat.full_avg10);
+    EXPECT_EQ(6543, stat.full_total);
+
+    // host wide cpu of old kernels, no full line
+    const std::string cpu = "some avg10=2.00 avg60=1.00 avg300=0.50 total=42";
+    ec = baidu::galaxy::collector::HostSampler::ParsePressure(cpu.data(), cpu.data() + cpu.size(), &stat);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(42, stat.some_total);
+    EXPECT_EQ(0, stat.full_total);
+
+    const std::string bad = "avg10=1.0\n";
+    ec = baidu::galaxy::collector::HostSampler::ParsePressure(bad.data(), bad.data() + bad.size(), &stat);
+    EXPECT_NE(0, ec.Code());
+    EXPECT_FALSE(stat.valid);
+}
+
+TEST_F(TestHostSampler, Collect)
+{
+    boost::shared_ptr<baidu::galaxy::collector::HostSampler> sampler
+        = baidu::galaxy::collector::HostSampler::GetInstance();
+    baidu::galaxy::util::ErrorCode ec = sampler->Collect();
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    ec = sampler->Collect();
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+
+    boost::shared_ptr<const baidu::galaxy::collector::HostSnapshot> snapshot = sampler->Snapshot();
+    ASSERT_TRUE(NULL != snapshot.get());
+    EXPECT_EQ(2, snapshot->version);
+    EXPECT_LT(0, snapshot->memory_total);
+
+    int64_t cpu_time = 0L;
+    ec = sampler->SystemCpuTime(1000000L, cpu_time);
+    EXPECT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(snapshot->cpu_total_time, cpu_time);
+}
+
+#endif
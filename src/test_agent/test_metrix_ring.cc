@@ -0,0 +1,109 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_METRIX_RING_ON
+#include "agent/collector/metrix_ring.h"
+
+#include <string>
+#include <vector>
+
+using baidu::galaxy::collector::MetrixRing;
+
+static std::vector<MetrixRing::Aggregation> TwoColumns() {
+    std::vector<MetrixRing::Aggregation> ret;
+    ret.push_back(MetrixRing::kAverage);
+    ret.push_back(MetrixRing::kLast);
+    return ret;
+}
+
+TEST(MetrixRing, Varint)
+{
+    const int64_t values[] = {0, 1, -1, 63, -64, 64, 1L << 40, -(1L << 40), 0x7fffffffffffffffLL, -0x7fffffffffffffffLL - 1};
+    std::string buf;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        MetrixRing::PutVarint(values[i], buf);
+    }
+
+    size_t pos = 0;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        int64_t v = 0;
+        ASSERT_TRUE(MetrixRing::GetVarint(buf, pos, v));
+        EXPECT_EQ(values[i], v);
+    }
+    EXPECT_EQ(buf.size(), pos);
+
+    std::string small;
+    MetrixRing::PutVarint(-3, small);
+    EXPECT_EQ(1u, small.size());
+}
+
+TEST(MetrixRing, AppendAndQuery)
+{
+    MetrixRing ring(TwoColumns(), 200, 16);
+    for (int i = 0; i < 100; i++) {
+        int64_t values[] = {1000 + i % 3, i * 10};
+        ring.Append(i * 1000000L, values);
+    }
+
+    EXPECT_EQ(100u, ring.Size());
+    EXPECT_EQ(99 * 1000000L, ring.LastTime());
+
+    std::vector<int64_t> times;
+    std::vector<std::vector<int64_t> > rows;
+    ring.Query(10 * 1000000L, 20 * 1000000L, 0, times, rows);
+    ASSERT_EQ(10u, times.size());
+    for (size_t i = 0; i < times.size(); i++) {
+        EXPECT_EQ((int64_t)(10 + i) * 1000000L, times[i]);
+        EXPECT_EQ(1000 + (int64_t)(10 + i) % 3, rows[i][0]);
+        EXPECT_EQ((int64_t)(10 + i) * 10, rows[i][1]);
+    }
+
+    // steady samples cost 1 byte per column
+    EXPECT_GT(100u * 3 * 2, ring.Bytes());
+}
+
+TEST(MetrixRing, Downsample)
+{
+    MetrixRing ring(TwoColumns(), 100);
+    for (int i = 0; i < 60; i++) {
+        int64_t values[] = {i, i};
+        ring.Append(i * 1000000L, values);
+    }
+
+    std::vector<int64_t> times;
+    std::vector<std::vector<int64_t> > rows;
+    ring.Query(0, 60 * 1000000L, 10 * 1000000L, times, rows);
+    ASSERT_EQ(6u, times.size());
+    for (size_t i = 0; i < times.size(); i++) {
+        EXPECT_EQ((int64_t)(i * 10 + 9) * 1000000L, times[i]);
+        // average of i*10 .. i*10+9
+        EXPECT_EQ((int64_t)(i * 10) + 4, rows[i][0]);
+        // last
+        EXPECT_EQ((int64_t)(i * 10 + 9), rows[i][1]);
+    }
+}
+
+TEST(MetrixRing, Wrap)
+{
+    MetrixRing ring(TwoColumns(), 32, 8);
+    for (int i = 0; i < 1000; i++) {
+        int64_t values[] = {i, -i};
+        ring.Append(i, values);
+    }
+
+    // full window and at most one more block
+    EXPECT_LE(32u, ring.Size());
+    EXPECT_GE(40u, ring.Size());
+
+    std::vector<int64_t> times;
+    std::vector<std::vector<int64_t> > rows;
+    ring.Query(0, 1000, 0, times, rows);
+    ASSERT_EQ(ring.Size(), times.size());
+    EXPECT_EQ(999, times.back());
+    EXPECT_EQ(-999, rows.back()[1]);
+    EXPECT_EQ(1000 - (int64_t)times.size(), times.front());
+}
+#endif
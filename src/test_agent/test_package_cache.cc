@@ -0,0 +1,184 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_PACKAGE_CACHE_ON
+#include "agent/package/package_cache.h"
+#include "protocol/galaxy.pb.h"
+
+#include "boost/bind.hpp"
+#include "boost/filesystem/operations.hpp"
+#include "boost/thread/condition_variable.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+class TestPackageCache : public testing::Test {
+protected:
+    virtual void SetUp() {
+        path_ = "./package_cache_test";
+        workspace_ = "./package_cache_workspace";
+        boost::filesystem::remove_all(path_);
+        boost::filesystem::remove_all(workspace_);
+        boost::filesystem::create_directories(path_);
+        boost::filesystem::create_directories(workspace_);
+    }
+
+    virtual void TearDown() {
+        boost::filesystem::remove_all(path_);
+        boost::filesystem::remove_all(workspace_);
+    }
+
+    // a package left by the last run of agent
+    void Seed(const std::string& source_path, const std::string& version, size_t size) {
+        const std::string file = path_ + "/"
+            + baidu::galaxy::package::PackageCache::Key(source_path, version) + ".tar.gz";
+        FILE* fp = fopen(file.c_str(), "w");
+        ASSERT_TRUE(NULL != fp);
+        fwrite(std::string(size, 'x').data(), 1, size, fp);
+        fclose(fp);
+    }
+
+    // callbacks run in worker threads of the cache
+    struct Result {
+        Result() :
+            done(false),
+            code(-1),
+            hit(false) {
+        }
+
+        void Fetched(const baidu::galaxy::util::ErrorCode& ec, bool h) {
+            boost::mutex::scoped_lock lock(mutex);
+            code = ec.Code();
+            hit = h;
+            done = true;
+            cond.notify_all();
+        }
+
+        void Wait() {
+            boost::mutex::scoped_lock lock(mutex);
+
+            while (!done) {
+                cond.wait(lock);
+            }
+
+            done = false;
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        bool done;
+        int code;
+        bool hit;
+    };
+
+    std::string path_;
+    std::string workspace_;
+};
+
+TEST_F(TestPackageCache, Key) {
+    std::string key = baidu::galaxy::package::PackageCache::Key("http://host/a.tar.gz", "v1");
+    EXPECT_EQ(16u, key.size());
+    EXPECT_EQ(key, baidu::galaxy::package::PackageCache::Key("http://host/a.tar.gz", "v1"));
+    EXPECT_NE(key, baidu::galaxy::package::PackageCache::Key("http://host/a.tar.gz", "v2"));
+    EXPECT_NE(key, baidu::galaxy::package::PackageCache::Key("http://host/a.tar.gz v", "1"));
+}
+
+TEST_F(TestPackageCache, Hit) {
+    Seed("http://host/a.tar.gz", "v1", 1024);
+    baidu::galaxy::package::PackageCache cache(path_, 1024 * 1024, 1);
+    ASSERT_EQ(0, cache.Setup().Code());
+
+    Result result;
+    const std::string target = workspace_ + "/a.tar.gz";
+    cache.Fetch("http://host/a.tar.gz", "v1", target, boost::bind(&Result::Fetched, &result, _1, _2));
+    result.Wait();
+    EXPECT_EQ(0, result.code);
+    EXPECT_TRUE(result.hit);
+
+    struct stat st;
+    ASSERT_EQ(0, stat(target.c_str(), &st));
+    EXPECT_EQ(1024, st.st_size);
+    EXPECT_EQ(1u, st.st_nlink);
+
+    // the workspace never shares the inode of the cached package
+    const std::string cached = path_ + "/"
+        + baidu::galaxy::package::PackageCache::Key("http://host/a.tar.gz", "v1") + ".tar.gz";
+    ASSERT_EQ(0, chmod(target.c_str(), 0644));
+    FILE* fp = fopen(target.c_str(), "w");
+    ASSERT_TRUE(NULL != fp);
+    fclose(fp);
+    ASSERT_EQ(0, stat(cached.c_str(), &st));
+    EXPECT_EQ(1024, st.st_size);
+
+    // target exists
+    cache.Fetch("http://host/a.tar.gz", "v1", target, boost::bind(&Result::Fetched, &result, _1, _2));
+    result.Wait();
+    EXPECT_NE(0, result.code);
+
+    baidu::galaxy::proto::PackageCacheMetrix metrix;
+    cache.Statistics(&metrix);
+    EXPECT_EQ(2, metrix.hits());
+    EXPECT_EQ(0, metrix.misses());
+    EXPECT_EQ(2048, metrix.bytes_saved());
+    EXPECT_EQ(1, metrix.linked() + metrix.copied());
+    EXPECT_EQ(1, metrix.failed());
+    EXPECT_EQ(1, metrix.packages());
+    cache.TearDown();
+}
+
+TEST_F(TestPackageCache, TearDown) {
+    // accepts connections but never responds, the download hangs
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    ASSERT_EQ(0, bind(fd, (struct sockaddr*)&addr, sizeof(addr)));
+    ASSERT_EQ(0, listen(fd, 16));
+    ASSERT_EQ(0, getsockname(fd, (struct sockaddr*)&addr, &len));
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/", ntohs(addr.sin_port));
+
+    baidu::galaxy::package::PackageCache cache(path_, 1024 * 1024, 1);
+    ASSERT_EQ(0, cache.Setup().Code());
+    Result downloading;
+    Result queued;
+    cache.Fetch(std::string(url) + "a.tar.gz", "v1", workspace_ + "/a.tar.gz",
+            boost::bind(&Result::Fetched, &downloading, _1, _2));
+    cache.Fetch(std::string(url) + "b.tar.gz", "v1", workspace_ + "/b.tar.gz",
+            boost::bind(&Result::Fetched, &queued, _1, _2));
+
+    // every waiter is called back
+    cache.TearDown();
+    downloading.Wait();
+    queued.Wait();
+    EXPECT_NE(0, downloading.code);
+    EXPECT_NE(0, queued.code);
+    close(fd);
+}
+
+TEST_F(TestPackageCache, Evict) {
+    Seed("http://host/a.tar.gz", "v1", 1024);
+    Seed("http://host/b.tar.gz", "v1", 1024);
+    baidu::galaxy::package::PackageCache cache(path_, 1024, 1);
+    ASSERT_EQ(0, cache.Setup().Code());
+
+    baidu::galaxy::proto::PackageCacheMetrix metrix;
+    cache.Statistics(&metrix);
+    EXPECT_EQ(1, metrix.packages());
+    EXPECT_EQ(1, metrix.evicted());
+    EXPECT_EQ(1024, metrix.size());
+    cache.TearDown();
+}
+
+#endif
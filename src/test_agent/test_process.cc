@@ -8,8 +8,11 @@
 #include "agent/container/process.h"
 #include "boost/bind.hpp"
 
+#include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
 namespace baidu {
 namespace galaxy {
@@ -48,6 +51,83 @@ TEST_F(TestProcess, Clone) {
     EXPECT_EQ(10, WEXITSTATUS(status));
 }
 
+int ExecRutine(void* param) {
+    const char* path = (const char*)param;
+    char* const argv[] = {const_cast<char*>(path), NULL};
+    ::execv(path, argv);
+    return -1;
+}
+
+int SleepRutine(void*) {
+    char* const argv[] = {const_cast<char*>("/bin/sleep"), const_cast<char*>("10"), NULL};
+    ::execv("/bin/sleep", argv);
+    return -1;
+}
+
+int FdRutine(void* param) {
+    int fd = *(int*)param;
+    // inherited fds are closed, the report pipe is left only
+    return -1 == ::fcntl(fd, F_GETFD) ? 0 : 1;
+}
+
+TEST_F(TestProcess, Exec) {
+    baidu::galaxy::container::Process process;
+    process.RedirectStderr("./stderr");
+    process.RedirectStdout("./stdout");
+    pid_t pid = process.Clone(boost::bind(ExecRutine, _1), (void*)"/bin/true", 0);
+    EXPECT_GT(pid, 0) << pid;
+    int status = -1;
+    process.Wait(status);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+}
+
+TEST_F(TestProcess, ExecFailed) {
+    baidu::galaxy::container::Process process;
+    process.RedirectStderr("./stderr");
+    process.RedirectStdout("./stdout");
+    pid_t pid = process.Clone(boost::bind(ExecRutine, _1), (void*)"/not/exist", 0);
+    EXPECT_EQ(-1, pid);
+    EXPECT_EQ(-1, process.Pid());
+}
+
+TEST_F(TestProcess, CloseFds) {
+    int fd = ::open("/dev/null", O_RDONLY);
+    ASSERT_GT(fd, 0);
+    baidu::galaxy::container::Process process;
+    process.RedirectStderr("./stderr");
+    process.RedirectStdout("./stdout");
+    pid_t pid = process.Clone(boost::bind(FdRutine, _1), &fd, 0);
+    EXPECT_GT(pid, 0) << pid;
+    int status = -1;
+    process.Wait(status);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    ::close(fd);
+}
+
+TEST_F(TestProcess, PidFd) {
+    baidu::galaxy::container::Process process;
+    process.RedirectStderr("./stderr");
+    process.RedirectStdout("./stdout");
+    pid_t pid = process.Clone(boost::bind(SleepRutine, _1), NULL, 0);
+    ASSERT_GT(pid, 0) << pid;
+    ASSERT_GE(process.PidFd(), 0);
+    EXPECT_FALSE(process.Exited());
+    EXPECT_EQ(0, process.Signal(SIGKILL).Code());
+    int status = -1;
+    process.Wait(status);
+    EXPECT_TRUE(process.Exited());
+    // reaped, the pid may be taken by others but the pidfd is not
+    EXPECT_EQ(0, process.Signal(SIGKILL).Code());
+
+    baidu::galaxy::container::Process reloaded;
+    reloaded.Reload(pid);
+    EXPECT_EQ(-1, reloaded.PidFd());
+    reloaded.Reload(::getpid());
+    EXPECT_GE(reloaded.PidFd(), 0);
+    EXPECT_FALSE(reloaded.Exited());
+}
 
 }
 }
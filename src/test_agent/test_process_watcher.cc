@@ -0,0 +1,111 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_PROCESS_WATCHER_ON
+#include "agent/container/process_watcher.h"
+#include "timer.h"
+
+#include "boost/bind.hpp"
+#include "boost/thread/mutex.hpp"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <vector>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+class TestProcessWatcher : public testing::Test {
+public:
+    void OnExit(const std::string& key) {
+        boost::mutex::scoped_lock lock(mutex_);
+        exited_.push_back(std::make_pair(key, baidu::common::timer::get_micros()));
+    }
+
+    // time the exit of key is seen, -1 if not in wait_ms
+    int64_t WaitExit(const std::string& key, int wait_ms) {
+        for (int i = 0; i <= wait_ms; i++) {
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+
+                for (size_t j = 0; j < exited_.size(); j++) {
+                    if (exited_[j].first == key) {
+                        return exited_[j].second;
+                    }
+                }
+            }
+
+            ::usleep(1000);
+        }
+
+        return -1;
+    }
+
+    // a child sleeping usec, pidfd is set
+    static pid_t Spawn(int usec, int& pidfd) {
+        pid_t pid = ::fork();
+
+        if (0 == pid) {
+            ::usleep(usec);
+            ::_exit(0);
+        }
+
+        pidfd = (int)::syscall(SYS_pidfd_open, pid, 0U);
+        return pid;
+    }
+
+protected:
+    boost::mutex mutex_;
+    std::vector<std::pair<std::string, int64_t> > exited_;
+};
+
+TEST_F(TestProcessWatcher, Exit) {
+    baidu::galaxy::container::ProcessWatcher watcher;
+    ASSERT_EQ(0, watcher.Setup().Code());
+    int pidfd = -1;
+    pid_t pid = Spawn(50000, pidfd);
+    ASSERT_GE(pidfd, 0);
+    EXPECT_EQ(0, watcher.Watch("container1",
+            pidfd,
+            boost::bind(&TestProcessWatcher::OnExit, this, "container1")).Code());
+    // the duplicated fd is watched
+    ::close(pidfd);
+    EXPECT_EQ(1, watcher.Size());
+    EXPECT_EQ(-1, WaitExit("container1", 20));
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    int64_t reaped = baidu::common::timer::get_micros();
+    int64_t seen = WaitExit("container1", 1000);
+    ASSERT_GT(seen, 0);
+    EXPECT_LT(seen - reaped, 10000);
+    EXPECT_EQ(0, watcher.Size());
+}
+
+TEST_F(TestProcessWatcher, Unwatch) {
+    baidu::galaxy::container::ProcessWatcher watcher;
+    ASSERT_EQ(0, watcher.Setup().Code());
+    int pidfd = -1;
+    pid_t pid = Spawn(10000000, pidfd);
+    ASSERT_GE(pidfd, 0);
+    watcher.Watch("container2", pidfd, boost::bind(&TestProcessWatcher::OnExit, this, "container2"));
+    watcher.Unwatch("container2");
+    EXPECT_EQ(0, watcher.Size());
+    ::kill(pid, SIGKILL);
+    ::waitpid(pid, NULL, 0);
+    EXPECT_EQ(-1, WaitExit("container2", 50));
+
+    // exited before watched, it is reported at once
+    watcher.Watch("container3", pidfd, boost::bind(&TestProcessWatcher::OnExit, this, "container3"));
+    EXPECT_GT(WaitExit("container3", 1000), 0);
+    ::close(pidfd);
+}
+
+#endif
@@ -0,0 +1,148 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_REPORT_CACHE_ON
+#include "agent/container/report_cache.h"
+#include "protocol/galaxy.pb.h"
+
+class TestReportCache : public testing::Test {
+protected:
+    static baidu::galaxy::proto::ContainerDescription Desc(const std::string& version,
+            baidu::galaxy::proto::JobType priority) {
+        baidu::galaxy::proto::ContainerDescription desc;
+        desc.set_version(version);
+        desc.set_priority(priority);
+        desc.set_cmd_line("sleep 1000");
+        return desc;
+    }
+
+    static baidu::galaxy::proto::ContainerInfo Brief(const std::string& id,
+            const baidu::galaxy::proto::ContainerDescription& desc,
+            int64_t cpu_used) {
+        baidu::galaxy::proto::ContainerInfo ci;
+        ci.set_id(id);
+        ci.set_group_id("group");
+        ci.set_status(baidu::galaxy::proto::kContainerReady);
+        ci.set_cpu_used(cpu_used);
+        ci.set_memory_used(1024);
+        ci.mutable_container_desc()->set_version(desc.version());
+        baidu::galaxy::proto::Volum* volum = ci.add_volum_used();
+        volum->set_device_path("/home/disk1");
+        volum->set_used_size(100);
+        return ci;
+    }
+
+    static baidu::galaxy::container::ReportCache::Stamp Stamp(int64_t cpu_used) {
+        return baidu::galaxy::container::ReportCache::Stamp(1, cpu_used);
+    }
+
+    // agent info received by resman
+    static void Received(const baidu::galaxy::container::ReportCache::Report& report,
+            bool full,
+            baidu::galaxy::proto::AgentInfo& received) {
+        baidu::galaxy::proto::AgentInfo ai;
+        ai.set_version("agent");
+        baidu::galaxy::container::ReportCache::Fill(report, full, &ai);
+        std::string bytes;
+        ASSERT_TRUE(ai.SerializeToString(&bytes));
+        ASSERT_TRUE(received.ParseFromString(bytes));
+    }
+};
+
+TEST_F(TestReportCache, Fill) {
+    baidu::galaxy::container::ReportCache cache;
+    baidu::galaxy::proto::ContainerDescription desc1 = Desc("v1", baidu::galaxy::proto::kJobService);
+    baidu::galaxy::proto::ContainerDescription desc2 = Desc("v2", baidu::galaxy::proto::kJobBestEffort);
+    cache.Begin();
+    cache.Add("group_container1", Stamp(100), Brief("container1", desc1, 100), desc1);
+    cache.Add("group_container2", Stamp(200), Brief("container2", desc2, 200), desc2);
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> report = cache.Finish(1);
+    EXPECT_EQ(2, report->rebuilt);
+    EXPECT_EQ(100, report->usage.cpu_used);
+    EXPECT_EQ(1024, report->usage.memory_used);
+    EXPECT_EQ(200, report->usage.volum_used.find("/home/disk1")->second);
+
+    baidu::galaxy::proto::AgentInfo brief;
+    Received(*report, false, brief);
+    EXPECT_EQ("agent", brief.version());
+    ASSERT_EQ(2, brief.container_info_size());
+    EXPECT_EQ("container1", brief.container_info(0).id());
+    EXPECT_EQ("v1", brief.container_info(0).container_desc().version());
+    EXPECT_FALSE(brief.container_info(0).container_desc().has_cmd_line());
+
+    baidu::galaxy::proto::AgentInfo full;
+    Received(*report, true, full);
+    ASSERT_EQ(2, full.container_info_size());
+    const baidu::galaxy::proto::ContainerInfo& ci = full.container_info(1);
+    EXPECT_EQ("container2", ci.id());
+    EXPECT_EQ(200, ci.cpu_used());
+    EXPECT_EQ(1, ci.volum_used_size());
+    EXPECT_EQ("v2", ci.container_desc().version());
+    EXPECT_EQ("sleep 1000", ci.container_desc().cmd_line());
+    EXPECT_EQ(baidu::galaxy::proto::kJobBestEffort, ci.container_desc().priority());
+}
+
+TEST_F(TestReportCache, Incremental) {
+    baidu::galaxy::container::ReportCache cache;
+    baidu::galaxy::proto::ContainerDescription desc = Desc("v1", baidu::galaxy::proto::kJobService);
+    cache.Begin();
+    cache.Add("group_container1", Stamp(100), Brief("container1", desc, 100), desc);
+    cache.Add("group_container2", Stamp(100), Brief("container2", desc, 100), desc);
+    cache.Add("group_container3", Stamp(100), Brief("container3", desc, 100), desc);
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> first = cache.Finish(1);
+
+    // container2 changed, container3 released
+    cache.Begin();
+    cache.Add("group_container1", Stamp(100), Brief("container1", desc, 100), desc);
+    cache.Add("group_container2", Stamp(300), Brief("container2", desc, 300), desc);
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> second = cache.Finish(2);
+    EXPECT_EQ(1, second->rebuilt);
+    ASSERT_EQ(2u, second->full.size());
+    EXPECT_EQ(first->full[0].get(), second->full[0].get());
+    EXPECT_NE(first->full[1].get(), second->full[1].get());
+    EXPECT_EQ(400, second->usage.cpu_used);
+
+    // unchanged containers are not asked for their info
+    cache.Begin();
+    EXPECT_TRUE(cache.Keep("group_container1", "v1", Stamp(100)));
+    EXPECT_FALSE(cache.Keep("group_container2", "v1", Stamp(100)));
+    cache.Add("group_container2", Stamp(100), Brief("container2", desc, 100), desc);
+    EXPECT_FALSE(cache.Keep("group_container3", "v1", Stamp(100)));
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> kept = cache.Finish(3);
+    EXPECT_EQ(1, kept->rebuilt);
+    ASSERT_EQ(2u, kept->full.size());
+    EXPECT_EQ(second->full[0].get(), kept->full[0].get());
+    EXPECT_EQ(200, kept->usage.cpu_used);
+    EXPECT_EQ(200, kept->usage.volum_used.find("/home/disk1")->second);
+
+    // created again by another version
+    cache.Begin();
+    baidu::galaxy::proto::ContainerDescription desc3 = Desc("v3", baidu::galaxy::proto::kJobService);
+    cache.Add("group_container3", Stamp(100), Brief("container3", desc3, 100), desc3);
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> third = cache.Finish(4);
+    EXPECT_EQ(1, third->rebuilt);
+
+    baidu::galaxy::proto::AgentInfo full;
+    Received(*third, true, full);
+    ASSERT_EQ(1, full.container_info_size());
+    EXPECT_EQ("v3", full.container_info(0).container_desc().version());
+}
+
+TEST_F(TestReportCache, DebugString) {
+    baidu::galaxy::container::ReportCache cache;
+    baidu::galaxy::proto::ContainerDescription desc = Desc("v1", baidu::galaxy::proto::kJobService);
+    cache.Begin();
+    cache.Add("group_container1", Stamp(100), Brief("container1", desc, 100), desc);
+    boost::shared_ptr<const baidu::galaxy::container::ReportCache::Report> report = cache.Finish(1);
+    baidu::galaxy::proto::AgentInfo ai;
+    baidu::galaxy::container::ReportCache::Fill(*report, false, &ai);
+    EXPECT_EQ(0, ai.container_info_size());
+    std::string debug = baidu::galaxy::container::ReportCache::DebugString(ai);
+    EXPECT_NE(std::string::npos, debug.find("container_info {"));
+    EXPECT_NE(std::string::npos, debug.find("\"container1\""));
+}
+
+#endif
@@ -0,0 +1,90 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_SLOT_POOL_ON
+#include "agent/container/slot_pool.h"
+#include "agent/util/path_tree.h"
+#include "protocol/galaxy.pb.h"
+
+#include "boost/filesystem/operations.hpp"
+#include <gflags/gflags.h>
+
+#include <unistd.h>
+
+DECLARE_string(cgroup_root_path);
+DECLARE_string(mount_templat);
+
+class TestSlotPool : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+        FLAGS_cgroup_root_path = "./slot_cgroups";
+        FLAGS_mount_templat = "/proc,/etc";
+        boost::filesystem::create_directories("./slot_cgroups/memory");
+        baidu::galaxy::path::SetRootPath("./slot_root");
+    }
+
+    static void TearDownTestCase() {
+        boost::filesystem::remove_all("./slot_cgroups");
+        boost::filesystem::remove_all("./slot_root");
+    }
+
+    int Ready(baidu::galaxy::container::SlotPool& pool, int expect) {
+        baidu::galaxy::proto::ConstructMetrix metrix;
+
+        for (int i = 0; i < 100; i++) {
+            pool.Statistics(&metrix);
+
+            if (metrix.slot_ready() == expect) {
+                break;
+            }
+
+            ::usleep(10000);
+        }
+
+        return metrix.slot_ready();
+    }
+};
+
+TEST_F(TestSlotPool, Claim) {
+    baidu::galaxy::container::SlotPool pool(2, 4, 60);
+    pool.Start();
+    EXPECT_EQ(2, Ready(pool, 2));
+
+    EXPECT_TRUE(pool.Claim("container1", "cgroup1"));
+    EXPECT_TRUE(boost::filesystem::exists("./slot_cgroups/memory/galaxy/container1_cgroup1"));
+    EXPECT_TRUE(boost::filesystem::exists(baidu::galaxy::path::ContainerRootPath("container1") + "/proc"));
+    EXPECT_TRUE(boost::filesystem::exists(baidu::galaxy::path::ContainerRootPath("container1") + "/etc"));
+
+    EXPECT_TRUE(pool.Claim("container2", "cgroup1"));
+    EXPECT_EQ(2, Ready(pool, 2));
+    // three containers in the window want three slots
+    EXPECT_TRUE(pool.Claim("container3", "cgroup1"));
+    EXPECT_EQ(3, Ready(pool, 3));
+
+    pool.Stop();
+    EXPECT_FALSE(pool.Claim("container4", "cgroup1"));
+    baidu::galaxy::proto::ConstructMetrix metrix;
+    pool.Statistics(&metrix);
+    EXPECT_EQ(3, metrix.slot_hit());
+    EXPECT_EQ(0, metrix.slot_miss());
+}
+
+TEST_F(TestSlotPool, RemoveLeft) {
+    boost::filesystem::create_directories("./slot_cgroups/memory/galaxy/.slot.99");
+    boost::filesystem::create_directories(baidu::galaxy::path::ContainerRootPath(".slot.99") + "/proc");
+    baidu::galaxy::container::SlotPool pool(2, 0, 60);
+    pool.Start();
+    EXPECT_FALSE(boost::filesystem::exists("./slot_cgroups/memory/galaxy/.slot.99"));
+    EXPECT_FALSE(boost::filesystem::exists(baidu::galaxy::path::ContainerRootPath(".slot.99")));
+    // and those of the last test
+    EXPECT_FALSE(boost::filesystem::exists(baidu::galaxy::path::ContainerRootPath(".slot.3")));
+    EXPECT_TRUE(boost::filesystem::exists("./slot_cgroups/memory/galaxy/container1_cgroup1"));
+    // disabled
+    EXPECT_FALSE(pool.Claim("container5", "cgroup1"));
+    EXPECT_EQ(0, Ready(pool, 0));
+}
+
+#endif
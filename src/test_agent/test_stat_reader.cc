@@ -0,0 +1,88 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_STAT_READER_ON
+#include "agent/cgroup/stat_reader.h"
+#include "agent/util/error_code.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+class TestStatReader : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+    }
+
+    static void TearDownTestCase() {
+    }
+
+    static void Write(const std::string& path, const std::string& content) {
+        FILE* f = fopen(path.c_str(), "w");
+        ASSERT_TRUE(NULL != f);
+        fwrite(content.data(), 1, content.size(), f);
+        fclose(f);
+    }
+};
+
+TEST_F(TestStatReader, ParseInt64)
+{
+    const char* s = "  -1234 56";
+    int64_t v = 0;
+    const char* p = baidu::galaxy::cgroup::StatReader::ParseInt64(s, s + strlen(s), v);
+    ASSERT_TRUE(NULL != p);
+    EXPECT_EQ(-1234, v);
+    p = baidu::galaxy::cgroup::StatReader::ParseInt64(p, s + strlen(s), v);
+    ASSERT_TRUE(NULL != p);
+    EXPECT_EQ(56, v);
+    EXPECT_TRUE(NULL == baidu::galaxy::cgroup::StatReader::ParseInt64(p, s + strlen(s), v));
+}
+
+TEST_F(TestStatReader, Read)
+{
+    const std::string path = "./stat_reader_test.stat";
+    Write(path, "nr_periods 10\nnr_throttled 3\nthrottled_time 123456789\n");
+
+    baidu::galaxy::cgroup::StatReader reader(path, 256);
+    baidu::galaxy::util::ErrorCode ec = reader.Read();
+    ASSERT_EQ(0, ec.Code()) << ec.Message();
+
+    static const char* const keys[] = {"throttled_time", "nr_throttled", "not_exist"};
+    int64_t values[] = {-1, -1, -1};
+    EXPECT_EQ(2, reader.Values(keys, values, 3));
+    EXPECT_EQ(123456789, values[0]);
+    EXPECT_EQ(3, values[1]);
+    EXPECT_EQ(-1, values[2]);
+
+    int64_t sum = 0;
+    EXPECT_TRUE(reader.Sum(sum));
+    EXPECT_EQ(123456802, sum);
+
+    // same fd, new content
+    Write(path, "4096\n");
+    ec = reader.Read();
+    ASSERT_EQ(0, ec.Code()) << ec.Message();
+    int64_t value = 0;
+    EXPECT_TRUE(reader.Value(value));
+    EXPECT_EQ(4096, value);
+
+    // exactly the buffer size, then larger than it
+    baidu::galaxy::cgroup::StatReader small(path, 5);
+    ec = small.Read();
+    ASSERT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(5u, small.Size());
+    Write(path, "123456789012\n");
+    ec = small.Read();
+    ASSERT_EQ(0, ec.Code()) << ec.Message();
+    EXPECT_EQ(13u, small.Size());
+    EXPECT_TRUE(small.Value(value));
+    EXPECT_EQ(123456789012, value);
+    ::unlink(path.c_str());
+
+    baidu::galaxy::cgroup::StatReader not_exist("./not_exist.stat");
+    EXPECT_NE(0, not_exist.Read().Code());
+}
+
+#endif
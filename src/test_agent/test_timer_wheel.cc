@@ -0,0 +1,78 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_TIMER_WHEEL_ON
+#include "agent/collector/timer_wheel.h"
+
+#include <stdlib.h>
+#include <map>
+
+class TestTimerWheel : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+    }
+
+    static void TearDownTestCase() {
+    }
+};
+
+TEST_F(TestTimerWheel, Order)
+{
+    baidu::galaxy::collector::TimerWheel<int> wheel(100, 1000);
+    wheel.Add(1, 1250);
+    wheel.Add(2, 1050);
+    wheel.Add(3, 500);  // expired already, fires on next tick
+    EXPECT_EQ(3, wheel.Size());
+
+    std::vector<int> expired;
+    wheel.Advance(1100, expired);
+    ASSERT_EQ(2, expired.size());
+    EXPECT_EQ(1, wheel.Size());
+
+    expired.clear();
+    wheel.Advance(1199, expired);
+    EXPECT_EQ(0, expired.size());
+    wheel.Advance(1200, expired);
+    ASSERT_EQ(1, expired.size());
+    EXPECT_EQ(1, expired[0]);
+    EXPECT_EQ(0, wheel.Size());
+}
+
+TEST_F(TestTimerWheel, Cascade)
+{
+    const int64_t tick = 100;
+    int64_t now = 123456;
+    baidu::galaxy::collector::TimerWheel<int> wheel(tick, now);
+    std::map<int, int64_t> due;
+    srand(1);
+
+    for (int i = 0; i < 10000; i++) {
+        // spread over all levels
+        int64_t delay = (int64_t)(rand() % (1 << 20)) * (i % 4 == 0 ? 64 : 1);
+        due[i] = now + delay;
+        wheel.Add(i, now + delay);
+    }
+
+    int fired = 0;
+    std::vector<int> expired;
+
+    while (wheel.Size() > 0) {
+        now += tick * (1 + rand() % 20);
+        expired.clear();
+        wheel.Advance(now, expired);
+
+        for (size_t i = 0; i < expired.size(); i++) {
+            // never early, late by less than one advance step
+            EXPECT_LE(due[expired[i]] / tick, now / tick);
+            EXPECT_GT(due[expired[i]] / tick, now / tick - 20);
+            fired++;
+        }
+    }
+
+    EXPECT_EQ(10000, fired);
+}
+
+#endif
@@ -0,0 +1,137 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+#ifdef TEST_CGROUP_UNIFIED_ON
+#include "agent/cgroup/unified_subsystem.h"
+#include "protocol/galaxy.pb.h"
+
+#include <gflags/gflags.h>
+
+#include <fstream>
+
+DECLARE_string(cgroup_root_path);
+
+namespace baidu {
+namespace galaxy {
+namespace test {
+
+static std::string ReadFile(const std::string& path) {
+    std::ifstream in(path.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+class TestUnifiedSubsystem : public testing::Test {
+protected:
+    static void SetUpTestCase() {
+        FLAGS_cgroup_root_path = "./";
+    }
+
+    static void TearDownTestCase() {
+        std::string path = FLAGS_cgroup_root_path + "galaxy";
+        std::string cmd = "rm -rf " + path;
+        //system(cmd.c_str());
+    }
+};
+
+TEST_F(TestUnifiedSubsystem, Path) {
+    FLAGS_cgroup_root_path = "/sys/fs/cgroup";
+    boost::shared_ptr<baidu::galaxy::proto::Cgroup> cgroup(new baidu::galaxy::proto::Cgroup);
+    cgroup->set_id("cgroup");
+    baidu::galaxy::cgroup::UnifiedSubsystem unified;
+    unified.SetContainerId("container");
+    unified.SetCgroup(cgroup);
+    EXPECT_STREQ(unified.Name().c_str(), "unified");
+    EXPECT_STREQ(unified.Path().c_str(), "/sys/fs/cgroup/galaxy/container_cgroup");
+}
+
+TEST_F(TestUnifiedSubsystem, Convert) {
+    EXPECT_STREQ("150000 100000", baidu::galaxy::cgroup::UnifiedSubsystem::CpuMax(1500).c_str());
+    EXPECT_STREQ("max 100000", baidu::galaxy::cgroup::UnifiedSubsystem::CpuMax(0).c_str());
+    EXPECT_EQ(1, baidu::galaxy::cgroup::UnifiedSubsystem::ShareToWeight(2));
+    EXPECT_EQ(39, baidu::galaxy::cgroup::UnifiedSubsystem::ShareToWeight(1024));
+    EXPECT_EQ(10000, baidu::galaxy::cgroup::UnifiedSubsystem::ShareToWeight(262144));
+    EXPECT_EQ(100, baidu::galaxy::cgroup::UnifiedSubsystem::BlkioToIoWeight(500));
+    EXPECT_EQ(1, baidu::galaxy::cgroup::UnifiedSubsystem::BlkioToIoWeight(1));
+
+    baidu::galaxy::proto::BlkioThrottle throttle;
+    throttle.set_device("8:16");
+    throttle.set_read_bps(1048576);
+    throttle.set_write_iops(100);
+    EXPECT_STREQ("8:16 rbps=1048576 wbps=max riops=max wiops=100",
+                 baidu::galaxy::cgroup::UnifiedSubsystem::IoMax(throttle).c_str());
+}
+
+TEST_F(TestUnifiedSubsystem, Construct) {
+    FLAGS_cgroup_root_path = "./";
+    // hard limit
+    {
+        boost::shared_ptr<baidu::galaxy::proto::Cgroup> cgroup(new baidu::galaxy::proto::Cgroup);
+        cgroup->set_id("cgroup_hard");
+        cgroup->mutable_cpu()->set_excess(false);
+        cgroup->mutable_cpu()->set_milli_core(2000);
+        cgroup->mutable_memory()->set_excess(false);
+        cgroup->mutable_memory()->set_size(1024L * 1024 * 1024);
+        baidu::galaxy::cgroup::UnifiedSubsystem unified;
+        unified.SetContainerId("container1");
+        unified.SetCgroup(cgroup);
+        EXPECT_EQ(0, unified.Construct().Code());
+        EXPECT_EQ(0, unified.Construct().Code());
+        EXPECT_STREQ("200000 100000", ReadFile(unified.Path() + "/cpu.max").c_str());
+        EXPECT_STREQ("77", ReadFile(unified.Path() + "/cpu.weight").c_str());
+        EXPECT_STREQ("1073741824", ReadFile(unified.Path() + "/memory.max").c_str());
+        EXPECT_STREQ("max", ReadFile(unified.Path() + "/memory.high").c_str());
+        EXPECT_EQ(0, unified.Freeze().Code());
+        EXPECT_STREQ("1", ReadFile(unified.Path() + "/cgroup.freeze").c_str());
+        EXPECT_EQ(0, unified.Thaw().Code());
+        EXPECT_STREQ("0", ReadFile(unified.Path() + "/cgroup.freeze").c_str());
+    }
+    // soft limit
+    {
+        boost::shared_ptr<baidu::galaxy::proto::Cgroup> cgroup(new baidu::galaxy::proto::Cgroup);
+        cgroup->set_id("cgroup_soft");
+        cgroup->mutable_cpu()->set_excess(true);
+        cgroup->mutable_cpu()->set_milli_core(1000);
+        cgroup->mutable_memory()->set_excess(true);
+        cgroup->mutable_memory()->set_size(4096);
+        cgroup->mutable_blkio()->set_weight(500);
+        baidu::galaxy::cgroup::UnifiedSubsystem unified;
+        unified.SetContainerId("container1");
+        unified.SetCgroup(cgroup);
+        EXPECT_EQ(0, unified.Construct().Code());
+        EXPECT_STREQ("39", ReadFile(unified.Path() + "/cpu.weight").c_str());
+        EXPECT_STREQ("max 100000", ReadFile(unified.Path() + "/cpu.max").c_str());
+        EXPECT_STREQ("4096", ReadFile(unified.Path() + "/memory.high").c_str());
+        EXPECT_STREQ("max", ReadFile(unified.Path() + "/memory.max").c_str());
+        EXPECT_STREQ("default 100", ReadFile(unified.Path() + "/io.weight").c_str());
+    }
+}
+
+TEST_F(TestUnifiedSubsystem, Attach) {
+    FLAGS_cgroup_root_path = "./";
+    boost::shared_ptr<baidu::galaxy::proto::Cgroup> cgroup(new baidu::galaxy::proto::Cgroup);
+    cgroup->set_id("cgroup_attach");
+    cgroup->mutable_cpu()->set_milli_core(1000);
+    cgroup->mutable_memory()->set_size(4096);
+    baidu::galaxy::cgroup::UnifiedSubsystem unified;
+    unified.SetContainerId("container1");
+    unified.SetCgroup(cgroup);
+    EXPECT_EQ(0, unified.Construct().Code());
+    EXPECT_NE(0, unified.Attach(12345).Code());
+    std::string cmd = "touch " + unified.Path() + "/cgroup.procs";
+    system(cmd.c_str());
+    EXPECT_EQ(0, unified.Attach(12345).Code());
+    EXPECT_EQ(0, unified.Attach(12346).Code());
+    std::vector<int> v;
+    EXPECT_EQ(0, unified.GetProcs(v).Code());
+    EXPECT_EQ(2u, v.size());
+}
+
+}
+}
+}
+
+#endif
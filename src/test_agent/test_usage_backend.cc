@@ -0,0 +1,100 @@
+// Copyright (c) 2016, Baidu.com, Inc. All Rights Reserved
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "unit_test.h"
+
+#ifdef TEST_USAGE_BACKEND_ON
+#include "agent/volum/usage_backend.h"
+#include "protocol/galaxy.pb.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+class TestUsageBackend : public testing::Test {
+protected:
+    virtual void SetUp() {
+        char tmpl[] = "/tmp/test_usage_backend_XXXXXX";
+        ASSERT_TRUE(NULL != mkdtemp(tmpl));
+        root_ = tmpl;
+    }
+
+    virtual void TearDown() {
+        std::string cmd = "rm -rf " + root_;
+        system(cmd.c_str());
+    }
+
+    static int64_t Write(const std::string& path, size_t size) {
+        FILE* f = fopen(path.c_str(), "w");
+        std::string data(size, 'x');
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+        struct stat st;
+        stat(path.c_str(), &st);
+        return st.st_blocks * 512L;
+    }
+
+    std::string root_;
+};
+
+TEST_F(TestUsageBackend, Walk)
+{
+    int64_t expect = 0;
+    std::string dir = root_;
+    for (int i = 0; i < 8; i++) {
+        dir += "/d";
+        ASSERT_EQ(0, mkdir(dir.c_str(), 0755));
+        struct stat st;
+        stat(dir.c_str(), &st);
+        expect += st.st_blocks * 512L;
+        expect += Write(dir + "/f", 10000 * (i + 1));
+    }
+
+    // hard link counted once, symlink does not follow
+    ASSERT_EQ(0, link((root_ + "/d/f").c_str(), (root_ + "/d/f2").c_str()));
+    ASSERT_EQ(0, symlink(root_.c_str(), (root_ + "/d/loop").c_str()));
+    struct stat st;
+    lstat((root_ + "/d/loop").c_str(), &st);
+    expect += st.st_blocks * 512L;
+    stat(root_.c_str(), &st);
+    expect += st.st_blocks * 512L;
+
+    baidu::galaxy::volum::WalkUsage walk(root_);
+    int64_t used = 0;
+    ASSERT_EQ(0, walk.Usage(used).Code());
+    EXPECT_EQ(expect, used);
+    EXPECT_FALSE(walk.Cheap());
+}
+
+TEST_F(TestUsageBackend, Statfs)
+{
+    baidu::galaxy::volum::StatfsUsage statfs(root_);
+    int64_t used = 0;
+    ASSERT_EQ(0, statfs.Usage(used).Code());
+    EXPECT_LT(0, used);
+    baidu::galaxy::volum::StatfsUsage missing(root_ + "/missing");
+    EXPECT_NE(0, missing.Usage(used).Code());
+}
+
+TEST_F(TestUsageBackend, Create)
+{
+    baidu::galaxy::proto::VolumRequired vr;
+    vr.set_medium(baidu::galaxy::proto::kTmpfs);
+    EXPECT_EQ("statfs", baidu::galaxy::volum::UsageBackend::Create(vr, root_)->Name());
+
+    vr.set_medium(baidu::galaxy::proto::kDisk);
+    vr.set_exclusive(true);
+    EXPECT_EQ("statfs", baidu::galaxy::volum::UsageBackend::Create(vr, root_)->Name());
+
+    // /tmp has no project quota here, falls back to walk
+    vr.set_exclusive(false);
+    boost::shared_ptr<baidu::galaxy::volum::UsageBackend> backend =
+        baidu::galaxy::volum::UsageBackend::Create(vr, root_);
+    int64_t used = 0;
+    EXPECT_EQ(0, backend->Usage(used).Code());
+}
+#endif
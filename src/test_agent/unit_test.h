@@ -12,16 +12,30 @@
 //#define TEST_CGROUP_FREEZER_ON
 //#define TEST_CGROUP_NETCLS_ON
 //#define TEST_CGROUP_TCPTHROT_ON
+//#define TEST_CGROUP_UNIFIED_ON
+//#define TEST_CGROUP_COLLECTOR_ON
 //#define TEST_SYMLINK_VOLUM_ON
 //#define TEST_TMPFS_VOLUM_ON
 //#define TEST_MOUNTER_ON
 //#define TEST_VOLUM_GROUP_ON
 
 //#define TEST_PROCESS_ON
+//#define TEST_PROCESS_WATCHER_ON
 
 //#define TEST_CONTAINER_ON
 #define TEST_CONTAINER_STATUS_ON
+//#define TEST_CONSTRUCT_POOL_ON
+//#define TEST_CONTAINER_GC_ON
+//#define TEST_REPORT_CACHE_ON
+//#define TEST_PACKAGE_CACHE_ON
+//#define TEST_DAG_ON
+//#define TEST_SLOT_POOL_ON
 //#define TEST_COLLECTOR_ENGINE_ON
+//#define TEST_HOST_SAMPLER_ON
+//#define TEST_TIMER_WHEEL_ON
+//#define TEST_STAT_READER_ON
+//#define TEST_USAGE_BACKEND_ON
+//#define TEST_METRIX_RING_ON
 //#define TEST_FILE_INPUT_STREAM
 //#define TEST_OUTPUT_STREAM_FILE_ON
 //#define TEST_DICT_FILE_ON
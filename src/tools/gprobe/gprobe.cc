@@ -16,6 +16,8 @@
 
 #include <gflags/gflags.h>
 
+#include <stdio.h>
+#include <time.h>
 #include <unistd.h>
 
 
@@ -28,6 +30,8 @@ DEFINE_string(a, "", "dir to append");
 DEFINE_string(h, "", "to print help");
 DEFINE_string(e, "", "endpoint");
 DEFINE_int32(t, -1, "");
+DEFINE_int32(m, 0, "dump metrix history of last m seconds");
+DEFINE_int32(s, 1, "interval of dumped metrix history, unit second");
 
 baidu::galaxy::util::ErrorCode CheckParameter();
 void PrintHelp(const char* argv0);
@@ -39,6 +43,9 @@ void WriteMetrixesToFiles(std::map<std::string, boost::shared_ptr<baidu::galaxy:
         const std::string& dir_path,
         bool append);
 void PrintMetrixes(std::map<std::string, boost::shared_ptr<baidu::galaxy::tools::PodMetrix> >& metrix);
+void PrintHistories(const baidu::galaxy::proto::GetMetricsResponse& response);
+void ParsePressure(const baidu::galaxy::proto::Pressure& from, baidu::galaxy::tools::Pressure& to);
+void PrintHost(const baidu::galaxy::proto::HostMetrix& host);
  
 int main(int argc, char** argv) {
     if (argc <= 1) {
@@ -79,6 +86,27 @@ int main(int argc, char** argv) {
         return -1;
     }
 
+    if (FLAGS_m > 0) {
+        baidu::galaxy::proto::GetMetricsRequest mreq;
+        baidu::galaxy::proto::GetMetricsResponse mres;
+        mreq.set_id(FLAGS_i);
+        mreq.set_start_time(baidu::common::timer::get_micros() - FLAGS_m * 1000000L);
+        mreq.set_interval(FLAGS_s);
+
+        if (!rpc->SendRequest(agent_stub,
+                        &baidu::galaxy::proto::Agent_Stub::GetMetrics,
+                        &mreq,
+                        &mres,
+                        5,
+                        1)) {
+            std::cerr << "get metrics failed, endpoint is " << endpoint << std::endl;
+            return -1;
+        }
+
+        PrintHistories(mres);
+        return 0;
+    }
+
     baidu::galaxy::proto::QueryRequest qr;
     qr.set_full_report(true);
     int64_t last_output_time = baidu::common::timer::get_micros();
@@ -103,6 +131,10 @@ int main(int argc, char** argv) {
                 WriteMetrixesToFiles(metrix, FLAGS_a, true);
             } else {
                 PrintMetrixes(metrix);
+
+                if (FLAGS_i.empty()) {
+                    PrintHost(qres.agent_info().host_metrix());
+                }
             }
         }
 
@@ -133,7 +165,7 @@ baidu::galaxy::util::ErrorCode CheckParameter() {
 }
 
 void PrintHelp(const char* argv0) {
-    std::cout << "usage: " << argv0 << " -p port [ -i ] [ -w ] [ -a ] [ -e ]" << std::endl;
+    std::cout << "usage: " << argv0 << " -p port [ -i ] [ -w ] [ -a ] [ -e ] [ -m seconds [ -s interval ] ]" << std::endl;
 }
 
 void ParseInfo(const baidu::galaxy::proto::QueryResponse& qres, std::map<std::string, boost::shared_ptr<baidu::galaxy::tools::PodMetrix> >& metrix) {
@@ -168,6 +200,23 @@ void ParseInfo(const baidu::galaxy::proto::QueryResponse& qres, std::map<std::st
         // used
         pm->rss_used_in_byte = cinf.memory_used();
         pm->cpu_used_in_millicore = cinf.cpu_used();
+        pm->io_read_bps = cinf.io_read_bps();
+        pm->io_write_bps = cinf.io_write_bps();
+        pm->io_read_iops = cinf.io_read_iops();
+        pm->io_write_iops = cinf.io_write_iops();
+
+        if (cinf.has_cpu_pressure()) {
+            ParsePressure(cinf.cpu_pressure(), pm->cpu_pressure);
+        }
+
+        if (cinf.has_memory_pressure()) {
+            ParsePressure(cinf.memory_pressure(), pm->memory_pressure);
+        }
+
+        if (cinf.has_io_pressure()) {
+            ParsePressure(cinf.io_pressure(), pm->io_pressure);
+        }
+
         // volum
 
         std::map<std::string, int64_t> volume_total;
@@ -278,3 +327,73 @@ void PrintMetrixes(std::map<std::string, boost::shared_ptr<baidu::galaxy::tools:
         iter++;
     }
 }
+
+void ParsePressure(const baidu::galaxy::proto::Pressure& from, baidu::galaxy::tools::Pressure& to) {
+    to.valid = true;
+    to.some_avg10 = from.some_avg10();
+    to.some_avg60 = from.some_avg60();
+    to.some_total = from.some_total();
+    to.full_avg10 = from.full_avg10();
+    to.full_avg60 = from.full_avg60();
+    to.full_total = from.full_total();
+}
+
+void PrintHost(const baidu::galaxy::proto::HostMetrix& host) {
+    std::stringstream ss;
+    baidu::galaxy::tools::Pressure pressure;
+
+    if (host.has_cpu_pressure()) {
+        ParsePressure(host.cpu_pressure(), pressure);
+        pressure.ToString("GALAXY_HOST_CPU", ss);
+    }
+
+    if (host.has_memory_pressure()) {
+        ParsePressure(host.memory_pressure(), pressure);
+        pressure.ToString("GALAXY_HOST_MEM", ss);
+    }
+
+    if (host.has_io_pressure()) {
+        ParsePressure(host.io_pressure(), pressure);
+        pressure.ToString("GALAXY_HOST_IO", ss);
+    }
+
+    if (!ss.str().empty()) {
+        fprintf(stdout, "host:\n%s", ss.str().c_str());
+        fflush(stdout);
+    }
+}
+
+void PrintHistories(const baidu::galaxy::proto::GetMetricsResponse& response) {
+    for (int i = 0; i < response.histories_size(); i++) {
+        const baidu::galaxy::proto::ContainerMetrixHistory& h = response.histories(i);
+        fprintf(stdout, "pod_id is: %s\n", h.id().c_str());
+        fprintf(stdout, "%-20s %10s %14s %14s %14s %10s %14s %10s %14s %12s %12s %8s %8s\n",
+                "time", "cpu", "memory", "rss", "cache", "fail_cnt", "volum", "throttled", "throttled_ns",
+                "read_bps", "write_bps", "r_iops", "w_iops");
+
+        for (int j = 0; j < h.metrix_size(); j++) {
+            const baidu::galaxy::proto::ContainerMetrix& m = h.metrix(j);
+            time_t sec = m.time() / 1000000L;
+            struct tm t;
+            localtime_r(&sec, &t);
+            char buf[32];
+            strftime(buf, sizeof buf, "%Y-%m-%d %H:%M:%S", &t);
+            fprintf(stdout, "%-20s %10lld %14lld %14lld %14lld %10lld %14lld %10lld %14lld %12lld %12lld %8lld %8lld\n",
+                    buf,
+                    (long long)m.cpu_used_in_millicore(),
+                    (long long)m.memory_used_in_byte(),
+                    (long long)m.memory_rss_in_byte(),
+                    (long long)m.memory_cache_in_byte(),
+                    (long long)m.memory_fail_cnt(),
+                    (long long)m.volum_used_in_byte(),
+                    (long long)m.cpu_nr_throttled(),
+                    (long long)m.cpu_throttled_time(),
+                    (long long)m.io_read_bps(),
+                    (long long)m.io_write_bps(),
+                    (long long)m.io_read_iops(),
+                    (long long)m.io_write_iops());
+        }
+    }
+
+    fflush(stdout);
+}
@@ -13,6 +13,43 @@ namespace galaxy {
 namespace tools {
 
 
+// pressure stall information of one resource
+class Pressure {
+public:
+    Pressure() :
+        valid(false),
+        some_avg10(0.0),
+        some_avg60(0.0),
+        some_total(0L),
+        full_avg10(0.0),
+        full_avg60(0.0),
+        full_total(0L) {
+    }
+
+    // eg: GALAXY_MEM_PRESSURE_SOME_AVG10:1.5
+    void ToString(const std::string& prefix, std::stringstream& ss) const {
+        if (!valid) {
+            return;
+        }
+
+        ss << prefix << "_PRESSURE_SOME_AVG10:" << some_avg10 << "\n"
+           << prefix << "_PRESSURE_SOME_AVG60:" << some_avg60 << "\n"
+           << prefix << "_PRESSURE_SOME_TOTAL:" << some_total << "\n"
+           << prefix << "_PRESSURE_FULL_AVG10:" << full_avg10 << "\n"
+           << prefix << "_PRESSURE_FULL_AVG60:" << full_avg60 << "\n"
+           << prefix << "_PRESSURE_FULL_TOTAL:" << full_total << "\n";
+    }
+
+public:
+    bool valid;
+    double some_avg10;
+    double some_avg60;
+    int64_t some_total;
+    double full_avg10;
+    double full_avg60;
+    int64_t full_total;
+};
+
 class PodMetrix {
 public:
     class Volum {
@@ -35,7 +72,11 @@ public:
         rss_used_in_byte(0L),
         cache_used_in_byte(0L),
         memory_limit_in_byte(0L),
-        memory_usage_in_byte(0L) {}
+        memory_usage_in_byte(0L),
+        io_read_bps(0L),
+        io_write_bps(0L),
+        io_read_iops(0L),
+        io_write_iops(0L) {}
 
     ~PodMetrix() {}
 
@@ -60,6 +101,15 @@ public:
                << "GALAXY_DISK" << path << "_USED:" << volums[i]->used_in_byte << "\n";
         }
 
+        ss << "GALAXY_IO_READ_BPS:" << io_read_bps << "\n"
+           << "GALAXY_IO_WRITE_BPS:" << io_write_bps << "\n"
+           << "GALAXY_IO_READ_IOPS:" << io_read_iops << "\n"
+           << "GALAXY_IO_WRITE_IOPS:" << io_write_iops << "\n";
+
+        cpu_pressure.ToString("GALAXY_CPU", ss);
+        memory_pressure.ToString("GALAXY_MEM", ss);
+        io_pressure.ToString("GALAXY_IO", ss);
+
         return ss.str();
     }
 
@@ -75,6 +125,17 @@ public:
     int64_t memory_limit_in_byte;
     int64_t memory_usage_in_byte;
 
+    // io of all disks
+    int64_t io_read_bps;
+    int64_t io_write_bps;
+    int64_t io_read_iops;
+    int64_t io_write_iops;
+
+    // psi
+    Pressure cpu_pressure;
+    Pressure memory_pressure;
+    Pressure io_pressure;
+
     // tcp throt
 
     // volum